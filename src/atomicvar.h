@@ -10,6 +10,9 @@
  * atomicSet(var,value)  -- Set the atomic counter value
  * atomicGetWithSync(var,value)  -- 'atomicGet' with inter-thread synchronization
  * atomicSetWithSync(var,value)  -- 'atomicSet' with inter-thread synchronization
+ * atomicCompareExchangeWithSync(var,expected_var,value,success_var) -- Set
+ *     var to value if var equals expected_var, otherwise load current value
+ *     into expected_var, success_var is set to 1 if var was set.
  *
  * Never use return value from the macros, instead use the AtomicGetIncr()
  * if you need to get the current value and increment it atomically, like
@@ -103,6 +106,10 @@
 } while(0)
 #define atomicSetWithSync(var,value) \
     atomic_store_explicit(&var,value,memory_order_seq_cst)
+#define atomicCompareExchangeWithSync(var,expected_var,value,success_var) do { \
+    success_var = atomic_compare_exchange_strong_explicit(&var,&expected_var, \
+            value,memory_order_seq_cst,memory_order_seq_cst); \
+} while(0)
 #define REDIS_ATOMIC_API "c11-builtin"
 
 #elif !defined(__ATOMIC_VAR_FORCE_SYNC_MACROS) && \
@@ -124,6 +131,10 @@
 } while(0)
 #define atomicSetWithSync(var,value) \
     __atomic_store_n(&var,value,__ATOMIC_SEQ_CST)
+#define atomicCompareExchangeWithSync(var,expected_var,value,success_var) do { \
+    success_var = __atomic_compare_exchange_n(&var,&expected_var,value,0, \
+            __ATOMIC_SEQ_CST,__ATOMIC_SEQ_CST); \
+} while(0)
 #define REDIS_ATOMIC_API "atomic-builtin"
 
 #elif defined(HAVE_ATOMIC)
@@ -149,6 +160,10 @@
     ANNOTATE_HAPPENS_BEFORE(&var);  \
     while(!__sync_bool_compare_and_swap(&var,var,value,__sync_synchronize)); \
 } while(0)
+#define atomicCompareExchangeWithSync(var,expected_var,value,success_var) do { \
+    success_var = __sync_bool_compare_and_swap(&var,expected_var,value); \
+    if (!success_var) expected_var = __sync_sub_and_fetch(&var,0); \
+} while(0)
 #define REDIS_ATOMIC_API "sync-builtin"
 
 #else
@@ -4420,6 +4420,38 @@ void clusterReplyMultiBulkSlots(client * c) {
     setDeferredArrayLen(c, slot_replylen, num_masters);
 }
 
+/* Cold keys of slot counted by swap thread (see SWAP_METASCAN_SLOT), keys
+ * also hot (kept in rocksdb by persist) are skipped there because they are
+ * already counted by slot index. */
+static long long countColdKeysInSlot(client *c) {
+    metaScanResult *metas = c->swap_metas;
+    long long count;
+
+    if (metas == NULL) return 0;
+    count = metas->count;
+    freeScanMetaResult(c->swap_metas);
+    c->swap_metas = NULL;
+    return count;
+}
+
+/* Cold keys of slot returned by swap thread, at most maxkeys minus hot keys
+ * of slot with hot ones skipped, so no more than maxkeys are replied. */
+static long long addReplyColdKeysInSlot(client *c, long long maxkeys) {
+    metaScanResult *metas = c->swap_metas;
+    long long count = 0;
+
+    if (metas == NULL) return 0;
+    for (int i = 0; i < metas->num && count < maxkeys; i++) {
+        sds key = metas->metas[i].key;
+        if (dictFind(c->db->dict,key) != NULL) continue;
+        addReplyBulkCBuffer(c,key,sdslen(key));
+        count++;
+    }
+    freeScanMetaResult(c->swap_metas);
+    c->swap_metas = NULL;
+    return count;
+}
+
 void clusterCommand(client *c) {
     if (server.cluster_enabled == 0) {
         addReplyError(c,"This instance has cluster support disabled");
@@ -4782,7 +4814,7 @@ NULL
             addReplyError(c,"Invalid slot");
             return;
         }
-        addReplyLongLong(c,countKeysInSlot(slot));
+        addReplyLongLong(c,countKeysInSlot(slot)+countColdKeysInSlot(c));
     } else if (!strcasecmp(c->argv[1]->ptr,"getkeysinslot") && c->argc == 4) {
         /* CLUSTER GETKEYSINSLOT <slot> <count> */
         long long maxkeys, slot;
@@ -4802,16 +4834,19 @@ NULL
         /* Avoid allocating more than needed in case of large COUNT argument
          * and smaller actual number of keys. */
         unsigned int keys_in_slot = countKeysInSlot(slot);
-        if (maxkeys > keys_in_slot) maxkeys = keys_in_slot;
+        long long hotkeys = maxkeys > keys_in_slot ? keys_in_slot : maxkeys;
+        void *replylen = addReplyDeferredLen(c);
 
-        keys = zmalloc(sizeof(robj*)*maxkeys);
-        numkeys = getKeysInSlot(slot, keys, maxkeys);
-        addReplyArrayLen(c,numkeys);
+        keys = zmalloc(sizeof(robj*)*hotkeys);
+        numkeys = getKeysInSlot(slot, keys, hotkeys);
         for (j = 0; j < numkeys; j++) {
             addReplyBulk(c,keys[j]);
             decrRefCount(keys[j]);
         }
         zfree(keys);
+        /* Fill up with cold keys scanned by swap thread. */
+        numkeys += addReplyColdKeysInSlot(c,maxkeys-numkeys);
+        setDeferredArrayLen(c,replylen,numkeys);
     } else if (!strcasecmp(c->argv[1]->ptr,"forget") && c->argc == 3) {
         /* CLUSTER FORGET <NODE ID> */
         clusterNode *n = clusterLookupNode(c->argv[2]->ptr);
@@ -5670,6 +5705,144 @@ socket_err:
     return;
 }
 
+/* SWAP.MIGRATESLOT host port slot count timeout
+ *
+ * Move at most count cold keys of slot to db of the same id in target by
+ * one SWAP.RESTORESLOT, raw kvs are read from rocksdb and written into
+ * rocksdb of target as is (see ctrip_swap_migrate.c). Hot keys of slot are
+ * not moved, they should be migrated by MIGRATE. Replies number of cold
+ * keys removed from slot (migrated or expired), 0 if there is no cold key
+ * left. Propagated as DEL of removed keys. */
+void swapMigrateSlotCommand(client *c) {
+    migrateCachedSocket *cs;
+    swapMigrateSlotBatch *batch;
+    long long slot, count, timeout;
+    sds payload = NULL, err = NULL;
+    int j, num_keys, may_retry = 1, write_error = 0;
+    robj **newargv;
+    rio cmd;
+
+    if (getLongLongFromObjectOrReply(c,c->argv[3],&slot,NULL) != C_OK ||
+        getLongLongFromObjectOrReply(c,c->argv[4],&count,NULL) != C_OK ||
+        getLongLongFromObjectOrReply(c,c->argv[5],&timeout,NULL) != C_OK)
+        return;
+    if (slot < 0 || slot >= CLUSTER_SLOTS || count <= 0 || count > INT_MAX) {
+        addReplyError(c,"Invalid slot or number of keys");
+        return;
+    }
+    if (timeout <= 0) timeout = 1000;
+    if (server.swap_key_encoding != SWAP_KEY_ENCODING_V3) {
+        addReplyError(c,"Slot migrate requires swap-key-encoding-version 3");
+        return;
+    }
+
+    if ((batch = swapMigrateSlotCollect(c->db,slot,count,&err)) == NULL) {
+        addReplyErrorSds(c,err);
+        return;
+    }
+    if (batch->num == 0) {
+        swapMigrateSlotBatchFree(batch);
+        addReplyLongLong(c,0);
+        return;
+    }
+
+    /* Expired keys are only deleted. */
+    payload = swapMigrateSlotEncodePayload(batch,&num_keys);
+    if (num_keys == 0) goto migrated;
+
+try_again:
+    write_error = 0;
+    cs = migrateGetSocket(c,c->argv[1],c->argv[2],timeout);
+    if (cs == NULL) goto cleanup; /* error sent by migrateGetSocket() */
+
+    rioInitWithBuffer(&cmd,sdsempty());
+    int select = cs->last_dbid != c->db->id;
+    if (select) {
+        serverAssertWithInfo(c,NULL,rioWriteBulkCount(&cmd,'*',2));
+        serverAssertWithInfo(c,NULL,rioWriteBulkString(&cmd,"SELECT",6));
+        serverAssertWithInfo(c,NULL,rioWriteBulkLongLong(&cmd,c->db->id));
+    }
+    serverAssertWithInfo(c,NULL,rioWriteBulkCount(&cmd,'*',3));
+    serverAssertWithInfo(c,NULL,rioWriteBulkString(&cmd,"SWAP.RESTORESLOT",16));
+    serverAssertWithInfo(c,NULL,rioWriteBulkLongLong(&cmd,slot));
+    serverAssertWithInfo(c,NULL,rioWriteBulkString(&cmd,payload,
+                sdslen(payload)));
+
+    /* Transfer the query to the other node in 64K chunks. */
+    errno = 0;
+    {
+        sds buf = cmd.io.buffer.ptr;
+        size_t pos = 0, towrite;
+        int nwritten = 0;
+
+        while ((towrite = sdslen(buf)-pos) > 0) {
+            towrite = (towrite > (64*1024) ? (64*1024) : towrite);
+            nwritten = connSyncWrite(cs->conn,buf+pos,towrite,timeout);
+            if (nwritten != (signed)towrite) {
+                write_error = 1;
+                goto socket_err;
+            }
+            pos += nwritten;
+        }
+    }
+    sdsfree(cmd.io.buffer.ptr);
+    cmd.io.buffer.ptr = NULL;
+
+    char buf1[1024]; /* Select reply. */
+    char buf2[1024]; /* Restore reply. */
+
+    /* Target may have restored keys once query sent, retry would be
+     * replied with BUSYKEY. */
+    may_retry = 0;
+    if ((select && connSyncReadLine(cs->conn,buf1,sizeof(buf1),timeout) <= 0) ||
+            connSyncReadLine(cs->conn,buf2,sizeof(buf2),timeout) <= 0)
+        goto socket_err;
+    if ((select && buf1[0] == '-') || buf2[0] == '-') {
+        cs->last_dbid = -1;
+        addReplyErrorFormat(c,"Target instance replied with error: %s",
+                (select && buf1[0] == '-') ? buf1+1 : buf2+1);
+        goto cleanup;
+    }
+    cs->last_dbid = c->db->id;
+
+migrated:
+    if (swapMigrateSlotDelete(c->db,batch,&err) != C_OK) {
+        serverLog(LL_WARNING,"[migrate] slot(%lld) migrated but %s",slot,err);
+        addReplyErrorSds(c,err);
+        goto cleanup;
+    }
+
+    /* Translate as DEL for replication/AOF, as MIGRATE does. */
+    newargv = zmalloc(sizeof(robj*)*(batch->num+1));
+    newargv[0] = createStringObject("DEL",3);
+    for (j = 0; j < batch->num; j++) {
+        sds key = batch->keys[j].key;
+        newargv[j+1] = createStringObject(key,sdslen(key));
+        signalModifiedKey(c,c->db,newargv[j+1]);
+        notifyKeyspaceEvent(NOTIFY_GENERIC,"del",newargv[j+1],c->db->id);
+        server.dirty++;
+    }
+    replaceClientCommandVector(c,batch->num+1,newargv);
+    addReplyLongLong(c,batch->num);
+    goto cleanup;
+
+socket_err:
+    if (cmd.io.buffer.ptr) sdsfree(cmd.io.buffer.ptr);
+    migrateCloseSocket(c->argv[1],c->argv[2]);
+    if (errno != ETIMEDOUT && may_retry) {
+        may_retry = 0;
+        goto try_again;
+    }
+    addReplySds(c,
+        sdscatprintf(sdsempty(),
+            "-IOERR error or timeout %s to target instance\r\n",
+            write_error ? "writing" : "reading"));
+
+cleanup:
+    sdsfree(payload);
+    swapMigrateSlotBatchFree(batch);
+}
+
 /* -----------------------------------------------------------------------------
  * Cluster functions related to serving / redirecting clients
  * -------------------------------------------------------------------------- */
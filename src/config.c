@@ -140,6 +140,12 @@ configEnum rocksdb_compression_enum[] = {
     {NULL, 0}
 };
 
+configEnum rocksdb_block_cache_type_enum[] = {
+    {"lru", ROCKSDB_BLOCK_CACHE_TYPE_LRU},
+    {"hyper_clock", ROCKSDB_BLOCK_CACHE_TYPE_HYPER_CLOCK},
+    {NULL, 0}
+};
+
 configEnum cuckoo_filter_bit_type_enum[] = {
     {"8", CUCKOO_FILTER_BITS_PER_TAG_8},
     {"12", CUCKOO_FILTER_BITS_PER_TAG_12},
@@ -2477,6 +2483,14 @@ static int updateSwapAbsentCacheCapacity(long long val, long long prev, const ch
     return 1;
 }
 
+static int updateSwapWarmTierMaxMemory(long long val, long long prev, const char **err) {
+    UNUSED(val);
+    UNUSED(prev);
+    UNUSED(err);
+    warmTiersTrim(NULL);
+    return 1;
+}
+
 static int updateRocksdbCFOption(int cf,char *key, char *val, const char**err) {
     rocks* rocks = serverRocksGetTryReadLock();
     if (rocks == NULL) {
@@ -2900,9 +2914,17 @@ standardConfig configs[] = {
     createBoolConfig("swap-bgsave-fix-metalen-mismatch", NULL, MODIFIABLE_CONFIG, server.swap_bgsave_fix_metalen_mismatch, 0, NULL, NULL),
     createBoolConfig("swap-dirty-subkeys-enabled", NULL, MODIFIABLE_CONFIG, server.swap_dirty_subkeys_enabled, 0, NULL, NULL),
     createBoolConfig("swap-persist-enabled", NULL, IMMUTABLE_CONFIG, server.swap_persist_enabled, 0, NULL, NULL),
+    createIntConfig("swap-key-encoding-version", NULL, IMMUTABLE_CONFIG, 1, 3, server.swap_key_encoding_version, 1, INTEGER_CONFIG, NULL, NULL),
     createBoolConfig("swap-repl-rordb-sync", NULL, MODIFIABLE_CONFIG, server.swap_repl_rordb_sync, 1, NULL, NULL),
+    createBoolConfig("swap-repl-rordb-delta-sync", NULL, MODIFIABLE_CONFIG, server.swap_repl_rordb_delta_sync, 0, NULL, NULL),
+    createBoolConfig("swap-rdb-load-ingest-enabled", NULL, MODIFIABLE_CONFIG, server.swap_rdb_load_ingest_enabled, 0, NULL, NULL),
     createBoolConfig("swap-rdb-bitmap-encode-enabled", NULL, MODIFIABLE_CONFIG, server.swap_rdb_bitmap_encode_enabled, 1, NULL, NULL),
     createBoolConfig("swap-bitmap-subkeys-enabled", NULL, MODIFIABLE_CONFIG, server.swap_bitmap_subkeys_enabled, 1, NULL, NULL),
+    createLongLongConfig("swap-async-complete-queue-budget-us", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_async_complete_queue_budget_us, ASYNC_COMPLETE_QUEUE_BUDGET_US_DEFAULT, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-pipeline-lookahead", NULL, MODIFIABLE_CONFIG, 0, 1024, server.swap_pipeline_lookahead, 16, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-threads-starvation-limit", NULL, MODIFIABLE_CONFIG, 1, INT_MAX, server.swap_threads_starvation_limit, SWAP_THREADS_STARVATION_LIMIT_DEFAULT, INTEGER_CONFIG, NULL, NULL),
+    createBoolConfig("swap-threads-work-stealing", NULL, MODIFIABLE_CONFIG, server.swap_threads_work_stealing, 1, NULL, NULL),
+    createBoolConfig("swap-rio-pinned-multiget", NULL, MODIFIABLE_CONFIG, server.swap_rio_pinned_multiget, 1, NULL, NULL),
     createBoolConfig("swap-ttl-compact-enabled", NULL, MODIFIABLE_CONFIG, server.swap_ttl_compact_enabled, 1, NULL, NULL),
     createBoolConfig("rocksdb.data.cache_index_and_filter_blocks", "rocksdb.cache_index_and_filter_blocks", IMMUTABLE_CONFIG, server.rocksdb_data_cache_index_and_filter_blocks, 0, NULL, NULL),
     createBoolConfig("rocksdb.meta.cache_index_and_filter_blocks", NULL, IMMUTABLE_CONFIG, server.rocksdb_meta_cache_index_and_filter_blocks, 0, NULL, NULL),
@@ -2911,6 +2933,13 @@ standardConfig configs[] = {
     createBoolConfig("rocksdb.meta.disable_auto_compactions", NULL, MODIFIABLE_CONFIG, server.rocksdb_meta_disable_auto_compactions, 0, NULL, updateRocksdbMetaDisableAutoCompactions),
     createBoolConfig("rocksdb.data.compaction_dynamic_level_bytes", "rocksdb.compaction_dynamic_level_bytes", IMMUTABLE_CONFIG, server.rocksdb_data_compaction_dynamic_level_bytes, 0, NULL, NULL),
     createBoolConfig("rocksdb.meta.compaction_dynamic_level_bytes", NULL, IMMUTABLE_CONFIG, server.rocksdb_meta_compaction_dynamic_level_bytes, 0, NULL, NULL),
+    createBoolConfig("rocksdb.data.prefix_extractor", NULL, IMMUTABLE_CONFIG, server.rocksdb_data_prefix_extractor, 1, NULL, NULL),
+    createBoolConfig("rocksdb.shared_block_cache", NULL, IMMUTABLE_CONFIG, server.rocksdb_shared_block_cache, 0, NULL, NULL),
+    createBoolConfig("swap-maxmemory-include-rocksdb", NULL, MODIFIABLE_CONFIG, server.swap_maxmemory_include_rocksdb, 0, NULL, NULL),
+    createBoolConfig("swap-evict-cost-aware", NULL, MODIFIABLE_CONFIG, server.swap_evict_cost_aware, 0, NULL, NULL),
+    createBoolConfig("swap-evict-subkey-clock", NULL, MODIFIABLE_CONFIG, server.swap_evict_subkey_clock, 0, NULL, NULL),
+    createBoolConfig("swap-pushdown-enabled", NULL, MODIFIABLE_CONFIG, server.swap_pushdown_enabled, 0, NULL, NULL),
+    createBoolConfig("swap-expire-index-enabled", NULL, IMMUTABLE_CONFIG, server.swap_expire_index_enabled, 0, NULL, NULL),
     createBoolConfig("rocksdb.data.enable_blob_files", "rocksdb.enable_blob_files", MODIFIABLE_CONFIG, server.rocksdb_data_enable_blob_files, 0, NULL, updateRocksdbDataEnableBlobFiles),
     createBoolConfig("rocksdb.meta.enable_blob_files", NULL, MODIFIABLE_CONFIG, server.rocksdb_meta_enable_blob_files, 0, NULL, updateRocksdbMetaEnableBlobFiles),
     createBoolConfig("rocksdb.data.enable_blob_garbage_collection", "rocksdb.enable_blob_garbage_collection", MODIFIABLE_CONFIG, server.rocksdb_data_enable_blob_garbage_collection, 1, NULL, updateRocksdbDataEnableBlobGarbageCollection),
@@ -2950,6 +2979,7 @@ standardConfig configs[] = {
     createEnumConfig("sanitize-dump-payload", NULL, MODIFIABLE_CONFIG, sanitize_dump_payload_enum, server.sanitize_dump_payload, SANITIZE_DUMP_NO, NULL, NULL),
     createEnumConfig("swap-mode", NULL, IMMUTABLE_CONFIG, swap_mode_enum, server.swap_mode, SWAP_MODE_MEMORY, isValidSwapMode, NULL),
     createEnumConfig("rocksdb.data.compression","rocksdb.compression", MODIFIABLE_CONFIG, rocksdb_compression_enum, server.rocksdb_data_compression, rocksdb_snappy_compression, NULL, updateRocksdbDataCompression),
+    createEnumConfig("rocksdb.block_cache_type", NULL, IMMUTABLE_CONFIG, rocksdb_block_cache_type_enum, server.rocksdb_block_cache_type, ROCKSDB_BLOCK_CACHE_TYPE_LRU, NULL, NULL),
     createEnumConfig("rocksdb.meta.compression", NULL, MODIFIABLE_CONFIG, rocksdb_compression_enum, server.rocksdb_meta_compression, rocksdb_snappy_compression, NULL, updateRocksdbMetaCompression),
     createEnumConfig("swap-cuckoo-filter-bit-per-key", NULL, IMMUTABLE_CONFIG, cuckoo_filter_bit_type_enum, server.swap_cuckoo_filter_bit_type, CUCKOO_FILTER_BITS_PER_TAG_8, NULL, NULL),
     createEnumConfig("swap-ratelimit-policy", NULL, MODIFIABLE_CONFIG, swap_ratelimit_policy_enum, server.swap_ratelimit_policy, SWAP_RATELIMIT_POLICY_PAUSE, NULL, NULL),
@@ -2995,7 +3025,9 @@ standardConfig configs[] = {
     createIntConfig("swap-debug-evict-keys", NULL, MODIFIABLE_CONFIG, -1, INT_MAX, server.swap_debug_evict_keys, 0, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("ps-parallism-rdb", NULL, MODIFIABLE_CONFIG, 4, 16384, server.ps_parallism_rdb, 32, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-evict-step-max-subkeys", NULL, MODIFIABLE_CONFIG, 0, 65536, server.swap_evict_step_max_subkeys, 1024, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-pushdown-promote-hits", NULL, MODIFIABLE_CONFIG, 0, INT_MAX, server.swap_pushdown_promote_hits, 16, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-debug-rio-delay-micro", NULL, MODIFIABLE_CONFIG, -1, INT_MAX, server.swap_debug_rio_delay_micro, 0, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-debug-dispatch-thread", NULL, MODIFIABLE_CONFIG, -1, 63, server.swap_debug_dispatch_thread, -1, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-threads", NULL, IMMUTABLE_CONFIG, 4, 64, server.swap_threads_num, 4, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("jemalloc-max-bg-threads", NULL, IMMUTABLE_CONFIG, 4, 16, server.jemalloc_max_bg_threads, 4, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-debug-swapout-notify-delay-micro", NULL, MODIFIABLE_CONFIG, -1, INT_MAX, server.swap_debug_swapout_notify_delay_micro, 0, INTEGER_CONFIG, NULL, NULL),
@@ -3012,7 +3044,9 @@ standardConfig configs[] = {
     createIntConfig("swap-ratelimit-maxmemory-pause-growth-rate", NULL, MODIFIABLE_CONFIG, 1, INT_MAX, server.swap_ratelimit_maxmemory_pause_growth_rate, 20*1024*1024, MEMORY_CONFIG, NULL, NULL),
     createIntConfig("swap-scan-session-bits", NULL, IMMUTABLE_CONFIG, 1, 16, server.swap_scan_session_bits, 7, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-scan-session-max-idle-seconds", NULL, MODIFIABLE_CONFIG, 1, INT_MAX, server.swap_scan_session_max_idle_seconds, 60, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-keys-cold-limit", NULL, MODIFIABLE_CONFIG, 1, INT_MAX, server.swap_keys_cold_limit, 100000, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-compaction-filter-skip-level", NULL, MODIFIABLE_CONFIG, -1, INT_MAX, server.swap_compaction_filter_skip_level, 0, INTEGER_CONFIG, NULL, NULL),
+    createIntConfig("swap-compaction-filter-meta-readahead", NULL, MODIFIABLE_CONFIG, 0, 4096, server.swap_compaction_filter_meta_readahead, 64, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-ratelimit-persist-lag", NULL, MODIFIABLE_CONFIG, 1, INT_MAX, server.swap_ratelimit_persist_lag, 60, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-ratelimit-persist-pause-growth-rate", NULL, MODIFIABLE_CONFIG, 1, INT_MAX, server.swap_ratelimit_persist_pause_growth_rate, 10, INTEGER_CONFIG, NULL, NULL),
     createIntConfig("swap-persist-lag-millis", NULL, MODIFIABLE_CONFIG, 0, INT_MAX, server.swap_persist_lag_millis, 0, INTEGER_CONFIG, NULL, NULL),
@@ -3043,6 +3077,7 @@ standardConfig configs[] = {
     /* Unsigned int configs */
     createUIntConfig("maxclients", NULL, MODIFIABLE_CONFIG, 1, UINT_MAX, server.maxclients, 10000, INTEGER_CONFIG, NULL, updateMaxclients),
     createUIntConfig("swap-ttl-compact-expire-percentile", NULL, MODIFIABLE_CONFIG, 1, 100, server.swap_ttl_compact_expire_percentile, 99, INTEGER_CONFIG, NULL, NULL),
+    createUIntConfig("swap-ttl-compact-expired-percentage", NULL, MODIFIABLE_CONFIG, 0, 100, server.swap_ttl_compact_expired_percentage, 0, INTEGER_CONFIG, NULL, NULL),
 
     /* Unsigned Long configs */
     createULongConfig("active-defrag-max-scan-fields", NULL, MODIFIABLE_CONFIG, 1, LONG_MAX, server.active_defrag_max_scan_fields, 1000, INTEGER_CONFIG, NULL, NULL), /* Default: keys with more than 1000 fields will be processed separately */
@@ -3065,11 +3100,14 @@ standardConfig configs[] = {
     createULongLongConfig("swap-evict-step-max-memory", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_evict_step_max_memory, 1*1024*1024, MEMORY_CONFIG, NULL, NULL), /* Default: 1mb */
     createULongLongConfig("swap-repl-max-rocksdb-read-bps", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_repl_max_rocksdb_read_bps, 0, MEMORY_CONFIG, NULL, NULL), /* Default: unlimited */
     createULongLongConfig("swap-cuckoo-filter-estimated-keys", NULL, IMMUTABLE_CONFIG, 1, LLONG_MAX, server.swap_cuckoo_filter_estimated_keys, 32000000, INTEGER_CONFIG, NULL, NULL), /* Default: 32M */
+    createULongLongConfig("swap-subkey-filter-min-subkeys", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_subkey_filter_min_subkeys, 0, INTEGER_CONFIG, NULL, NULL), /* Default: disabled */
+    createULongLongConfig("swap-warm-tier-max-memory", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_warm_tier_max_memory, 0, MEMORY_CONFIG, NULL, updateSwapWarmTierMaxMemory), /* Default: disabled */
     createULongLongConfig("swap-absent-cache-capacity", NULL, MODIFIABLE_CONFIG, 1, LLONG_MAX, server.swap_absent_cache_capacity, 64*1024, INTEGER_CONFIG, NULL, updateSwapAbsentCacheCapacity), /* Default: 64k */
     createULongLongConfig("swap-compaction-filter-disable-until", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_compaction_filter_disable_until, 0, INTEGER_CONFIG, NULL, NULL),
     createULongLongConfig("swap-flush-meta-deletes-num", NULL, MODIFIABLE_CONFIG, 1, LLONG_MAX, server.swap_flush_meta_deletes_num, 200000, INTEGER_CONFIG, NULL, NULL),
     createULongLongConfig("rocksdb.data.block_cache_size", "rocksdb.block_cache_size", IMMUTABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_data_block_cache_size, 8*1024*1024, MEMORY_CONFIG, NULL, NULL),
     createULongLongConfig("rocksdb.meta.block_cache_size", NULL, IMMUTABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_meta_block_cache_size, 512*1024*1024, MEMORY_CONFIG, NULL, NULL),
+    createULongLongConfig("rocksdb.write_buffer_manager_size", NULL, IMMUTABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_write_buffer_manager_size, 0, MEMORY_CONFIG, NULL, NULL),
     createULongLongConfig("rocksdb.data.write_buffer_size", "rocksdb.write_buffer_size", MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_data_write_buffer_size, 64*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbDataWriteBufferSize),
     createULongLongConfig("rocksdb.meta.write_buffer_size", NULL, MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_meta_write_buffer_size, 64*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbMetaWriteBufferSize),
     createULongLongConfig("rocksdb.data.target_file_size_base", "rocksdb.target_file_size_base", MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_data_target_file_size_base, 32*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbDataTargetFileSizeBase),
@@ -3092,6 +3130,7 @@ standardConfig configs[] = {
     createULongLongConfig("rocksdb.meta.min_blob_size", NULL, MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_meta_min_blob_size, 4096, MEMORY_CONFIG, NULL, updateRocksdbMetaMinBlobSize),
     createULongLongConfig("rocksdb.data.blob_file_size", "rocksdb.blob_file_size", MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_data_blob_file_size, 256*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbDataBlobFileSize),
     createULongLongConfig("rocksdb.meta.blob_file_size", NULL, MODIFIABLE_CONFIG, 0, ULLONG_MAX, server.rocksdb_meta_blob_file_size, 256*1024*1024, MEMORY_CONFIG, NULL, updateRocksdbMetaBlobFileSize),
+    createULongLongConfig("swap-rdb-load-ingest-run-size", NULL, MODIFIABLE_CONFIG, 1024*1024, LLONG_MAX, server.swap_rdb_load_ingest_run_size, 256*1024*1024, MEMORY_CONFIG, NULL, NULL),
     createULongLongConfig("swap-repl-rordb-max-write-bps", NULL, MODIFIABLE_CONFIG, 0, LLONG_MAX, server.swap_repl_rordb_max_write_bps, 200*1024*1024, MEMORY_CONFIG, NULL, NULL),
     createULongLongConfig("swap-ttl-compact-period", NULL, MODIFIABLE_CONFIG, 1, 3600*24, server.swap_ttl_compact_period, 60, INTEGER_CONFIG, NULL, NULL),
     createULongLongConfig("swap-sst-age-limit-refresh-period", NULL, MODIFIABLE_CONFIG, 1, 3600*24, server.swap_sst_age_limit_refresh_period, 60, INTEGER_CONFIG, NULL, NULL),
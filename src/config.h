@@ -89,6 +89,11 @@
 #define HAVE_EPOLL 1
 #endif
 
+/* Test for eventfd */
+#ifdef __linux__
+#define HAVE_EVENTFD 1
+#endif
+
 #if (defined(__APPLE__) && defined(MAC_OS_10_6_DETECTED)) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined (__NetBSD__)
 #define HAVE_KQUEUE 1
 #endif
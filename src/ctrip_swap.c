@@ -182,6 +182,9 @@ swapCtx *swapCtxCreate(client *c, keyRequest *key_request,
     swapDebugMsgsInit(&ctx->msgs, identity);
 #endif
     ctx->pd = pd;
+    ctx->pushdown_allowed = 0;
+    ctx->warm_tier_missed = 0;
+    ctx->pushdown = NULL;
     return ctx;
 }
 
@@ -201,6 +204,10 @@ void swapCtxFree(swapCtx *ctx) {
         swapDataFree(ctx->data,ctx->datactx);
         ctx->data = NULL;
     }
+    if (ctx->pushdown) {
+        swapPushdownFree(ctx->pushdown);
+        ctx->pushdown = NULL;
+    }
     zfree(ctx);
 }
 
@@ -223,6 +230,14 @@ void replySwapFailed(client *c) {
         rejectCommandFormat(c,
                 "Swap failed: cursor not match (restart scan with cursor 0 when failed)");
         break;
+    case SWAP_ERR_METASCAN_SLOT_UNSUPPORTED:
+        rejectCommandFormat(c,
+                "Swap failed: cold keys of slot only listed with swap-key-encoding-version 3.");
+        break;
+    case SWAP_ERR_METASCAN_KEYS_TRUNCATED:
+        rejectCommandFormat(c,
+                "Swap failed: cold keys matched exceed swap-keys-cold-limit, use SCAN instead.");
+        break;
     case SWAP_ERR_DATA_WRONG_TYPE_ERROR:
         addReplyErrorObject(c,shared.wrongtypeerr);
         break;
@@ -239,8 +254,11 @@ void continueProcessCommand(client *c) {
 	if (c->swap_errcode) {
         replySwapFailed(c);
         c->swap_errcode = 0;
+        swapPushdownAfterCall(c);
     } else {
+        swapPushdownBeforeCall(c);
 		call(c,CMD_CALL_FULL);
+        swapPushdownAfterCall(c);
 		/* post call */
 		c->woff = server.master_repl_offset;
 		if (listLength(server.ready_keys))
@@ -278,6 +296,11 @@ void normalClientKeyRequestFinished(client *c, swapCtx *ctx) {
     swapCmdSwapFinished(ctx->key_request->swap_cmd);
     if (ctx->errcode) clientSwapError(c,ctx->errcode);
     keyRequestBeforeCall(c,ctx);
+    if (ctx->pushdown) {
+        serverAssert(c->swap_pushdown == NULL);
+        c->swap_pushdown = ctx->pushdown;
+        ctx->pushdown = NULL;
+    }
     if (c->keyrequests_count == 0) {
         continueProcessCommand(c);
     }
@@ -368,11 +391,22 @@ void keyRequestProceed(void *lock, int flush, redisDb *db, robj *key,
     }
 
     value = lookupKey(db,key,LOOKUP_NOTOUCH);
+    if (value == NULL) {
+        /* restored from warm tier, proceed as hot key without rio. */
+        value = warmTierRestoreKey(db,key,cmd_intention,cmd_intention_flags);
+    }
     dirty_subkeys = lookupDirtySubkeys(db,key);
 
     data = createSwapData(db,key,value,dirty_subkeys);
     swapCtxSetSwapData(ctx,data,datactx);
 
+    /* all subkeys filtered leaves cold key cold (no swap), which is fine
+     * only if command won't write. */
+    if (value != NULL || (ctx->key_request->cmd_flags & CMD_READONLY)) {
+        data->subkey_filter = coldFilterLookupSubkeyFilter(db->cold_filter,
+                key->ptr);
+    }
+
     if (isSwapHitStatKeyRequest(ctx->key_request)) {
         atomicIncr(server.swap_hit_stats->stat_swapin_attempt_count,1);
     }
@@ -399,6 +433,11 @@ void keyRequestProceed(void *lock, int flush, redisDb *db, robj *key,
                 reason_num = NOSWAP_REASON_FILT_BY_ABSENTCACHE;
             goto noswap;
         } else {
+            /* type of cold key not known yet, miss is counted after meta
+             * swapped in, and only if tier could have held the key. */
+            if (db->cold_filter->warm && isSwapHitStatKeyRequest(ctx->key_request))
+                ctx->warm_tier_missed = 1;
+            ctx->pushdown_allowed = keyRequestPushdownAllowed(c,ctx);
             req = swapMetaRequestNew(ctx->key_request,
                     ctx,data,datactx,ctx->key_request->trace,
                     keyRequestSwapFinished,ctx,msgs);
@@ -588,6 +627,7 @@ int dbSwap(client *c) {
          * 2. client will not reset
          * 3. client will break out process loop. */
         if (c->keyrequests_count) c->flags |= CLIENT_SWAPPING;
+        swapPrefetchPipelinedCommands(c);
         return C_ERR;
     } else if (keyrequests_submit < 0) {
         /* Swapping command parsed and dispatched, return C_OK so that:
@@ -622,6 +662,7 @@ void swapInit() {
         c->cmd = lookupCommandByCString("SWAP.EVICT");
         c->db = server.db+i;
         c->client_hold_mode = CLIENT_HOLD_MODE_EVICT;
+        c->swap_priority = SWAP_PRIORITY_LOW;
         server.evict_clients[i] = c;
     }
 
@@ -672,6 +713,7 @@ void swapInit() {
     for (i = 0; i < server.repl_workers; i++) {
         client *c = createClient(NULL);
         c->client_hold_mode = CLIENT_HOLD_MODE_REPL;
+        c->swap_priority = SWAP_PRIORITY_NORMAL;
         listAddNodeTail(server.repl_worker_clients_free, c);
     }
 
@@ -696,6 +738,9 @@ void swapInit() {
         server.swap_persist_ctx = NULL;
     
     server.swap_ttl_compact_ctx = swapTtlCompactCtxNew();
+
+    server.swap_prefetch_ctx = swapPrefetchCtxNew();
+    server.swap_subkey_clocks = subkeyClocksNew();
 }
 
 
@@ -787,8 +832,13 @@ int swapTest(int argc, char **argv, int accurate) {
   result += roaringBitmapTest(argc, argv, accurate);
   result += swapRordbTest(argc, argv, accurate);
   result += swapDataBitmapTest(argc, argv, accurate);
+  result += swapDataModuleTest(argc, argv, accurate);
   result += wtdigestTest(argc, argv, accurate);
   result += swapReplTest(argc, argv, accurate);
+  result += swapThreadTest(argc, argv, accurate);
+  result += swapSubkeyClockTest(argc, argv, accurate);
+  result += swapWarmTierTest(argc, argv, accurate);
+  result += swapMigrateSlotTest(argc, argv, accurate);
   return result;
 }
 #endif
@@ -45,11 +45,13 @@
 #define DATA_CF 0
 #define META_CF 1
 #define SCORE_CF 2
-#define CF_COUNT 3
+#define EXPIRE_CF 3
+#define CF_COUNT 4
 
 #define data_cf_name "default"
 #define meta_cf_name "meta"
 #define score_cf_name "score"
+#define expire_cf_name "expire"
 extern const char *swap_cf_names[CF_COUNT];
 #define rocksdb_stats_section "rocksdb.stats"
 #define rocksdb_stats_section_len 13
@@ -82,6 +84,12 @@ extern const char *swap_cf_names[CF_COUNT];
 #define SWAP_OUT_PERSIST (1U<<10)
 /* Keep data in memory because memory is sufficient. */
 #define SWAP_OUT_KEEP_DATA (1U<<11)
+/* This is a metascan request for keys command. */
+#define SWAP_METASCAN_KEYS (1U<<12)
+/* This is a metascan request for cluster countkeysinslot/getkeysinslot. */
+#define SWAP_METASCAN_SLOT (1U<<13)
+/* Read-only command could be served by pushdown if key is cold. */
+#define SWAP_IN_PUSHDOWN (1U<<14)
 
 /* --- swap intention flags --- */
 /* Delete rocksdb data key when swap in */
@@ -94,6 +102,8 @@ extern const char *swap_cf_names[CF_COUNT];
 #define SWAP_FIN_DEL_SKIP (1U<<3)
 /* Reserve data when swap out. */
 #define SWAP_EXEC_OUT_KEEP_DATA (1U<<4)
+/* Swapped in object serves current command only, keyspace untouched. */
+#define SWAP_EXEC_IN_PUSHDOWN (1U<<5)
 
 
 #define SWAP_UNSET -1
@@ -113,7 +123,14 @@ extern const char *swap_cf_names[CF_COUNT];
 #define SWAP_TYPE_ZSET      OBJ_ZSET
 #define SWAP_TYPE_HASH      OBJ_HASH
 #define SWAP_TYPE_STREAM    OBJ_STREAM
+#define SWAP_TYPE_MODULE    OBJ_MODULE
 #define SWAP_TYPE_BITMAP    OBJ_BITMAP
+#define SWAP_TYPE_COUNT     (SWAP_TYPE_BITMAP+1)
+
+/* Types swapped as a single data CF value with SWAP_VERSION_ZERO. */
+static inline int swapTypeIsWholeKey(int swap_type) {
+    return swap_type == SWAP_TYPE_STRING || swap_type == SWAP_TYPE_MODULE;
+}
 
 static inline const char *swapIntentionName(int intention) {
   const char *name = "?";
@@ -135,7 +152,9 @@ static inline int getSwapIntentionByName(char *name) {
 static inline int isMetaScanRequest(uint32_t intention_flag) {
     return (intention_flag & SWAP_METASCAN_SCAN) ||
            (intention_flag & SWAP_METASCAN_RANDOMKEY) ||
-           (intention_flag & SWAP_METASCAN_EXPIRE);
+           (intention_flag & SWAP_METASCAN_EXPIRE) ||
+           (intention_flag & SWAP_METASCAN_KEYS) ||
+           (intention_flag & SWAP_METASCAN_SLOT);
 }
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
@@ -231,10 +250,13 @@ void copyKeyRequest(keyRequest *dst, keyRequest *src);
 void moveKeyRequest(keyRequest *dst, keyRequest *src);
 void keyRequestDeinit(keyRequest *key_request);
 void getKeyRequests(client *c, struct getKeyRequestsResult *result);
+void getCommandKeyRequests(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 void releaseKeyRequests(struct getKeyRequestsResult *result);
 int getKeyRequestsNone(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsGlobal(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsDb(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsMetaScan(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsCluster(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 
 int getKeyRequestsSort(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 
@@ -288,6 +310,7 @@ int getKeyRequestsZremRangeByScore1(int dbid, struct redisCommand *cmd, robj **a
 int getKeyRequestsZrevrangeByLex(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZrangeByLex(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZremRangeByLex(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
+int getKeyRequestsZcount(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 int getKeyRequestsZlexCount(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result);
 
 #define getKeyRequestsSdiffstore getKeyRequestsSinterstore
@@ -402,6 +425,28 @@ void swapPersistCtxAddKey(swapPersistCtx *ctx, redisDb *db, robj *key);
 void swapPersistCtxPersistKeys(swapPersistCtx *ctx);
 sds genSwapPersistInfoString(sds info);
 void swapPersistKeyRequestFinished(swapPersistCtx *ctx, int dbid, robj *key, uint64_t persist_version);
+
+/* Pipeline lookahead prefetch */
+#define SWAP_PREFETCH_MAX_ARGC 4096
+#define SWAP_PREFETCH_INPROGRESS_LIMIT 4096
+
+typedef struct swapPrefetchStat {
+  long long cmd_count; /* commands that submitted prefetch */
+  long long key_count; /* key requests prefetched */
+  long long error_count;
+} swapPrefetchStat;
+
+typedef struct swapPrefetchCtx {
+  client **clients; /* prefetch clients, one for each db */
+  long long inprogress_count;
+  swapPrefetchStat stat;
+} swapPrefetchCtx;
+
+swapPrefetchCtx *swapPrefetchCtxNew(void);
+void swapPrefetchCtxFree(swapPrefetchCtx *ctx);
+void swapPrefetchPipelinedCommands(client *c);
+sds genSwapPrefetchInfoString(sds info);
+void resetSwapPrefetchStats(void);
 void loadDataFromDisk(void);
 void ctripLoadDataFromDisk(void);
 int submitEvictClientRequest(client *c, robj *key, int persist_keep, uint64_t persist_version);
@@ -530,6 +575,7 @@ typedef struct objectMeta {
 extern objectMetaType lenObjectMetaType;
 extern objectMetaType listObjectMetaType;
 extern objectMetaType bitmapObjectMetaType;
+extern objectMetaType wholekeyObjectMetaType;
 
 static inline void swapInitVersion(void) { server.swap_key_version = 1; }
 static inline void swapSetVersion(uint64_t version) { server.swap_key_version = version; }
@@ -634,8 +680,10 @@ typedef struct swapData {
   unsigned set_persist_keep:1;
   unsigned reserved:27;
   sds nextseek; /* own, moved from exec */
+  long long iterate_count; /* keys counted by ROCKS_ITERATE_COUNT_ONLY, set by exec */
   swapDataAbsentSubkey *absent;
   robj *dirty_subkeys;
+  struct subkeyFilter *subkey_filter; /* ref, bound while key locked */
   void *extends[2];
 } swapData;
 
@@ -649,6 +697,8 @@ typedef struct swapDataType {
   int (*swapAnaAction)(struct swapData *data, int intention, void *datactx, OUT int *action);
   int (*encodeKeys)(struct swapData *data, int intention, void *datactx, OUT int *num, OUT int **cfs, OUT sds **rawkeys);
   int (*encodeRange)(struct swapData *data, int intention, void *datactx, OUT int *limit, OUT uint32_t *flags, OUT int *cf, OUT sds *start, OUT sds *end);
+  void (*encodeRangeExcludes)(struct swapData *data, void *datactx, OUT sds **excludes, OUT int *num);
+  sds (*encodeRangeMatch)(struct swapData *data, void *datactx);
   int (*encodeData)(struct swapData *data, int intention, void *datactx, OUT int *num, OUT int **cfs, OUT sds **rawkeys, OUT sds **rawvals);
   int (*decodeData)(struct swapData *data, int num, int *cfs, sds *rawkeys, sds *rawvals, OUT void **decoded);
   int (*swapIn)(struct swapData *data, MOVE void *result, void *datactx);
@@ -670,10 +720,13 @@ void swapDataMarkPropagateExpire(swapData *data);
 int swapDataAna(swapData *d, int thd, struct keyRequest *key_request, int *intention, uint32_t *intention_flag, void *datactx);
 int swapDataSwapAnaAction(swapData *data, int intention, void *datactx_, int *action);
 sds swapDataEncodeMetaKey(swapData *d);
+sds swapDataEncodeExpireIndexKey(swapData *d);
 sds swapDataEncodeMetaVal(swapData *d, void *datactx);
 int swapDataEncodeKeys(swapData *d, int intention, void *datactx, int *num, int **cfs, sds **rawkeys);
 int swapDataEncodeData(swapData *d, int intention, void *datactx, int *num, int **cfs, sds **rawkeys, sds **rawvals);
 int swapDataEncodeRange(struct swapData *data, int intention, void *datactx_, int *limit, uint32_t *flags, int *pcf, sds *start, sds *end);
+void swapDataEncodeRangeExcludes(struct swapData *data, void *datactx_, sds **excludes, int *num);
+sds swapDataEncodeRangeMatch(struct swapData *data, void *datactx_);
 int swapDataDecodeAndSetupMeta(swapData *d, sds rawval, OUT void **datactx);
 int swapDataDecodeData(swapData *d, int num, int *cfs, sds *rawkeys, sds *rawvals, void **decoded);
 int swapDataSwapIn(swapData *d, void *result, void *datactx);
@@ -689,6 +742,7 @@ int swapDataMergedIsHot(swapData *d, void *result, void *datactx);
 void swapDataRetainAbsentSubkeys(swapData *data, int num, int *cfs, sds *rawkeys, sds *rawvals);
 void swapDataMergeAbsentSubkey(swapData *data);
 int swapDataMayContainSubkey(swapData *data, int thd, robj *subkey);
+void swapDataSubkeysSwappedOut(swapData *data, robj **subkeys, int num, size_t nsubkeys);
 void *swapDataGetObjectMetaAux(swapData *data, void *datactx);
 
 static inline void swapDataSetObjectMeta(swapData *d, objectMeta *object_meta) {
@@ -819,6 +873,8 @@ void swapDebugMsgsDump(swapDebugMsgs *msgs);
 #define SWAP_ERR_METASCAN_SESSION_UNASSIGNED -402
 #define SWAP_ERR_METASCAN_SESSION_INPROGRESS -403
 #define SWAP_ERR_METASCAN_SESSION_SEQUNMATCH -404
+#define SWAP_ERR_METASCAN_SLOT_UNSUPPORTED -405
+#define SWAP_ERR_METASCAN_KEYS_TRUNCATED -406
 #define SWAP_ERR_RIO_FAIL -500
 #define SWAP_ERR_RIO_GET_FAIL -501
 #define SWAP_ERR_RIO_PUT_FAIL -502
@@ -842,6 +898,9 @@ typedef struct swapCtx {
   swapDebugMsgs msgs;
 #endif
   void *pd;
+  int pushdown_allowed;
+  struct swapPushdown *pushdown;
+  int warm_tier_missed; /* miss counted once type known (string only) */
 } swapCtx;
 
 swapCtx *swapCtxCreate(client *c, keyRequest *key_request, clientKeyRequestFinished finished, void* pd);
@@ -903,6 +962,19 @@ typedef struct wholeKeySwapData {
 } wholeKeySwapData;
 
 int swapDataSetupWholeKey(swapData *d, OUT void **datactx);
+robj *dupSharedObject(robj *o);
+int wholeKeySwapAna(swapData *data, int thd, struct keyRequest *req, int *intention, uint32_t *intention_flags, void *datactx);
+int wholeKeySwapAnaAction(swapData *data, int intention, void *datactx, int *action);
+int wholeKeyEncodeKeys(swapData *data, int intention, void *datactx, int *numkeys, int **pcfs, sds **prawkeys);
+int wholeKeyEncodeData(swapData *data, int intention, void *datactx, int *numkeys, int **pcfs, sds **prawkeys, sds **prawvals);
+int wholeKeyDecodeData(swapData *data, int num, int *cfs, sds *rawkeys, sds *rawvals, void **pdecoded);
+int wholeKeySwapIn(swapData *data, MOVE void *result, void *datactx);
+int wholeKeySwapOut(swapData *data, void *datactx, int keep_data, int *totally_out);
+int wholeKeySwapDel(swapData *data, void *datactx, int async);
+void *wholeKeyCreateOrMergeObject(swapData *data, void *decoded, void *datactx);
+
+/* Module */
+int swapDataSetupModule(swapData *d, OUT void **datactx);
 
 /* Set */
 typedef struct setSwapData {
@@ -1029,6 +1101,8 @@ typedef struct metaScanResult {
   int num;
   int size;
   sds nextseek;
+  int filtered; /* MATCH/TYPE already applied in swap thread */
+  long long count; /* metas counted (not returned) if count_only */
 } metaScanResult;
 
 metaScanResult *metaScanResultCreate(void);
@@ -1045,7 +1119,7 @@ struct metaScanDataCtx;
 
 typedef struct metaScanDataCtxType {
     void (*swapAna)(struct metaScanDataCtx *datactx, int *intention, uint32_t *intention_flags);
-    void (*swapIn)(struct metaScanDataCtx *datactx, metaScanResult *result);
+    int (*swapIn)(struct metaScanDataCtx *datactx, metaScanResult *result);
     void (*freeExtend)(struct metaScanDataCtx *datactx);
 } metaScanDataCtxType;
 
@@ -1055,9 +1129,22 @@ typedef struct metaScanDataCtx {
     int limit;
     sds seek;
     void *extend;
+    /* MATCH/TYPE filters pushed down to swap thread (NULL if none), limit
+     * is then the scanned budget and count the max metas returned. */
+    sds pattern;
+    sds typename;
+    sds prefix; /* literal prefix of pattern, used as iterate range */
+    int count;
+    int db_bounded; /* iterate only meta keys of current db */
+    int slot; /* cluster slot filter, -1 if none */
+    int expire_index; /* iterate expire index instead of metas */
+    int count_only; /* metas counted by swap thread, not returned */
+    sds *excludes; /* sorted meta rawkeys of hot keys, skipped by iterate */
+    int numexcludes;
 } metaScanDataCtx;
 
 int swapDataSetupMetaScan(swapData *d, uint32_t intention_flags, client *c, OUT void **datactx);
+sds *swapSlotHotMetaKeys(redisDb *db, int slot, unsigned int hotkeys, OUT int *num);
 
 robj *metaScanResultRandomKey(redisDb *db, metaScanResult *result);
 
@@ -1093,6 +1180,7 @@ void scanExpireEmpty(scanExpire *scan_expire);
 
 void swapScanexpireCommand(client *c);
 int scanExpireDbCycle(redisDb *db, int type, long long timelimit);
+int expireIndexDecodeData(redisDb *db, int num, sds *rawkeys, MOVE sds nextseek, void **pdecoded);
 sds genSwapScanExpireInfoString(sds info);
 
 void expireSlaveKeysSwapMode(void);
@@ -1220,12 +1308,47 @@ void swapRequestUpdateStatsExecuted(swapRequest *req);
 void swapRequestUpdateStatsCallback(swapRequest *req);
 void swapRequestMerge(swapRequest *req);
 
+/* Pushdown */
+typedef struct swapPushdown {
+  redisDb *db;
+  robj *key;
+  robj *value; /* NULL if nothing swapped in or linked into keyspace. */
+  long long expire;
+  int linked;
+} swapPushdown;
+
+swapPushdown *swapPushdownNew(redisDb *db, robj *key, MOVE robj *value, long long expire);
+void swapPushdownFree(swapPushdown *pushdown);
+int keyRequestPushdownAllowed(client *c, swapCtx *ctx);
+int swapRequestCanPushdown(swapRequest *req, int intention, uint32_t intention_flags);
+void swapRequestPushdown(swapRequest *req);
+void swapPushdownBeforeCall(client *c);
+void swapPushdownAfterCall(client *c);
+
 
 #define SWAP_BATCH_DEFAULT_SIZE 16
 #define SWAP_BATCH_LINEAR_SIZE  4096
 
 typedef void (*swapRequestBatchNotifyCallback)(struct swapRequestBatch *req, void *pd);
 
+/* Swap threads serve higher priority (lower value) batches first. */
+#define SWAP_PRIORITY_HIGH      0 /* foreground & internal client requests */
+#define SWAP_PRIORITY_NORMAL    1 /* replication, loading & util tasks */
+#define SWAP_PRIORITY_LOW       2 /* evict, persist & compaction */
+#define SWAP_PRIORITY_COUNT     3
+
+#define SWAP_THREADS_STARVATION_LIMIT_DEFAULT 8
+
+static inline const char *swapPriorityName(int prio) {
+    const char *name = "?";
+    const char *names[] = {"high", "normal", "low"};
+    if (prio >= 0 && (size_t)prio < sizeof(names)/sizeof(char*))
+        name = names[prio];
+    return name;
+}
+
+int swapRequestPriority(swapRequest *req);
+
 typedef struct swapRequestBatch {
   swapRequest *req_buf[SWAP_BATCH_DEFAULT_SIZE];
   swapRequest **reqs;
@@ -1235,6 +1358,9 @@ typedef struct swapRequestBatch {
   void *notify_pd;
   monotime notify_queue_timer;
   monotime swap_queue_timer;
+  monotime dispatch_timer;
+  int priority;
+  struct swapRequestBatch *cq_next; /* link in async complete queue */
 } swapRequestBatch;
 
 swapRequestBatch *swapRequestBatchNew(void);
@@ -1297,19 +1423,59 @@ void swapExecBatchCtxFeed(swapExecBatch *exec_ctx, swapRequest *req);
 #define SWAP_THREADS_DEFAULT     4
 #define SWAP_THREADS_MAX         64
 
+#define SWAP_THREAD_RING_SIZE    1024 /* must be power of 2 */
+#define SWAP_CACHELINE_SIZE      64
+
+typedef struct swapRingCell {
+    redisAtomic size_t seq;
+    void *data;
+} swapRingCell;
+
+/* Bounded lock-free ring (Vyukov MPMC queue): main thread pushes, owner
+ * thread and stealing threads pop. */
+typedef struct swapRing {
+    swapRingCell *cells;
+    size_t mask;
+    char pad0[SWAP_CACHELINE_SIZE];
+    redisAtomic size_t enqueue_pos;
+    char pad1[SWAP_CACHELINE_SIZE];
+    redisAtomic size_t dequeue_pos;
+    char pad2[SWAP_CACHELINE_SIZE];
+} swapRing;
+
+void swapRingInit(swapRing *ring, size_t size);
+void swapRingDeinit(swapRing *ring);
+int swapRingPush(swapRing *ring, void *data);
+void *swapRingPop(swapRing *ring);
+size_t swapRingLength(swapRing *ring);
+
+typedef struct swapThreadPriorityStat {
+    redisAtomic long long count; /* batches popped */
+    redisAtomic long long wait_us; /* total wait time in queue */
+    redisAtomic long long starvation_count; /* popped by starvation protection */
+} swapThreadPriorityStat;
+
 typedef struct swapThread {
     int id;
     pthread_t thread_id;
-    pthread_mutex_t lock;
+    pthread_mutex_t lock; /* guards overflow_reqs & sleep/wakeup only */
     pthread_cond_t cond;
-    list *pending_reqs;
+    swapRing rings[SWAP_PRIORITY_COUNT];
+    list *overflow_reqs[SWAP_PRIORITY_COUNT]; /* reqs dispatched when ring is full */
+    redisAtomic size_t overflow_len[SWAP_PRIORITY_COUNT];
+    int skipped[SWAP_PRIORITY_COUNT]; /* owner thread only */
+    redisAtomic int sleeping;
     redisAtomic unsigned long is_running_rio;
+    redisAtomic long long stat_steal_count; /* batches stolen by this thread */
+    redisAtomic long long stat_overflow_count;
+    swapThreadPriorityStat prio_stats[SWAP_PRIORITY_COUNT];
 } swapThread;
 
 int swapThreadsInit(void);
 void swapThreadsDeinit(void);
 void swapThreadsDispatch(struct swapRequestBatch *reqs, int idx);
 int swapThreadsDrained(void);
+void resetSwapThreadsStats(void);
 sds genSwapThreadInfoString(sds info);
 
 
@@ -1377,6 +1543,11 @@ typedef struct RIO {
         sds *rawkeys;
         sds *rawvals;
         sds nextseek; /* own */
+        sds *excludes; /* ref, sorted rawkeys skipped (only forward) */
+        int numexcludes;
+        sds match; /* ref, glob on meta key (META_CF), unmatched keys
+                      skipped and not counted towards limit */
+        size_t count; /* keys counted if ROCKS_ITERATE_COUNT_ONLY */
     } iterate;
 	};
   sds err;
@@ -1392,11 +1563,14 @@ typedef struct RIO {
 #define ROCKS_ITERATE_HIGH_BOUND_EXCLUDE (1<<3)
 #define ROCKS_ITERATE_DISABLE_CACHE (1<<4)
 #define ROCKS_ITERATE_PREFIX_MATCH (1<<5)
+#define ROCKS_ITERATE_COUNT_ONLY (1<<6) /* count keys instead of returning them */
 
 void RIOInitGet(RIO *rio, int numkeys, int *cfs, sds *rawkeys);
 void RIOInitPut(RIO *rio, int numkeys, int *cfs, sds *rawkeys, sds *rawvals);
 void RIOInitDel(RIO *rio, int numkeys, int *cfs, sds *rawkeys);
 void RIOInitIterate(RIO *rio, int cf, uint32_t flags, sds start, sds end, size_t limit);
+void RIOIterateSetExcludes(RIO *rio, sds *excludes, int numexcludes);
+void RIOIterateSetMatch(RIO *rio, sds match);
 void RIODeinit(RIO *rio);
 void RIODo(RIO *rio);
 
@@ -1438,11 +1612,12 @@ void RIOBatchUpdateStatsDataNotFound(RIOBatch *rios);
 #define SWAP_BATCH_FLUSH_THREAD_SWITCH  3
 #define SWAP_BATCH_FLUSH_INTENT_SWITCH  4
 #define SWAP_BATCH_FLUSH_BEFORE_SLEEP   5
-#define SWAP_BATCH_FLUSH_TYPES          6
+#define SWAP_BATCH_FLUSH_PRIORITY_SWITCH 6
+#define SWAP_BATCH_FLUSH_TYPES          7
 
 static inline const char *swapBatchFlushTypeName(int type) {
     const char *name = "?";
-    const char *names[] = {"FORCE_FLUSH", "REACH_LIMIT", "UTILS_TYPE", "THREAD_SWITCH", "INTENT_SWITCH", "BEFORE_SLEEP"};
+    const char *names[] = {"FORCE_FLUSH", "REACH_LIMIT", "UTILS_TYPE", "THREAD_SWITCH", "INTENT_SWITCH", "BEFORE_SLEEP", "PRIORITY_SWITCH"};
     if (type >= 0 && (size_t)type < sizeof(names)/sizeof(char*))
         name = names[type];
     return name;
@@ -1461,6 +1636,7 @@ typedef struct swapBatchCtx {
   swapRequestBatch *batch;
   int thread_idx;
   int cmd_intention;
+  int priority;
 } swapBatchCtx;
 
 swapBatchCtx *swapBatchCtxNew(void);
@@ -1476,18 +1652,32 @@ extern swapBatchLimitsConfig swapBatchLimitsDefaults[SWAP_TYPES];
 
 /* Async */
 #define ASYNC_COMPLETE_QUEUE_NOTIFY_READ_MAX  512
+#define ASYNC_COMPLETE_QUEUE_BUDGET_US_DEFAULT 1000
 
 typedef struct asyncCompleteQueue {
     int notify_recv_fd;
-    int notify_send_fd;
-    pthread_mutex_t lock;
-    list *complete_queue;
+    int notify_send_fd; /* same as notify_recv_fd if eventfd used */
+    /* lock-free mpsc stack pushed by swap threads, main thread takes all. */
+    swapRequestBatch * redisAtomic head;
+    /* taken from head in complete order but not processed yet (budget
+     * exceeded), accessed by main thread only. */
+    swapRequestBatch *pending;
+    swapRequestBatch *pending_tail;
+    redisAtomic size_t length;
+    redisAtomic long long stat_notify_count;
+    long long stat_wakeup_count;
+    long long stat_processed_count;
+    long long stat_budget_exceeded_count;
 } asyncCompleteQueue;
 
 int asyncCompleteQueueInit(void);
 void asyncCompleteQueueDeinit(asyncCompleteQueue *cq);
 void asyncCompleteQueueAppend(asyncCompleteQueue *cq, swapRequestBatch *reqs);
+int asyncCompleteQueueProcess(asyncCompleteQueue *cq, long long budget_us);
+void asyncCompleteQueueProcessBeforeSleep(void);
 int asyncCompleteQueueDrain(mstime_t time_limit);
+sds genAsyncCompleteQueueInfoString(sds info);
+void resetAsyncCompleteQueueStats(void);
 
 void asyncSwapRequestBatchSubmit(swapRequestBatch *reqs, int idx);
 
@@ -1660,6 +1850,8 @@ static inline int evictResultIsFreed(int evict_result) {
 
 typedef struct swapEvictionStat {
     long long evict_result[EVICT_RESULT_TYPES];
+    long long freed_bytes; /* estimated bytes freed by evicted keys */
+    long long rio_count; /* evictions that wrote rocksdb (dirty keys) */
 } swapEvictionStat;
 
 typedef struct swapEvictionCtx {
@@ -1687,6 +1879,51 @@ void updateMaxMemoryScaleFrom(void);
 int swapEvictGetInprogressLimit(size_t mem_tofree);
 int swapEvictionReachedInprogressLimit(void);
 sds genSwapEvictionInfoString(sds info);
+void resetSwapEvictionStats(void);
+
+/* Cost aware eviction: bytes freed per expected swap-in rio, clean keys
+ * (no rocksdb write needed) are preferred. */
+#define SWAP_EVICT_CLEAN_WEIGHT 2
+#define SWAP_EVICT_SUBKEYS_PER_RIO 64
+unsigned long long swapEvictionCostAwareScore(redisDb *db, sds key, robj *o, unsigned long long score);
+
+/* Subkey clock: per big key subkey access bits, subkeys recently accessed
+ * are given a second chance when selecting subkeys to swap out. */
+#define SUBKEY_CLOCK_MIN_BITS 64
+#define SUBKEY_CLOCK_MAX_BITS 8192
+#define SUBKEY_CLOCK_MIN_SUBKEYS 64
+#define SUBKEY_CLOCK_MAX_KEYS 4096
+
+typedef struct subkeyClock {
+    long long hits; /* accessed subkey in memory */
+    long long misses; /* accessed subkey not in memory */
+    uint32_t nbits;
+    unsigned char bits[];
+} subkeyClock;
+
+typedef struct subkeyClocks {
+    dict *clocks; /* dbid+key => subkeyClock */
+    long long stat_hits;
+    long long stat_misses;
+    long long stat_second_chances;
+    long long stat_dropped;
+} subkeyClocks;
+
+subkeyClocks *subkeyClocksNew(void);
+void subkeyClocksFree(subkeyClocks *clocks);
+subkeyClock *subkeyClockLookup(redisDb *db, robj *key);
+subkeyClock *subkeyClockLookupOrCreate(redisDb *db, robj *key, size_t nsubkeys);
+void subkeyClockAccess(subkeyClock *clock, robj *subkey, int hit);
+/* Second chances given per subkeys selection are bounded, so that walking
+ * a big key whose subkeys are all recently accessed stops and evicts anyway. */
+#define SUBKEY_CLOCK_SECOND_CHANCES_FACTOR 4
+static inline size_t subkeyClockSecondChances(size_t count) {
+    return count*SUBKEY_CLOCK_SECOND_CHANCES_FACTOR;
+}
+int subkeyClockSecondChance(subkeyClock *clock, robj *subkey, size_t *chances);
+sds genSubkeyClockInfo(subkeyClock *clock);
+sds genSwapSubkeyClockInfoString(sds info);
+void resetSwapSubkeyClockStats(void);
 
 #define EVICT_ASAP_OK 0
 #define EVICT_ASAP_AGAIN 1
@@ -1726,8 +1963,12 @@ size_t coldFiltersUsedMemory(void); /* cuckoo filter not counted in maxmemory */
 static inline size_t ctrip_getUsedMemory(void) {
   int swap_inprogress_memory;
   atomicGet(server.swap_inprogress_memory, swap_inprogress_memory);
-  return zmalloc_used_memory() - swap_inprogress_memory -
+  size_t used = zmalloc_used_memory() - swap_inprogress_memory -
       coldFiltersUsedMemory() - swapPersistCtxUsedMemory(server.swap_persist_ctx);
+  /* rocksdb memory (block cache, memtables, table readers) is not allocated
+   * by zmalloc, updated by serverRocksCron. */
+  if (server.swap_maxmemory_include_rocksdb) used += server.rocksdb_memory_used;
+  return used;
 }
 static inline int ctrip_evictionTimeProcGetDelayMillis(void) {
   if (server.swap_mode == SWAP_MODE_MEMORY) return 0;
@@ -1773,8 +2014,12 @@ int submitExpireClientRequest(client *c, robj *key, int force);
 #define ROCKS_DIR_MAX_LEN 512
 #define ROCKS_DATA "data.rocks"
 #define ROCKS_DISK_HEALTH_DETECT_FILE "disk_health_detect"
+#define ROCKS_KEY_ENCODING_FILE "key_encoding"
 
 /* Rocksdb engine */
+#define ROCKSDB_BLOCK_CACHE_TYPE_LRU 0
+#define ROCKSDB_BLOCK_CACHE_TYPE_HYPER_CLOCK 1
+
 typedef struct rocks {
     int rocksdb_epoch;
     rocksdb_t *db;
@@ -1784,6 +2029,9 @@ typedef struct rocks {
     rocksdb_readoptions_t *ropts;
     rocksdb_writeoptions_t *wopts;
     rocksdb_readoptions_t *filter_meta_ropts;
+    rocksdb_cache_t *block_caches[CF_COUNT]; /* dedicated block caches, NULL if shared */
+    rocksdb_cache_t *shared_block_cache;
+    rocksdb_write_buffer_manager_t *write_buffer_manager;
     const rocksdb_snapshot_t *snapshot;
     pthread_rwlock_t rwlock[1];
 } rocks;
@@ -1916,9 +2164,34 @@ typedef struct rocksdbCreateCheckpointResult{
 } rocksdbCreateCheckpointResult;
 
 /* rocksdb util task: collect cf meta */
+#define SST_EXPIRE_PROPS_SAMPLE_KEYS 64
+
+/* Expire properties of data cf sst, sampled from keys in sst and their
+ * metas. Sst is immutable, so props are sampled once and cached by util
+ * thread, expired fraction evaluated at any time with expires. */
+typedef struct sstExpireProps {
+  uint64_t file_size;
+  uint sampled; /* keys sampled */
+  uint stale; /* meta missing or newer than data version */
+  uint persist; /* live keys without expire */
+  long long min_expire;
+  long long max_expire;
+  uint nexpires;
+  long long *expires; /* expire of live keys with expire, ascending */
+} sstExpireProps;
+
+sstExpireProps *sstExpirePropsNew(void);
+sstExpireProps *sstExpirePropsDup(sstExpireProps *props);
+void sstExpirePropsFree(sstExpireProps *props);
+uint sstExpirePropsReclaimPercentage(sstExpireProps *props, long long now);
+
 typedef struct cfMetas {
   uint num;
   rocksdb_column_family_metadata_t** cf_meta;
+  /* props of ssts in highest level with sst of cf_meta[0], NULL if not
+   * collected. */
+  uint sst_props_num;
+  sstExpireProps **sst_props;
 } cfMetas;
 
 cfMetas *cfMetasNew(uint cf_num);
@@ -1927,8 +2200,11 @@ void cfMetasFree(cfMetas *metas);
 typedef struct cfIndexes {
   uint num;
   int *index;
+  int collect_sst_props;
 } cfIndexes;
 
+void collectSstExpireProps(cfMetas *metas);
+
 cfIndexes *cfIndexesNew(uint num);
 void cfIndexesFree(cfIndexes *indexes);
 
@@ -1975,6 +2251,7 @@ typedef struct swapTtlCompactCtx {
     redisAtomic unsigned long long stat_request_sst_count;
     redisAtomic unsigned long long stat_expired_sst_count;
     redisAtomic unsigned long long stat_compacted_data_size;
+    redisAtomic unsigned long long stat_sampled_sst_count;
 } swapTtlCompactCtx;
 
 swapTtlCompactCtx *swapTtlCompactCtxNew();
@@ -1984,6 +2261,7 @@ void swapTtlCompactCtxReset(swapTtlCompactCtx *ctx);
 swapExpireStatus *swapExpireStatusNew();
 void swapExpireStatusFree(swapExpireStatus *stats);
 void swapExpireStatusReset(swapExpireStatus *stats);
+void swapExpireStatusSample(swapExpireStatus *stats, long long expire);
 
 sds genSwapTtlCompactInfoString(sds info);
 
@@ -2024,6 +2302,7 @@ void submitDeferredClientKeyRequests(client *c, getKeyRequestsResult *result, cl
 void submitClientKeyRequests(client *c, getKeyRequestsResult *result, clientKeyRequestFinished cb, void* ctx_pd);
 int submitNormalClientRequests(client *c);
 void keyRequestBeforeCall(client *c, swapCtx *ctx);
+void normalClientKeyRequestFinished(client *c, swapCtx *ctx);
 void swapMutexopCommand(client *c);
 int lockGlobalAndExec(clientKeyRequestFinished locked_op, uint64_t exclude_mark);
 uint64_t dictEncObjHash(const void *key);
@@ -2104,6 +2383,7 @@ typedef struct compactionFilterStat {
     redisAtomic long long filt_count;
     redisAtomic long long scan_count;
     redisAtomic long long rio_count;
+    redisAtomic long long cache_hit_count; /* meta lookups avoided by cache or readahead */
     int stats_metric_idx_filt;
     int stats_metric_idx_scan;
     int stats_metric_idx_rio;
@@ -2118,6 +2398,13 @@ typedef struct swapHitStat {
     redisAtomic long long stat_swapin_data_not_found_count;
     redisAtomic long long stat_absent_subkey_query_count;
     redisAtomic long long stat_absent_subkey_filt_count;
+    redisAtomic long long stat_swapin_warm_tier_hit_count;
+    redisAtomic long long stat_swapin_warm_tier_miss_count;
+    redisAtomic long long stat_warm_tier_put_count;
+    redisAtomic long long stat_warm_tier_evict_count;
+    redisAtomic long long stat_swapin_pushdown_count;
+    redisAtomic long long stat_subkey_filter_query_count;
+    redisAtomic long long stat_subkey_filter_filt_count;
 } swapHitStat;
 
 static inline int isSwapHitStatKeyRequest(keyRequest *kr) {
@@ -2132,6 +2419,10 @@ typedef struct rorStat {
     struct swapStat *swap_stats; /* array of swap stats (one for each swap type). */
     struct swapStat *rio_stats; /* array of rio stats (one for each rio type). */
     struct compactionFilterStat *compaction_filter_stats; /* array of compaction filter stats (one for each column family). */
+    redisAtomic size_t rio_get_value_count; /* values fetched by rio get. */
+    redisAtomic size_t rio_get_copied_bytes; /* bytes copied to materialize rio get values. */
+    redisAtomic size_t swapin_rio_count[SWAP_TYPE_COUNT]; /* swap in rios (one for each swap type). */
+    redisAtomic size_t swapin_rio_time[SWAP_TYPE_COUNT]; /* swap in rio time in us (one for each swap type). */
 } rorStat;
 
 void initStatsSwap(void);
@@ -2146,6 +2437,9 @@ static inline void updateCompactionFiltScanCount(int cf) {
 static inline void updateCompactionFiltRioCount(int cf) {
     atomicIncr(server.ror_stats->compaction_filter_stats[cf].rio_count, 1);
 }
+static inline void updateCompactionFiltCacheHitCount(int cf) {
+    atomicIncr(server.ror_stats->compaction_filter_stats[cf].cache_hit_count, 1);
+}
 
 typedef
 struct swapDebugInfo {
@@ -2334,10 +2628,82 @@ typedef struct ctripRdbLoadCtx {
     sds *rawkeys;
     sds *rawvals;
   } batch;
+  struct rdbLoadIngest *ingest; /* NULL if not loading by ingest */
 } ctripRdbLoadCtx;
 
 void evictStartLoading(void);
 void evictStopLoading(int success);
+int evictFinishLoading(void);
+
+/* Rdb load by ingest */
+#define RDB_LOAD_INGEST_SST_SIZE (256*1024*1024)
+#define RDB_LOAD_INGEST_MERGE_FANIN 256
+#define RDB_LOAD_INGEST_DIR_PREFIX "ingest_"
+
+/* Key/vals of one cf, sorted and spilled to run file by swap thread. */
+typedef struct rdbLoadIngestRun {
+  int cf;
+  size_t num;
+  size_t capacity;
+  size_t memory;
+  sds *kvs; /* rawkey and rawval interleaved */
+  sds path; /* run file */
+} rdbLoadIngestRun;
+
+/* Runs of one cf merged into non-overlapping ssts by swap thread. */
+typedef struct rdbLoadIngestMerge {
+  int cf;
+  sds dir;
+  int nruns;
+  sds *runs; /* run files */
+  rdbLoadIngestRun *last; /* last run not spilled, could be NULL */
+  int nssts;
+  sds *ssts; /* ssts to ingest */
+} rdbLoadIngestMerge;
+
+typedef struct rdbLoadIngest {
+  sds dir;
+  long long seq;
+  int errors;
+  rdbLoadIngestRun *runs[CF_COUNT]; /* runs buffering */
+  list *spilled[CF_COUNT]; /* run files spilled */
+  rdbLoadIngestMerge *merges[CF_COUNT];
+} rdbLoadIngest;
+
+rdbLoadIngest *rdbLoadIngestNew(void);
+void rdbLoadIngestFree(rdbLoadIngest *ingest);
+void rdbLoadIngestCleanupStale(void);
+void rdbLoadIngestFeed(rdbLoadIngest *ingest, int cf, MOVE sds rawkey, MOVE sds rawval);
+int rdbLoadIngestFinish(rdbLoadIngest *ingest);
+void rdbLoadIngestRunSpill(rdbLoadIngestRun *run, char **err);
+void rdbLoadIngestMergeRuns(rdbLoadIngestMerge *merge, char **err);
+
+/* Bulk slot migration of cold keys */
+typedef struct swapMigrateKey {
+  sds key;
+  long long expire;
+  uint64_t version;
+  int num; /* meta first, then data & score kvs */
+  int capacity;
+  int *cfs;
+  sds *rawkeys;
+  sds *rawvals;
+} swapMigrateKey;
+
+typedef struct swapMigrateSlotBatch {
+  int slot;
+  int num;
+  int capacity;
+  swapMigrateKey *keys; /* sorted by meta rawkey */
+} swapMigrateSlotBatch;
+
+swapMigrateSlotBatch *swapMigrateSlotCollect(redisDb *db, int slot, int count, OUT sds *err);
+void swapMigrateSlotBatchFree(swapMigrateSlotBatch *batch);
+sds swapMigrateSlotEncodePayload(swapMigrateSlotBatch *batch, OUT int *num);
+int swapMigrateSlotDelete(redisDb *db, swapMigrateSlotBatch *batch, OUT sds *err);
+swapMigrateSlotBatch *swapRestoreSlotPayload(redisDb *db, int slot, sds payload, OUT sds *err);
+void swapMigrateSlotCommand(client *c);
+void swapRestoreSlotCommand(client *c);
 
 struct rdbKeyLoadData;
 
@@ -2388,6 +2754,8 @@ void rdbKeyLoadExpired(struct rdbKeyLoadData *keydata);
 void rdbLoadStartLenMeta(struct rdbKeyLoadData *load, rio *rdb, int *cf, sds *rawkey, sds *rawval, int *error);
 
 void wholeKeyLoadInit(rdbKeyLoadData *keydata);
+void wholekeyLoadStart(struct rdbKeyLoadData *keydata, rio *rdb, int *cf, sds *rawkey, sds *rawval, int *error);
+void moduleValueLoadInit(rdbKeyLoadData *load);
 void hashLoadInit(rdbKeyLoadData *load);
 void setLoadInit(rdbKeyLoadData *load);
 void listLoadInit(rdbKeyLoadData *load);
@@ -2418,6 +2786,7 @@ typedef struct loadFixStats {
   long long fix_update;
   long long fix_delete;
   long long fix_err;
+  long long fix_index;
 } loadFixStats;
 
 sds loadFixStatsDump(loadFixStats *stats);
@@ -2449,6 +2818,34 @@ int absentCacheGetSubkey(absentCache *absent, sds key, sds subkey);
 void absentCacheSetCapacity(absentCache *absent, size_t capacity);
 
 
+/* warm tier: bounded in-memory store of compressed encoded values of
+ * evicted whole keys, swap in served without rocksdb read. */
+#define WARM_TIER_COMPRESS_MIN_LEN 32
+
+typedef struct warmTierEntry {
+  sds key; /* shared with map */
+  sds blob; /* rdb encoded value, lzf compressed if rawlen > 0 */
+  size_t rawlen;
+  long long expire;
+} warmTierEntry;
+
+typedef struct warmTier {
+  dict *map; /* key => listNode of warmTierEntry */
+  list *list; /* most recently put at head */
+  size_t used_memory;
+  size_t raw_bytes; /* encoded bytes before compression */
+  size_t blob_bytes; /* encoded bytes after compression */
+} warmTier;
+
+warmTier *warmTierNew(void);
+void warmTierFree(warmTier *tier);
+int warmTierDelete(warmTier *tier, sds key);
+void warmTierPutKey(redisDb *db, robj *key, robj *value, long long expire);
+robj *warmTierRestoreKey(redisDb *db, robj *key, int cmd_intention, uint32_t cmd_intention_flags);
+size_t warmTiersUsedMemory(void);
+void warmTiersTrim(warmTier *prefer);
+sds genSwapWarmTierInfoString(sds info);
+
 /* cold keys filter */
 #define COLDFILTER_FILT_BY_CUCKOO_FILTER 1
 #define COLDFILTER_FILT_BY_ABSENT_CACHE 2
@@ -2464,10 +2861,20 @@ void trackSwapCuckooFilterInstantaneousMetrics(void);
 void resetSwapCukooFilterInstantaneousMetrics(void);
 sds genSwapCuckooFilterInfoString(sds info);
 
+/* Per-key cuckoo filter of subkeys persisted in rocksdb, only valid for
+ * the object version it was created with. */
+typedef struct subkeyFilter {
+  uint64_t version;
+  cuckooFilter *filter;
+} subkeyFilter;
+
 typedef struct coldFilter {
   absentCache *absents;
   cuckooFilter *filter;
+  warmTier *warm; /* lazily created */
   swapCuckooFilterStat filter_stat;
+  dict *subkey_filters; /* key => subkeyFilter, lazily created */
+  size_t subkey_filters_memory;
 } coldFilter;
 
 coldFilter *coldFilterCreate(void);
@@ -2484,6 +2891,12 @@ void coldFilterSubkeyAdded(coldFilter *filter, sds key);
 void coldFilterSubkeyNotFound(coldFilter *filter, sds key, sds subkey);
 int coldFilterMayContainSubkey(coldFilter *filter, sds key, sds subkey);
 
+subkeyFilter *coldFilterLookupSubkeyFilter(coldFilter *filter, sds key);
+subkeyFilter *coldFilterCreateSubkeyFilter(coldFilter *filter, sds key, uint64_t version, size_t nsubkeys);
+void coldFilterDeleteSubkeyFilter(coldFilter *filter, sds key);
+int coldFilterSubkeyFilterInsert(coldFilter *filter, subkeyFilter *sf, sds subkey);
+int subkeyFilterMayContain(subkeyFilter *sf, uint64_t version, sds subkey);
+
 /* Util */
 
 #define ROCKS_KEY_FLAG_NONE 0x0
@@ -2507,7 +2920,17 @@ long rocksDecodeObjectMetaLen(const char *raw, size_t rawlen);
 sds encodeMetaScanKey(unsigned long cursor, int limit, sds seek);
 int decodeMetaScanKey(sds meta_scan_key, unsigned long *cursor, int *limit, const char **seek, size_t *seeklen);
 sds rocksEncodeDbRangeStartKey(int dbid);
+sds rocksEncodeExpireIndexKey(int dbid, long long expire, const char *key, size_t keylen);
+int rocksDecodeExpireIndexKey(const char *raw, size_t rawlen, int *dbid, long long *expire, const char **key, size_t *keylen);
 sds rocksEncodeDbRangeEndKey(int dbid);
+size_t rocksDataKeyPrefixLen(const char *raw, size_t rawlen);
+sds rocksEncodePrefixSuccessor(const char *prefix, size_t prefixlen);
+#define SWAP_KEY_ENCODING_V1 1
+#define SWAP_KEY_ENCODING_V2 2
+#define SWAP_KEY_ENCODING_V3 3
+int rocksEncodeKeyPrefixRange(int dbid, const char *prefix, size_t prefixlen, sds *start, sds *end);
+int rocksEncodeSlotRange(int dbid, int slot, sds *start, sds *end);
+sds rocksConvertKeyEncoding(const char *raw, size_t rawlen, int from, int to);
 
 #define sizeOfDouble (BYTE_ORDER == BIG_ENDIAN? sizeof(double):8)
 int encodeDouble(char* buf, double value);
@@ -2561,7 +2984,9 @@ uint64_t SwapCommandDataTypeFlagByName(const char *name);
 static inline void clientSwapError(client *c, int swap_errcode) {
   if (c && swap_errcode) {
     if (swap_errcode != SWAP_ERR_DATA_WRONG_TYPE_ERROR &&
-        swap_errcode != SWAP_ERR_METASCAN_UNSUPPORTED_IN_MULTI) {
+        swap_errcode != SWAP_ERR_METASCAN_UNSUPPORTED_IN_MULTI &&
+        swap_errcode != SWAP_ERR_METASCAN_SLOT_UNSUPPORTED &&
+        swap_errcode != SWAP_ERR_METASCAN_KEYS_TRUNCATED) {
       atomicIncr(server.swap_error_count,1);
     }
     c->swap_errcode = swap_errcode;
@@ -2574,6 +2999,8 @@ static inline void clientSwapError(client *c, int swap_errcode) {
 #define ROCKSDB_EXCLUSIVE_TASK_COUNT 3
 #define ROCKSDB_CREATE_CHECKPOINT 3
 #define ROCKSDB_COLLECT_CF_META_TASK 4
+#define ROCKSDB_INGEST_SPILL_RUN_TASK 5
+#define ROCKSDB_INGEST_MERGE_RUNS_TASK 6
 
 typedef void (*rocksdbUtilTaskCallback)(void *result, void *pd, int errcode);
 
@@ -2594,6 +3021,7 @@ typedef struct rocksdbUtilTaskCtx {
 } rocksdbUtilTaskCtx;
 
 int submitUtilTask(int type, void *arg, rocksdbUtilTaskCallback cb, void* pd, sds* error);
+void submitParallelUtilTask(int type, void *arg, rocksdbUtilTaskCallback cb, void* pd);
 
 /* swap trace */
 #define SLOWLOG_ENTRY_MAX_TRACE 16
@@ -2724,8 +3152,13 @@ int swapPersistTest(int argc, char *argv[], int accurate);
 int swapRordbTest(int argc, char *argv[], int accurate);
 int roaringBitmapTest(int argc, char *argv[], int accurate);
 int swapDataBitmapTest(int argc, char **argv, int accurate);
+int swapDataModuleTest(int argc, char **argv, int accurate);
 int wtdigestTest(int argc, char **argv, int accurate);
 int swapReplTest(int argc, char **argv, int accurate);
+int swapThreadTest(int argc, char **argv, int accurate);
+int swapSubkeyClockTest(int argc, char **argv, int accurate);
+int swapWarmTierTest(int argc, char **argv, int accurate);
+int swapMigrateSlotTest(int argc, char **argv, int accurate);
 
 int swapTest(int argc, char **argv, int accurate);
 
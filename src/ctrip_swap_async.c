@@ -27,35 +27,88 @@
 
 #include "ctrip_swap.h"
 
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
 /* --- Async rocks io --- */
-int asyncCompleteQueueProcess(asyncCompleteQueue *cq) {
-    int processed;
-    listIter li;
-    listNode *ln;
-    list *processing_reqs = listCreate();
-    monotime process_timer = 0;
-    if (server.swap_debug_trace_latency) elapsedStart(&process_timer);
+static void asyncCompleteQueueNotify(asyncCompleteQueue *cq) {
+#ifdef HAVE_EVENTFD
+    uint64_t u = 1;
+    ssize_t nwritten = write(cq->notify_send_fd, &u, sizeof(u));
+#else
+    ssize_t nwritten = write(cq->notify_send_fd, "x", 1);
+#endif
+    atomicIncr(cq->stat_notify_count,1);
+    if (nwritten < 1 && errno != EAGAIN) {
+        static mstime_t prev_log;
+        if (server.mstime - prev_log >= 1000) {
+            prev_log = server.mstime;
+            serverLog(LL_NOTICE, "[rocks] notify rio finish failed: %s",
+                    strerror(errno));
+        }
+    }
+}
+
+/* Take all completed reqs from lock-free stack, and append to pending in
+ * complete order. */
+static void asyncCompleteQueueFetch(asyncCompleteQueue *cq) {
+    swapRequestBatch *head, *next, *first = NULL, *last = NULL;
+    int success;
+
+    atomicGetWithSync(cq->head,head);
+    if (head == NULL) return;
+    do {
+        atomicCompareExchangeWithSync(cq->head,head,NULL,success);
+    } while (!success);
 
-    pthread_mutex_lock(&cq->lock);
-    listRewind(cq->complete_queue, &li);
-    while ((ln = listNext(&li))) {
-        listAddNodeTail(processing_reqs, listNodeValue(ln));
-        listDelNode(cq->complete_queue, ln);
+    /* stack is lifo, reverse to complete order. */
+    last = head;
+    while (head) {
+        next = head->cq_next;
+        head->cq_next = first;
+        first = head;
+        head = next;
     }
-    pthread_mutex_unlock(&cq->lock);
 
-    listRewind(processing_reqs, &li);
-    while ((ln = listNext(&li))) {
-        swapRequestBatch *reqs = listNodeValue(ln);
+    if (cq->pending_tail) {
+        cq->pending_tail->cq_next = first;
+    } else {
+        cq->pending = first;
+    }
+    cq->pending_tail = last;
+}
+
+/* Process completed reqs, stop if budget_us (if positive) exceeded. */
+int asyncCompleteQueueProcess(asyncCompleteQueue *cq, long long budget_us) {
+    int processed = 0;
+    swapRequestBatch *reqs;
+    monotime process_timer = 0;
+    elapsedStart(&process_timer);
+
+    asyncCompleteQueueFetch(cq);
+
+    while ((reqs = cq->pending)) {
+        if (budget_us > 0 && processed > 0 &&
+                (long long)elapsedUs(process_timer) >= budget_us) {
+            cq->stat_budget_exceeded_count++;
+            break;
+        }
+
+        cq->pending = reqs->cq_next;
+        if (cq->pending == NULL) cq->pending_tail = NULL;
+        reqs->cq_next = NULL;
+
         if (reqs->notify_queue_timer) {
             metricDebugInfo(SWAP_DEBUG_NOTIFY_QUEUE_WAIT, elapsedUs(reqs->notify_queue_timer));
         }
         swapRequestBatchCallback(reqs);
         swapRequestBatchFree(reqs);
+        atomicDecr(cq->length,1);
+        processed++;
     }
 
-    processed = listLength(processing_reqs);
-    listRelease(processing_reqs);
+    cq->stat_processed_count += processed;
     if (server.swap_debug_trace_latency) {
         metricDebugInfo(SWAP_DEBUG_NOTIFY_QUEUE_HANDLES, processed);
         metricDebugInfo(SWAP_DEBUG_NOTIFY_QUEUE_HANDLE_TIME, elapsedUs(process_timer));
@@ -63,34 +116,60 @@ int asyncCompleteQueueProcess(asyncCompleteQueue *cq) {
     return processed;
 }
 
-/* read before unlink clients so that main thread won't miss notify event:
- * rocksb thread: 1. link req; 2. send notify byte;
- * main thread: 1. read notify bytes; 2. unlink req;
- * if main thread read less notify bytes than unlink clients num (e.g. rockdb
- * thread link more clients when , main thread would still be triggered because
- * epoll LT-triggering mode. */
+/* Leftover reqs (budget exceeded) would not be notified by swap threads,
+ * notify ourself so that event loop won't block before they are processed. */
+static void asyncCompleteQueueProcessBudgeted(asyncCompleteQueue *cq) {
+    asyncCompleteQueueProcess(cq, server.swap_async_complete_queue_budget_us);
+    if (cq->pending) asyncCompleteQueueNotify(cq);
+}
+
+/* Swap threads notify only when queue turns from empty to non-empty, main
+ * thread clear notify before taking reqs, so it won't miss notify:
+ * swap thread: 1. push req; 2. notify if queue was empty;
+ * main thread: 1. clear notify; 2. take all reqs. */
 void asyncCompleteQueueHandler(aeEventLoop *el, int fd, void *privdata, int mask) {
+    asyncCompleteQueue *cq = privdata;
+#ifdef HAVE_EVENTFD
+    uint64_t notify_recv_buf;
+#else
     char notify_recv_buf[ASYNC_COMPLETE_QUEUE_NOTIFY_READ_MAX];
+#endif
 
     UNUSED(el);
     UNUSED(mask);
 
-    int nread = read(fd, notify_recv_buf, sizeof(notify_recv_buf));
+    int nread = read(fd, &notify_recv_buf, sizeof(notify_recv_buf));
     if (nread == 0) {
         serverLog(LL_WARNING, "[rocks] notify recv fd closed.");
-    } else if (nread < 0) {
+    } else if (nread < 0 && errno != EAGAIN) {
         serverLog(LL_WARNING, "[rocks] read notify failed: %s",
                 strerror(errno));
     }
 
-    asyncCompleteQueueProcess(privdata);
+    cq->stat_wakeup_count++;
+    asyncCompleteQueueProcessBudgeted(cq);
+}
+
+/* Process reqs completed while main thread is busy, saves a wakeup. */
+void asyncCompleteQueueProcessBeforeSleep() {
+    if (server.CQ == NULL) return;
+    asyncCompleteQueueProcessBudgeted(server.CQ);
 }
 
 int asyncCompleteQueueInit() {
-    int fds[2];
     char anetErr[ANET_ERR_LEN];
     asyncCompleteQueue *cq = zcalloc(sizeof(asyncCompleteQueue));
 
+#ifdef HAVE_EVENTFD
+    int efd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if (efd == -1) {
+        perror("Can't create notify eventfd");
+        return -1;
+    }
+    cq->notify_recv_fd = efd;
+    cq->notify_send_fd = efd;
+#else
+    int fds[2];
     if (pipe(fds)) {
         perror("Can't create notify pipe");
         return -1;
@@ -99,10 +178,6 @@ int asyncCompleteQueueInit() {
     cq->notify_recv_fd = fds[0];
     cq->notify_send_fd = fds[1];
 
-    pthread_mutex_init(&cq->lock, NULL);
-
-    cq->complete_queue = listCreate();
-
     if (anetNonBlock(anetErr, cq->notify_recv_fd) != ANET_OK) {
         serverLog(LL_WARNING,
                 "Fatal: set notify_recv_fd non-blocking failed: %s",
@@ -116,6 +191,13 @@ int asyncCompleteQueueInit() {
                 anetErr);
         return -1;
     }
+#endif
+    UNUSED(anetErr);
+
+    atomicSetWithSync(cq->head, NULL);
+    cq->pending = NULL;
+    cq->pending_tail = NULL;
+    atomicSetWithSync(cq->length, 0);
 
     if (aeCreateFileEvent(server.el, cq->notify_recv_fd,
                 AE_READABLE, asyncCompleteQueueHandler, cq) == AE_ERR) {
@@ -130,9 +212,7 @@ int asyncCompleteQueueInit() {
 
 void asyncCompleteQueueDeinit(asyncCompleteQueue *cq) {
     close(cq->notify_recv_fd);
-    close(cq->notify_send_fd);
-    pthread_mutex_destroy(&cq->lock);
-    listRelease(cq->complete_queue);
+    if (cq->notify_send_fd != cq->notify_recv_fd) close(cq->notify_send_fd);
 }
 
 void asyncSwapRequestNotifyCallback(swapRequestBatch *reqs, void *pd) {
@@ -141,17 +221,20 @@ void asyncSwapRequestNotifyCallback(swapRequestBatch *reqs, void *pd) {
 }
 
 void asyncCompleteQueueAppend(asyncCompleteQueue *cq, swapRequestBatch *reqs) {
-    pthread_mutex_lock(&cq->lock);
-    listAddNodeTail(cq->complete_queue, reqs);
-    pthread_mutex_unlock(&cq->lock);
-    if (write(cq->notify_send_fd, "x", 1) < 1 && errno != EAGAIN) {
-        static mstime_t prev_log;
-        if (server.mstime - prev_log >= 1000) {
-            prev_log = server.mstime;
-            serverLog(LL_NOTICE, "[rocks] notify rio finish failed: %s",
-                    strerror(errno));
-        }
-    }
+    swapRequestBatch *head;
+    int success;
+
+    /* count before push, so that queue won't be seen drained when req
+     * pushed but not yet processed. */
+    atomicIncr(cq->length,1);
+    atomicGetWithSync(cq->head,head);
+    do {
+        reqs->cq_next = head;
+        atomicCompareExchangeWithSync(cq->head,head,reqs,success);
+    } while (!success);
+
+    /* only the one turns queue non-empty notifies, others coalesced. */
+    if (head == NULL) asyncCompleteQueueNotify(cq);
 }
 
 void asyncSwapRequestBatchSubmit(swapRequestBatch *reqs, int idx) {
@@ -161,14 +244,10 @@ void asyncSwapRequestBatchSubmit(swapRequestBatch *reqs, int idx) {
 }
 
 static int asyncCompleteQueueDrained() {
-    int drained = 1;
-
+    size_t length;
     if (!swapThreadsDrained()) return 0;
-    pthread_mutex_lock(&server.CQ->lock);
-    if (listLength(server.CQ->complete_queue)) drained = 0;
-    pthread_mutex_unlock(&server.CQ->lock);
-
-    return drained;
+    atomicGetWithSync(server.CQ->length,length);
+    return length == 0;
 }
 
 int asyncCompleteQueueDrain(mstime_t time_limit) {
@@ -176,7 +255,7 @@ int asyncCompleteQueueDrain(mstime_t time_limit) {
     mstime_t start = mstime();
 
     while (!asyncCompleteQueueDrained()) {
-        asyncCompleteQueueProcess(server.CQ);
+        asyncCompleteQueueProcess(server.CQ, -1);
 
         if (time_limit >= 0 && mstime() - start > time_limit) {
             result = -1;
@@ -191,3 +270,22 @@ int asyncCompleteQueueDrain(mstime_t time_limit) {
     return result;
 }
 
+sds genAsyncCompleteQueueInfoString(sds info) {
+    asyncCompleteQueue *cq = server.CQ;
+    long long notify_count;
+    atomicGet(cq->stat_notify_count,notify_count);
+    info = sdscatprintf(info,
+            "swap_async_complete:notifies=%lld,wakeups=%lld,processed=%lld,budget_exceeded=%lld\r\n",
+            notify_count, cq->stat_wakeup_count, cq->stat_processed_count,
+            cq->stat_budget_exceeded_count);
+    return info;
+}
+
+void resetAsyncCompleteQueueStats() {
+    asyncCompleteQueue *cq = server.CQ;
+    if (cq == NULL) return;
+    atomicSet(cq->stat_notify_count,0);
+    cq->stat_wakeup_count = 0;
+    cq->stat_processed_count = 0;
+    cq->stat_budget_exceeded_count = 0;
+}
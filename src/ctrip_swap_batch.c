@@ -111,6 +111,21 @@ void swapExecBatchCtxEnd(swapExecBatch *exec_batch) {
     swapExecBatchCtxReset(exec_batch,SWAP_UNSET,ROCKS_UNSET);
 }
 
+/* Priority is set where client created: evict (and persist) clients are
+ * low, repl workers normal, others (including internal clients that
+ * foreground commands wait for) high. Requests without client are util
+ * tasks or loading, only compaction among them yields. */
+int swapRequestPriority(swapRequest *req) {
+    client *c = req->swap_ctx ? req->swap_ctx->c : NULL;
+    if (c != NULL)
+        return c->swap_priority;
+    else if (req->intention == SWAP_UTILS &&
+            req->intention_flags == ROCKSDB_COMPACT_RANGE_TASK)
+        return SWAP_PRIORITY_LOW;
+    else
+        return SWAP_PRIORITY_NORMAL;
+}
+
 /* swapRequestBatch: batch of requests that submitted together, those requests
  * does not depend on each other to proceed or unlock.
  * Although these requests have same cmd intentions, their swap intention
@@ -122,6 +137,9 @@ swapRequestBatch *swapRequestBatchNew() {
     reqs->count = 0;
     reqs->swap_queue_timer = 0;
     reqs->notify_queue_timer = 0;
+    reqs->dispatch_timer = 0;
+    reqs->priority = SWAP_PRIORITY_LOW;
+    reqs->cq_next = NULL;
     return reqs;
 }
 
@@ -184,8 +202,12 @@ void swapRequestBatchDispatched(swapRequestBatch *reqs) {
 
     if (server.swap_debug_trace_latency) elapsedStart(&reqs->swap_queue_timer);
 
+    /* batch served as its most urgent request. */
+    reqs->priority = SWAP_PRIORITY_LOW;
     for (size_t i = 0; i < reqs->count; i++) {
         swapRequest *req = reqs->reqs[i];
+        int priority = swapRequestPriority(req);
+        if (priority < reqs->priority) reqs->priority = priority;
         if (req->trace) swapTraceDispatch(req->trace);
         req->swap_memory += SWAP_REQUEST_MEMORY_OVERHEAD;
         swap_memory += req->swap_memory;
@@ -330,6 +352,7 @@ swapBatchCtx *swapBatchCtxNew() {
     batch_ctx->batch = swapRequestBatchNew();
     batch_ctx->thread_idx = -1;
     batch_ctx->cmd_intention = SWAP_UNSET;
+    batch_ctx->priority = SWAP_PRIORITY_LOW;
     return batch_ctx;
 }
 
@@ -379,7 +402,7 @@ inline int swapBatchCtxExceedsLimit(swapBatchCtx *batch_ctx) {
 
 void swapBatchCtxFeed(swapBatchCtx *batch_ctx, int flush,
         swapRequest *req, int thread_idx) {
-    int cmd_intention;
+    int cmd_intention, priority = swapRequestPriority(req);
 
     if (req->intention == SWAP_UNSET) {
         cmd_intention = req->key_request->cmd_intention;
@@ -392,12 +415,16 @@ void swapBatchCtxFeed(swapBatchCtx *batch_ctx, int flush,
         swapBatchCtxFlush(batch_ctx,SWAP_BATCH_FLUSH_THREAD_SWITCH);
     } else if (batch_ctx->cmd_intention != cmd_intention) {
         swapBatchCtxFlush(batch_ctx,SWAP_BATCH_FLUSH_INTENT_SWITCH);
+    } else if (batch_ctx->priority != priority) {
+        /* keep foreground reqs from waiting behind background ones. */
+        swapBatchCtxFlush(batch_ctx,SWAP_BATCH_FLUSH_PRIORITY_SWITCH);
     } else {
         /* no need to flush beforehand */
     }
 
     batch_ctx->thread_idx = thread_idx;
     batch_ctx->cmd_intention = cmd_intention;
+    batch_ctx->priority = priority;
 
     swapRequestBatchAppend(batch_ctx->batch,req);
 
@@ -40,6 +40,7 @@ struct SwapDataTypeItem {
     {"swap_zset", CMD_SWAP_DATATYPE_ZSET},
     {"swap_list", CMD_SWAP_DATATYPE_LIST},
     {"swap_bitmap", CMD_SWAP_DATATYPE_BITMAP},
+    {"swap_module", CMD_SWAP_DATATYPE_MODULE},
     {NULL,0} /* Terminator. */
 };
 /* Given the category name the command returns the corresponding flag, or
@@ -402,6 +403,14 @@ static void getSingleCmdKeyRequests(client *c, getKeyRequestsResult *result) {
     _getSingleCmdKeyRequests(c->db->id,c->cmd,c->argv,c->argc,result);
 }
 
+/* Key requests of command not bound to any client (e.g. pipelined command
+ * parsed ahead by prefetch). */
+void getCommandKeyRequests(int dbid, struct redisCommand *cmd, robj **argv,
+        int argc, getKeyRequestsResult *result) {
+    getKeyRequestsPrepareResult(result, MAX_KEYREQUESTS_BUFFER);
+    _getSingleCmdKeyRequests(dbid,cmd,argv,argc,result);
+}
+
 static inline int clientSwitchDb(client *c, int argidx) {
     long long dbid;
     if (getLongLongFromObject(c->argv[argidx],&dbid)) return C_ERR;
@@ -515,6 +524,18 @@ int getKeyRequestsGlobal(int dbid, struct redisCommand *cmd, robj **argv,
     return 0;
 }
 
+/* Used by swap.migrateslot/swap.restoreslot to lock the whole db, so that
+ * no swap of db is inflight while rocksdb accessed on main thread. */
+int getKeyRequestsDb(int dbid, struct redisCommand *cmd, robj **argv,
+        int argc, getKeyRequestsResult *result) {
+    UNUSED(argc);
+    UNUSED(argv);
+    getKeyRequestsPrepareResult(result,result->num+ 1);
+    getKeyRequestsAppendSubkeyResult(result,REQUEST_LEVEL_DB,NULL,0,NULL,
+            cmd->intention,cmd->intention_flags,cmd->flags,dbid);
+    return 0;
+}
+
 int getKeyRequestsMetaScan(int dbid, struct redisCommand *cmd, robj **argv,
         int argc, struct getKeyRequestsResult *result) {
     char randbuf[16] = {0};
@@ -530,6 +551,17 @@ int getKeyRequestsMetaScan(int dbid, struct redisCommand *cmd, robj **argv,
     return 0;
 }
 
+/* Only COUNTKEYSINSLOT/GETKEYSINSLOT need to scan cold keys. */
+int getKeyRequestsCluster(int dbid, struct redisCommand *cmd, robj **argv,
+        int argc, struct getKeyRequestsResult *result) {
+    if ((argc == 3 && !strcasecmp(argv[1]->ptr,"countkeysinslot")) ||
+            (argc == 4 && !strcasecmp(argv[1]->ptr,"getkeysinslot"))) {
+        return getKeyRequestsMetaScan(dbid,cmd,argv,argc,result);
+    } else {
+        return getKeyRequestsNone(dbid,cmd,argv,argc,result);
+    }
+}
+
 int getKeyRequestsOneDestKeyMultiSrcKeys(int dbid, struct redisCommand *cmd, robj **argv,
                                          int argc, struct getKeyRequestsResult *result, int dest_key_Index,
                                                  int first_src_key, int last_src_key) {
@@ -1077,6 +1109,10 @@ int getKeyRequestsZrangeByLex(int dbid, struct redisCommand *cmd, robj **argv, i
     return getKeyRequestsZrangeGeneric(dbid, cmd, argv, argc, result, ZRANGE_LEX, ZRANGE_DIRECTION_FORWARD);
 }
 
+int getKeyRequestsZcount(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
+    return getKeyRequestsZrangeGeneric(dbid, cmd, argv, argc, result, ZRANGE_SCORE, ZRANGE_DIRECTION_FORWARD);
+}
+
 int getKeyRequestsZlexCount(int dbid, struct redisCommand *cmd, robj **argv, int argc, struct getKeyRequestsResult *result) {
     return getKeyRequestsZrangeGeneric(dbid, cmd, argv, argc, result, ZRANGE_LEX, ZRANGE_DIRECTION_FORWARD);
 }
@@ -56,14 +56,35 @@ static sds rocksdbGet(rocksdb_readoptions_t* ropts, int cf, sds rawkey, char** e
     return result;
 }
 
+/* Metas read ahead from meta cf on cache miss: data/score keys are visited
+ * in (dbid,key) order by compaction, so metas of following keys are likely
+ * to be found in the readahead window. Window covers range [start,end) of
+ * meta cf, meta not found in window means it does not exist (end is NULL
+ * if meta cf exhausted). */
+typedef struct metaReadahead {
+    int capacity;
+    int num;
+    sds *metakeys;
+    uint64_t *metaversions;
+    sds start;
+    sds end;
+} metaReadahead;
+
 typedef struct metaVersionFilter {
     uint64_t cached_keyversion;
     sds cached_metakey;
     uint64_t cached_metaversion;
+    metaReadahead readahead; /* capacity 0 if readahead disabled */
 } metaVersionFilter;
 
 static inline metaVersionFilter *metaVersionFilterCreate() {
     metaVersionFilter *mvfilter = zcalloc(sizeof(metaVersionFilter));
+    int capacity = server.swap_compaction_filter_meta_readahead;
+    if (capacity > 0) {
+        mvfilter->readahead.capacity = capacity;
+        mvfilter->readahead.metakeys = zmalloc(sizeof(sds)*capacity);
+        mvfilter->readahead.metaversions = zmalloc(sizeof(uint64_t)*capacity);
+    }
     return mvfilter;
 }
 
@@ -81,6 +102,83 @@ static inline int metaVersionFilterMatchCache(metaVersionFilter *mvfilter,
         sdscmp(mvfilter->cached_metakey, metakey) == 0;
 }
 
+static void metaReadaheadReset(metaReadahead *ra) {
+    for (int i = 0; i < ra->num; i++) sdsfree(ra->metakeys[i]);
+    ra->num = 0;
+    if (ra->start) {
+        sdsfree(ra->start);
+        ra->start = NULL;
+    }
+    if (ra->end) {
+        sdsfree(ra->end);
+        ra->end = NULL;
+    }
+}
+
+/* Returns 1 if metakey in window, meta version (SWAP_VERSION_MAX if meta not
+ * exists) saved in pversion. */
+static int metaReadaheadLookup(metaReadahead *ra, sds metakey,
+        uint64_t *pversion) {
+    int lo = 0, hi = ra->num-1;
+
+    if (ra->start == NULL || sdscmp(metakey,ra->start) < 0 ||
+            (ra->end && sdscmp(metakey,ra->end) >= 0))
+        return 0;
+
+    while (lo <= hi) {
+        int mid = lo + (hi-lo)/2, cmp = sdscmp(ra->metakeys[mid],metakey);
+        if (cmp == 0) {
+            *pversion = ra->metaversions[mid];
+            return 1;
+        } else if (cmp < 0) {
+            lo = mid+1;
+        } else {
+            hi = mid-1;
+        }
+    }
+    *pversion = SWAP_VERSION_MAX;
+    return 1;
+}
+
+/* Iterator created for each readahead rather than each compaction job, so
+ * that metas won't be read from a stale snapshot. */
+static int metaReadaheadFill(metaReadahead *ra, sds metakey, char **err) {
+    rocksdb_iterator_t *iter;
+
+    metaReadaheadReset(ra);
+    iter = rocksdb_create_iterator_cf(server.rocks->db,
+            server.rocks->filter_meta_ropts,server.rocks->cf_handles[META_CF]);
+    rocksdb_iter_seek(iter,metakey,sdslen(metakey));
+    while (rocksdb_iter_valid(iter)) {
+        size_t klen, vlen;
+        const char *rawkey = rocksdb_iter_key(iter,&klen);
+        const char *rawval;
+        uint64_t version;
+
+        if (ra->num >= ra->capacity) {
+            ra->end = sdsnewlen(rawkey,klen);
+            break;
+        }
+        rawval = rocksdb_iter_value(iter,&vlen);
+        /* undecodable meta never filters keys. */
+        if (rocksDecodeMetaVal(rawval,vlen,NULL,NULL,&version,NULL,NULL))
+            version = 0;
+        ra->metakeys[ra->num] = sdsnewlen(rawkey,klen);
+        ra->metaversions[ra->num] = version;
+        ra->num++;
+        rocksdb_iter_next(iter);
+    }
+    rocksdb_iter_get_error(iter,err);
+    rocksdb_iter_destroy(iter);
+
+    if (*err != NULL) {
+        metaReadaheadReset(ra);
+        return -1;
+    }
+    ra->start = sdsdup(metakey);
+    return 0;
+}
+
 static inline void metaVersionFilterDestroy(void* mvfilter_) {
     metaVersionFilter *mvfilter = mvfilter_;
     if (mvfilter == NULL) return;
@@ -88,6 +186,9 @@ static inline void metaVersionFilterDestroy(void* mvfilter_) {
         sdsfree(mvfilter->cached_metakey);
         mvfilter->cached_metakey = NULL;
     }
+    metaReadaheadReset(&mvfilter->readahead);
+    zfree(mvfilter->readahead.metakeys);
+    zfree(mvfilter->readahead.metaversions);
     zfree(mvfilter);
 }
 
@@ -132,7 +233,24 @@ static unsigned char metaVersionFilterFilt(void* mvfilter_, int level, int cf, c
     sds meta_key = encodeMetaKey(dbid, key, key_len);
 
     if (metaVersionFilterMatchCache(mvfilter,key_version,meta_key)) {
+        updateCompactionFiltCacheHitCount(cf);
         meta_version = mvfilter->cached_metaversion;
+    } else if (mvfilter->readahead.capacity > 0) {
+        metaReadahead *ra = &mvfilter->readahead;
+        if (metaReadaheadLookup(ra,meta_key,&meta_version)) {
+            updateCompactionFiltCacheHitCount(cf);
+        } else {
+            updateCompactionFiltRioCount(cf);
+            if (metaReadaheadFill(ra,meta_key,&err)) {
+                serverLog(LL_NOTICE, "[metaVersionFilter] readahead (%s) meta fail: %s ", meta_key, err);
+                /* if error happened, key will not be filtered. */
+                meta_version = key_version;
+                goto end;
+            }
+            serverAssert(metaReadaheadLookup(ra,meta_key,&meta_version));
+        }
+        metaVersionFilterUpdateCache(mvfilter,key_version,meta_key,meta_version);
+        meta_key = NULL; /*moved*/
     } else {
         updateCompactionFiltRioCount(cf);
         meta_val = rocksdbGet(server.rocks->filter_meta_ropts, META_CF, meta_key, &err);
@@ -277,6 +395,7 @@ cfIndexes *cfIndexesNew(uint num) {
     cfIndexes *idxes = zmalloc(sizeof(cfIndexes));
     idxes->num = num;
     idxes->index = zcalloc(sizeof(int) * num);
+    idxes->collect_sst_props = 0;
     return idxes;
 }
 
@@ -400,6 +519,30 @@ static int getExpiredSstInfo(rocksdb_level_metadata_t* level_meta, long long sst
     return sst_recorded_num;
 }
 
+/* Ssts whose stale or expired keys reach percentage of sampled keys, score
+ * (estimated reclaimable bytes) saved in sst_score_arr to be sorted just
+ * like sst age. */
+static int getReclaimableSstInfo(cfMetas *metas, uint percentage, uint *sst_index_arr, uint64_t *sst_score_arr) {
+    int sst_recorded_num = 0;
+
+    for (uint i = 0; i < metas->sst_props_num; i++) {
+        sstExpireProps *props = metas->sst_props[i];
+        if (props == NULL) continue;
+
+        uint reclaim_percentage = sstExpirePropsReclaimPercentage(props, server.mstime);
+        if (reclaim_percentage == 0 || reclaim_percentage < percentage) {
+            continue;
+        }
+
+        sst_index_arr[sst_recorded_num] = i;
+        sst_score_arr[sst_recorded_num] = props->file_size / 100 * reclaim_percentage;
+
+        sst_recorded_num++;
+    }
+
+    return sst_recorded_num;
+}
+
 /*
  * sort the sst to get oldest sst range with the continous index(ascending or descending order).
  */
@@ -495,8 +638,10 @@ void genServerTtlCompactTask(void *result, void *pd, int errcode) {
     cfMetas *metas = result;
     serverAssert(metas->num == 1);
 
+    /* select sst by sampled expire props rather than age if collected. */
+    int expire_aware = metas->sst_props != NULL && server.swap_ttl_compact_expired_percentage > 0;
     long long sst_age_limit = server.swap_ttl_compact_ctx->expire_stats->sst_age_limit;
-    if (!(sst_age_limit > LONG_LONG_MIN && sst_age_limit < LONG_LONG_MAX)) {
+    if (!expire_aware && !(sst_age_limit > LONG_LONG_MIN && sst_age_limit < LONG_LONG_MAX)) {
         /* illegal age limit for sst. */
         cfMetasFree(metas);
         return;
@@ -521,7 +666,13 @@ void genServerTtlCompactTask(void *result, void *pd, int errcode) {
     uint64_t *sst_age_arr = zmalloc(sizeof(uint64_t) * highest_level_sst_num);
     memset(sst_age_arr, 0, sizeof(uint64_t) * highest_level_sst_num);
 
-    uint expired_sst_num = getExpiredSstInfo(level_meta, sst_age_limit, sst_index_arr, sst_age_arr);
+    uint expired_sst_num;
+    if (expire_aware) {
+        serverAssert(metas->sst_props_num == highest_level_sst_num);
+        expired_sst_num = getReclaimableSstInfo(metas, server.swap_ttl_compact_expired_percentage, sst_index_arr, sst_age_arr);
+    } else {
+        expired_sst_num = getExpiredSstInfo(level_meta, sst_age_limit, sst_index_arr, sst_age_arr);
+    }
     if (expired_sst_num == 0) {
         goto end;
     }
@@ -544,6 +695,210 @@ end:
     cfMetasFree(metas);
 }
 
+sstExpireProps *sstExpirePropsNew() {
+    sstExpireProps *props = zcalloc(sizeof(sstExpireProps));
+    props->min_expire = -1;
+    props->max_expire = -1;
+    props->expires = zmalloc(sizeof(long long) * SST_EXPIRE_PROPS_SAMPLE_KEYS);
+    return props;
+}
+
+sstExpireProps *sstExpirePropsDup(sstExpireProps *props) {
+    sstExpireProps *dup = zmalloc(sizeof(sstExpireProps));
+    memcpy(dup, props, sizeof(sstExpireProps));
+    dup->expires = zmalloc(sizeof(long long) * SST_EXPIRE_PROPS_SAMPLE_KEYS);
+    memcpy(dup->expires, props->expires, sizeof(long long) * props->nexpires);
+    return dup;
+}
+
+void sstExpirePropsFree(sstExpireProps *props) {
+    if (props == NULL) return;
+    zfree(props->expires);
+    zfree(props);
+}
+
+/* Percentage of sampled keys that could be reclaimed by compaction at now:
+ * stale ones (dropped by compaction filter) and expired ones (dropped by
+ * compaction filter after active expire deletes their metas). */
+uint sstExpirePropsReclaimPercentage(sstExpireProps *props, long long now) {
+    uint expired = 0;
+    if (props->sampled == 0) return 0;
+    while (expired < props->nexpires && props->expires[expired] <= now) {
+        expired++;
+    }
+    return (props->stale + expired) * 100 / props->sampled;
+}
+
+static int expireCompare(const void *a, const void *b) {
+    long long ea = *(const long long*)a, eb = *(const long long*)b;
+    return ea < eb ? -1 : (ea > eb ? 1 : 0);
+}
+
+static void sstExpirePropsAddKey(sstExpireProps *props, int dbid, const char *key,
+        size_t keylen, uint64_t version, char **err) {
+    int swap_type;
+    long long expire;
+    uint64_t meta_version;
+    const char *extend;
+    size_t extend_len;
+
+    sds meta_key = encodeMetaKey(dbid, key, keylen);
+    sds meta_val = rocksdbGet(server.rocks->ropts, META_CF, meta_key, err);
+    sdsfree(meta_key);
+    if (*err != NULL) return;
+
+    if (meta_val == NULL) {
+        props->stale++;
+    } else if (rocksDecodeMetaVal(meta_val, sdslen(meta_val), &swap_type, &expire,
+                &meta_version, &extend, &extend_len)) {
+        /* undecodable meta never filters keys, not sampled. */
+        sdsfree(meta_val);
+        return;
+    } else if (meta_version > version) {
+        props->stale++;
+    } else if (expire == -1) {
+        props->persist++;
+    } else {
+        props->expires[props->nexpires++] = expire;
+        if (props->min_expire == -1 || expire < props->min_expire) props->min_expire = expire;
+        if (expire > props->max_expire) props->max_expire = expire;
+    }
+    props->sampled++;
+    if (meta_val) sdsfree(meta_val);
+}
+
+/* Sample first SST_EXPIRE_PROPS_SAMPLE_KEYS keys in range of sst, each key
+ * sampled once no matter how many subkeys it has. Note that keys of other
+ * levels in the range are sampled too, which is fine for bottommost level. */
+static sstExpireProps *sstExpirePropsSample(rocksdb_sst_file_metadata_t *sst_meta, char **err) {
+    size_t smallest_len, largest_len;
+    char *smallest = rocksdb_sst_file_metadata_get_smallestkey(sst_meta, &smallest_len);
+    char *largest = rocksdb_sst_file_metadata_get_largestkey(sst_meta, &largest_len);
+    sds upper_bound = sdscatlen(sdsnewlen(largest, largest_len), "\0", 1);
+    sstExpireProps *props = sstExpirePropsNew();
+    props->file_size = rocksdb_sst_file_metadata_get_size(sst_meta);
+
+    rocksdb_readoptions_t *ropts = rocksdb_readoptions_create();
+    rocksdb_readoptions_set_iterate_upper_bound(ropts, upper_bound, sdslen(upper_bound));
+    rocksdb_readoptions_set_total_order_seek(ropts, 1);
+    rocksdb_iterator_t *iter = rocksdb_create_iterator_cf(server.rocks->db,
+            ropts, server.rocks->cf_handles[DATA_CF]);
+
+    rocksdb_iter_seek(iter, smallest, smallest_len);
+    while (rocksdb_iter_valid(iter) && props->sampled < SST_EXPIRE_PROPS_SAMPLE_KEYS) {
+        int dbid;
+        const char *key, *subkey;
+        size_t rawkey_len, keylen, subkeylen;
+        uint64_t version;
+        const char *rawkey = rocksdb_iter_key(iter, &rawkey_len);
+
+        /* string (version zero) are not filtered by compaction filter. */
+        if (rocksDecodeDataKey(rawkey, rawkey_len, &dbid, &key, &keylen,
+                    &version, &subkey, &subkeylen) || version == SWAP_VERSION_ZERO ||
+                dbid < 0 || dbid >= server.dbnum) {
+            rocksdb_iter_next(iter);
+            continue;
+        }
+
+        sstExpirePropsAddKey(props, dbid, key, keylen, version, err);
+        if (*err != NULL) break;
+
+        /* skip subkeys of current key. */
+        sds keysds = sdsnewlen(key, keylen);
+        sds next = rocksEncodeDataRangeEndKey(server.db+dbid, keysds, version);
+        rocksdb_iter_seek(iter, next, sdslen(next));
+        sdsfree(keysds);
+        sdsfree(next);
+    }
+    if (*err == NULL) rocksdb_iter_get_error(iter, err);
+
+    rocksdb_iter_destroy(iter);
+    rocksdb_readoptions_destroy(ropts);
+    sdsfree(upper_bound);
+    zlibc_free(smallest);
+    zlibc_free(largest);
+
+    if (*err != NULL) {
+        sstExpirePropsFree(props);
+        return NULL;
+    }
+    qsort(props->expires, props->nexpires, sizeof(long long), expireCompare);
+    return props;
+}
+
+static void sstExpirePropsDictValDestructor(void *privdata, void *val) {
+    UNUSED(privdata);
+    sstExpirePropsFree(val);
+}
+
+static dictType sstExpirePropsDictType = {
+    dictSdsHash,                    /* hash function */
+    NULL,                           /* key dup */
+    NULL,                           /* val dup */
+    dictSdsKeyCompare,              /* key compare */
+    dictSdsDestructor,              /* key destructor */
+    sstExpirePropsDictValDestructor,/* val destructor */
+    NULL,                           /* allow to expand */
+};
+
+/* sst name => sstExpireProps, only accessed by util thread. Ssts dropped
+ * by compaction are evicted every time props collected. */
+static dict *sst_expire_props_cache = NULL;
+
+/* Called in util thread: collect props of ssts in highest level with sst of
+ * cf_meta[0] (data cf), props sampled only if sst not cached. */
+void collectSstExpireProps(cfMetas *metas) {
+    dict *cache = dictCreate(&sstExpirePropsDictType, NULL);
+    rocksdb_level_metadata_t *level_meta = getHighestLevelMetaWithSST(metas->cf_meta[0]);
+
+    if (level_meta != NULL) {
+        size_t level_sst_num = rocksdb_level_metadata_get_file_count(level_meta);
+        metas->sst_props_num = level_sst_num;
+        metas->sst_props = zcalloc(sizeof(sstExpireProps*) * level_sst_num);
+
+        for (uint i = 0; i < level_sst_num; i++) {
+            sstExpireProps *props = NULL;
+            char *err = NULL;
+            rocksdb_sst_file_metadata_t *sst_meta = rocksdb_level_metadata_get_sst_file_metadata(level_meta, i);
+            if (sst_meta == NULL) continue;
+
+            char *name = rocksdb_sst_file_metadata_get_relative_filename(sst_meta);
+            sds sst_name = sdsnew(name);
+            zlibc_free(name);
+
+            /* same name could be reused by another sst after reopen. */
+            dictEntry *de = sst_expire_props_cache ? dictFind(sst_expire_props_cache, sst_name) : NULL;
+            if (de && ((sstExpireProps*)dictGetVal(de))->file_size == rocksdb_sst_file_metadata_get_size(sst_meta)) {
+                props = dictGetVal(de);
+                dictSetVal(sst_expire_props_cache, de, NULL);
+            } else {
+                props = sstExpirePropsSample(sst_meta, &err);
+                if (props != NULL) {
+                    atomicIncr(server.swap_ttl_compact_ctx->stat_sampled_sst_count, 1);
+                } else {
+                    serverLog(LL_NOTICE, "[rocksdb] sample sst(%s) expire props failed: %s", sst_name, err);
+                    zlibc_free(err);
+                }
+            }
+            rocksdb_sst_file_metadata_destroy(sst_meta);
+
+            if (props == NULL) {
+                sdsfree(sst_name);
+                continue;
+            }
+            metas->sst_props[i] = sstExpirePropsDup(props);
+            if (dictAdd(cache, sst_name, props) != DICT_OK) {
+                sstExpirePropsFree(props);
+                sdsfree(sst_name);
+            }
+        }
+        rocksdb_level_metadata_destroy(level_meta);
+    }
+
+    if (sst_expire_props_cache) dictRelease(sst_expire_props_cache);
+    sst_expire_props_cache = cache;
+}
+
 long long getServerMstime() {
     return server.mstime;
 }
@@ -570,6 +925,18 @@ void swapExpireStatusReset(swapExpireStatus *stats) {
     stats->sst_age_limit = SWAP_TTL_COMPACT_INVALID_EXPIRE; 
 }
 
+/* Sample expire time of a cold key (-1 if no ttl) for sst age limit. */
+void swapExpireStatusSample(swapExpireStatus *stats, long long expire) {
+    long long expire_add;
+    if (expire != -1) {
+        expire_add = expire - server.mstime;
+    } else {
+        expire_add = SWAP_TTL_COMPACT_INVALID_EXPIRE;
+    }
+    int res = wtdigestAdd(stats->expire_wt, (double)expire_add, 1);
+    serverAssert(res == 0);
+}
+
 swapTtlCompactCtx *swapTtlCompactCtxNew() {
     swapTtlCompactCtx *ctx = zcalloc(sizeof(swapTtlCompactCtx));
 
@@ -579,6 +946,7 @@ swapTtlCompactCtx *swapTtlCompactCtxNew() {
     ctx->stat_request_sst_count = 0;
     ctx->stat_expired_sst_count = 0;
     ctx->stat_compacted_data_size = 0;
+    ctx->stat_sampled_sst_count = 0;
     return ctx;
 }
 
@@ -614,6 +982,8 @@ cfMetas *cfMetasNew(uint cf_num) {
     cfMetas *metas = zmalloc(sizeof(cfMetas));
     metas->num = cf_num;
     metas->cf_meta = zcalloc(sizeof(rocksdb_column_family_metadata_t*));
+    metas->sst_props_num = 0;
+    metas->sst_props = NULL;
     return metas;
 }
 
@@ -623,6 +993,10 @@ void cfMetasFree(cfMetas *metas) {
             rocksdb_column_family_metadata_destroy(metas->cf_meta[i]);
         }
     }
+    for (uint i = 0; i < metas->sst_props_num; i++) {
+        sstExpirePropsFree(metas->sst_props[i]);
+    }
+    zfree(metas->sst_props);
     zfree(metas->cf_meta);
     zfree(metas);
 }
@@ -631,12 +1005,13 @@ sds genSwapTtlCompactInfoString(sds info) {
     info = sdscatprintf(info,
             "swap_ttl_compact:times=%llu,request_sst_count=%llu,"
             "expired_sst_count=%llu,compacted_data_size=%llu,"
-            "sst_age_limit=%lld\r\n",
+            "sst_age_limit=%lld,sampled_sst_count=%llu\r\n",
             server.swap_ttl_compact_ctx->stat_request_compact_times,
             server.swap_ttl_compact_ctx->stat_request_sst_count,
             server.swap_ttl_compact_ctx->stat_expired_sst_count,
             server.swap_ttl_compact_ctx->stat_compacted_data_size,
-            server.swap_ttl_compact_ctx->expire_stats->sst_age_limit);
+            server.swap_ttl_compact_ctx->expire_stats->sst_age_limit,
+            server.swap_ttl_compact_ctx->stat_sampled_sst_count);
     return info;
 }
 
@@ -892,6 +1267,63 @@ int swapFilterTest(int argc, char **argv, int accurate) {
             test_assert(filt_count == 0);
             test_assert(scan_count >= 1);
         }
+
+        /* metas of following keys found (or known absent) by readahead */
+        {
+            long long rio_count, cache_hit_count;
+            sds rawkeys[9], rawmetakeys[8];
+            sds extend = rocksEncodeObjectMetaLen(1);
+            sds rawmetaval = rocksEncodeMetaVal(OBJ_HASH, -1, 1, extend);
+
+            rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF], NULL, 0, NULL, 0);
+            resetStatsSwap();
+            server.swap_compaction_filter_meta_readahead = 64;
+
+            for (int i = 0; i < 8; i++) {
+                sds key = sdscatprintf(sdsempty(),"ra%d",i);
+                rawkeys[i] = rocksEncodeDataKey(db, key, 1, subkey);
+                rawmetakeys[i] = rocksEncodeMetaKey(db, key);
+                rocksdbPut(DATA_CF,rawkeys[i],val1->ptr, &err);
+                test_assert(err == NULL);
+                rocksdbPut(META_CF,rawmetakeys[i],rawmetaval, &err);
+                test_assert(err == NULL);
+                sdsfree(key);
+            }
+            /* meta of ra4x absent, but in readahead window of ra4 */
+            sds absent = sdsnew("ra4x");
+            rawkeys[8] = rocksEncodeDataKey(db, absent, 1, subkey);
+            rocksdbPut(DATA_CF,rawkeys[8],val1->ptr, &err);
+            test_assert(err == NULL);
+            sdsfree(absent);
+
+            rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF], NULL, 0, NULL, 0);
+            for (int i = 0; i < 9; i++) {
+                sds val = rocksdbGet(server.rocks->ropts, DATA_CF, rawkeys[i], &err);
+                test_assert(err == NULL);
+                test_assert(i < 8 ? val != NULL : val == NULL);
+                if (val) sdsfree(val);
+            }
+
+            atomicGet(server.ror_stats->compaction_filter_stats[DATA_CF].filt_count, filt_count);
+            atomicGet(server.ror_stats->compaction_filter_stats[DATA_CF].rio_count, rio_count);
+            atomicGet(server.ror_stats->compaction_filter_stats[DATA_CF].cache_hit_count, cache_hit_count);
+            test_assert(filt_count == 1);
+            /* subcompactions may read ahead separately. */
+            test_assert(rio_count + cache_hit_count == 9);
+            test_assert(cache_hit_count > 0);
+
+            for (int i = 0; i < 8; i++) {
+                rocksdbDelete(META_CF, rawmetakeys[i], &err);
+                test_assert(err == NULL);
+                rocksdbDelete(DATA_CF, rawkeys[i], &err);
+                test_assert(err == NULL);
+                sdsfree(rawkeys[i]);
+                sdsfree(rawmetakeys[i]);
+            }
+            sdsfree(rawkeys[8]);
+            sdsfree(rawmetaval);
+            sdsfree(extend);
+        }
    }
 
    TEST("exec: score compaction filter -data") {
@@ -1090,6 +1522,90 @@ int swapFilterTest(int argc, char **argv, int accurate) {
             compactTaskFree(server.swap_ttl_compact_ctx->task);
     }
 
+    TEST("server ttl compact task - select sst by expire props") {
+        server.swap_ttl_compact_ctx = swapTtlCompactCtxNew();
+        const char *keys[4] = {"ttl-live", "ttl-expired", "ttl-nometa", "ttl-stale"};
+        long long expires[4] = {-1, 1, -1, -1};
+        uint64_t meta_versions[4] = {1, 2, 0, 5};
+        uint64_t data_versions[4] = {1, 2, 3, 4};
+
+        for (int i = 0; i < 4; i++) {
+            sds key = sdsnew(keys[i]);
+            for (int j = 0; j < 3; j++) {
+                sds sk = sdscatfmt(sdsempty(), "sk%i", j);
+                sds rawkey = rocksEncodeDataKey(db, key, data_versions[i], sk);
+                rocksdbPut(DATA_CF, rawkey, val1->ptr, &err);
+                test_assert(err == NULL);
+                sdsfree(rawkey);
+                sdsfree(sk);
+            }
+            if (meta_versions[i]) {
+                sds rawmetakey = rocksEncodeMetaKey(db, key);
+                sds extend = rocksEncodeObjectMetaLen(3);
+                sds rawmetaval = rocksEncodeMetaVal(OBJ_HASH, expires[i], meta_versions[i], extend);
+                rocksdbPut(META_CF, rawmetakey, rawmetaval, &err);
+                test_assert(err == NULL);
+                sdsfree(rawmetakey);
+                sdsfree(rawmetaval);
+                sdsfree(extend);
+            }
+            sdsfree(key);
+        }
+
+        /* keep data intact while moving it to bottommost level. */
+        setFilterState(FILTER_STATE_CLOSE);
+        rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF], NULL, 0, NULL, 0);
+        setFilterState(FILTER_STATE_OPEN);
+
+        cfMetas *cf_metas = cfMetasNew(1);
+        cf_metas->cf_meta[0] = rocksdb_get_column_family_metadata_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF]);
+        collectSstExpireProps(cf_metas);
+        test_assert(cf_metas->sst_props_num == 1);
+        sstExpireProps *props = cf_metas->sst_props[0];
+        test_assert(props->sampled == 4);
+        test_assert(props->stale == 2);
+        test_assert(props->persist == 1);
+        test_assert(props->nexpires == 1);
+        test_assert(props->min_expire == 1 && props->max_expire == 1);
+        test_assert(sstExpirePropsReclaimPercentage(props, 0) == 50);
+        test_assert(sstExpirePropsReclaimPercentage(props, 1) == 75);
+        long long sampled_sst_count;
+        atomicGet(server.swap_ttl_compact_ctx->stat_sampled_sst_count, sampled_sst_count);
+        test_assert(sampled_sst_count == 1);
+
+        /* not enough to reclaim */
+        server.swap_ttl_compact_expired_percentage = 80;
+        genServerTtlCompactTask(cf_metas, cfIndexesNew(1), 0);
+        test_assert(server.swap_ttl_compact_ctx->task == NULL);
+
+        /* props cached for unchanged sst */
+        server.swap_ttl_compact_expired_percentage = 70;
+        cf_metas = cfMetasNew(1);
+        cf_metas->cf_meta[0] = rocksdb_get_column_family_metadata_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF]);
+        collectSstExpireProps(cf_metas);
+        atomicGet(server.swap_ttl_compact_ctx->stat_sampled_sst_count, sampled_sst_count);
+        test_assert(sampled_sst_count == 1);
+        genServerTtlCompactTask(cf_metas, cfIndexesNew(1), 0);
+        test_assert(server.swap_ttl_compact_ctx->task != NULL);
+        test_assert(server.swap_ttl_compact_ctx->task->count == 1);
+        test_assert(server.swap_ttl_compact_ctx->task->key_range[0]->cf_index == DATA_CF);
+
+        /* clean */
+        for (int i = 0; i < 4; i++) {
+            sds key = sdsnew(keys[i]);
+            sds rawmetakey = rocksEncodeMetaKey(db, key);
+            rocksdbDelete(META_CF, rawmetakey, &err);
+            test_assert(err == NULL);
+            sdsfree(rawmetakey);
+            sdsfree(key);
+        }
+        rocksdb_compact_range_cf(server.rocks->db, server.rocks->cf_handles[DATA_CF], NULL, 0, NULL, 0);
+
+        server.swap_ttl_compact_expired_percentage = 0;
+        swapTtlCompactCtxFree(server.swap_ttl_compact_ctx);
+        server.swap_ttl_compact_ctx = NULL;
+    }
+
     TEST("swapTtlCompactCtx - new & reset & free") {
         
         server.swap_ttl_compact_ctx = swapTtlCompactCtxNew();
@@ -47,6 +47,9 @@ int swapDataAlreadySetup(swapData *data) {
 }
 
 int swapDataMayContainSubkey(swapData *data, int thd, robj *subkey) {
+    /* subkey filter bound to data, safe to access from swap thread. */
+    if (!subkeyFilterMayContain(data->subkey_filter,
+                swapDataObjectVersion(data),subkey->ptr)) return 0;
     /* To avoid lock, only main thread access absent cache. */
     if (thd != SWAP_ANA_THD_MAIN) return 1;
     return coldFilterMayContainSubkey(data->db->cold_filter,data->key->ptr,subkey->ptr);
@@ -214,6 +217,21 @@ inline int swapDataEncodeRange(struct swapData *d, int intention, void *datactx,
         return 0;
 }
 
+/* Swap-thread: sorted rawkeys skipped by iterate (ref, owned by datactx). */
+inline void swapDataEncodeRangeExcludes(struct swapData *d, void *datactx,
+        sds **excludes, int *num) {
+    *excludes = NULL, *num = 0;
+    if (d->type->encodeRangeExcludes)
+        d->type->encodeRangeExcludes(d,datactx,excludes,num);
+}
+
+inline sds swapDataEncodeRangeMatch(struct swapData *d, void *datactx) {
+    if (d->type->encodeRangeMatch)
+        return d->type->encodeRangeMatch(d,datactx);
+    else
+        return NULL;
+}
+
 /* Swap-thread: decode val/subval from rawvalss returned by rocksdb. */
 inline int swapDataDecodeData(swapData *d, int num, int *cfs, sds *rawkeys,
         sds *rawvals, void **decoded) {
@@ -355,6 +373,11 @@ sds swapDataEncodeMetaKey(swapData *d) {
     return rocksEncodeMetaKey(d->db,(sds)d->key->ptr);
 }
 
+sds swapDataEncodeExpireIndexKey(swapData *d) {
+    return rocksEncodeExpireIndexKey(d->db->id,d->expire,d->key->ptr,
+            sdslen(d->key->ptr));
+}
+
 int swapDataSetupMeta(swapData *d, int swap_type, long long expire,
         void **datactx) {
     int retval;
@@ -389,6 +412,9 @@ int swapDataSetupMeta(swapData *d, int swap_type, long long expire,
     case SWAP_TYPE_STREAM:
         retval = SWAP_ERR_SETUP_UNSUPPORTED;
         break;
+    case SWAP_TYPE_MODULE:
+        retval = swapDataSetupModule(d, datactx);
+        break;
     case SWAP_TYPE_BITMAP:
         retval = swapDataSetupBitmap(d, datactx);
         break;
@@ -434,7 +460,35 @@ void swapDataTurnCold(swapData *data) {
     data->db->cold_keys++;
 }
 
+/* Main-thread: subkeys swapped out (persisted to rocksdb), nsubkeys is the
+ * total number of subkeys of the key. */
+void swapDataSubkeysSwappedOut(swapData *data, robj **subkeys, int num,
+        size_t nsubkeys) {
+    coldFilter *filter = data->db->cold_filter;
+    uint64_t version = swapDataObjectVersion(data);
+
+    /* nothing persisted for a fresh version, filter could start empty. */
+    if (data->new_meta) {
+        data->subkey_filter = coldFilterCreateSubkeyFilter(filter,
+                data->key->ptr,version,nsubkeys);
+    }
+
+    if (data->subkey_filter == NULL ||
+            data->subkey_filter->version != version) return;
+
+    for (int i = 0; i < num; i++) {
+        if (coldFilterSubkeyFilterInsert(filter,data->subkey_filter,
+                    subkeys[i]->ptr) == C_ERR) {
+            coldFilterDeleteSubkeyFilter(filter,data->key->ptr);
+            data->subkey_filter = NULL;
+            break;
+        }
+    }
+}
+
 void swapDataTurnDeleted(swapData *data, int del_skip) {
+    coldFilterDeleteSubkeyFilter(data->db->cold_filter,data->key->ptr);
+    data->subkey_filter = NULL;
     if (swapDataIsCold(data)) {
         data->db->cold_keys--;
         coldFilterDeleteKey(data->db->cold_filter,data->key->ptr);
@@ -76,6 +76,8 @@ static int getCfOrReply(client *c, robj *cf) {
         return DATA_CF;
     } else if (!strcasecmp(cf->ptr, "score")) {
         return SCORE_CF;
+    } else if (!strcasecmp(cf->ptr, "expire")) {
+        return EXPIRE_CF;
     } else {
         addReplyError(c,"invalid cf");
         return -1;
@@ -169,6 +171,12 @@ NULL
         sds info = sdscatprintf(sdsempty(),
                 "value: %s\nhot_meta: %s\ncold_meta: %s\n",
                 value_info,hot_meta_info,cold_meta_info);
+        subkeyClock *clock = subkeyClockLookup(db,key);
+        if (clock) {
+            sds clock_info = genSubkeyClockInfo(clock);
+            info = sdscatprintf(info,"subkey_clock: %s\n",clock_info);
+            sdsfree(clock_info);
+        }
         addReplyVerbatim(c,info,sdslen(info),"txt");
         sdsfree(value_info);
         sdsfree(hot_meta_info);
@@ -237,8 +237,86 @@ void swapEvictionCtxFree(swapEvictionCtx *ctx) {
     zfree(ctx);
 }
 
-static inline void swapEvictionCtxUpdateStat(swapEvictionCtx *ctx, int evict_result) {
+static inline void swapEvictionCtxUpdateStat(swapEvictionCtx *ctx,
+        int evict_result, size_t mem_freed) {
     ctx->stat.evict_result[evict_result]++;
+    if (evictResultIsSucc(evict_result)) ctx->stat.freed_bytes += mem_freed;
+    if (evict_result == EVICT_SUCC_SWAPPED) ctx->stat.rio_count++;
+}
+
+/* Subkeys that would be swapped out with key (and back in later). Hash, set
+ * and zset might be merged by swap thread in createOrMergeObject, so length
+ * is only inspected if key is not locked, otherwise default count is used
+ * as objectEstimateSize does. */
+static size_t swapEvictionSubkeys(redisDb *db, robj *keyobj, robj *o) {
+    int locked;
+
+    if (o->type == OBJ_LIST) return listTypeLength(o);
+    if (o->type != OBJ_HASH && o->type != OBJ_SET && o->type != OBJ_ZSET)
+        return 0;
+
+    locked = lockWouldBlock(server.swap_txid++,db,keyobj);
+    switch (o->type) {
+    case OBJ_HASH:
+        return locked ? DEFAULT_HASH_FIELD_COUNT : hashTypeLength(o);
+    case OBJ_SET:
+        return locked ? DEFAULT_SET_MEMBER_COUNT : setTypeSize(o);
+    default: /* OBJ_ZSET */
+        return locked ? DEFAULT_ZSET_MEMBER_COUNT : zsetLength(o);
+    }
+}
+
+static size_t swapEvictionEstimateSize(robj *o, size_t subkeys) {
+    switch (o->type) {
+    case OBJ_HASH:
+        return subkeys*DEFAULT_HASH_FIELD_SIZE;
+    case OBJ_SET:
+        return subkeys*DEFAULT_SET_MEMBER_SIZE;
+    case OBJ_ZSET:
+        return subkeys*DEFAULT_ZSET_MEMBER_SIZE;
+    default:
+        return objectEstimateSize(o);
+    }
+}
+
+/* Measured swap in latency (us) per rio for type, falls back to the
+ * average of all types and then to 1 if nothing measured yet. */
+static double swapEvictionRIOLatency(int type) {
+    size_t count, time, total_count = 0, total_time = 0;
+
+    for (int i = 0; i < SWAP_TYPE_COUNT; i++) {
+        atomicGet(server.ror_stats->swapin_rio_count[i],count);
+        atomicGet(server.ror_stats->swapin_rio_time[i],time);
+        if (i == type && count) return (double)(time ? time : 1)/count;
+        total_count += count;
+        total_time += time;
+    }
+    if (total_count && total_time) return (double)total_time/total_count;
+    return 1;
+}
+
+/* Expected latency to swap key back in: one rio for meta/value, plus
+ * iterating subkeys in batches. */
+static inline double swapEvictionSwapInCost(robj *o, size_t subkeys) {
+    double rios = 1 + (double)subkeys/SWAP_EVICT_SUBKEYS_PER_RIO;
+    return rios*swapEvictionRIOLatency(o->type);
+}
+
+/* Weight policy score (idle time or inverted frequency, higher evicts
+ * first) by estimated bytes freed per expected swap-in latency. */
+unsigned long long swapEvictionCostAwareScore(redisDb *db, sds key,
+        robj *o, unsigned long long score) {
+    robj keyobj;
+    size_t subkeys;
+    double weighted;
+
+    if (o == NULL || score == 0) return score;
+    initStaticStringObject(keyobj,key);
+    subkeys = swapEvictionSubkeys(db,&keyobj,o);
+    weighted = (double)score * swapEvictionEstimateSize(o,subkeys) /
+        swapEvictionSwapInCost(o,subkeys);
+    if (!objectIsDirty(o)) weighted *= SWAP_EVICT_CLEAN_WEIGHT;
+    return weighted >= (double)ULLONG_MAX ? ULLONG_MAX : (unsigned long long)weighted;
 }
 
 inline size_t performEvictionSwapSelectedKey(swapEvictKeysCtx *sectx, redisDb *db,
@@ -266,7 +344,7 @@ inline size_t performEvictionSwapSelectedKey(swapEvictKeysCtx *sectx, redisDb *d
     } else {
         ctx->failed_inrow++;
     }
-    swapEvictionCtxUpdateStat(ctx,evict_result);
+    swapEvictionCtxUpdateStat(ctx,evict_result,mem_freed);
 
     latencyEndMonitor(eviction_latency);
     latencyAddSampleIfNeeded("swap-eviction",eviction_latency);
@@ -321,9 +399,20 @@ sds genSwapEvictionInfoString(sds info) {
         }
     }
     info = sdscatprintf(info,"\r\n");
+
+    info = sdscatprintf(info,
+            "swap_evict_efficiency:cost_aware=%d,freed_bytes=%lld,rios=%lld,bytes_per_rio=%lld\r\n",
+            server.swap_evict_cost_aware,ctx->stat.freed_bytes,ctx->stat.rio_count,
+            ctx->stat.rio_count ? ctx->stat.freed_bytes/ctx->stat.rio_count : 0);
     return info;
 }
 
+void resetSwapEvictionStats() {
+    swapEvictionCtx *ctx = server.swap_eviction_ctx;
+    if (ctx == NULL) return;
+    memset(&ctx->stat,0,sizeof(ctx->stat));
+}
+
 /* ----------------------------- evict asap ------------------------------ */
 #define EVICT_ASAP_KEYS_LIMIT 256
 
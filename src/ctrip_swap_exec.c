@@ -241,10 +241,46 @@ void swapRequestExecuteUtil_CollectCfMeta(swapRequest* req) {
         cf_metas->cf_meta[i] = rocksdb_get_column_family_metadata_cf(rocks->db, rocks->cf_handles[cf_indexes->index[i]]);
     }
 
+    if (cf_indexes->collect_sst_props) {
+        collectSstExpireProps(cf_metas);
+    }
+
     utilctx->result = cf_metas;
     serverRocksUnlock(rocks);
 }
 
+void swapRequestExecuteUtil_IngestSpillRun(swapRequest *req) {
+    char *err = NULL;
+    rocksdbUtilTaskCtx *utilctx = req->finish_pd;
+    rdbLoadIngestRun *run = utilctx->argument;
+
+    rdbLoadIngestRunSpill(run,&err);
+    if (err != NULL) {
+        serverLog(LL_WARNING,"[rocksdb] spill ingest run(%s) failed: %s",
+                run->path,err);
+        swapRequestSetError(req,SWAP_ERR_EXEC_FAIL);
+        zlibc_free(err);
+    }
+    utilctx->result = run;
+}
+
+void swapRequestExecuteUtil_IngestMergeRuns(swapRequest *req) {
+    char *err = NULL;
+    rocks *rocks = serverRocksGetReadLock();
+    rocksdbUtilTaskCtx *utilctx = req->finish_pd;
+    rdbLoadIngestMerge *merge = utilctx->argument;
+
+    rdbLoadIngestMergeRuns(merge,&err);
+    if (err != NULL) {
+        serverLog(LL_WARNING,"[rocksdb] merge ingest runs of cf(%s) failed: %s",
+                swap_cf_names[merge->cf],err);
+        swapRequestSetError(req,SWAP_ERR_EXEC_FAIL);
+        zlibc_free(err);
+    }
+    utilctx->result = merge;
+    serverRocksUnlock(rocks);
+}
+
 void swapRequestExecuteUtil(swapRequest *req) {
     switch(req->intention_flags) {
     case ROCKSDB_COMPACT_RANGE_TASK:
@@ -262,6 +298,12 @@ void swapRequestExecuteUtil(swapRequest *req) {
     case ROCKSDB_CREATE_CHECKPOINT:
         swapRequestExecuteUtil_CreateCheckpoint(req);
         break;
+    case ROCKSDB_INGEST_SPILL_RUN_TASK:
+        swapRequestExecuteUtil_IngestSpillRun(req);
+        break;
+    case ROCKSDB_INGEST_MERGE_RUNS_TASK:
+        swapRequestExecuteUtil_IngestMergeRuns(req);
+        break;
     default:
         swapRequestSetError(req,SWAP_ERR_EXEC_UNEXPECTED_UTIL);
         break;
@@ -288,6 +330,12 @@ void swapRequestMerge(swapRequest *req) {
 
         break;
     case SWAP_IN:
+        if (req->intention_flags & SWAP_EXEC_IN_PUSHDOWN) {
+            /* keyspace untouched, result serves current command only. */
+            swapRequestPushdown(req);
+            swapDataMergeAbsentSubkey(data);
+            break;
+        }
         retval = swapDataSwapIn(data,req->result,datactx);
         if (retval == 0) {
             if (swapDataIsCold(data) && req->result) {
@@ -304,6 +352,13 @@ void swapRequestMerge(swapRequest *req) {
         if (!swapDataIsCold(data)) {
             if (swap_out_completely) {
                 swapDataTurnCold(data);
+                /* scan expire by index can't sample expire of cold keys. */
+                if (server.swap_ttl_compact_enabled &&
+                        server.swap_expire_index_enabled && iAmMaster()) {
+                    swapExpireStatusSample(
+                            server.swap_ttl_compact_ctx->expire_stats,
+                            data->expire);
+                }
             } else {
                 coldFilterSubkeyAdded(data->db->cold_filter,data->key->ptr);
             }
@@ -341,6 +396,20 @@ void swapExecBatchUpdateStatsRIOBatch(swapExecBatch *exec_batch,
     atomicIncr(server.swap_inprogress_memory,payload_size);
 }
 
+/* Swap in rio latency by swap type, used to weight swap in cost when
+ * evicting. Batch latency is shared evenly among rios. */
+static void swapExecBatchUpdateStatsSwapInRIO(swapExecBatch *exec_batch,
+        long duration) {
+    size_t rio_time = exec_batch->count ? duration/exec_batch->count : 0;
+    for (size_t i = 0; i < exec_batch->count; i++) {
+        swapRequest *req = exec_batch->reqs[i];
+        int swap_type = req->data->swap_type;
+        if (swap_type < 0 || swap_type >= SWAP_TYPE_COUNT) continue;
+        atomicIncr(server.ror_stats->swapin_rio_count[swap_type],1);
+        atomicIncr(server.ror_stats->swapin_rio_time[swap_type],rio_time);
+    }
+}
+
 /* Note that, to keep rio count align with req, an empty rio will be append
  * to rios. */
 static
@@ -373,6 +442,15 @@ void swapExecBatchPrepareRIOBatch(swapExecBatch *exec_batch, RIOBatch *rios) {
                 serverAssert(start == NULL);
             }
             RIOInitIterate(rio,cf,flags,start,end,limit);
+            if (!errcode) {
+                sds *excludes;
+                int numexcludes;
+                swapDataEncodeRangeExcludes(req->data,req->datactx,
+                        &excludes,&numexcludes);
+                RIOIterateSetExcludes(rio,excludes,numexcludes);
+                RIOIterateSetMatch(rio,swapDataEncodeRangeMatch(req->data,
+                            req->datactx));
+            }
             break;
         case ROCKS_PUT:
             if ((errcode = swapDataEncodeData(req->data,req->intention,
@@ -424,13 +502,13 @@ static void swapRequestInIntentionDelEncodeKeys(swapRequest *req, RIO *rio,
 
     /* There is no need to delete subkey if meta gets deleted,
      * subkeys will be deleted by compaction filter (except for
-     * string type, which is not deleted by compaction filter). */
+     * whole key types, which are not deleted by compaction filter). */
 
     if (merged_is_hot) {
         meta_rawkey = swapDataEncodeMetaKey(req->data);
     }
 
-    if (!merged_is_hot || req->data->swap_type == SWAP_TYPE_STRING) {
+    if (!merged_is_hot || swapTypeIsWholeKey(req->data->swap_type)) {
         int *rio_cfs = NULL, rio_numkeys = 0;
         sds *rio_rawkeys = NULL, *rio_rawvals = NULL;
 
@@ -573,13 +651,16 @@ static void swapExecBatchExecuteIntentionDel(swapExecBatch *exec_batch,
 void swapExecBatchExecuteIn(swapExecBatch *exec_batch) {
     RIOBatch _rios = {0}, *rios = &_rios;
     int errcode, action = exec_batch->action;
+    monotime rio_timer;
     void *decoded;
 
     serverAssert(action == ROCKS_GET || action == ROCKS_ITERATE);
 
     RIOBatchInit(rios,action);
     swapExecBatchPrepareRIOBatch(exec_batch,rios);
+    elapsedStart(&rio_timer);
     swapExecBatchDoRIOBatch(exec_batch,rios);
+    swapExecBatchUpdateStatsSwapInRIO(exec_batch,elapsedUs(rio_timer));
 
     for (size_t i = 0; i < exec_batch->count; i++) {
         swapRequest *req = exec_batch->reqs[i];
@@ -604,6 +685,7 @@ void swapExecBatchExecuteIn(swapExecBatch *exec_batch) {
                 req->data->nextseek = rio->iterate.nextseek;
                 rio->iterate.nextseek = NULL;
             }
+            req->data->iterate_count = rio->iterate.count;
 
             if ((errcode = swapDataDecodeData(req->data,rio->iterate.numkeys,
                             tmpcfs,rio->iterate.rawkeys,rio->iterate.rawvals,
@@ -629,9 +711,10 @@ static void swapExecBatchExecuteDoOutMeta(swapExecBatch *exec_batch) {
     sds *meta_rawkeys = NULL, *meta_rawvals = NULL;
     size_t count = exec_batch->count;
 
-    meta_cfs = zmalloc(sizeof(int)*count);
-    meta_rawkeys = zmalloc(sizeof(sds)*count);
-    meta_rawvals = zmalloc(sizeof(sds)*count);
+    /* at most one meta and one expire index entry per request. */
+    meta_cfs = zmalloc(sizeof(int)*count*2);
+    meta_rawkeys = zmalloc(sizeof(sds)*count*2);
+    meta_rawvals = zmalloc(sizeof(sds)*count*2);
     for (size_t i = 0; i < count; i++) {
         swapRequest *req = exec_batch->reqs[i];
         /* rdb out do not meta already encoded, can't put. */
@@ -640,6 +723,12 @@ static void swapExecBatchExecuteDoOutMeta(swapExecBatch *exec_batch) {
         meta_rawkeys[num_metas] = swapDataEncodeMetaKey(req->data);
         meta_rawvals[num_metas] = swapDataEncodeMetaVal(req->data,req->datactx);
         num_metas++;
+        if (server.swap_expire_index_enabled && req->data->expire != -1) {
+            meta_cfs[num_metas] = EXPIRE_CF;
+            meta_rawkeys[num_metas] = swapDataEncodeExpireIndexKey(req->data);
+            meta_rawvals[num_metas] = sdsempty();
+            num_metas++;
+        }
     }
     RIOInitPut(meta_rio,num_metas,meta_cfs,meta_rawkeys,meta_rawvals);
     RIODo(meta_rio);
@@ -676,13 +765,20 @@ static void swapExecBatchExecuteDoDelMeta(swapExecBatch *exec_batch) {
     RIO _meta_rio = {0}, *meta_rio = &_meta_rio;
     size_t count = exec_batch->count;
 
-    meta_cfs = zmalloc(sizeof(int)*count);
-    meta_rawkeys = zmalloc(sizeof(sds)*count);
+    meta_cfs = zmalloc(sizeof(int)*count*2);
+    meta_rawkeys = zmalloc(sizeof(sds)*count*2);
     for (size_t i = 0; i < count; i++) {
         swapRequest *req = exec_batch->reqs[i];
         meta_cfs[num_metas] = META_CF;
         meta_rawkeys[num_metas] = swapDataEncodeMetaKey(req->data);
         num_metas++;
+        /* index entry of expire other than data->expire is stale, dropped
+         * when scanned by active expire. */
+        if (server.swap_expire_index_enabled && req->data->expire != -1) {
+            meta_cfs[num_metas] = EXPIRE_CF;
+            meta_rawkeys[num_metas] = swapDataEncodeExpireIndexKey(req->data);
+            num_metas++;
+        }
     }
 
     RIOInitDel(meta_rio,num_metas,meta_cfs,meta_rawkeys);
@@ -808,12 +904,21 @@ void swapExecBatchPreprocess(swapExecBatch *meta_batch) {
 
         swapCtxSetSwapData(req->swap_ctx,req->data,req->datactx);
 
+        /* warm tier holds only string keys. */
+        if (req->swap_ctx->warm_tier_missed &&
+                req->data->swap_type == SWAP_TYPE_STRING) {
+            atomicIncr(server.swap_hit_stats->stat_swapin_warm_tier_miss_count,1);
+        }
+
         if ((errcode = swapDataAna(req->data,SWAP_ANA_THD_SWAP,req->key_request,
                         &intention,&intention_flags,req->datactx))) {
             swapRequestSetError(req, errcode);
             continue;
         }
 
+        if (swapRequestCanPushdown(req,intention,intention_flags))
+            intention_flags |= SWAP_EXEC_IN_PUSHDOWN;
+
         swapRequestSetIntention(req,intention,intention_flags);
     }
 
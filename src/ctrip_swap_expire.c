@@ -225,6 +225,97 @@ void startMetaScan4ScanExpire(client *c) {
     getKeyRequestsFreeResult(&result);
 }
 
+/* Expire index */
+static redisAtomic long long expire_index_stale_count;
+
+/* Index entries (expired ones scanned in swap thread) are verified against
+ * metas: entry is stale if meta deleted or expire changed afterwards, stale
+ * entries are deleted so that they won't be scanned again, so are the
+ * undecodable ones. */
+int expireIndexDecodeData(redisDb *db, int num, sds *rawkeys,
+        MOVE sds nextseek, void **pdecoded) {
+    int i, n = 0, nstale = 0, errcode = 0, *cfs, *stale_cfs;
+    sds *meta_rawkeys, *stale_rawkeys;
+    const char **keys;
+    size_t *keylens;
+    long long *expires;
+    RIO _rio = {0}, *rio = &_rio;
+    metaScanResult *result = metaScanResultCreate();
+
+    /* nextseek is raw index key, scan resumes from it. */
+    if (nextseek) metaScanResultSetNextSeek(result,nextseek);
+
+    keys = zmalloc(sizeof(char*)*num);
+    keylens = zmalloc(sizeof(size_t)*num);
+    expires = zmalloc(sizeof(long long)*num);
+    cfs = zmalloc(sizeof(int)*num);
+    meta_rawkeys = zmalloc(sizeof(sds)*num);
+    stale_cfs = zmalloc(sizeof(int)*num);
+    stale_rawkeys = zmalloc(sizeof(sds)*num);
+
+    for (i = 0; i < num; i++) {
+        if (rocksDecodeExpireIndexKey(rawkeys[i],sdslen(rawkeys[i]),NULL,
+                    &expires[n],&keys[n],&keylens[n])) {
+            stale_cfs[nstale] = EXPIRE_CF;
+            stale_rawkeys[nstale++] = sdsdup(rawkeys[i]);
+            continue;
+        }
+        cfs[n] = META_CF;
+        meta_rawkeys[n] = encodeMetaKey(db->id,keys[n],keylens[n]);
+        n++;
+    }
+
+    if (n == 0) {
+        zfree(cfs);
+        zfree(meta_rawkeys);
+        goto end;
+    }
+
+    RIOInitGet(rio,n,cfs,meta_rawkeys);
+    RIODo(rio);
+    if ((errcode = RIOGetError(rio))) {
+        RIODeinit(rio);
+        goto end;
+    }
+
+    for (i = 0; i < n; i++) {
+        sds rawval = rio->get.rawvals[i];
+        long long expire;
+        int swap_type;
+
+        if (rawval == NULL || rocksDecodeMetaVal(rawval,sdslen(rawval),
+                    &swap_type,&expire,NULL,NULL,NULL) ||
+                expire != expires[i]) {
+            stale_cfs[nstale] = EXPIRE_CF;
+            stale_rawkeys[nstale++] = rocksEncodeExpireIndexKey(db->id,
+                    expires[i],keys[i],keylens[i]);
+        } else {
+            metaScanResultAppend(result,swap_type,
+                    sdsnewlen(keys[i],keylens[i]),expire);
+        }
+    }
+    RIODeinit(rio);
+
+end:
+    if (nstale) {
+        RIO _del_rio = {0}, *del_rio = &_del_rio;
+        RIOInitDel(del_rio,nstale,stale_cfs,stale_rawkeys);
+        RIODo(del_rio);
+        RIODeinit(del_rio);
+        atomicIncr(expire_index_stale_count,nstale);
+    } else {
+        zfree(stale_cfs);
+        zfree(stale_rawkeys);
+    }
+
+    zfree(keys);
+    zfree(keylens);
+    zfree(expires);
+
+    *pdecoded = result;
+    return errcode;
+}
+
 void scanExpireCycleTryExpire(sds key, long long expire, redisDb *db,
         long long now) {
     robj *keyobj = createStringObject(key,sdslen(key));
@@ -273,19 +364,17 @@ int scanExpireDbCycle(redisDb *db, int type, long long timelimit) {
         for (int i = 0; i < metas->num; i++) {
             scanMeta *meta = metas->metas + i;
 
-            long long nowtime = server.mstime;
-            long long expire_add;
             if (meta->expire != -1) {
                 expireCandidatesAdd(scan_expire->candidates,
                         meta->expire,meta->key);
-                expire_add = meta->expire - nowtime;
-            } else {
-                expire_add = SWAP_TTL_COMPACT_INVALID_EXPIRE;
             }
 
-            if (server.swap_ttl_compact_enabled) {
-                int res = wtdigestAdd(server.swap_ttl_compact_ctx->expire_stats->expire_wt, (double)expire_add, 1);
-                serverAssert(res == 0);
+            /* index scan only returns expired keys, samples are biased:
+             * sampled on swap out instead (see swapRequestMerge). */
+            if (server.swap_ttl_compact_enabled &&
+                    !server.swap_expire_index_enabled) {
+                swapExpireStatusSample(
+                        server.swap_ttl_compact_ctx->expire_stats,meta->expire);
             }
         }
 
@@ -368,7 +457,7 @@ sds genSwapScanExpireInfoString(sds info) {
     double stale_percent = 0;
     int limit = 0;
     long long estimated_cycle_seconds = 0, scan_time_used = 0,
-         expire_time_used = 0;
+         expire_time_used = 0, index_stale_count;
 
     for (int dbid = 0; dbid < server.dbnum; dbid++) {
         db = server.db + dbid;
@@ -392,6 +481,7 @@ sds genSwapScanExpireInfoString(sds info) {
         scan_time_used += scan_expire->stat_scan_time_used;
         expire_time_used += scan_expire->stat_expire_time_used;
     }
+    atomicGet(expire_index_stale_count,index_stale_count);
 
 	info = sdscatprintf(info,
 			"swap_scan_expire_used_memory:%ld\r\n"
@@ -402,7 +492,9 @@ sds genSwapScanExpireInfoString(sds info) {
 			"swap_scan_expire_scan_key_per_second:%ld\r\n"
 			"swap_scan_expire_expired_key_per_second:%ld\r\n"
 			"swap_scan_expire_scan_used_time:%lld\r\n"
-			"swap_scan_expire_expire_used_time:%lld\r\n",
+			"swap_scan_expire_expire_used_time:%lld\r\n"
+			"swap_scan_expire_index_enabled:%d\r\n"
+			"swap_scan_expire_index_stale_count:%lld\r\n",
             used_memory,
             candidates_count,
             stale_percent*100,
@@ -411,7 +503,9 @@ sds genSwapScanExpireInfoString(sds info) {
             scan_per_sec,
             expired_per_sec,
             scan_time_used,
-            expire_time_used);
+            expire_time_used,
+            server.swap_expire_index_enabled,
+            index_stale_count);
     return info;
 }
 
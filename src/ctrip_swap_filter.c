@@ -57,6 +57,11 @@ void coldFilterInitCuckooFilter(coldFilter *filter) {
 }
 
 void coldFilterDeinit(coldFilter *filter) {
+    if (filter->subkey_filters) {
+        dictRelease(filter->subkey_filters);
+        filter->subkey_filters = NULL;
+        filter->subkey_filters_memory = 0;
+    }
     if (filter->absents) {
         absentCacheFree(filter->absents);
         filter->absents = NULL;
@@ -65,6 +70,10 @@ void coldFilterDeinit(coldFilter *filter) {
         cuckooFilterFree(filter->filter);
         filter->filter = NULL;
     }
+    if (filter->warm) {
+        warmTierFree(filter->warm);
+        filter->warm = NULL;
+    }
 }
 
 coldFilter *coldFilterCreate() {
@@ -108,6 +117,7 @@ void coldFilterDeleteKey(coldFilter *filter, sds key) {
     if (filter->filter) {
         serverAssert(cuckooFilterDelete(filter->filter,key,sdslen(key)) == CUCKOO_OK);
     }
+    if (filter->warm) warmTierDelete(filter->warm,key);
 }
 
 void coldFilterKeyNotFound(coldFilter *filter, sds key) {
@@ -162,6 +172,93 @@ int coldFilterMayContainSubkey(coldFilter *filter, sds key, sds subkey) {
     }
 }
 
+/* Subkey filter: cuckoo filter of subkeys persisted in rocksdb for big
+ * hash/set, so that absent subkeys of cold key could be filtered without
+ * rocksdb lookup (absent cache only learns after lookup missed).
+ *
+ * Filter is created when a fresh object version is swapped out (nothing
+ * persisted for that version yet), and subkeys are inserted whenever they
+ * are swapped out later, so it never misses a persisted subkey. Subkeys
+ * deleted from rocksdb are not removed (cuckoo delete requires the subkey
+ * inserted exactly once), which only raises false positive rate. Filter
+ * maintained in main thread only; swap thread reads the filter bound to
+ * swapData, which is safe because key is locked during swap. */
+static void dictSubkeyFilterDestructor(void *privdata, void *val) {
+    subkeyFilter *sf = val;
+    UNUSED(privdata);
+    cuckooFilterFree(sf->filter);
+    zfree(sf);
+}
+
+dictType subkeyFilterDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    dictSubkeyFilterDestructor, /* val destructor */
+    NULL                        /* allow to expand */
+};
+
+subkeyFilter *coldFilterLookupSubkeyFilter(coldFilter *filter, sds key) {
+    if (filter->subkey_filters == NULL) return NULL;
+    return dictFetchValue(filter->subkey_filters,key);
+}
+
+void coldFilterDeleteSubkeyFilter(coldFilter *filter, sds key) {
+    subkeyFilter *sf;
+    if ((sf = coldFilterLookupSubkeyFilter(filter,key)) == NULL) return;
+    filter->subkey_filters_memory -= cuckooFilterUsedMemory(sf->filter);
+    dictDelete(filter->subkey_filters,key);
+}
+
+/* Create filter for a fresh version of key (replacing stale one), returns
+ * NULL if key not big enough. */
+subkeyFilter *coldFilterCreateSubkeyFilter(coldFilter *filter, sds key,
+        uint64_t version, size_t nsubkeys) {
+    subkeyFilter *sf;
+
+    coldFilterDeleteSubkeyFilter(filter,key);
+    if (server.swap_subkey_filter_min_subkeys == 0 ||
+            nsubkeys < server.swap_subkey_filter_min_subkeys)
+        return NULL;
+
+    if (filter->subkey_filters == NULL)
+        filter->subkey_filters = dictCreate(&subkeyFilterDictType,NULL);
+
+    sf = zmalloc(sizeof(subkeyFilter));
+    sf->version = version;
+    sf->filter = cuckooFilterNew(cuckooGenHashFunction,
+            server.swap_cuckoo_filter_bit_type,nsubkeys);
+    filter->subkey_filters_memory += cuckooFilterUsedMemory(sf->filter);
+    dictAdd(filter->subkey_filters,sdsdup(key),sf);
+    return sf;
+}
+
+/* Returns C_ERR if filter is full, in which case caller should drop it. */
+int coldFilterSubkeyFilterInsert(coldFilter *filter, subkeyFilter *sf,
+        sds subkey) {
+    size_t used_memory;
+    int retval;
+
+    if (cuckooFilterContains(sf->filter,subkey,sdslen(subkey)) == CUCKOO_OK)
+        return C_OK;
+    used_memory = cuckooFilterUsedMemory(sf->filter);
+    retval = cuckooFilterInsert(sf->filter,subkey,sdslen(subkey));
+    filter->subkey_filters_memory += cuckooFilterUsedMemory(sf->filter) - used_memory;
+    return retval == CUCKOO_OK ? C_OK : C_ERR;
+}
+
+int subkeyFilterMayContain(subkeyFilter *sf, uint64_t version, sds subkey) {
+    if (sf == NULL || sf->version != version) return 1;
+    atomicIncr(server.swap_hit_stats->stat_subkey_filter_query_count,1);
+    if (cuckooFilterContains(sf->filter,subkey,sdslen(subkey)) == CUCKOO_ERR) {
+        atomicIncr(server.swap_hit_stats->stat_subkey_filter_filt_count,1);
+        return 0;
+    }
+    return 1;
+}
+
 /* cuckoo filter not counted in maxmemory */
 size_t coldFiltersUsedMemory() {
     size_t used_memory = 0;
@@ -170,6 +267,7 @@ size_t coldFiltersUsedMemory() {
         if (cold_filter->filter) {
             used_memory += cuckooFilterUsedMemory(cold_filter->filter);
         }
+        used_memory += cold_filter->subkey_filters_memory;
     }
     return used_memory;
 }
@@ -238,6 +336,15 @@ sds genSwapCuckooFilterInfoString(sds info) {
                 i,cuckoo_stat->used_memory,cuckoo_stat->ntags,cuckoo_stat->load_factor);
     }
 
+    for (int i = 0; i < server.dbnum; i++) {
+        redisDb *db = server.db+i;
+        if (db->cold_filter->subkey_filters == NULL) continue;
+        info = sdscatprintf(info,
+                "swap_subkey_filter%d:keys=%lu,used_memory=%lu\r\n",i,
+                dictSize(db->cold_filter->subkey_filters),
+                db->cold_filter->subkey_filters_memory);
+    }
+
     return info;
 }
 
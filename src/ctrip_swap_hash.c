@@ -40,7 +40,7 @@ static void createFakeHashForDeleteIfCold(swapData *data) {
 
 /* return 1 if noswap needed */
 static int hashSwapAnaOutSelectSubkeys(swapData *data, hashDataCtx *datactx,
-        int *may_keep_data) {
+        subkeyClock *clock, int *may_keep_data) {
     int select_type, noswap;
     size_t count;
     robj *subkeys;
@@ -75,6 +75,7 @@ static int hashSwapAnaOutSelectSubkeys(swapData *data, hashDataCtx *datactx,
     }
 
     count = MIN(count,(size_t)server.swap_evict_step_max_subkeys);
+    size_t chances = subkeyClockSecondChances(count);
     datactx->ctx.type = BASE_SWAP_CTX_TYPE_SUBKEY;
     datactx->ctx.sub.subkeys = zmalloc(count*sizeof(robj*));
 
@@ -103,6 +104,14 @@ static int hashSwapAnaOutSelectSubkeys(swapData *data, hashDataCtx *datactx,
                 subkey = createStringObjectFromLongLong(vll);
                 subkey = unshareStringValue(subkey);
             }
+
+            /* Recently accessed field kept in memory for now, evicted
+             * in later steps if not accessed again. */
+            if (subkeyClockSecondChance(clock,subkey,&chances)) {
+                if (!noswap) *may_keep_data = 0;
+                decrRefCount(subkey);
+                continue;
+            }
             datactx->ctx.sub.subkeys[datactx->ctx.sub.num++] = subkey;
 
             hashTypeCurrentObject(hi,OBJ_HASH_VALUE,&vstr,&vlen,&vll);
@@ -222,13 +231,23 @@ int hashSwapAna(swapData *data, int thd, struct keyRequest *req,
             datactx->ctx.type = BASE_SWAP_CTX_TYPE_SUBKEY;
             datactx->ctx.sub.num = 0;
             datactx->ctx.sub.subkeys = zmalloc(req->b.num_subkeys * sizeof(robj*));
+            subkeyClock *clock = NULL;
+            /* HDEL: deleted fields need no second chance. */
+            if (thd == SWAP_ANA_THD_MAIN && server.swap_evict_subkey_clock &&
+                    cmd_intention_flags != SWAP_IN_DEL) {
+                objectMeta *meta = swapDataObjectMeta(data);
+                size_t nsubkeys = meta ? meta->len : 0;
+                if (data->value) nsubkeys += hashTypeLength(data->value);
+                clock = subkeyClockLookupOrCreate(data->db,data->key,nsubkeys);
+            }
             for (int i = 0; i < req->b.num_subkeys; i++) {
                 robj *subkey = req->b.subkeys[i];
+                int hot = data->value != NULL &&
+                    hashTypeExists(data->value,subkey->ptr);
+                if (clock) subkeyClockAccess(clock,subkey,hot);
                 /* HDEL: even if field is hot (exists in value), we still
                  * need to do ROCKS_DEL on those fields. */
-                if (cmd_intention_flags == SWAP_IN_DEL ||
-                        data->value == NULL ||
-                        !hashTypeExists(data->value,subkey->ptr)) {
+                if (cmd_intention_flags == SWAP_IN_DEL || !hot) {
                     if (swapDataMayContainSubkey(data,thd,subkey)) {
                         incrRefCount(subkey);
                         datactx->ctx.sub.subkeys[datactx->ctx.sub.num++] = subkey;
@@ -255,7 +274,10 @@ int hashSwapAna(swapData *data, int thd, struct keyRequest *req,
             /* may_keep_data is true if we could keep data in memory and clear dirty
              * after persisting data to rocksdb. */
             int may_keep_data;
-            int noswap = hashSwapAnaOutSelectSubkeys(data,datactx,&may_keep_data);
+            subkeyClock *clock = thd == SWAP_ANA_THD_MAIN ?
+                subkeyClockLookup(data->db,data->key) : NULL;
+            int noswap = hashSwapAnaOutSelectSubkeys(data,datactx,clock,
+                    &may_keep_data);
             int keep_data = swapDataPersistKeepData(data,cmd_intention_flags,may_keep_data);
 
             /* create new meta if needed */
@@ -491,10 +513,16 @@ int hashSwapIn(swapData *data, void *result, void *datactx) {
 /* subkeys already cleaned by cleanObject(to save cpu usage of main thread),
  * swapout only updates db.dict keyspace, meta (db.meta/db.expire) swapped
  * out by swap framework. */
-int hashSwapOut(swapData *data, void *datactx, int keep_data, int *totally_out) {
-    UNUSED(datactx);
+int hashSwapOut(swapData *data, void *datactx_, int keep_data, int *totally_out) {
+    hashDataCtx *datactx = datactx_;
     serverAssert(!swapDataIsCold(data));
 
+    if (datactx->ctx.type == BASE_SWAP_CTX_TYPE_SUBKEY) {
+        swapDataSubkeysSwappedOut(data,datactx->ctx.sub.subkeys,
+                datactx->ctx.sub.num,
+                hashTypeLength(data->value)+datactx->ctx.sub.num);
+    }
+
     if (data->dirty_subkeys &&
             dirtySubkeysLength(data->dirty_subkeys) == 0) {
         dbDeleteDirtySubkeys(data->db,data->key);
@@ -0,0 +1,553 @@
+/* Copyright (c) 2023, ctrip.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ctrip_swap.h"
+#include <sys/stat.h>
+#include <dirent.h>
+
+/* Rdb load by ingest: rawkeys/rawvals loaded are buffered per cf instead of
+ * rocksdb puts. Buffered runs are sorted and spilled to run files by swap
+ * threads in parallel, runs of each cf are then merged into non-overlapping
+ * ssts by SstFileWriter and ingested when rdb loaded. So that loading is
+ * bounded by disk bandwidth rather than memtable, wal and compaction. */
+
+int rmdirRecursive(const char *path);
+
+#define INGEST_IO_BUF_SIZE (64*1024)
+
+/* ------------------------------ run -------------------------------- */
+static rdbLoadIngestRun *rdbLoadIngestRunNew(int cf) {
+    rdbLoadIngestRun *run = zcalloc(sizeof(rdbLoadIngestRun));
+    run->cf = cf;
+    return run;
+}
+
+static void rdbLoadIngestRunFreeKvs(rdbLoadIngestRun *run) {
+    for (size_t i = 0; i < run->num*2; i++) {
+        sdsfree(run->kvs[i]);
+    }
+    zfree(run->kvs);
+    run->kvs = NULL;
+    run->num = 0;
+    run->capacity = 0;
+    run->memory = 0;
+}
+
+static void rdbLoadIngestRunFree(rdbLoadIngestRun *run) {
+    if (run == NULL) return;
+    rdbLoadIngestRunFreeKvs(run);
+    if (run->path) sdsfree(run->path);
+    zfree(run);
+}
+
+static void rdbLoadIngestRunAppend(rdbLoadIngestRun *run, MOVE sds rawkey,
+        MOVE sds rawval) {
+    if (run->num == run->capacity) {
+        run->capacity = run->capacity ? run->capacity*2 : 1024;
+        run->kvs = zrealloc(run->kvs,sizeof(sds)*2*run->capacity);
+    }
+    run->kvs[run->num*2] = rawkey;
+    run->kvs[run->num*2+1] = rawval;
+    run->num++;
+    run->memory += sdslen(rawkey) + sdslen(rawval);
+}
+
+static int rawkeyCompare(const char *k1, size_t k1len, const char *k2,
+        size_t k2len) {
+    /* same as rocksdb bytewise comparator */
+    int cmp = memcmp(k1,k2,k1len < k2len ? k1len : k2len);
+    if (cmp == 0) cmp = k1len < k2len ? -1 : (k1len > k2len ? 1 : 0);
+    return cmp;
+}
+
+static int kvCompare(const void *a, const void *b) {
+    sds k1 = *(sds*)a, k2 = *(sds*)b;
+    return rawkeyCompare(k1,sdslen(k1),k2,sdslen(k2));
+}
+
+static void rdbLoadIngestRunSort(rdbLoadIngestRun *run) {
+    qsort(run->kvs,run->num,sizeof(sds)*2,kvCompare);
+}
+
+/* Run file: [klen(u32)|key|vlen(u32)|val]..., only read by this process. */
+static int runFileWrite(FILE *fp, const char *key, size_t klen,
+        const char *val, size_t vlen) {
+    uint32_t len;
+    len = (uint32_t)klen;
+    if (fwrite(&len,sizeof(len),1,fp) != 1) return -1;
+    if (klen && fwrite(key,klen,1,fp) != 1) return -1;
+    len = (uint32_t)vlen;
+    if (fwrite(&len,sizeof(len),1,fp) != 1) return -1;
+    if (vlen && fwrite(val,vlen,1,fp) != 1) return -1;
+    return 0;
+}
+
+static void setIOError(char **err, const char *op, const char *path) {
+    char buf[512];
+    snprintf(buf,sizeof(buf),"%s %s: %s",op,path,strerror(errno));
+    *err = strdup(buf); /* freed by zlibc_free like rocksdb errors */
+}
+
+/* Called in swap thread, kvs released as soon as spilled. */
+void rdbLoadIngestRunSpill(rdbLoadIngestRun *run, char **err) {
+    FILE *fp;
+
+    rdbLoadIngestRunSort(run);
+
+    if ((fp = fopen(run->path,"w")) == NULL) {
+        setIOError(err,"open",run->path);
+        return;
+    }
+    setvbuf(fp,NULL,_IOFBF,INGEST_IO_BUF_SIZE);
+
+    for (size_t i = 0; i < run->num; i++) {
+        sds rawkey = run->kvs[i*2], rawval = run->kvs[i*2+1];
+        if (runFileWrite(fp,rawkey,sdslen(rawkey),rawval,sdslen(rawval))) {
+            setIOError(err,"write",run->path);
+            fclose(fp);
+            return;
+        }
+    }
+
+    if (fclose(fp)) {
+        setIOError(err,"close",run->path);
+        return;
+    }
+    rdbLoadIngestRunFreeKvs(run);
+}
+
+/* ------------------------------ merge -------------------------------- */
+/* Merge source: run file or sorted run in memory. */
+typedef struct ingestSource {
+    int index;
+    FILE *fp;
+    sds path;
+    sds kbuf;
+    sds vbuf;
+    rdbLoadIngestRun *run;
+    size_t pos;
+    const char *key;
+    size_t klen;
+    const char *val;
+    size_t vlen;
+} ingestSource;
+
+/* Returns 1 if next record read, 0 if source exhausted, -1 if failed. */
+static int ingestSourceNext(ingestSource *src, char **err) {
+    uint32_t klen, vlen;
+
+    if (src->run) {
+        if (src->pos >= src->run->num) return 0;
+        src->key = src->run->kvs[src->pos*2];
+        src->klen = sdslen(src->run->kvs[src->pos*2]);
+        src->val = src->run->kvs[src->pos*2+1];
+        src->vlen = sdslen(src->run->kvs[src->pos*2+1]);
+        src->pos++;
+        return 1;
+    }
+
+    if (fread(&klen,sizeof(klen),1,src->fp) != 1) {
+        if (feof(src->fp)) return 0;
+        goto err;
+    }
+    sdsclear(src->kbuf);
+    src->kbuf = sdsMakeRoomFor(src->kbuf,klen);
+    if (klen && fread(src->kbuf,klen,1,src->fp) != 1) goto err;
+    sdssetlen(src->kbuf,klen);
+    if (fread(&vlen,sizeof(vlen),1,src->fp) != 1) goto err;
+    sdsclear(src->vbuf);
+    src->vbuf = sdsMakeRoomFor(src->vbuf,vlen);
+    if (vlen && fread(src->vbuf,vlen,1,src->fp) != 1) goto err;
+    sdssetlen(src->vbuf,vlen);
+
+    src->key = src->kbuf, src->klen = klen;
+    src->val = src->vbuf, src->vlen = vlen;
+    return 1;
+
+err:
+    errno = ferror(src->fp) ? errno : EIO;
+    setIOError(err,"read",src->path);
+    return -1;
+}
+
+static int ingestSourceLess(ingestSource *a, ingestSource *b) {
+    int cmp = rawkeyCompare(a->key,a->klen,b->key,b->klen);
+    return cmp < 0 || (cmp == 0 && a->index < b->index);
+}
+
+static void ingestHeapSiftDown(ingestSource **heap, int num, int i) {
+    while (1) {
+        int l = i*2+1, r = l+1, min = i;
+        if (l < num && ingestSourceLess(heap[l],heap[min])) min = l;
+        if (r < num && ingestSourceLess(heap[r],heap[min])) min = r;
+        if (min == i) break;
+        ingestSource *tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
+    }
+}
+
+/* Merge output: another run file (fan-in reduce), or ssts rotated every
+ * RDB_LOAD_INGEST_SST_SIZE bytes. */
+typedef struct ingestSink {
+    FILE *fp;
+    sds path;
+    rdbLoadIngestMerge *merge;
+    rocksdb_envoptions_t *envopts;
+    rocksdb_sstfilewriter_t *writer;
+} ingestSink;
+
+static void ingestSinkFinishSst(ingestSink *sink, char **err) {
+    if (sink->writer == NULL) return;
+    rocksdb_sstfilewriter_finish(sink->writer,err);
+    rocksdb_sstfilewriter_destroy(sink->writer);
+    sink->writer = NULL;
+}
+
+static int ingestSinkPut(ingestSink *sink, ingestSource *src, char **err) {
+    rdbLoadIngestMerge *merge = sink->merge;
+
+    if (sink->fp) {
+        if (runFileWrite(sink->fp,src->key,src->klen,src->val,src->vlen)) {
+            setIOError(err,"write",sink->path);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (sink->writer == NULL) {
+        sds path = sdscatprintf(sdsempty(),"%s/%s-%d.sst",merge->dir,
+                swap_cf_names[merge->cf],merge->nssts);
+        merge->ssts = zrealloc(merge->ssts,sizeof(sds)*(merge->nssts+1));
+        merge->ssts[merge->nssts++] = path;
+        sink->writer = rocksdb_sstfilewriter_create(sink->envopts,
+                server.rocks->cf_opts[merge->cf]);
+        rocksdb_sstfilewriter_open(sink->writer,path,err);
+        if (*err != NULL) return -1;
+    }
+
+    rocksdb_sstfilewriter_put(sink->writer,src->key,src->klen,
+            src->val,src->vlen,err);
+    if (*err != NULL) return -1;
+
+    uint64_t file_size;
+    rocksdb_sstfilewriter_file_size(sink->writer,&file_size);
+    if (file_size >= RDB_LOAD_INGEST_SST_SIZE) {
+        ingestSinkFinishSst(sink,err);
+        if (*err != NULL) return -1;
+    }
+    return 0;
+}
+
+/* Merge run files and optional memory run into sink, duplicated key (not
+ * expected, keys in rdb are unique) keeps the one of earlier source. */
+static void ingestMerge(sds *runs, int nruns, rdbLoadIngestRun *last,
+        ingestSink *sink, char **err) {
+    int nsrcs = nruns + (last ? 1 : 0), num = 0;
+    ingestSource *srcs = zcalloc(sizeof(ingestSource)*nsrcs);
+    ingestSource **heap = zmalloc(sizeof(ingestSource*)*nsrcs);
+    sds lastkey = sdsempty();
+    int haslast = 0;
+
+    for (int i = 0; i < nsrcs; i++) {
+        ingestSource *src = srcs+i;
+        int ret;
+        src->index = i;
+        if (i < nruns) {
+            src->path = runs[i];
+            if ((src->fp = fopen(src->path,"r")) == NULL) {
+                setIOError(err,"open",src->path);
+                goto end;
+            }
+            setvbuf(src->fp,NULL,_IOFBF,INGEST_IO_BUF_SIZE);
+            src->kbuf = sdsempty();
+            src->vbuf = sdsempty();
+        } else {
+            src->run = last;
+        }
+        if ((ret = ingestSourceNext(src,err)) < 0) goto end;
+        if (ret > 0) heap[num++] = src;
+    }
+
+    for (int i = num/2-1; i >= 0; i--) ingestHeapSiftDown(heap,num,i);
+
+    while (num > 0) {
+        ingestSource *src = heap[0];
+        int ret;
+
+        if (!haslast || rawkeyCompare(src->key,src->klen,lastkey,
+                    sdslen(lastkey))) {
+            if (ingestSinkPut(sink,src,err)) goto end;
+            lastkey = sdscpylen(lastkey,src->key,src->klen);
+            haslast = 1;
+        }
+
+        if ((ret = ingestSourceNext(src,err)) < 0) goto end;
+        if (ret == 0) heap[0] = heap[--num];
+        ingestHeapSiftDown(heap,num,0);
+    }
+
+end:
+    for (int i = 0; i < nsrcs; i++) {
+        ingestSource *src = srcs+i;
+        if (src->fp) fclose(src->fp);
+        if (src->kbuf) sdsfree(src->kbuf);
+        if (src->vbuf) sdsfree(src->vbuf);
+    }
+    sdsfree(lastkey);
+    zfree(heap);
+    zfree(srcs);
+}
+
+/* Called in swap thread: reduce runs by merging RDB_LOAD_INGEST_MERGE_FANIN
+ * runs each time, then merge the rest into ssts. */
+void rdbLoadIngestMergeRuns(rdbLoadIngestMerge *merge, char **err) {
+    ingestSink sink = {0};
+    int reduced = 0;
+
+    while (merge->nruns + (merge->last ? 1 : 0) > RDB_LOAD_INGEST_MERGE_FANIN) {
+        int fanin = RDB_LOAD_INGEST_MERGE_FANIN;
+        sink.path = sdscatprintf(sdsempty(),"%s/%s-reduced-%d.run",merge->dir,
+                swap_cf_names[merge->cf],reduced++);
+        if ((sink.fp = fopen(sink.path,"w")) == NULL) {
+            setIOError(err,"open",sink.path);
+            sdsfree(sink.path);
+            return;
+        }
+        setvbuf(sink.fp,NULL,_IOFBF,INGEST_IO_BUF_SIZE);
+
+        ingestMerge(merge->runs,fanin,NULL,&sink,err);
+        if (fclose(sink.fp) && *err == NULL) setIOError(err,"close",sink.path);
+        sink.fp = NULL;
+        if (*err != NULL) {
+            sdsfree(sink.path);
+            return;
+        }
+
+        for (int i = 0; i < fanin; i++) {
+            unlink(merge->runs[i]);
+            sdsfree(merge->runs[i]);
+        }
+        memmove(merge->runs,merge->runs+fanin,
+                sizeof(sds)*(merge->nruns-fanin));
+        merge->nruns -= fanin;
+        merge->runs[merge->nruns++] = sink.path;
+        sink.path = NULL;
+    }
+
+    if (merge->last) rdbLoadIngestRunSort(merge->last);
+
+    sink.merge = merge;
+    sink.envopts = rocksdb_envoptions_create();
+    ingestMerge(merge->runs,merge->nruns,merge->last,&sink,err);
+    if (*err == NULL) {
+        ingestSinkFinishSst(&sink,err);
+    } else if (sink.writer) {
+        rocksdb_sstfilewriter_destroy(sink.writer);
+    }
+    rocksdb_envoptions_destroy(sink.envopts);
+
+    /* runs not needed any more */
+    for (int i = 0; i < merge->nruns; i++) unlink(merge->runs[i]);
+    if (merge->last) rdbLoadIngestRunFreeKvs(merge->last);
+}
+
+static rdbLoadIngestMerge *rdbLoadIngestMergeNew(int cf, sds dir) {
+    rdbLoadIngestMerge *merge = zcalloc(sizeof(rdbLoadIngestMerge));
+    merge->cf = cf;
+    merge->dir = sdsdup(dir);
+    return merge;
+}
+
+static void rdbLoadIngestMergeFree(rdbLoadIngestMerge *merge) {
+    if (merge == NULL) return;
+    for (int i = 0; i < merge->nruns; i++) sdsfree(merge->runs[i]);
+    zfree(merge->runs);
+    for (int i = 0; i < merge->nssts; i++) sdsfree(merge->ssts[i]);
+    zfree(merge->ssts);
+    rdbLoadIngestRunFree(merge->last);
+    sdsfree(merge->dir);
+    zfree(merge);
+}
+
+/* ------------------------------ ingest -------------------------------- */
+rdbLoadIngest *rdbLoadIngestNew() {
+    sds dir = sdscatprintf(sdsempty(),"%s/%s%lld",ROCKS_DATA,
+            RDB_LOAD_INGEST_DIR_PREFIX,ustime());
+    if (mkdir(dir,0755)) {
+        serverLog(LL_WARNING,"[rdb load] create ingest dir(%s) failed: %s",
+                dir,strerror(errno));
+        sdsfree(dir);
+        return NULL;
+    }
+
+    rdbLoadIngest *ingest = zcalloc(sizeof(rdbLoadIngest));
+    ingest->dir = dir;
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        ingest->spilled[cf] = listCreate();
+        listSetFreeMethod(ingest->spilled[cf],(void (*)(void*))sdsfree);
+    }
+    return ingest;
+}
+
+void rdbLoadIngestFree(rdbLoadIngest *ingest) {
+    if (ingest == NULL) return;
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        rdbLoadIngestRunFree(ingest->runs[cf]);
+        listRelease(ingest->spilled[cf]);
+        rdbLoadIngestMergeFree(ingest->merges[cf]);
+    }
+    rmdirRecursive(ingest->dir);
+    sdsfree(ingest->dir);
+    zfree(ingest);
+}
+
+/* Ingest dirs left behind by a crash during rdb load (kept in data.rocks if
+ * persist enabled) are never reused, remove them on startup. */
+void rdbLoadIngestCleanupStale(void) {
+    struct dirent *p;
+    DIR *d = opendir(ROCKS_DATA);
+    char path[ROCKS_DIR_MAX_LEN];
+
+    if (d == NULL) return;
+    while ((p = readdir(d))) {
+        if (strncmp(p->d_name,RDB_LOAD_INGEST_DIR_PREFIX,
+                    strlen(RDB_LOAD_INGEST_DIR_PREFIX)))
+            continue;
+        snprintf(path,sizeof(path),"%s/%s",ROCKS_DATA,p->d_name);
+        if (rmdirRecursive(path)) {
+            serverLog(LL_WARNING,"[rdb load] remove stale ingest dir(%s) failed: %s",
+                    path,strerror(errno));
+        } else {
+            serverLog(LL_NOTICE,"[rdb load] removed stale ingest dir(%s).",path);
+        }
+    }
+    closedir(d);
+}
+
+static void rdbLoadIngestRunSpilled(void *result, void *pd, int errcode) {
+    UNUSED(result);
+    rdbLoadIngestRun *run = pd;
+    rdbLoadIngest *ingest = server.rdb_load_ctx->ingest;
+
+    if (errcode) {
+        ingest->errors++;
+    } else {
+        listAddNodeTail(ingest->spilled[run->cf],sdsdup(run->path));
+    }
+    rdbLoadIngestRunFree(run);
+}
+
+static void rdbLoadIngestSpill(rdbLoadIngest *ingest, int cf) {
+    rdbLoadIngestRun *run = ingest->runs[cf];
+    ingest->runs[cf] = NULL;
+    run->path = sdscatprintf(sdsempty(),"%s/%s-%lld.run",ingest->dir,
+            swap_cf_names[cf],ingest->seq++);
+    submitParallelUtilTask(ROCKSDB_INGEST_SPILL_RUN_TASK,run,
+            rdbLoadIngestRunSpilled,run);
+}
+
+void rdbLoadIngestFeed(rdbLoadIngest *ingest, int cf, MOVE sds rawkey,
+        MOVE sds rawval) {
+    if (ingest->runs[cf] == NULL) ingest->runs[cf] = rdbLoadIngestRunNew(cf);
+    rdbLoadIngestRunAppend(ingest->runs[cf],rawkey,rawval);
+    if (ingest->runs[cf]->memory >= server.swap_rdb_load_ingest_run_size)
+        rdbLoadIngestSpill(ingest,cf);
+}
+
+static void rdbLoadIngestRunsMerged(void *result, void *pd, int errcode) {
+    UNUSED(result), UNUSED(pd);
+    if (errcode) server.rdb_load_ctx->ingest->errors++;
+}
+
+/* Merge and ingest runs of all cfs, returns C_ERR if failed. */
+int rdbLoadIngestFinish(rdbLoadIngest *ingest) {
+    int nssts = 0, ret = C_OK;
+    char *err = NULL;
+    rocksdb_ingestexternalfileoptions_t *ingest_opts;
+
+    /* wait runs spilled */
+    parallelSyncDrain();
+    if (ingest->errors) return C_ERR;
+
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        list *spilled = ingest->spilled[cf];
+        listIter li;
+        listNode *ln;
+        rdbLoadIngestMerge *merge;
+
+        if (listLength(spilled) == 0 && ingest->runs[cf] == NULL) continue;
+
+        merge = rdbLoadIngestMergeNew(cf,ingest->dir);
+        merge->runs = zmalloc(sizeof(sds)*(listLength(spilled)+1));
+        listRewind(spilled,&li);
+        while ((ln = listNext(&li))) {
+            merge->runs[merge->nruns++] = sdsdup(listNodeValue(ln));
+        }
+        merge->last = ingest->runs[cf];
+        ingest->runs[cf] = NULL;
+        ingest->merges[cf] = merge;
+
+        submitParallelUtilTask(ROCKSDB_INGEST_MERGE_RUNS_TASK,merge,
+                rdbLoadIngestRunsMerged,merge);
+    }
+
+    /* wait runs merged into ssts */
+    parallelSyncDrain();
+    if (ingest->errors) return C_ERR;
+
+    ingest_opts = rocksdb_ingestexternalfileoptions_create();
+    rocksdb_ingestexternalfileoptions_set_move_files(ingest_opts,1);
+
+    rocks *rocks = serverRocksGetReadLock();
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        rdbLoadIngestMerge *merge = ingest->merges[cf];
+        if (merge == NULL || merge->nssts == 0) continue;
+
+        rocksdb_ingest_external_file_cf(rocks->db,rocks->cf_handles[cf],
+                (const char* const*)merge->ssts,merge->nssts,ingest_opts,&err);
+        if (err != NULL) {
+            serverLog(LL_WARNING,"[rdb load] ingest %d ssts of cf(%s) failed: %s",
+                    merge->nssts,swap_cf_names[cf],err);
+            zlibc_free(err);
+            ret = C_ERR;
+            break;
+        }
+        nssts += merge->nssts;
+    }
+    serverRocksUnlock(rocks);
+
+    rocksdb_ingestexternalfileoptions_destroy(ingest_opts);
+
+    if (ret == C_OK) {
+        serverLog(LL_NOTICE,"[rdb load] %lld runs spilled, %d ssts ingested.",
+                ingest->seq,nssts);
+    }
+    return ret;
+}
@@ -304,10 +304,10 @@ rocksIter *rocksCreateIter(rocks *rocks, redisDb *db) {
                 it->cf_handles, errs);
         for (i = 0; i < CF_COUNT; i++) rocksdb_options_destroy(cf_opts[i]);
 
-        if (errs[0] || errs[1] || errs[2]) {
+        if (errs[0] || errs[1] || errs[2] || errs[3]) {
             serverLog(LL_WARNING,
-                    "[rocks] rocksdb open db fail, dir:%s, default_cf=%s, meta_cf=%s, score_cf=%s",
-                    server.rocksdb_rdb_checkpoint_dir, errs[0], errs[1], errs[2]);
+                    "[rocks] rocksdb open db fail, dir:%s, default_cf=%s, meta_cf=%s, score_cf=%s, expire_cf=%s",
+                    server.rocksdb_rdb_checkpoint_dir, errs[0], errs[1], errs[2], errs[3]);
             goto err;
         }
         it->checkpoint_db = checkpoint_db;
@@ -27,6 +27,7 @@
  */
 
 #include "ctrip_swap.h"
+#include "cluster.h"
 #include <ctype.h>
 
 void scanMetaInit(scanMeta *meta, int swap_type, sds key, long long expire) {
@@ -110,10 +111,11 @@ void metaScanDataCtxSwapAna(metaScanDataCtx *datactx, int *intention,
     }
 }
 
-void metaScanDataCtxSwapIn(metaScanDataCtx *datactx, metaScanResult *result) {
-    if (datactx->type->swapIn) {
-        datactx->type->swapIn(datactx,result);
-    }
+int metaScanDataCtxSwapIn(metaScanDataCtx *datactx, metaScanResult *result) {
+    if (datactx->type->swapIn)
+        return datactx->type->swapIn(datactx,result);
+    else
+        return 0;
 }
 
 /* metaScanDataCtx - Scan */
@@ -142,10 +144,11 @@ void metaScanDataCtxScanSwapAna(metaScanDataCtx *datactx,
     }
 }
 
-void metaScanDataCtxScanSwapIn(struct metaScanDataCtx *datactx, metaScanResult *result) {
+int metaScanDataCtxScanSwapIn(struct metaScanDataCtx *datactx, metaScanResult *result) {
     metaScanDataCtxScan *scanctx = datactx->extend;
     swapScanSessionUnbind(scanctx->session, result->nextseek);
     result->nextseek = NULL; /* moved */
+    return 0;
 }
 
 metaScanDataCtxType scanMetaScanDataCtxType = {
@@ -154,6 +157,67 @@ metaScanDataCtxType scanMetaScanDataCtxType = {
     .freeExtend = NULL,
 };
 
+#define METASCAN_FILTER_BUDGET_FACTOR 10
+#define METASCAN_FILTER_BUDGET_MAX 10000
+
+/* Literal prefix of glob pattern (NULL if empty), keys not starting with
+ * it never match. */
+static sds metaScanPatternPrefix(sds pattern) {
+    size_t len = strcspn(pattern,"*?[\\");
+    return len ? sdsnewlen(pattern,len) : NULL;
+}
+
+static inline int metaScanDataCtxHasFilter(metaScanDataCtx *datactx) {
+    return datactx->pattern || datactx->typename || datactx->slot >= 0;
+}
+
+static int metaScanDataCtxFiltered(metaScanDataCtx *datactx, scanMeta *meta) {
+    if (datactx->slot >= 0 && (int)keyHashSlot(meta->key,
+                sdslen(meta->key)) != datactx->slot)
+        return 1;
+    if (datactx->pattern && !stringmatchlen(datactx->pattern,
+                sdslen(datactx->pattern),meta->key,sdslen(meta->key),0))
+        return 1;
+    if (datactx->typename && strcasecmp(datactx->typename,
+                strObjectType(meta->swap_type)))
+        return 1;
+    return 0;
+}
+
+/* Apply MATCH/TYPE/slot in swap thread so that main thread handles only
+ * matched metas; at most count metas are returned, scan resumes from the
+ * first one left over. */
+static void metaScanDataCtxFilter(metaScanDataCtx *datactx,
+        metaScanResult *result) {
+    int i, num = 0;
+
+    for (i = 0; i < result->num; i++) {
+        scanMeta *meta = result->metas+i;
+        if (num >= datactx->count) {
+            if (result->nextseek) sdsfree(result->nextseek);
+            result->nextseek = meta->key;
+            meta->key = NULL;
+            for (; i < result->num; i++) scanMetaDeinit(result->metas+i);
+            break;
+        }
+        if (metaScanDataCtxFiltered(datactx,meta)) {
+            scanMetaDeinit(meta);
+        } else {
+            result->metas[num++] = *meta;
+        }
+    }
+    result->num = num;
+    result->filtered = 1;
+
+    /* iterate range bounded by prefix: keys beyond it never match. */
+    if (datactx->prefix && result->nextseek &&
+            (sdslen(result->nextseek) < sdslen(datactx->prefix) ||
+             memcmp(result->nextseek,datactx->prefix,sdslen(datactx->prefix)))) {
+        sdsfree(result->nextseek);
+        result->nextseek = NULL;
+    }
+}
+
 /* SCAN cursor [MATCH pattern] [COUNT count] [TYPE type] */
 int setupMetaScanDataCtx4Scan(metaScanDataCtx *datactx, client *c) {
     int i, j, reason = 0;
@@ -181,15 +245,35 @@ int setupMetaScanDataCtx4Scan(metaScanDataCtx *datactx, client *c) {
     datactx->limit = 10;
     for (i = 2; i < c->argc; i+=2) {
         j = c->argc - i;
-        if (!strcasecmp(c->argv[i]->ptr, "count") && j >= 2) {
+        if (j < 2) break;
+        if (!strcasecmp(c->argv[i]->ptr, "count")) {
             long long value;
             if (getLongLongFromObject(c->argv[i+1],&value) == C_OK) {
                 datactx->limit = value;
-                break;
             }
+        } else if (!strcasecmp(c->argv[i]->ptr, "match")) {
+            sds pat = c->argv[i+1]->ptr;
+            if (datactx->pattern) sdsfree(datactx->pattern);
+            datactx->pattern = NULL;
+            if (!(pat[0] == '*' && sdslen(pat) == 1))
+                datactx->pattern = sdsdup(pat);
+        } else if (!strcasecmp(c->argv[i]->ptr, "type")) {
+            if (datactx->typename) sdsfree(datactx->typename);
+            datactx->typename = sdsdup(c->argv[i+1]->ptr);
         }
     }
 
+    if (datactx->pattern || datactx->typename) {
+        /* filtered keys are cheap in swap thread, scan more of them (bounded
+         * like dictScan maxiterations) so that SCAN returns enough keys. */
+        datactx->count = datactx->limit;
+        if (datactx->limit < METASCAN_FILTER_BUDGET_MAX/METASCAN_FILTER_BUDGET_FACTOR)
+            datactx->limit *= METASCAN_FILTER_BUDGET_FACTOR;
+        else if (datactx->limit < METASCAN_FILTER_BUDGET_MAX)
+            datactx->limit = METASCAN_FILTER_BUDGET_MAX;
+        if (datactx->pattern) datactx->prefix = metaScanPatternPrefix(datactx->pattern);
+    }
+
     metaScanDataCtxScan *scanctx = zmalloc(sizeof(metaScanDataCtxScan));
     scanctx->session = session;
     if (session->nextseek) datactx->seek = sdsdup(session->nextseek);
@@ -212,7 +296,7 @@ void metaScanDataCtxRandomkeySwapAna(metaScanDataCtx *datactx,
     *intention_flags = 0;
 }
 
-void metaScanDataCtxRandomkeySwapIn(struct metaScanDataCtx *datactx,
+int metaScanDataCtxRandomkeySwapIn(struct metaScanDataCtx *datactx,
         metaScanResult *result) {
     metaScanDataCtxRandomkey *randomkeyctx = datactx->extend;
     redisDb *db = randomkeyctx->db;
@@ -226,6 +310,7 @@ void metaScanDataCtxRandomkeySwapIn(struct metaScanDataCtx *datactx,
         db->randomkey_nextseek = result->nextseek;
         result->nextseek = NULL;
     }
+    return 0;
 }
 
 metaScanDataCtxType randomkeyMetaScanDataCtxType = {
@@ -287,7 +372,7 @@ void metaScanDataCtxScanExpireSwapAna(metaScanDataCtx *datactx,
     *intention_flags = 0;
 }
 
-void metaScanDataCtxScanExpireSwapIn(struct metaScanDataCtx *datactx,
+int metaScanDataCtxScanExpireSwapIn(struct metaScanDataCtx *datactx,
         metaScanResult *result) {
     metaScanDataCtxScanExpire *expirectx = datactx->extend;
     scanExpire *scan_expire = expirectx->scan_expire;
@@ -300,6 +385,7 @@ void metaScanDataCtxScanExpireSwapIn(struct metaScanDataCtx *datactx,
         scan_expire->nextseek = result->nextseek;
         result->nextseek = NULL;
     }
+    return 0;
 }
 
 metaScanDataCtxType expireMetaScanDataCtxType = {
@@ -313,6 +399,7 @@ int setupMetaScanDataCtx4ScanExpire(metaScanDataCtx *datactx, client *c) {
     scanExpire *scan_expire = c->db->scan_expire;
     datactx->type = &expireMetaScanDataCtxType;
     datactx->limit = scan_expire->limit;
+    datactx->expire_index = server.swap_expire_index_enabled;
     if (scan_expire->nextseek)
         datactx->seek = sdsdup(scan_expire->nextseek);
     else
@@ -323,6 +410,143 @@ int setupMetaScanDataCtx4ScanExpire(metaScanDataCtx *datactx, client *c) {
     return 0;
 }
 
+/* metaScanDataCtx - Keys */
+void metaScanDataCtxKeysSwapAna(metaScanDataCtx *datactx,
+        int *intention, uint32_t *intention_flags) {
+    if (!datactx->db_bounded) { /* hot keys only (multi/exec) */
+        *intention = SWAP_NOP;
+        *intention_flags = 0;
+    } else {
+        *intention = SWAP_IN;
+        /* whole db iterated at once, abort rather than oom. */
+        *intention_flags = SWAP_EXEC_OOM_CHECK;
+    }
+}
+
+/* iterate stopped by limit with keys left: partial reply not allowed. */
+int metaScanDataCtxKeysSwapIn(metaScanDataCtx *datactx,
+        metaScanResult *result) {
+    UNUSED(datactx);
+    return result->nextseek ? SWAP_ERR_METASCAN_KEYS_TRUNCATED : 0;
+}
+
+metaScanDataCtxType keysMetaScanDataCtxType = {
+    .swapAna = metaScanDataCtxKeysSwapAna,
+    .swapIn = metaScanDataCtxKeysSwapIn,
+    .freeExtend = NULL,
+};
+
+/* KEYS pattern: cold keys of db iterated in one go by swap thread, pattern
+ * matched by iterate so that only matched metas (at most
+ * swap-keys-cold-limit of them, error if more) are held in memory. Pattern
+ * is not known when KEYS is queued in multi/exec, error if db has cold keys
+ * then. */
+int setupMetaScanDataCtx4Keys(metaScanDataCtx *datactx, client *c) {
+    sds pat;
+
+    datactx->type = &keysMetaScanDataCtxType;
+    if (c->argc != 2 || c->argv[1] == NULL ||
+            strcasecmp(c->argv[0]->ptr,"keys"))
+        return c->db->cold_keys ? SWAP_ERR_METASCAN_UNSUPPORTED_IN_MULTI : 0;
+
+    datactx->limit = server.swap_keys_cold_limit;
+    datactx->db_bounded = 1;
+    pat = c->argv[1]->ptr;
+    if (!(pat[0] == '*' && sdslen(pat) == 1)) {
+        datactx->pattern = sdsdup(pat);
+        datactx->prefix = metaScanPatternPrefix(pat);
+        datactx->count = INT_MAX;
+    }
+    return 0;
+}
+
+/* metaScanDataCtx - Slot */
+void metaScanDataCtxSlotSwapAna(metaScanDataCtx *datactx,
+        int *intention, uint32_t *intention_flags) {
+    if (datactx->slot < 0) { /* invalid slot replied by command */
+        *intention = SWAP_NOP;
+        *intention_flags = 0;
+    } else {
+        *intention = SWAP_IN;
+        *intention_flags = SWAP_EXEC_OOM_CHECK;
+    }
+}
+
+metaScanDataCtxType slotMetaScanDataCtxType = {
+    .swapAna = metaScanDataCtxSlotSwapAna,
+    .swapIn = NULL,
+    .freeExtend = NULL,
+};
+
+static int metaScanExcludeCompare(const void *a, const void *b) {
+    return sdscmp(*(sds*)a,*(sds*)b);
+}
+
+/* Meta rawkeys of (at most hotkeys) hot keys in slot, sorted as in rocksdb
+ * so that iterate could skip them (see RIOIterateSetExcludes). */
+sds *swapSlotHotMetaKeys(redisDb *db, int slot, unsigned int hotkeys,
+        int *num) {
+    robj **keys;
+    sds *metakeys;
+    unsigned int i, numkeys;
+
+    *num = 0;
+    if (hotkeys == 0) return NULL;
+    keys = zmalloc(sizeof(robj*)*hotkeys);
+    numkeys = getKeysInSlot(slot,keys,hotkeys);
+    metakeys = zmalloc(sizeof(sds)*numkeys);
+    for (i = 0; i < numkeys; i++) {
+        metakeys[i] = rocksEncodeMetaKey(db,keys[i]->ptr);
+        decrRefCount(keys[i]);
+    }
+    qsort(metakeys,numkeys,sizeof(sds),metaScanExcludeCompare);
+    zfree(keys);
+    *num = numkeys;
+    return metakeys;
+}
+
+/* CLUSTER COUNTKEYSINSLOT <slot> | CLUSTER GETKEYSINSLOT <slot> <count>:
+ * cold keys of slot is a range scan of slot if key encoding is v3, hot keys
+ * of slot are skipped by swap thread. COUNTKEYSINSLOT only counts cold keys
+ * in swap thread, GETKEYSINSLOT returns exactly the cold keys needed after
+ * hot ones. Otherwise keys of slot are scattered over the whole db, error is
+ * replied instead of hot keys only (so as in multi/exec, where slot is not
+ * known), unless db has no cold keys at all. */
+int setupMetaScanDataCtx4Slot(metaScanDataCtx *datactx, client *c) {
+    long long slot, maxkeys = -1;
+    unsigned int hotkeys;
+
+    datactx->type = &slotMetaScanDataCtxType;
+    if (c->db->cold_keys == 0)
+        return 0;
+    if (c->argc < 3 || c->argv[2] == NULL ||
+            strcasecmp(c->argv[0]->ptr,"cluster"))
+        return SWAP_ERR_METASCAN_UNSUPPORTED_IN_MULTI;
+    if (server.swap_key_encoding != SWAP_KEY_ENCODING_V3)
+        return SWAP_ERR_METASCAN_SLOT_UNSUPPORTED;
+
+    if (getLongLongFromObject(c->argv[2],&slot) != C_OK ||
+            slot < 0 || slot >= CLUSTER_SLOTS)
+        return 0;
+    if (c->argc == 4 && (getLongLongFromObject(c->argv[3],&maxkeys) != C_OK ||
+                maxkeys < 0))
+        return 0;
+
+    hotkeys = server.cluster_enabled ? countKeysInSlot(slot) : 0;
+    if (maxkeys >= 0 && hotkeys >= maxkeys) return 0;
+
+    datactx->db_bounded = 1;
+    datactx->count = INT_MAX;
+    datactx->count_only = maxkeys < 0;
+    datactx->limit = maxkeys < 0 ? ROCKS_ITERATE_NO_LIMIT :
+        (int)(maxkeys - hotkeys > INT_MAX ? INT_MAX : maxkeys - hotkeys);
+    datactx->slot = slot;
+    /* hot keys already replied from slot index. */
+    datactx->excludes = swapSlotHotMetaKeys(c->db,slot,hotkeys,
+            &datactx->numexcludes);
+    return 0;
+}
+
 /* MetaScan */
 int metaScanSwapAna(swapData *data, int thd, struct keyRequest *req,
         int *intention, uint32_t *intention_flags, void *datactx_) {
@@ -349,20 +573,93 @@ int metaScanEncodeRange(struct swapData *data, int intention, void *datactx_, in
         uint32_t *flags, int *pcf, sds *start, sds *end) {
     metaScanDataCtx *datactx = datactx_;
     serverAssert(SWAP_IN == intention);
+    if (datactx->expire_index) {
+        /* index entries of db that already expired, resumed from seek
+         * (raw index key) so that unexpired hot keys won't block the scan. */
+        *pcf = EXPIRE_CF;
+        *flags |= ROCKS_ITERATE_CONTINUOUSLY_SEEK|ROCKS_ITERATE_HIGH_BOUND_EXCLUDE;
+        *start = datactx->seek ? sdsdup(datactx->seek) :
+            rocksEncodeExpireIndexKey(data->db->id,0,NULL,0);
+        *end = rocksEncodeExpireIndexKey(data->db->id,mstime(),NULL,0);
+        *limit = datactx->limit;
+        return 0;
+    }
     *pcf = META_CF;
     *flags |= ROCKS_ITERATE_CONTINUOUSLY_SEEK;
     *start = rocksEncodeMetaKey(data->db,datactx->seek);
-    *end = NULL;
+    *end = datactx->db_bounded ? rocksEncodeDbRangeEndKey(data->db->id) : NULL;
     *limit = datactx->limit;
+    if (datactx->count_only) *flags |= ROCKS_ITERATE_COUNT_ONLY;
+    if (datactx->slot >= 0) {
+        sds slot_start, slot_end;
+        if (rocksEncodeSlotRange(data->db->id,datactx->slot,&slot_start,
+                    &slot_end) == 0) {
+            if (sdscmp(*start,slot_start) < 0) {
+                sdsfree(*start);
+                *start = slot_start;
+            } else {
+                sdsfree(slot_start);
+            }
+            if (*end) sdsfree(*end);
+            *end = slot_end;
+            *flags |= ROCKS_ITERATE_HIGH_BOUND_EXCLUDE;
+        }
+    }
+    if (datactx->prefix) {
+        sds prefix_start, prefix_end;
+        if (rocksEncodeKeyPrefixRange(data->db->id,datactx->prefix,
+                    sdslen(datactx->prefix),&prefix_start,&prefix_end)) {
+            /* keys not grouped by prefix in current key encoding. */
+            sdsfree(datactx->prefix);
+            datactx->prefix = NULL;
+        } else {
+            if (sdscmp(*start,prefix_start) < 0) {
+                sdsfree(*start);
+                *start = prefix_start;
+            } else {
+                sdsfree(prefix_start);
+            }
+            if (*end) sdsfree(*end);
+            *end = prefix_end;
+            *flags |= ROCKS_ITERATE_HIGH_BOUND_EXCLUDE;
+        }
+    }
     return 0;
 }
 
+void metaScanEncodeRangeExcludes(struct swapData *data, void *datactx_,
+        sds **excludes, int *num) {
+    metaScanDataCtx *datactx = datactx_;
+    UNUSED(data);
+    *excludes = datactx->excludes;
+    *num = datactx->numexcludes;
+}
+
+/* KEYS limits matched keys rather than scanned ones, unmatched keys are
+ * skipped by iterate. */
+sds metaScanEncodeRangeMatch(struct swapData *data, void *datactx_) {
+    metaScanDataCtx *datactx = datactx_;
+    UNUSED(data);
+    if (datactx->type != &keysMetaScanDataCtxType) return NULL;
+    return datactx->pattern;
+}
+
 int metaScanDecodeData(swapData *data, int num, int *cfs, sds *rawkeys,
         sds *rawvals, void **pdecoded) {
     int i, retval = 0;
-    metaScanResult *result = metaScanResultCreate();
+    metaScanResult *result;
     sds nextseek_rawkey = data->nextseek;
 
+    if (num > 0 && cfs[0] == EXPIRE_CF) {
+        data->nextseek = NULL;
+        return expireIndexDecodeData(data->db,num,rawkeys,nextseek_rawkey,
+                pdecoded);
+    }
+
+    result = metaScanResultCreate();
+    result->count = data->iterate_count;
+    data->iterate_count = 0;
+
     /* last entry in rawkeys is nextseek, NULL if iterate EOF. */
     if (nextseek_rawkey) {
         const char *nextseek;
@@ -400,8 +697,11 @@ int metaScanDecodeData(swapData *data, int num, int *cfs, sds *rawkeys,
     return retval;
 }
 
-void *metaScanCreateOrMergeObject(swapData *data, void *decoded, void *datactx) {
-    UNUSED(data), UNUSED(datactx);
+void *metaScanCreateOrMergeObject(swapData *data, void *decoded, void *datactx_) {
+    metaScanDataCtx *datactx = datactx_;
+    UNUSED(data);
+    if (decoded && metaScanDataCtxHasFilter(datactx))
+        metaScanDataCtxFilter(datactx,decoded);
     return decoded;
 }
 
@@ -409,11 +709,15 @@ int metaScanSwapIn(swapData *data, void *result_, void *datactx_) {
     metaScanDataCtx *datactx = datactx_;
     metaScanResult *result = result_;
     client *c = datactx->c;
+    int retval;
     UNUSED(data);
     if (c->swap_metas) freeScanMetaResult(c->swap_metas);
     c->swap_metas = result;
-    metaScanDataCtxSwapIn(datactx,result);
-    return 0;
+    if ((retval = metaScanDataCtxSwapIn(datactx,result))) {
+        freeScanMetaResult(c->swap_metas);
+        c->swap_metas = NULL;
+    }
+    return retval;
 }
 
 void freeMetaScanSwapData(swapData *data, void *datactx_) {
@@ -431,6 +735,14 @@ void freeMetaScanSwapData(swapData *data, void *datactx_) {
         sdsfree(datactx->seek);
         datactx->seek = NULL;
     }
+    if (datactx->pattern) sdsfree(datactx->pattern);
+    if (datactx->typename) sdsfree(datactx->typename);
+    if (datactx->prefix) sdsfree(datactx->prefix);
+    if (datactx->excludes) {
+        for (int i = 0; i < datactx->numexcludes; i++)
+            sdsfree(datactx->excludes[i]);
+        zfree(datactx->excludes);
+    }
     zfree(datactx);
 }
 
@@ -441,6 +753,8 @@ swapDataType metaScanSwapDataType = {
     .encodeKeys = NULL,
     .encodeData = NULL,
     .encodeRange = metaScanEncodeRange,
+    .encodeRangeExcludes = metaScanEncodeRangeExcludes,
+    .encodeRangeMatch = metaScanEncodeRangeMatch,
     .decodeData = metaScanDecodeData,
     .swapIn = metaScanSwapIn,
     .swapOut = NULL,
@@ -471,6 +785,16 @@ int swapDataSetupMetaScan(swapData *data, uint32_t intention_flags,
     datactx->limit = METASCAN_DEFAULT_LIMIT;
     datactx->seek = NULL;
     datactx->extend = NULL;
+    datactx->pattern = NULL;
+    datactx->typename = NULL;
+    datactx->prefix = NULL;
+    datactx->count = 0;
+    datactx->db_bounded = 0;
+    datactx->slot = -1;
+    datactx->expire_index = 0;
+    datactx->count_only = 0;
+    datactx->excludes = NULL;
+    datactx->numexcludes = 0;
 
     if (c == NULL) {
         return SWAP_ERR_SETUP_FAIL;
@@ -480,6 +804,10 @@ int swapDataSetupMetaScan(swapData *data, uint32_t intention_flags,
         retval = setupMetaScanDataCtx4Randomkey(datactx,c);
     } else if (intention_flags & SWAP_METASCAN_EXPIRE) {
         retval = setupMetaScanDataCtx4ScanExpire(datactx,c);
+    } else if (intention_flags & SWAP_METASCAN_KEYS) {
+        retval = setupMetaScanDataCtx4Keys(datactx,c);
+    } else if (intention_flags & SWAP_METASCAN_SLOT) {
+        retval = setupMetaScanDataCtx4Slot(datactx,c);
     } else {
         retval = SWAP_ERR_SETUP_FAIL;
     }
@@ -731,6 +1059,7 @@ int metaScanTest(int argc, char *argv[], int accurate) {
 
         server.swap_scan_session_bits = 7;
         server.swap_scan_session_max_idle_seconds = 60;
+        server.swap_keys_cold_limit = 100000;
         server.swap_scan_sessions = swapScanSessionsCreate(server.swap_scan_session_bits);
     }
 
@@ -823,6 +1152,206 @@ int metaScanTest(int argc, char *argv[], int accurate) {
         sdsfree(lastkey);
     }
 
+    TEST("metascan - scan match & type pushdown") {
+        int retval, cf, limit, orig_encoding = server.swap_key_encoding;
+        uint32_t flags = 0;
+        sds start, end;
+        metaScanDataCtx *datactx;
+        metaScanResult *result;
+        swapScanSession *session;
+        swapData *data;
+
+        data = createSwapData(db,NULL,NULL,NULL);
+        session = swapScanSessionsAssign(server.swap_scan_sessions);
+        rewriteResetClientCommandCString(c,8,"SCAN","1","COUNT","2","MATCH","k*","TYPE","hash");
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_SCAN,c,(void**)&datactx);
+        test_assert(retval == 0);
+        test_assert(datactx->count == 2 && datactx->limit == 2*METASCAN_FILTER_BUDGET_FACTOR);
+        test_assert(!strcmp(datactx->prefix,"k") && !strcmp(datactx->typename,"hash"));
+
+        /* v1 keys not grouped by prefix: no iterate range */
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V1;
+        swapDataEncodeRange(data,SWAP_IN,datactx,&limit,&flags,&cf,&start,&end);
+        test_assert(end == NULL && datactx->prefix == NULL);
+        sdsfree(start);
+
+        result = metaScanResultCreate();
+        metaScanResultAppend(result,SWAP_TYPE_HASH,sdsnew("k1"),-1);
+        metaScanResultAppend(result,SWAP_TYPE_STRING,sdsnew("k2"),-1);
+        metaScanResultAppend(result,SWAP_TYPE_HASH,sdsnew("x1"),-1);
+        metaScanResultAppend(result,SWAP_TYPE_HASH,sdsnew("k3"),-1);
+        metaScanResultAppend(result,SWAP_TYPE_HASH,sdsnew("k4"),-1);
+        metaScanResultSetNextSeek(result,sdsnew("k5"));
+        swapDataCreateOrMergeObject(data,result,datactx);
+        test_assert(result->filtered && result->num == 2);
+        test_assert(!strcmp(result->metas[0].key,"k1"));
+        test_assert(!strcmp(result->metas[1].key,"k3"));
+        test_assert(!strcmp(result->nextseek,"k4"));
+        freeScanMetaResult(result);
+
+        /* v2 iterates prefix range only, finished once out of prefix */
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V2;
+        datactx->prefix = sdsnew("k");
+        swapDataEncodeRange(data,SWAP_IN,datactx,&limit,&flags,&cf,&start,&end);
+        test_assert(end != NULL && sdscmp(start,end) < 0);
+        test_assert(flags & ROCKS_ITERATE_HIGH_BOUND_EXCLUDE);
+        test_assert(datactx->prefix != NULL);
+        sdsfree(start), sdsfree(end);
+
+        result = metaScanResultCreate();
+        metaScanResultAppend(result,SWAP_TYPE_HASH,sdsnew("k1"),-1);
+        metaScanResultSetNextSeek(result,sdsnew("l"));
+        swapDataCreateOrMergeObject(data,result,datactx);
+        test_assert(result->num == 1 && result->nextseek == NULL);
+        freeScanMetaResult(result);
+
+        server.swap_key_encoding = orig_encoding;
+        swapScanSessionUnbind(session,NULL);
+        swapScanSessionUnassign(server.swap_scan_sessions,session);
+        swapDataFree(data,datactx);
+    }
+
+    TEST("metascan - keys") {
+        int retval, cf, limit, orig_encoding = server.swap_key_encoding;
+        uint32_t flags = 0, intention_flags;
+        int intention;
+        sds start, end, dbend;
+        metaScanDataCtx *datactx;
+        metaScanResult *result;
+        swapData *data;
+
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V1;
+        data = createSwapData(db,NULL,NULL,NULL);
+        rewriteResetClientCommandCString(c,2,"KEYS","k*");
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_KEYS,c,(void**)&datactx);
+        test_assert(retval == 0);
+        test_assert(datactx->limit == server.swap_keys_cold_limit && datactx->db_bounded);
+        test_assert(!strcmp(datactx->pattern,"k*"));
+        metaScanDataCtxSwapAna(datactx,&intention,&intention_flags);
+        test_assert(intention == SWAP_IN && (intention_flags & SWAP_EXEC_OOM_CHECK));
+        swapDataEncodeRange(data,SWAP_IN,datactx,&limit,&flags,&cf,&start,&end);
+        dbend = rocksEncodeDbRangeEndKey(db->id);
+        test_assert(cf == META_CF && limit == server.swap_keys_cold_limit);
+        test_assert(end != NULL && !sdscmp(end,dbend));
+        test_assert(!strcmp(swapDataEncodeRangeMatch(data,datactx),"k*"));
+        sdsfree(start), sdsfree(end), sdsfree(dbend);
+
+        /* limit hit with keys left: error rather than partial reply. */
+        result = metaScanResultCreate();
+        metaScanResultSetNextSeek(result,sdsnew("k9"));
+        test_assert(metaScanDataCtxSwapIn(datactx,result) ==
+                SWAP_ERR_METASCAN_KEYS_TRUNCATED);
+        freeScanMetaResult(result);
+        result = metaScanResultCreate();
+        test_assert(metaScanDataCtxSwapIn(datactx,result) == 0);
+        freeScanMetaResult(result);
+        swapDataFree(data,datactx);
+
+        /* queued in multi: argv is EXEC, error if db has cold keys. */
+        db->cold_keys = 1;
+        data = createSwapData(db,NULL,NULL,NULL);
+        rewriteResetClientCommandCString(c,1,"EXEC");
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_KEYS,c,(void**)&datactx);
+        test_assert(retval == SWAP_ERR_METASCAN_UNSUPPORTED_IN_MULTI);
+        swapDataFree(data,datactx);
+        db->cold_keys = 0;
+        data = createSwapData(db,NULL,NULL,NULL);
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_KEYS,c,(void**)&datactx);
+        test_assert(retval == 0 && !datactx->db_bounded);
+        metaScanDataCtxSwapAna(datactx,&intention,&intention_flags);
+        test_assert(intention == SWAP_NOP);
+        swapDataFree(data,datactx);
+        server.swap_key_encoding = orig_encoding;
+    }
+
+    TEST("metascan - cluster slot") {
+        int retval, intention, slot = keyHashSlot("{t}k1",5);
+        int orig_encoding = server.swap_key_encoding;
+        uint32_t intention_flags;
+        metaScanDataCtx *datactx;
+        metaScanResult *result;
+        swapData *data;
+        char slotstr[16];
+
+        long long orig_cold_keys = db->cold_keys;
+        int cf, limit;
+        uint32_t flags = 0;
+        sds start, end, *excludes;
+        int numexcludes;
+
+        /* no cold keys: hot keys are exact. */
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V2;
+        db->cold_keys = 0;
+        data = createSwapData(db,NULL,NULL,NULL);
+        snprintf(slotstr,sizeof(slotstr),"%d",slot);
+        rewriteResetClientCommandCString(c,4,"CLUSTER","GETKEYSINSLOT",slotstr,"1");
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_SLOT,c,(void**)&datactx);
+        test_assert(retval == 0 && datactx->slot == -1);
+        metaScanDataCtxSwapAna(datactx,&intention,&intention_flags);
+        test_assert(intention == SWAP_NOP);
+        swapDataFree(data,datactx);
+
+        /* slot not contiguous: error rather than hot keys only. */
+        db->cold_keys = 1;
+        data = createSwapData(db,NULL,NULL,NULL);
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_SLOT,c,(void**)&datactx);
+        test_assert(retval == SWAP_ERR_METASCAN_SLOT_UNSUPPORTED);
+        swapDataFree(data,datactx);
+
+        /* queued in multi: slot not known. */
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V3;
+        data = createSwapData(db,NULL,NULL,NULL);
+        rewriteResetClientCommandCString(c,1,"EXEC");
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_SLOT,c,(void**)&datactx);
+        test_assert(retval == SWAP_ERR_METASCAN_UNSUPPORTED_IN_MULTI);
+        swapDataFree(data,datactx);
+
+        data = createSwapData(db,NULL,NULL,NULL);
+        rewriteResetClientCommandCString(c,4,"CLUSTER","GETKEYSINSLOT","16384","1");
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_SLOT,c,(void**)&datactx);
+        test_assert(retval == 0 && datactx->slot == -1);
+        metaScanDataCtxSwapAna(datactx,&intention,&intention_flags);
+        test_assert(intention == SWAP_NOP);
+        swapDataFree(data,datactx);
+
+        /* GETKEYSINSLOT: limited to maxkeys, slot filter still applied. */
+        data = createSwapData(db,NULL,NULL,NULL);
+        rewriteResetClientCommandCString(c,4,"CLUSTER","GETKEYSINSLOT",slotstr,"1");
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_SLOT,c,(void**)&datactx);
+        test_assert(retval == 0 && datactx->slot == slot && datactx->limit == 1);
+        test_assert(!datactx->count_only);
+        swapDataEncodeRange(data,SWAP_IN,datactx,&limit,&flags,&cf,&start,&end);
+        test_assert(cf == META_CF && limit == 1 && !(flags & ROCKS_ITERATE_COUNT_ONLY));
+        sdsfree(start), sdsfree(end);
+        swapDataEncodeRangeExcludes(data,datactx,&excludes,&numexcludes);
+        test_assert(numexcludes == 0);
+        result = metaScanResultCreate();
+        metaScanResultAppend(result,SWAP_TYPE_STRING,sdsnew("{t}k1"),-1);
+        metaScanResultAppend(result,SWAP_TYPE_STRING,sdsnew("{t}k2"),-1);
+        swapDataCreateOrMergeObject(data,result,datactx);
+        test_assert(result->num == 1 && !strcmp(result->metas[0].key,"{t}k1"));
+        freeScanMetaResult(result);
+        swapDataFree(data,datactx);
+
+        /* COUNTKEYSINSLOT: counted by swap thread, nothing returned. */
+        flags = 0;
+        data = createSwapData(db,NULL,NULL,NULL);
+        rewriteResetClientCommandCString(c,3,"CLUSTER","COUNTKEYSINSLOT",slotstr);
+        retval = swapDataSetupMetaScan(data,SWAP_METASCAN_SLOT,c,(void**)&datactx);
+        test_assert(retval == 0 && datactx->slot == slot && datactx->count_only);
+        swapDataEncodeRange(data,SWAP_IN,datactx,&limit,&flags,&cf,&start,&end);
+        test_assert(limit == ROCKS_ITERATE_NO_LIMIT && (flags & ROCKS_ITERATE_COUNT_ONLY));
+        sdsfree(start), sdsfree(end);
+        data->iterate_count = 3;
+        swapDataDecodeData(data,0,NULL,NULL,NULL,(void**)&result);
+        test_assert(result->num == 0 && result->count == 3);
+        test_assert(data->iterate_count == 0);
+        freeScanMetaResult(result);
+        swapDataFree(data,datactx);
+        db->cold_keys = orig_cold_keys;
+        server.swap_key_encoding = orig_encoding;
+    }
+
     TEST("metascan - scan session cursor manipulate") {
         swapScanSession session_, *session = &session_;
 
@@ -0,0 +1,710 @@
+/* Copyright (c) 2023, ctrip.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "ctrip_swap.h"
+#include "cluster.h"
+
+/* Bulk slot migration (SWAP.MIGRATESLOT/SWAP.RESTORESLOT, key encoding v3
+ * only): raw meta, data and score kvs of cold keys in slot are read from
+ * rocksdb and shipped in one payload, which target writes into rocksdb as
+ * is. So that cold keys are moved without being swapped in and serialized
+ * one by one as MIGRATE does. Hot keys of slot are skipped, they are still
+ * moved by MIGRATE.
+ *
+ * Both sides run on main thread holding db lock (see getKeyRequestsDb) so
+ * that no swap of db is inflight, rocksdb io is bounded by count keys per
+ * call and blocks as MIGRATE does. */
+
+#define SWAP_MIGRATE_KVS_INIT 4
+#define SWAP_MIGRATE_KEYS_INIT 16
+
+static int swapMigrateRawCompare(const char *a, size_t alen, const char *b,
+        size_t blen) {
+    int cmp = memcmp(a,b,MIN(alen,blen));
+    if (cmp == 0) cmp = alen == blen ? 0 : (alen < blen ? -1 : 1);
+    return cmp;
+}
+
+static void swapMigrateKeyAppend(swapMigrateKey *mkey, int cf,
+        MOVE sds rawkey, MOVE sds rawval) {
+    if (mkey->num == mkey->capacity) {
+        mkey->capacity = mkey->capacity ? mkey->capacity*2 :
+            SWAP_MIGRATE_KVS_INIT;
+        mkey->cfs = zrealloc(mkey->cfs,mkey->capacity*sizeof(int));
+        mkey->rawkeys = zrealloc(mkey->rawkeys,mkey->capacity*sizeof(sds));
+        mkey->rawvals = zrealloc(mkey->rawvals,mkey->capacity*sizeof(sds));
+    }
+    mkey->cfs[mkey->num] = cf;
+    mkey->rawkeys[mkey->num] = rawkey;
+    mkey->rawvals[mkey->num] = rawval;
+    mkey->num++;
+}
+
+static swapMigrateSlotBatch *swapMigrateSlotBatchNew(int slot) {
+    swapMigrateSlotBatch *batch = zcalloc(sizeof(swapMigrateSlotBatch));
+    batch->slot = slot;
+    return batch;
+}
+
+static swapMigrateKey *swapMigrateSlotBatchAppend(swapMigrateSlotBatch *batch,
+        MOVE sds key, long long expire, uint64_t version) {
+    swapMigrateKey *mkey;
+    if (batch->num == batch->capacity) {
+        batch->capacity = batch->capacity ? batch->capacity*2 :
+            SWAP_MIGRATE_KEYS_INIT;
+        batch->keys = zrealloc(batch->keys,
+                batch->capacity*sizeof(swapMigrateKey));
+    }
+    mkey = batch->keys+batch->num++;
+    memset(mkey,0,sizeof(swapMigrateKey));
+    mkey->key = key;
+    mkey->expire = expire;
+    mkey->version = version;
+    return mkey;
+}
+
+void swapMigrateSlotBatchFree(swapMigrateSlotBatch *batch) {
+    if (batch == NULL) return;
+    for (int i = 0; i < batch->num; i++) {
+        swapMigrateKey *mkey = batch->keys+i;
+        for (int j = 0; j < mkey->num; j++) {
+            sdsfree(mkey->rawkeys[j]);
+            sdsfree(mkey->rawvals[j]);
+        }
+        zfree(mkey->cfs);
+        zfree(mkey->rawkeys);
+        zfree(mkey->rawvals);
+        sdsfree(mkey->key);
+    }
+    zfree(batch->keys);
+    zfree(batch);
+}
+
+static inline int swapMigrateKeyExpired(swapMigrateKey *mkey, long long now) {
+    return mkey->expire != -1 && mkey->expire < now;
+}
+
+/* Metas of cold keys in slot, hot keys (in slot index, or in keyspace if
+ * not cluster) are skipped. Meta is the first kv of each key. */
+static int swapMigrateSlotCollectMetas(redisDb *db,
+        swapMigrateSlotBatch *batch, int count, sds *err) {
+    sds start, end, seek, *excludes = NULL;
+    int i, numexcludes = 0, retval = C_OK;
+
+    serverAssert(rocksEncodeSlotRange(db->id,batch->slot,&start,&end) == 0);
+    if (server.cluster_enabled) {
+        excludes = swapSlotHotMetaKeys(db,batch->slot,
+                countKeysInSlot(batch->slot),&numexcludes);
+    }
+
+    seek = start;
+    while (seek != NULL && batch->num < count) {
+        RIO _rio, *rio = &_rio;
+        int limit = count - batch->num;
+
+        RIOInitIterate(rio,META_CF,ROCKS_ITERATE_CONTINUOUSLY_SEEK|
+                ROCKS_ITERATE_HIGH_BOUND_EXCLUDE,seek,sdsdup(end),limit);
+        RIOIterateSetExcludes(rio,excludes,numexcludes);
+        RIODo(rio);
+        if (RIOGetError(rio)) {
+            *err = sdscatprintf(sdsempty(),"iterate meta failed: %s",
+                    rio->err ? rio->err : "");
+            retval = C_ERR;
+        }
+
+        for (i = 0; retval == C_OK && i < rio->iterate.numkeys; i++) {
+            sds rawkey = rio->iterate.rawkeys[i];
+            sds rawval = rio->iterate.rawvals[i];
+            const char *key;
+            size_t keylen;
+            long long expire;
+            uint64_t version;
+            swapMigrateKey *mkey;
+            sds keysds;
+
+            if (rocksDecodeMetaKey(rawkey,sdslen(rawkey),NULL,&key,&keylen) ||
+                    rocksDecodeMetaVal(rawval,sdslen(rawval),NULL,&expire,
+                        &version,NULL,NULL)) {
+                *err = sdsnew("decode meta failed");
+                retval = C_ERR;
+                break;
+            }
+            keysds = sdsnewlen(key,keylen);
+            if (dictFind(db->dict,keysds) != NULL) {
+                sdsfree(keysds);
+                continue;
+            }
+            mkey = swapMigrateSlotBatchAppend(batch,keysds,expire,version);
+            swapMigrateKeyAppend(mkey,META_CF,rawkey,rawval);
+            rio->iterate.rawkeys[i] = NULL, rio->iterate.rawvals[i] = NULL;
+        }
+
+        /* iterate stopped before limit reached: slot exhausted. */
+        seek = NULL;
+        if (retval == C_OK && rio->iterate.numkeys == limit) {
+            seek = rio->iterate.nextseek;
+            rio->iterate.nextseek = NULL;
+        }
+        RIODeinit(rio);
+        if (retval != C_OK) break;
+    }
+
+    if (seek) sdsfree(seek);
+    sdsfree(end);
+    for (i = 0; i < numexcludes; i++) sdsfree(excludes[i]);
+    zfree(excludes);
+    return retval;
+}
+
+/* Data or score kvs of collected keys. Meta key is prefix of data & score
+ * keys and metas are sorted, so kvs of batch lie in [first meta, successor
+ * of last meta) and are assigned to keys by merge walk. kvs of other keys
+ * in range (hot keys or stale versions) are skipped. */
+static int swapMigrateSlotCollectData(swapMigrateSlotBatch *batch, int cf,
+        sds *err) {
+    RIO _rio, *rio = &_rio;
+    sds first = batch->keys[0].rawkeys[0];
+    sds last = batch->keys[batch->num-1].rawkeys[0];
+    sds end = rocksEncodePrefixSuccessor(last,sdslen(last));
+    int i, j = 0, cmp = 0;
+
+    serverAssert(end != NULL);
+    RIOInitIterate(rio,cf,ROCKS_ITERATE_HIGH_BOUND_EXCLUDE,sdsdup(first),end,
+            ROCKS_ITERATE_NO_LIMIT);
+    RIODo(rio);
+    if (RIOGetError(rio)) {
+        *err = sdscatprintf(sdsempty(),"iterate %s failed: %s",
+                swapGetCFName(cf),rio->err ? rio->err : "");
+        RIODeinit(rio);
+        return C_ERR;
+    }
+
+    for (i = 0; i < rio->iterate.numkeys && j < batch->num; i++) {
+        sds rawkey = rio->iterate.rawkeys[i];
+        size_t metalen = rocksDataKeyPrefixLen(rawkey,sdslen(rawkey));
+        uint64_t version;
+
+        if (metalen == 0) continue;
+        metalen -= sizeof(uint64_t);
+        while (j < batch->num) {
+            sds metakey = batch->keys[j].rawkeys[0];
+            cmp = swapMigrateRawCompare(metakey,sdslen(metakey),rawkey,metalen);
+            if (cmp >= 0) break;
+            j++;
+        }
+        if (j == batch->num || cmp != 0) continue;
+        if (rocksDecodeDataKey(rawkey,sdslen(rawkey),NULL,NULL,NULL,&version,
+                    NULL,NULL) || version != batch->keys[j].version) continue;
+
+        swapMigrateKeyAppend(batch->keys+j,cf,rawkey,rio->iterate.rawvals[i]);
+        rio->iterate.rawkeys[i] = NULL, rio->iterate.rawvals[i] = NULL;
+    }
+
+    RIODeinit(rio);
+    return C_OK;
+}
+
+/* Collect at most count cold keys of slot with all their kvs, returns NULL
+ * with err set if failed. */
+swapMigrateSlotBatch *swapMigrateSlotCollect(redisDb *db, int slot, int count,
+        sds *err) {
+    swapMigrateSlotBatch *batch = swapMigrateSlotBatchNew(slot);
+
+    serverAssert(server.swap_key_encoding == SWAP_KEY_ENCODING_V3);
+    if (swapMigrateSlotCollectMetas(db,batch,count,err) != C_OK ||
+            (batch->num > 0 &&
+             (swapMigrateSlotCollectData(batch,DATA_CF,err) != C_OK ||
+              swapMigrateSlotCollectData(batch,SCORE_CF,err) != C_OK))) {
+        swapMigrateSlotBatchFree(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+/* Payload: key encoding, slot and number of keys, then each key as number
+ * of kvs followed by (cf,rawkey,rawval) with meta first. Footer is the same
+ * as DUMP payload (rdb version and crc64). Expired keys are not shipped,
+ * *num set to number of keys shipped. */
+sds swapMigrateSlotEncodePayload(swapMigrateSlotBatch *batch, int *num) {
+    rio payload;
+    unsigned char buf[2];
+    uint64_t crc;
+    long long now = mstime();
+    int i, j, n = 0;
+
+    for (i = 0; i < batch->num; i++) {
+        if (!swapMigrateKeyExpired(batch->keys+i,now)) n++;
+    }
+
+    rioInitWithBuffer(&payload,sdsempty());
+    serverAssert(rdbSaveLen(&payload,server.swap_key_encoding) != -1);
+    serverAssert(rdbSaveLen(&payload,batch->slot) != -1);
+    serverAssert(rdbSaveLen(&payload,n) != -1);
+    for (i = 0; i < batch->num; i++) {
+        swapMigrateKey *mkey = batch->keys+i;
+        if (swapMigrateKeyExpired(mkey,now)) continue;
+        serverAssert(rdbSaveLen(&payload,mkey->num) != -1);
+        for (j = 0; j < mkey->num; j++) {
+            serverAssert(rdbSaveLen(&payload,mkey->cfs[j]) != -1);
+            serverAssert(rdbSaveRawString(&payload,
+                        (unsigned char*)mkey->rawkeys[j],
+                        sdslen(mkey->rawkeys[j])) != -1);
+            serverAssert(rdbSaveRawString(&payload,
+                        (unsigned char*)mkey->rawvals[j],
+                        sdslen(mkey->rawvals[j])) != -1);
+        }
+    }
+
+    buf[0] = RDB_VERSION & 0xff;
+    buf[1] = (RDB_VERSION >> 8) & 0xff;
+    payload.io.buffer.ptr = sdscatlen(payload.io.buffer.ptr,buf,2);
+    crc = crc64(0,(unsigned char*)payload.io.buffer.ptr,
+            sdslen(payload.io.buffer.ptr));
+    memrev64ifbe(&crc);
+    payload.io.buffer.ptr = sdscatlen(payload.io.buffer.ptr,&crc,8);
+
+    *num = n;
+    return payload.io.buffer.ptr;
+}
+
+/* Delete collected keys (expire index included) from rocksdb and turn them
+ * deleted as DEL does, returns C_ERR with err set if failed. */
+int swapMigrateSlotDelete(redisDb *db, swapMigrateSlotBatch *batch, sds *err) {
+    RIO _rio, *rio = &_rio;
+    int i, j, numkeys = 0, *cfs;
+    sds *rawkeys;
+
+    for (i = 0; i < batch->num; i++) {
+        numkeys += batch->keys[i].num;
+        if (batch->keys[i].expire != -1) numkeys++;
+    }
+    cfs = zmalloc(numkeys*sizeof(int));
+    rawkeys = zmalloc(numkeys*sizeof(sds));
+    numkeys = 0;
+    for (i = 0; i < batch->num; i++) {
+        swapMigrateKey *mkey = batch->keys+i;
+        for (j = 0; j < mkey->num; j++) {
+            cfs[numkeys] = mkey->cfs[j];
+            rawkeys[numkeys++] = sdsdup(mkey->rawkeys[j]);
+        }
+        if (mkey->expire != -1) {
+            cfs[numkeys] = EXPIRE_CF;
+            rawkeys[numkeys++] = rocksEncodeExpireIndexKey(db->id,
+                    mkey->expire,mkey->key,sdslen(mkey->key));
+        }
+    }
+
+    RIOInitDel(rio,numkeys,cfs,rawkeys);
+    RIODo(rio);
+    if (RIOGetError(rio)) {
+        *err = sdscatprintf(sdsempty(),"delete migrated keys failed: %s",
+                rio->err ? rio->err : "");
+        RIODeinit(rio);
+        return C_ERR;
+    }
+    RIODeinit(rio);
+
+    for (i = 0; i < batch->num; i++) {
+        sds key = batch->keys[i].key;
+        coldFilterDeleteSubkeyFilter(db->cold_filter,key);
+        db->cold_keys--;
+        coldFilterDeleteKey(db->cold_filter,key);
+    }
+    return C_OK;
+}
+
+/* Parse payload of SWAP.MIGRATESLOT, keys must belong to slot of db. */
+static swapMigrateSlotBatch *swapRestoreSlotDecodePayload(redisDb *db,
+        int slot, sds payload, sds *err) {
+    rio rdb;
+    uint64_t encoding, pslot, numkeys, num, cf;
+    swapMigrateSlotBatch *batch = NULL;
+
+    if (verifyDumpPayload((unsigned char*)payload,sdslen(payload)) == C_ERR) {
+        *err = sdsnew("payload version or checksum are wrong");
+        return NULL;
+    }
+
+    rioInitWithBuffer(&rdb,payload);
+    if ((encoding = rdbLoadLen(&rdb,NULL)) == RDB_LENERR ||
+            (pslot = rdbLoadLen(&rdb,NULL)) == RDB_LENERR ||
+            (numkeys = rdbLoadLen(&rdb,NULL)) == RDB_LENERR)
+        goto malformed;
+    if (encoding != (uint64_t)server.swap_key_encoding) {
+        *err = sdscatprintf(sdsempty(),
+                "key encoding of payload (%llu) mismatch with mine (%d)",
+                (unsigned long long)encoding,server.swap_key_encoding);
+        return NULL;
+    }
+    if (pslot != (uint64_t)slot) goto malformed;
+
+    batch = swapMigrateSlotBatchNew(slot);
+    while (numkeys--) {
+        swapMigrateKey *mkey = NULL;
+
+        if ((num = rdbLoadLen(&rdb,NULL)) == RDB_LENERR || num == 0)
+            goto malformed;
+        while (num--) {
+            sds rawkey, rawval;
+
+            if ((cf = rdbLoadLen(&rdb,NULL)) == RDB_LENERR) goto malformed;
+            if ((rawkey = rdbGenericLoadStringObject(&rdb,RDB_LOAD_SDS,
+                            NULL)) == NULL) goto malformed;
+            if ((rawval = rdbGenericLoadStringObject(&rdb,RDB_LOAD_SDS,
+                            NULL)) == NULL) {
+                sdsfree(rawkey);
+                goto malformed;
+            }
+
+            if (mkey == NULL) {
+                /* meta first */
+                const char *key;
+                size_t keylen;
+                long long expire;
+                uint64_t version;
+                int dbid;
+
+                if (cf != META_CF ||
+                        rocksDecodeMetaKey(rawkey,sdslen(rawkey),&dbid,&key,
+                            &keylen) || dbid != db->id ||
+                        keyHashSlot((char*)key,(int)keylen) != slot ||
+                        rocksDecodeMetaVal(rawval,sdslen(rawval),NULL,&expire,
+                            &version,NULL,NULL)) {
+                    sdsfree(rawkey), sdsfree(rawval);
+                    goto malformed;
+                }
+                mkey = swapMigrateSlotBatchAppend(batch,
+                        sdsnewlen(key,keylen),expire,version);
+            } else {
+                sds metakey = mkey->rawkeys[0];
+                if ((cf != DATA_CF && cf != SCORE_CF) ||
+                        sdslen(rawkey) <= sdslen(metakey) ||
+                        memcmp(rawkey,metakey,sdslen(metakey))) {
+                    sdsfree(rawkey), sdsfree(rawval);
+                    goto malformed;
+                }
+            }
+            swapMigrateKeyAppend(mkey,(int)cf,rawkey,rawval);
+        }
+    }
+    return batch;
+
+malformed:
+    swapMigrateSlotBatchFree(batch);
+    *err = sdsnew("malformed payload");
+    return NULL;
+}
+
+/* Keys of payload must not exist, neither hot nor cold. */
+static int swapRestoreSlotCheckBusy(redisDb *db, swapMigrateSlotBatch *batch,
+        sds *err) {
+    RIO _rio, *rio = &_rio;
+    int i, busy = 0, *cfs;
+    sds *rawkeys;
+
+    for (i = 0; i < batch->num; i++) {
+        if (dictFind(db->dict,batch->keys[i].key) != NULL) busy = 1;
+    }
+    if (!busy && db->cold_keys > 0) {
+        cfs = zmalloc(batch->num*sizeof(int));
+        rawkeys = zmalloc(batch->num*sizeof(sds));
+        for (i = 0; i < batch->num; i++) {
+            cfs[i] = META_CF;
+            rawkeys[i] = sdsdup(batch->keys[i].rawkeys[0]);
+        }
+        RIOInitGet(rio,batch->num,cfs,rawkeys);
+        RIODo(rio);
+        if (RIOGetError(rio)) {
+            *err = sdscatprintf(sdsempty(),"get metas failed: %s",
+                    rio->err ? rio->err : "");
+            RIODeinit(rio);
+            return C_ERR;
+        }
+        busy = RIOGetNotFound(rio) != batch->num;
+        RIODeinit(rio);
+    }
+
+    if (busy) {
+        *err = sdsnew("-BUSYKEY Target key name already exists.");
+        return C_ERR;
+    }
+    return C_OK;
+}
+
+/* Write kvs of payload (expire index rebuilt) into rocksdb and turn keys
+ * cold. Returns keys restored, or NULL with err set if failed. */
+swapMigrateSlotBatch *swapRestoreSlotPayload(redisDb *db, int slot,
+        sds payload, sds *err) {
+    RIO _rio, *rio = &_rio;
+    swapMigrateSlotBatch *batch;
+    int i, j, numkeys = 0, *cfs;
+    sds *rawkeys, *rawvals;
+
+    if ((batch = swapRestoreSlotDecodePayload(db,slot,payload,err)) == NULL)
+        return NULL;
+    if (swapRestoreSlotCheckBusy(db,batch,err) != C_OK) {
+        swapMigrateSlotBatchFree(batch);
+        return NULL;
+    }
+
+    for (i = 0; i < batch->num; i++) {
+        numkeys += batch->keys[i].num;
+        if (batch->keys[i].expire != -1) numkeys++;
+    }
+    cfs = zmalloc(numkeys*sizeof(int));
+    rawkeys = zmalloc(numkeys*sizeof(sds));
+    rawvals = zmalloc(numkeys*sizeof(sds));
+    numkeys = 0;
+    for (i = 0; i < batch->num; i++) {
+        swapMigrateKey *mkey = batch->keys+i;
+        for (j = 0; j < mkey->num; j++) {
+            cfs[numkeys] = mkey->cfs[j];
+            rawkeys[numkeys] = sdsdup(mkey->rawkeys[j]);
+            rawvals[numkeys++] = sdsdup(mkey->rawvals[j]);
+        }
+        if (mkey->expire != -1 && server.swap_expire_index_enabled) {
+            cfs[numkeys] = EXPIRE_CF;
+            rawkeys[numkeys] = rocksEncodeExpireIndexKey(db->id,mkey->expire,
+                    mkey->key,sdslen(mkey->key));
+            rawvals[numkeys++] = sdsempty();
+        }
+    }
+
+    RIOInitPut(rio,numkeys,cfs,rawkeys,rawvals);
+    RIODo(rio);
+    if (RIOGetError(rio)) {
+        *err = sdscatprintf(sdsempty(),"write restored keys failed: %s",
+                rio->err ? rio->err : "");
+        RIODeinit(rio);
+        swapMigrateSlotBatchFree(batch);
+        return NULL;
+    }
+    RIODeinit(rio);
+
+    for (i = 0; i < batch->num; i++) {
+        swapMigrateKey *mkey = batch->keys+i;
+        coldFilterAddKey(db->cold_filter,mkey->key);
+        db->cold_keys++;
+        /* versions of source must not be reused by keys created later. */
+        if (mkey->version >= server.swap_key_version)
+            swapSetVersion(mkey->version+1);
+    }
+    return batch;
+}
+
+/* SWAP.RESTORESLOT <slot> <payload>: sent by SWAP.MIGRATESLOT of source
+ * node (and propagated as is to replicas and aof). */
+void swapRestoreSlotCommand(client *c) {
+    long long slot;
+    swapMigrateSlotBatch *batch;
+    sds err = NULL;
+
+    if (getLongLongFromObjectOrReply(c,c->argv[1],&slot,NULL) != C_OK)
+        return;
+    if (slot < 0 || slot >= CLUSTER_SLOTS) {
+        addReplyError(c,"Invalid slot");
+        return;
+    }
+    if (server.swap_key_encoding != SWAP_KEY_ENCODING_V3) {
+        addReplyError(c,"Slot restore requires swap-key-encoding-version 3");
+        return;
+    }
+    if (server.cluster_enabled && !(c->flags & CLIENT_MASTER) &&
+            c->id != CLIENT_ID_AOF &&
+            server.cluster->slots[slot] != server.cluster->myself &&
+            server.cluster->importing_slots_from[slot] == NULL) {
+        addReplyErrorFormat(c,"I'm not serving or importing slot %lld",slot);
+        return;
+    }
+
+    if ((batch = swapRestoreSlotPayload(c->db,slot,c->argv[2]->ptr,
+                    &err)) == NULL) {
+        addReplyErrorSds(c,err);
+        return;
+    }
+
+    for (int i = 0; i < batch->num; i++) {
+        robj *key = createStringObject(batch->keys[i].key,
+                sdslen(batch->keys[i].key));
+        signalModifiedKey(c,c->db,key);
+        notifyKeyspaceEvent(NOTIFY_GENERIC,"restore",key,c->db->id);
+        decrRefCount(key);
+        server.dirty++;
+    }
+    swapMigrateSlotBatchFree(batch);
+    addReply(c,shared.ok);
+}
+
+#ifdef REDIS_TEST
+
+sds *genSdsArray(int count, ...);
+int *genIntArray(int count, ...);
+
+static sds swapMigrateTestGet(int cf, sds rawkey) {
+    RIO _rio, *rio = &_rio;
+    sds rawval;
+    RIOInitGet(rio,1,genIntArray(1,cf),genSdsArray(1,sdsdup(rawkey)));
+    RIODo(rio);
+    rawval = rio->get.rawvals[0];
+    rio->get.rawvals[0] = NULL;
+    RIODeinit(rio);
+    return rawval;
+}
+
+static void swapMigrateTestPut(int cf, MOVE sds rawkey, MOVE sds rawval) {
+    RIO _rio, *rio = &_rio;
+    RIOInitPut(rio,1,genIntArray(1,cf),genSdsArray(1,rawkey),
+            genSdsArray(1,rawval));
+    RIODo(rio);
+    RIODeinit(rio);
+}
+
+int swapMigrateSlotTest(int argc, char *argv[], int accurate) {
+    UNUSED(argc), UNUSED(argv), UNUSED(accurate);
+    int error = 0, num, orig_encoding = server.swap_key_encoding;
+    int slot = keyHashSlot("{t}",3);
+    sds a = sdsnew("{t}a"), e = sdsnew("{t}e"), h = sdsnew("{t}h");
+    sds hot = sdsnew("{t}hot"), other = sdsnew("other");
+    sds f1 = sdsnew("f1"), f2 = sdsnew("f2"), payload, err = NULL;
+    swapMigrateSlotBatch *batch, *restored;
+    uint64_t orig_version = server.swap_key_version;
+    sds rawval;
+    redisDb *db;
+
+    TEST("migrate slot - init") {
+        server.hz = 10;
+        initTestRedisDb();
+        monotonicInit();
+        initServerConfig4Test();
+        if (!server.rocks) serverRocksInit();
+        initStatsSwap();
+        db = server.db;
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V3;
+        server.swap_key_version = 1;
+
+        swapMigrateTestPut(META_CF,rocksEncodeMetaKey(db,a),
+                rocksEncodeMetaVal(SWAP_TYPE_STRING,-1,0,NULL));
+        swapMigrateTestPut(DATA_CF,rocksEncodeDataKey(db,a,0,NULL),
+                sdsnew("va"));
+        swapMigrateTestPut(META_CF,rocksEncodeMetaKey(db,e),
+                rocksEncodeMetaVal(SWAP_TYPE_STRING,1,0,NULL));
+        swapMigrateTestPut(DATA_CF,rocksEncodeDataKey(db,e,0,NULL),
+                sdsnew("ve"));
+        swapMigrateTestPut(META_CF,rocksEncodeMetaKey(db,h),
+                rocksEncodeMetaVal(SWAP_TYPE_HASH,-1,5,NULL));
+        swapMigrateTestPut(DATA_CF,rocksEncodeDataKey(db,h,5,f1),
+                sdsnew("v1"));
+        swapMigrateTestPut(DATA_CF,rocksEncodeDataKey(db,h,5,f2),
+                sdsnew("v2"));
+        /* stale version, hot key and key of other slot not migrated. */
+        swapMigrateTestPut(DATA_CF,rocksEncodeDataKey(db,h,4,f1),
+                sdsnew("stale"));
+        swapMigrateTestPut(META_CF,rocksEncodeMetaKey(db,hot),
+                rocksEncodeMetaVal(SWAP_TYPE_STRING,-1,0,NULL));
+        swapMigrateTestPut(META_CF,rocksEncodeMetaKey(db,other),
+                rocksEncodeMetaVal(SWAP_TYPE_STRING,-1,0,NULL));
+        dictAdd(db->dict,sdsdup(hot),createStringObject("hot",3));
+        coldFilterAddKey(db->cold_filter,a);
+        coldFilterAddKey(db->cold_filter,e);
+        coldFilterAddKey(db->cold_filter,h);
+        db->cold_keys += 3;
+    }
+
+    TEST("migrate slot - collect") {
+        batch = swapMigrateSlotCollect(db,slot,1,&err);
+        test_assert(batch != NULL && batch->num == 1);
+        test_assert(!sdscmp(batch->keys[0].key,a) && batch->keys[0].num == 2);
+        swapMigrateSlotBatchFree(batch);
+
+        batch = swapMigrateSlotCollect(db,slot,10,&err);
+        test_assert(batch != NULL && batch->num == 3);
+        test_assert(!sdscmp(batch->keys[1].key,e) && batch->keys[1].expire == 1);
+        test_assert(!sdscmp(batch->keys[2].key,h) && batch->keys[2].num == 3);
+        test_assert(batch->keys[2].version == 5);
+        test_assert(batch->keys[2].cfs[0] == META_CF && batch->keys[2].cfs[1] == DATA_CF);
+    }
+
+    TEST("migrate slot - payload and delete") {
+        payload = swapMigrateSlotEncodePayload(batch,&num);
+        test_assert(num == 2);
+        test_assert(swapMigrateSlotDelete(db,batch,&err) == C_OK);
+        test_assert(db->cold_keys == 0);
+        sds metakey = rocksEncodeMetaKey(db,a);
+        test_assert(swapMigrateTestGet(META_CF,metakey) == NULL);
+        sdsfree(metakey);
+        swapMigrateSlotBatchFree(batch);
+    }
+
+    TEST("migrate slot - restore") {
+        restored = swapRestoreSlotPayload(db,slot+1,payload,&err);
+        test_assert(restored == NULL && err != NULL);
+        sdsfree(err), err = NULL;
+
+        restored = swapRestoreSlotPayload(db,slot,payload,&err);
+        test_assert(restored != NULL && restored->num == 2);
+        test_assert(db->cold_keys == 2 && server.swap_key_version == 6);
+        sds datakey = rocksEncodeDataKey(db,h,5,f2);
+        rawval = swapMigrateTestGet(DATA_CF,datakey);
+        test_assert(rawval != NULL && !strcmp(rawval,"v2"));
+        sdsfree(rawval), sdsfree(datakey);
+        swapMigrateSlotBatchFree(restored);
+
+        restored = swapRestoreSlotPayload(db,slot,payload,&err);
+        test_assert(restored == NULL && !strncmp(err,"-BUSYKEY",8));
+        sdsfree(err), err = NULL;
+
+        payload[0] ^= 0xff;
+        restored = swapRestoreSlotPayload(db,slot,payload,&err);
+        test_assert(restored == NULL && err != NULL);
+        sdsfree(err), err = NULL;
+        sdsfree(payload);
+    }
+
+    TEST("migrate slot - deinit") {
+        RIO _rio, *rio = &_rio;
+        batch = swapMigrateSlotCollect(db,slot,10,&err);
+        test_assert(batch != NULL && batch->num == 2);
+        test_assert(swapMigrateSlotDelete(db,batch,&err) == C_OK);
+        swapMigrateSlotBatchFree(batch);
+        RIOInitDel(rio,3,genIntArray(3,DATA_CF,META_CF,META_CF),
+                genSdsArray(3,rocksEncodeDataKey(db,h,4,f1),
+                    rocksEncodeMetaKey(db,hot),rocksEncodeMetaKey(db,other)));
+        RIODo(rio);
+        RIODeinit(rio);
+        dictDelete(db->dict,hot);
+        server.swap_key_encoding = orig_encoding;
+        server.swap_key_version = orig_version;
+    }
+
+    sdsfree(a), sdsfree(e), sdsfree(h), sdsfree(hot), sdsfree(other);
+    sdsfree(f1), sdsfree(f2);
+    return error;
+}
+
+#endif
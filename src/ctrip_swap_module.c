@@ -0,0 +1,260 @@
+/* Copyright (c) 2021, ctrip.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ctrip_swap.h"
+
+/* Module value is swapped as a whole key, encoded by the rdb_save/rdb_load
+ * callbacks of its module type (same payload as RDB_TYPE_MODULE_2), so any
+ * module type that persists to rdb can be swapped without module changes.
+ * Module callbacks are not thread safe: value is serialized in main thread
+ * (swapAna) and handed to swap thread as raw bytes, raw bytes read by swap
+ * thread are deserialized in main thread (swapIn). */
+
+static sds moduleEncodeValRdb(robj *key, robj *value) {
+    rio sdsrdb;
+    rioInitWithBuffer(&sdsrdb,sdsempty());
+    rdbSaveObjectType(&sdsrdb,value);
+    rdbSaveObject(&sdsrdb,value,key);
+    return sdsrdb.io.buffer.ptr;
+}
+
+static robj *moduleDecodeValRdb(robj *key, sds raw) {
+    rio sdsrdb;
+    int rdbtype;
+    rioInitWithBuffer(&sdsrdb,raw);
+    rdbtype = rdbLoadObjectType(&sdsrdb);
+    if (rdbtype != RDB_TYPE_MODULE_2) return NULL;
+    return rdbLoadObject(rdbtype,&sdsrdb,key->ptr,NULL,0);
+}
+
+/* datactx is data->extends: ctx_flag in extends[0] (same as string),
+ * value serialized by main thread in extends[1]. */
+#define moduleDataCtxEncoded(data) ((sds*)&(data)->extends[1])
+
+int moduleSwapAna(swapData *data, int thd, struct keyRequest *req,
+        int *intention, uint32_t *intention_flags, void *datactx) {
+    sds *encoded = moduleDataCtxEncoded(data);
+    wholeKeySwapAna(data,thd,req,intention,intention_flags,datactx);
+    if (*intention == SWAP_OUT) {
+        serverAssert(thd == SWAP_ANA_THD_MAIN && data->value);
+        if (*encoded) sdsfree(*encoded);
+        *encoded = moduleEncodeValRdb(data->key,data->value);
+    }
+    return 0;
+}
+
+int moduleEncodeData(swapData *data, int intention, void *datactx,
+        int *numkeys, int **pcfs, sds **prawkeys, sds **prawvals) {
+    UNUSED(datactx);
+    sds *encoded = moduleDataCtxEncoded(data);
+    serverAssert(intention == SWAP_OUT && *encoded);
+    sds *rawkeys = zmalloc(sizeof(sds));
+    sds *rawvals = zmalloc(sizeof(sds));
+    int *cfs = zmalloc(sizeof(int));
+    rawkeys[0] = rocksEncodeDataKey(data->db,data->key->ptr,SWAP_VERSION_ZERO,NULL);
+    rawvals[0] = *encoded;
+    *encoded = NULL;
+    cfs[0] = DATA_CF;
+    *numkeys = 1;
+    *prawkeys = rawkeys;
+    *prawvals = rawvals;
+    *pcfs = cfs;
+    return 0;
+}
+
+/* raw value passed to main thread as is, decoded in moduleSwapIn. */
+int moduleDecodeData(swapData *data, int num, int *cfs, sds *rawkeys,
+        sds *rawvals, void **pdecoded) {
+    serverAssert(num == 1);
+    UNUSED(data);
+    UNUSED(rawkeys);
+    UNUSED(cfs);
+    *pdecoded = sdsdup(rawvals[0]);
+    return 0;
+}
+
+int moduleSwapIn(swapData *data, MOVE void *result, void *datactx) {
+    robj *value = moduleDecodeValRdb(data->key,result);
+    sdsfree(result);
+    /* module type not loaded or module failed to load its value. */
+    if (value == NULL) return SWAP_ERR_DATA_DECODE_FAIL;
+    return wholeKeySwapIn(data,value,datactx);
+}
+
+void freeModuleSwapData(swapData *data, void *datactx) {
+    sds *encoded = moduleDataCtxEncoded(data);
+    UNUSED(datactx);
+    if (*encoded) {
+        sdsfree(*encoded);
+        *encoded = NULL;
+    }
+}
+
+swapDataType moduleSwapDataType = {
+    .name = "module",
+    .cmd_swap_flags = CMD_SWAP_DATATYPE_MODULE,
+    .swapAna = moduleSwapAna,
+    .swapAnaAction = wholeKeySwapAnaAction,
+    .encodeKeys = wholeKeyEncodeKeys,
+    .encodeData = moduleEncodeData,
+    .decodeData = moduleDecodeData,
+    .encodeRange = NULL,
+    .swapIn = moduleSwapIn,
+    .swapOut = wholeKeySwapOut,
+    .swapDel = wholeKeySwapDel,
+    .createOrMergeObject = wholeKeyCreateOrMergeObject,
+    .cleanObject = NULL,
+    .beforeCall = NULL,
+    .free = freeModuleSwapData,
+    .rocksDel = NULL,
+    .mergedIsHot = wholeKeyMergedIsHot,
+};
+
+int swapDataSetupModule(swapData *d, OUT void **pdatactx) {
+    d->type = &moduleSwapDataType;
+    d->omtype = &wholekeyObjectMetaType;
+    /* same as string, store ctx_flag in struct swapData's `void *extends[2];` */
+    long *datactx = (long*)d->extends;
+    *datactx = BIG_DATA_CTX_FLAG_NONE;
+    *moduleDataCtxEncoded(d) = NULL;
+    *pdatactx = d->extends;
+    return 0;
+}
+
+/* ------------------- module rdb load -------------------------------- */
+int moduleValueLoad(struct rdbKeyLoadData *load, rio *rdb, int *cf,
+        sds *rawkey, sds *rawval, int *error) {
+    robj *o, keyobj;
+    int rdb_error = 0;
+
+    o = rdbLoadObject(load->rdbtype,rdb,load->key,&rdb_error,0);
+    if (o == NULL) {
+        *error = rdb_error ? rdb_error : RDB_LOAD_ERR_OTHER;
+        return 0;
+    }
+
+    initStaticStringObject(keyobj,load->key);
+    *error = 0;
+    *cf = DATA_CF;
+    *rawkey = rocksEncodeDataKey(load->db,load->key,SWAP_VERSION_ZERO,NULL);
+    /* RDB_TYPE_MODULE (v1) re-encoded as RDB_TYPE_MODULE_2. */
+    *rawval = moduleEncodeValRdb(&keyobj,o);
+    decrRefCount(o);
+    return 0;
+}
+
+rdbKeyLoadType moduleValueLoadType = {
+    .load_start = wholekeyLoadStart,
+    .load = moduleValueLoad,
+    .load_end = NULL,
+    .load_deinit = NULL,
+};
+
+void moduleValueLoadInit(rdbKeyLoadData *load) {
+    load->type = &moduleValueLoadType;
+    load->omtype = &wholekeyObjectMetaType;
+    load->swap_type = SWAP_TYPE_MODULE;
+}
+
+#ifdef REDIS_TEST
+
+static void *testModuleTypeLoad(RedisModuleIO *io, int encver) {
+    UNUSED(encver);
+    return (void*)(long)rdbLoadLen(io->rio,NULL);
+}
+
+static void testModuleTypeSave(RedisModuleIO *io, void *value) {
+    rdbSaveLen(io->rio,(long)value);
+}
+
+static void testModuleTypeFree(void *value) {
+    UNUSED(value);
+}
+
+int swapDataModuleTest(int argc, char **argv, int accurate) {
+    UNUSED(argc), UNUSED(argv), UNUSED(accurate);
+    int error = 0;
+    moduleType mt = {0};
+
+    initTestRedisServer();
+    redisDb *db = server.db + 0;
+
+    mt.id = 0x1234ULL<<10;
+    mt.rdb_load = testModuleTypeLoad;
+    mt.rdb_save = testModuleTypeSave;
+    mt.free = testModuleTypeFree;
+    memcpy(mt.name,"swaptest1",sizeof(mt.name));
+
+    TEST("module - setup") {
+        void *ctx = NULL;
+        robj *key = createStringObject("mkey",4);
+        robj *value = createModuleObject(&mt,(void*)12345L);
+        swapData *data = createSwapData(db,key,value,NULL);
+        test_assert(!swapDataSetupMeta(data,SWAP_TYPE_MODULE,-1,&ctx));
+        test_assert(data->type == &moduleSwapDataType);
+        test_assert(swapTypeIsWholeKey(data->swap_type));
+        swapDataFree(data,ctx);
+        decrRefCount(key), decrRefCount(value);
+    }
+
+    TEST("module - encode & load rdb payload") {
+        void *ctx = NULL;
+        robj *key = createStringObject("mkey",4);
+        robj *value = createModuleObject(&mt,(void*)12345L);
+        swapData *data = createSwapData(db,key,value,NULL);
+        int numkeys, *cfs;
+        sds *rawkeys, *rawvals;
+        rio sdsrdb;
+        RedisModuleIO io;
+
+        swapDataSetupMeta(data,SWAP_TYPE_MODULE,-1,&ctx);
+        /* serialized in main thread by swapAna. */
+        *moduleDataCtxEncoded(data) = moduleEncodeValRdb(key,value);
+        test_assert(!moduleEncodeData(data,SWAP_OUT,ctx,&numkeys,&cfs,
+                    &rawkeys,&rawvals));
+        test_assert(*moduleDataCtxEncoded(data) == NULL);
+        test_assert(numkeys == 1 && cfs[0] == DATA_CF);
+
+        /* payload is the same as RDB_TYPE_MODULE_2 in rdb. */
+        rioInitWithBuffer(&sdsrdb,rawvals[0]);
+        test_assert(rdbLoadObjectType(&sdsrdb) == RDB_TYPE_MODULE_2);
+        test_assert(rdbLoadLen(&sdsrdb,NULL) == mt.id);
+        moduleInitIOContext(io,&mt,&sdsrdb,key);
+        test_assert(testModuleTypeLoad(&io,0) == (void*)12345L);
+        test_assert(rdbLoadLen(&sdsrdb,NULL) == RDB_MODULE_OPCODE_EOF);
+
+        sdsfree(rawkeys[0]), sdsfree(rawvals[0]);
+        zfree(rawkeys), zfree(rawvals), zfree(cfs);
+        swapDataFree(data,ctx);
+        decrRefCount(key), decrRefCount(value);
+    }
+
+    return error;
+}
+
+#endif
@@ -37,6 +37,7 @@ static inline objectMetaType *getObjectMetaType(int swap_type) {
     objectMetaType *omtype = NULL;
     switch (swap_type) {
     case SWAP_TYPE_STRING:
+    case SWAP_TYPE_MODULE:
         omtype = NULL;
         break;
     case SWAP_TYPE_HASH:
@@ -344,7 +345,7 @@ size_t objectEstimateSize(robj *o) {
         asize = objectComputeSize(o,OBJECT_ESTIMATE_SIZE_SAMPLE);
         break;
     case OBJ_MODULE:
-        /*TODO support module*/
+        /* mem_usage callback of module type, if any. */
         asize = objectComputeSize(o,OBJECT_ESTIMATE_SIZE_SAMPLE);
         break;
     }
@@ -366,6 +367,7 @@ size_t ctrip_objectComputeSize(robj *val, int samples, objectMeta *object_meta)
 
     switch (object_meta->swap_type) {
     case SWAP_TYPE_STRING:
+    case SWAP_TYPE_MODULE:
         total_size = hot_size;
         break;
     case SWAP_TYPE_HASH:
@@ -469,6 +469,7 @@ int keyLoadFixDataInit(keyLoadFixData *fix, redisDb *db, decodedResult *dr) {
 
     switch (dm->swap_type) {
     case SWAP_TYPE_STRING:
+    case SWAP_TYPE_MODULE:
         rebuild_meta = NULL;
         break;
     case SWAP_TYPE_HASH:
@@ -606,8 +607,22 @@ static int keyLoadFixAna(struct keyLoadFixData *fix) {
     }
 }
 
+/* Expire index is rebuilt from fixed metas: entries written before crash
+ * might be missing or stale. */
+static inline void keyLoadFixIndexExpire(struct keyLoadFixData *fix,
+        rocksdb_writebatch_t *index_wb, loadFixStats *fix_stats) {
+    sds rawkey;
+    if (index_wb == NULL || fix->expire == -1) return;
+    rawkey = rocksEncodeExpireIndexKey(fix->db->id,fix->expire,
+            fix->key->ptr,sdslen(fix->key->ptr));
+    rocksdb_writebatch_put_cf(index_wb,server.rocks->cf_handles[EXPIRE_CF],
+            rawkey,sdslen(rawkey),"",0);
+    sdsfree(rawkey);
+    fix_stats->fix_index++;
+}
+
 static inline int keyLoadFixEnd(struct keyLoadFixData *fix,
-        loadFixStats *fix_stats) {
+        rocksdb_writebatch_t *index_wb, loadFixStats *fix_stats) {
     sds extend = NULL;
     int fix_result = 0;
     RIO _rio = {0}, *rio = &_rio;
@@ -625,6 +640,7 @@ static inline int keyLoadFixEnd(struct keyLoadFixData *fix,
         fix_stats->fix_none++;
         fix->db->cold_keys++;
         coldFilterAddKey(fix->db->cold_filter,fix->key->ptr);
+        keyLoadFixIndexExpire(fix,index_wb,fix_stats);
         break;
     case FIX_UPDATE:
         cfs = zmalloc(sizeof(int));
@@ -640,6 +656,7 @@ static inline int keyLoadFixEnd(struct keyLoadFixData *fix,
             fix_stats->fix_update++;
             fix->db->cold_keys++;
             coldFilterAddKey(fix->db->cold_filter,fix->key->ptr);
+            keyLoadFixIndexExpire(fix,index_wb,fix_stats);
         } else  {
             fix_stats->fix_err++;
             if (rio->err) fix->errstr = sdsdup(rio->err);
@@ -678,14 +695,53 @@ sds loadFixStatsDump(loadFixStats *stats) {
             "fix.do.none=%lld,"
             "fix.do.update=%lld,"
             "fix.do.delete=%lld,"
-            "fix.do.err=%lld",
+            "fix.do.err=%lld,"
+            "fix.do.index=%lld",
             stats->init_ok,
             stats->init_skip,
             stats->init_err,
             stats->fix_none,
             stats->fix_update,
             stats->fix_delete,
-            stats->fix_err);
+            stats->fix_err,
+            stats->fix_index);
+}
+
+#define EXPIRE_INDEX_REBUILD_BATCH 1024
+
+static rocksdb_writebatch_t *persistLoadFixIndexStart(rocks *rocks, redisDb *db) {
+    char *err = NULL;
+    sds start, end;
+
+    if (!server.swap_expire_index_enabled) return NULL;
+
+    start = rocksEncodeDbRangeStartKey(db->id);
+    end = rocksEncodeDbRangeEndKey(db->id);
+    rocksdb_delete_range_cf(rocks->db,rocks->wopts,
+            rocks->cf_handles[EXPIRE_CF],start,sdslen(start),
+            end,sdslen(end),&err);
+    sdsfree(start), sdsfree(end);
+    if (err != NULL) {
+        serverLog(LL_WARNING,"[persist] drop db(%d) expire index failed: %s",
+                db->id,err);
+        zlibc_free(err);
+    }
+    return rocksdb_writebatch_create();
+}
+
+static void persistLoadFixIndexFlush(rocks *rocks, rocksdb_writebatch_t *index_wb,
+        int force) {
+    char *err = NULL;
+    if (index_wb == NULL) return;
+    if (!force && rocksdb_writebatch_count(index_wb) < EXPIRE_INDEX_REBUILD_BATCH)
+        return;
+    rocksdb_write(rocks->db,rocks->wopts,index_wb,&err);
+    rocksdb_writebatch_clear(index_wb);
+    if (err != NULL) {
+        /* missing index only delays active expire of keys. */
+        serverLog(LL_WARNING,"[persist] write expire index failed: %s",err);
+        zlibc_free(err);
+    }
 }
 
 /* scan and fix whole persisted data. */
@@ -698,6 +754,7 @@ int persistLoadFixDb(redisDb *db) {
     decodedResultInit(cur);
     decodedResultInit(next);
     int iter_valid; /* true if current iter value is valid. */
+    rocksdb_writebatch_t *index_wb = NULL;
 
     rocks *rocks = serverRocksGetReadLock();
     if (!(it = rocksCreateIter(rocks,db))) {
@@ -705,6 +762,7 @@ int persistLoadFixDb(redisDb *db) {
         serverRocksUnlock(rocks);
         return C_ERR;
     }
+    index_wb = persistLoadFixIndexStart(rocks,db);
 
     iter_valid = rocksIterSeekToFirst(it);
 
@@ -791,14 +849,16 @@ int persistLoadFixDb(redisDb *db) {
         }
 
         /* call save_end if save_start called, no matter error or not. */
-        if (keyLoadFixEnd(fix, fix_stats) != C_OK) {
+        if (keyLoadFixEnd(fix, index_wb, fix_stats) != C_OK) {
             errstr = sdsdup(fix->errstr);
             keyLoadFixDataDeinit(fix);
             goto err;
         }
 
         keyLoadFixDataDeinit(fix);
+        persistLoadFixIndexFlush(rocks,index_wb,0);
     }
+    persistLoadFixIndexFlush(rocks,index_wb,1);
 
     if (db->cold_keys) {
         sds iter_stats_dump = rocksIterDecodeStatsDump(iter_stats);
@@ -811,6 +871,7 @@ int persistLoadFixDb(redisDb *db) {
     }
 
     if (it) rocksReleaseIter(it);
+    if (index_wb) rocksdb_writebatch_destroy(index_wb);
     serverRocksUnlock(rocks);
 
     return C_OK;
@@ -818,6 +879,7 @@ int persistLoadFixDb(redisDb *db) {
 err:
     serverLog(LL_WARNING, "Fix persist data rdb failed: %s", errstr);
     if (it) rocksReleaseIter(it);
+    if (index_wb) rocksdb_writebatch_destroy(index_wb);
     if (errstr) sdsfree(errstr);
     serverRocksUnlock(rocks);
     return C_ERR;
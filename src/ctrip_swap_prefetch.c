@@ -0,0 +1,218 @@
+/* Copyright (c) 2024, ctrip.com * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ctrip_swap.h"
+
+/* Pipeline lookahead: when a command of a client needs swap, commands
+ * already pipelined in its querybuf are parsed (without touching client
+ * state) and swap-ins for their cold keys are submitted by prefetch
+ * clients, so that they are batched into the same multiget and served
+ * from memory when those commands are processed. */
+
+swapPrefetchCtx *swapPrefetchCtxNew(void) {
+    int i;
+    swapPrefetchCtx *ctx = zcalloc(sizeof(swapPrefetchCtx));
+    ctx->clients = zmalloc(server.dbnum*sizeof(client*));
+    for (i = 0; i < server.dbnum; i++) {
+        client *c = createClient(NULL);
+        c->db = server.db+i;
+        c->cmd = lookupCommandByCString("get");
+        c->client_hold_mode = CLIENT_HOLD_MODE_EVICT;
+        c->flags |= CLIENT_SWAP_PREFETCH;
+        ctx->clients[i] = c;
+    }
+    return ctx;
+}
+
+void swapPrefetchCtxFree(swapPrefetchCtx *ctx) {
+    int i;
+    if (ctx == NULL) return;
+    for (i = 0; i < server.dbnum; i++) {
+        freeClient(ctx->clients[i]);
+    }
+    zfree(ctx->clients);
+    zfree(ctx);
+}
+
+static void swapPrefetchKeyRequestFinished(client *c, swapCtx *ctx) {
+    swapPrefetchCtx *prefetch_ctx = server.swap_prefetch_ctx;
+    robj *key = ctx->key_request->key;
+    /* prefetch is best effort, error is reported when command proceed. */
+    if (ctx->errcode) prefetch_ctx->stat.error_count++;
+    incrRefCount(key);
+    c->keyrequests_count--;
+    prefetch_ctx->inprogress_count--;
+    serverAssert(c->client_hold_mode == CLIENT_HOLD_MODE_EVICT);
+    clientReleaseLocks(c,ctx);
+    decrRefCount(key);
+}
+
+/* Parse one multibulk command from buf, returns bytes consumed or 0 if
+ * command is not complete (or not parsable, leave it to processInputBuffer).
+ * argv is created only if command parsed. */
+static size_t swapPrefetchParseCommand(const char *buf, size_t len,
+        robj ***pargv, int *pargc) {
+    const char *p = buf, *end = buf+len, *newline;
+    long long multibulklen, bulklen;
+    robj **argv;
+    int argc = 0;
+
+    if (len == 0 || *p != '*') return 0;
+    newline = memchr(p,'\r',end-p);
+    if (newline == NULL || newline+1 >= end) return 0;
+    if (!string2ll(p+1,newline-(p+1),&multibulklen) || multibulklen <= 0 ||
+            multibulklen > SWAP_PREFETCH_MAX_ARGC) return 0;
+    p = newline+2;
+
+    argv = zmalloc(sizeof(robj*)*multibulklen);
+    while (argc < multibulklen) {
+        if (p >= end || *p != '$') goto err;
+        newline = memchr(p,'\r',end-p);
+        if (newline == NULL || newline+1 >= end) goto err;
+        if (!string2ll(p+1,newline-(p+1),&bulklen) || bulklen < 0 ||
+                bulklen > server.proto_max_bulk_len) goto err;
+        p = newline+2;
+        if (end-p < bulklen+2) goto err;
+        argv[argc++] = createStringObject(p,bulklen);
+        p += bulklen+2;
+    }
+
+    *pargv = argv;
+    *pargc = argc;
+    return p-buf;
+
+err:
+    while (argc--) decrRefCount(argv[argc]);
+    zfree(argv);
+    return 0;
+}
+
+/* Key might need swap in if it's not in memory or not fully hot. */
+static inline int swapPrefetchKeyMayNeedSwapIn(redisDb *db, robj *key) {
+    return lookupKey(db,key,LOOKUP_NOTOUCH) == NULL ||
+        lookupMeta(db,key) != NULL;
+}
+
+static inline int swapPrefetchKeyRequestCandidate(redisDb *db, keyRequest *kr) {
+    /* only key/subkey requests are prefetched: range/score/bitmap requests
+     * relies on arg rewrite of the command being processed. */
+    return kr->level == REQUEST_LEVEL_KEY && kr->key != NULL &&
+        kr->cmd_intention == SWAP_IN &&
+        !isMetaScanRequest(kr->cmd_intention_flags) &&
+        (kr->type == KEYREQUEST_TYPE_KEY ||
+         kr->type == KEYREQUEST_TYPE_SUBKEY) &&
+        swapPrefetchKeyMayNeedSwapIn(db,kr->key);
+}
+
+/* Returns 1 if lookahead should stop at this command (db might switch,
+ * or following commands would be queued). */
+static int swapPrefetchCommand(swapPrefetchCtx *ctx, redisDb *db,
+        robj **argv, int argc) {
+    struct redisCommand *cmd;
+    getKeyRequestsResult result = GET_KEYREQUESTS_RESULT_INIT;
+    getKeyRequestsResult prefetch = GET_KEYREQUESTS_RESULT_INIT;
+    int i;
+
+    cmd = lookupCommand(argv[0]->ptr);
+    if (cmd == NULL) return 0;
+    if (cmd->proc == selectCommand || cmd->proc == swapdbCommand ||
+            cmd->proc == multiCommand || cmd->proc == execCommand)
+        return 1;
+    if (!(cmd->flags & CMD_READONLY) || cmd->intention != SWAP_IN) return 0;
+    if ((cmd->arity > 0 && cmd->arity != argc) || argc < -cmd->arity) return 0;
+
+    getCommandKeyRequests(db->id,cmd,argv,argc,&result);
+    getKeyRequestsPrepareResult(&prefetch,result.num);
+    for (i = 0; i < result.num; i++) {
+        keyRequest *kr = result.key_requests+i;
+        if (!swapPrefetchKeyRequestCandidate(db,kr)) continue;
+        moveKeyRequest(prefetch.key_requests+prefetch.num,kr);
+        prefetch.num++;
+    }
+
+    if (prefetch.num > 0) {
+        client *c = ctx->clients[db->id];
+        c->cmd = cmd;
+        c->keyrequests_count += prefetch.num;
+        ctx->inprogress_count += prefetch.num;
+        ctx->stat.cmd_count++;
+        ctx->stat.key_count += prefetch.num;
+        submitClientKeyRequests(c,&prefetch,swapPrefetchKeyRequestFinished,NULL);
+    }
+
+    releaseKeyRequests(&prefetch);
+    getKeyRequestsFreeResult(&prefetch);
+    releaseKeyRequests(&result);
+    getKeyRequestsFreeResult(&result);
+    return 0;
+}
+
+/* Called after swap submitted for current command of c, prefetch for at
+ * most swap-pipeline-lookahead commands pipelined after it. Commands that
+ * already prefetched (c->swap_prefetched_cmds) are skipped. */
+void swapPrefetchPipelinedCommands(client *c) {
+    swapPrefetchCtx *ctx = server.swap_prefetch_ctx;
+    size_t pos, len, parsed;
+    int ncmds = 0, argc, stop = 0;
+    robj **argv;
+
+    if (ctx == NULL || server.swap_pipeline_lookahead <= 0) return;
+    if (c->flags & (CLIENT_MASTER|CLIENT_SLAVE|CLIENT_MULTI)) return;
+    if (c->querybuf == NULL) return;
+    if (ctx->inprogress_count >= SWAP_PREFETCH_INPROGRESS_LIMIT) return;
+
+    pos = c->qb_pos;
+    len = sdslen(c->querybuf);
+    while (!stop && pos < len && ncmds < server.swap_pipeline_lookahead) {
+        parsed = swapPrefetchParseCommand(c->querybuf+pos,len-pos,&argv,&argc);
+        if (parsed == 0) break;
+        pos += parsed;
+        ncmds++;
+        if (ncmds > c->swap_prefetched_cmds)
+            stop = swapPrefetchCommand(ctx,c->db,argv,argc);
+        while (argc--) decrRefCount(argv[argc]);
+        zfree(argv);
+    }
+
+    if (ncmds > c->swap_prefetched_cmds) c->swap_prefetched_cmds = ncmds;
+}
+
+sds genSwapPrefetchInfoString(sds info) {
+    swapPrefetchCtx *ctx = server.swap_prefetch_ctx;
+    if (ctx == NULL) return info;
+    info = sdscatprintf(info,
+            "swap_pipeline_prefetch:lookahead=%d,cmds=%lld,keys=%lld,errors=%lld,inprogress=%lld\r\n",
+            server.swap_pipeline_lookahead,ctx->stat.cmd_count,
+            ctx->stat.key_count,ctx->stat.error_count,ctx->inprogress_count);
+    return info;
+}
+
+void resetSwapPrefetchStats(void) {
+    swapPrefetchCtx *ctx = server.swap_prefetch_ctx;
+    if (ctx == NULL) return;
+    memset(&ctx->stat,0,sizeof(ctx->stat));
+}
@@ -0,0 +1,124 @@
+/* Copyright (c) 2021, ctrip.com
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ctrip_swap.h"
+
+/* Pushdown: whitelisted read-only commands (SWAP_IN_PUSHDOWN) on a cold key
+ * compute reply from the object decoded by swap thread, which only lives
+ * during the call: it is linked into keyspace right before the command is
+ * called and unlinked right after, so keyspace (and cold/warm/hot state of
+ * the key) is left unchanged and the object never needs to be evicted.
+ *
+ * Key stays locked through the call, so no other client can observe the
+ * transient object. */
+
+swapPushdown *swapPushdownNew(redisDb *db, robj *key, MOVE robj *value,
+        long long expire) {
+    swapPushdown *pushdown = zmalloc(sizeof(swapPushdown));
+    incrRefCount(key);
+    pushdown->db = db;
+    pushdown->key = key;
+    pushdown->value = value;
+    pushdown->expire = expire;
+    pushdown->linked = 0;
+    return pushdown;
+}
+
+void swapPushdownFree(swapPushdown *pushdown) {
+    if (pushdown == NULL) return;
+    serverAssert(!pushdown->linked);
+    if (pushdown->value) decrRefCount(pushdown->value);
+    decrRefCount(pushdown->key);
+    zfree(pushdown);
+}
+
+/* Main-thread: decide whether the key request could be served by pushdown
+ * if key turns out to be cold. Only plain single key command (not in multi
+ * or script) is supported, so that the object is consumed by exactly the
+ * command that requested it. */
+int keyRequestPushdownAllowed(client *c, swapCtx *ctx) {
+    if (!server.swap_pushdown_enabled) return 0;
+    if (!(ctx->key_request->cmd_intention_flags & SWAP_IN_PUSHDOWN)) return 0;
+    if (ctx->finished != normalClientKeyRequestFinished) return 0;
+    if (c->flags & (CLIENT_MULTI|CLIENT_LUA)) return 0;
+    if (c->keyrequests_count != 1) return 0;
+    /* key read that often is worth swapping in: promote with probability
+     * 1/swap-pushdown-promote-hits (once per that many hits on average). */
+    if (server.swap_pushdown_promote_hits &&
+            rand() % server.swap_pushdown_promote_hits == 0) return 0;
+    return 1;
+}
+
+/* Swap-thread: meta of cold key decoded, pushdown if a plain swap in is
+ * going to be executed. */
+int swapRequestCanPushdown(swapRequest *req, int intention,
+        uint32_t intention_flags) {
+    if (!req->swap_ctx || !req->swap_ctx->pushdown_allowed) return 0;
+    if (intention != SWAP_IN || intention_flags != 0) return 0;
+    if (!swapDataAlreadySetup(req->data) || !swapDataIsCold(req->data))
+        return 0;
+    return 1;
+}
+
+/* Main-thread: swap in finished, move result to swap ctx instead of db. */
+void swapRequestPushdown(swapRequest *req) {
+    swapData *data = req->data;
+    swapCtx *ctx = req->swap_ctx;
+
+    serverAssert(ctx->pushdown == NULL);
+    ctx->pushdown = swapPushdownNew(data->db,data->key,req->result,
+            data->expire);
+    req->result = NULL;
+    atomicIncr(server.swap_hit_stats->stat_swapin_pushdown_count,1);
+}
+
+void swapPushdownBeforeCall(client *c) {
+    swapPushdown *pushdown = c->swap_pushdown;
+
+    if (pushdown == NULL || pushdown->value == NULL) return;
+    /* logically expired (slave), not visible as if swapped in. */
+    if (pushdown->expire != -1 && timestampIsExpired(pushdown->expire))
+        return;
+
+    serverAssert(dictAdd(pushdown->db->dict,sdsdup(pushdown->key->ptr),
+                pushdown->value) == DICT_OK);
+    pushdown->value = NULL; /* owned by dict */
+    pushdown->linked = 1;
+}
+
+void swapPushdownAfterCall(client *c) {
+    swapPushdown *pushdown = c->swap_pushdown;
+
+    if (pushdown == NULL) return;
+    if (pushdown->linked) {
+        serverAssert(dictDelete(pushdown->db->dict,pushdown->key->ptr) == DICT_OK);
+        pushdown->linked = 0;
+    }
+    swapPushdownFree(pushdown);
+    c->swap_pushdown = NULL;
+}
@@ -215,6 +215,7 @@ static int rdbKeySaveDataInitWarm(rdbKeySaveData *save, redisDb *db,
 
     switch (object_meta->swap_type) {
     case SWAP_TYPE_STRING:
+    case SWAP_TYPE_MODULE:
         wholeKeySaveInit(save);
         break;
     case SWAP_TYPE_HASH:
@@ -249,6 +250,7 @@ static int rdbKeySaveDataInitCold(rdbKeySaveData *save, redisDb *db,
 
     switch (dm->swap_type) {
     case SWAP_TYPE_STRING:
+    case SWAP_TYPE_MODULE:
         serverAssert(dm->extend == NULL);
         wholeKeySaveInit(save);
         break;
@@ -654,6 +656,7 @@ ctripRdbLoadCtx *ctripRdbLoadCtxNew() {
     ctx->batch.cfs = zmalloc(sizeof(int)*ctx->batch.count);
     ctx->batch.rawkeys = zmalloc(sizeof(sds)*ctx->batch.count);
     ctx->batch.rawvals = zmalloc(sizeof(sds)*ctx->batch.count);
+    ctx->ingest = NULL;
     return ctx;
 }
 
@@ -690,6 +693,11 @@ void ctripRdbLoadSendBatch(ctripRdbLoadCtx *ctx) {
 }
 
 void ctripRdbLoadCtxFeed(ctripRdbLoadCtx *ctx, int cf, MOVE sds rawkey, MOVE sds rawval) {
+    if (ctx->ingest) {
+        rdbLoadIngestFeed(ctx->ingest,cf,rawkey,rawval);
+        return;
+    }
+
     ctx->batch.cfs[ctx->batch.index] = cf;
     ctx->batch.rawkeys[ctx->batch.index] = rawkey;
     ctx->batch.rawvals[ctx->batch.index] = rawval;
@@ -714,6 +722,21 @@ void ctripRdbLoadCtxFree(ctripRdbLoadCtx *ctx) {
 
 void evictStartLoading() {
     server.rdb_load_ctx = ctripRdbLoadCtxNew();
+    if (server.swap_rdb_load_ingest_enabled)
+        server.rdb_load_ctx->ingest = rdbLoadIngestNew();
+}
+
+/* Called when rdb loaded ok: keys loaded are accounted as cold already, so
+ * load fails if ingest failed. */
+int evictFinishLoading() {
+    ctripRdbLoadCtx *ctx = server.rdb_load_ctx;
+    int ret;
+
+    if (ctx == NULL || ctx->ingest == NULL) return C_OK;
+    ret = rdbLoadIngestFinish(ctx->ingest);
+    rdbLoadIngestFree(ctx->ingest);
+    ctx->ingest = NULL;
+    return ret;
 }
 
 void evictStopLoading(int success) {
@@ -722,6 +745,8 @@ void evictStopLoading(int success) {
     ctripRdbLoadSendBatch(server.rdb_load_ctx);
     asyncCompleteQueueDrain(-1); /* CONFIRM */
     parallelSyncDrain();
+    /* ingest not finished if load failed. */
+    rdbLoadIngestFree(server.rdb_load_ctx->ingest);
     ctripRdbLoadCtxFree(server.rdb_load_ctx);
     server.rdb_load_ctx = NULL;
 }
@@ -948,6 +973,10 @@ int rdbKeyLoadDataInit(rdbKeyLoadData *load, int rdbtype,
     case RDB_TYPE_BITMAP:
         bitmapLoadInit(load);
         break;
+    case RDB_TYPE_MODULE:
+    case RDB_TYPE_MODULE_2:
+        moduleValueLoadInit(load);
+        break;
     default:
         retval = SWAP_ERR_RDB_LOAD_UNSUPPORTED;
         break;
@@ -981,6 +1010,13 @@ int ctripRdbLoadObject(int rdbtype, rio *rdb, redisDb *db, sds key,
     } while (!error && cont);
 
     if (!error) error = rdbKeyLoadEnd(load,rdb);
+
+    if (!error && load->nfeeds && load->expire != -1 &&
+            server.swap_expire_index_enabled) {
+        rawkey = rocksEncodeExpireIndexKey(load->db->id,load->expire,
+                load->key,sdslen(load->key));
+        ctripRdbLoadCtxFeed(server.rdb_load_ctx,EXPIRE_CF,rawkey,sdsempty());
+    }
     return error;
 }
 
@@ -75,11 +75,28 @@ void RIOInitIterate(RIO *rio, int cf, uint32_t flags, sds start, sds end, size_t
     rio->iterate.rawkeys = NULL;
     rio->iterate.rawvals = NULL;
     rio->iterate.nextseek = NULL;
+    rio->iterate.excludes = NULL;
+    rio->iterate.numexcludes = 0;
+    rio->iterate.match = NULL;
+    rio->iterate.count = 0;
     rio->err = NULL;
     rio->errcode = 0;
     rio->oom_check = 0;
 }
 
+void RIOIterateSetExcludes(RIO *rio, sds *excludes, int numexcludes) {
+    serverAssert(rio->action == ROCKS_ITERATE);
+    serverAssert(numexcludes == 0 || !(rio->iterate.flags & ROCKS_ITERATE_REVERSE));
+    rio->iterate.excludes = excludes;
+    rio->iterate.numexcludes = numexcludes;
+}
+
+void RIOIterateSetMatch(RIO *rio, sds match) {
+    serverAssert(rio->action == ROCKS_ITERATE);
+    serverAssert(match == NULL || rio->iterate.cf == META_CF);
+    rio->iterate.match = match;
+}
+
 void RIODeinit(RIO *rio) {
     int i;
 
@@ -127,69 +144,178 @@ void RIODeinit(RIO *rio) {
     }
 }
 
+/* Values fetched by RIOMultiGet: either malloc'ed by rocksdb (value copied
+ * out of block cache by rocksdb) or pinned (value references block cache or
+ * memtable directly until released), so that value could be materialized
+ * into sds with only one memcpy. */
+typedef struct RIOMultiGetValues {
+    int pinned;
+    size_t count;
+    const char **vals;
+    size_t *vlens;
+    void **owners;
+    char **errs;
+} RIOMultiGetValues;
+
+static void RIOMultiGetValuesInit(RIOMultiGetValues *v, size_t count) {
+    v->pinned = server.swap_rio_pinned_multiget;
+    v->count = count;
+    v->vals = zcalloc(count*sizeof(char*));
+    v->vlens = zcalloc(count*sizeof(size_t));
+    v->owners = zcalloc(count*sizeof(void*));
+    v->errs = zcalloc(count*sizeof(char*));
+}
+
+static inline void RIOMultiGetValuesRelease(RIOMultiGetValues *v, size_t i) {
+    if (v->owners[i] == NULL) return;
+    if (v->pinned) rocksdb_pinnableslice_destroy(v->owners[i]);
+    else zlibc_free(v->owners[i]);
+    v->owners[i] = NULL;
+    v->vals[i] = NULL;
+}
+
+static void RIOMultiGetValuesDeinit(RIOMultiGetValues *v) {
+    for (size_t i = 0; i < v->count; i++) {
+        RIOMultiGetValuesRelease(v,i);
+        if (v->errs[i]) zlibc_free(v->errs[i]);
+    }
+    zfree(v->vals);
+    zfree(v->vlens);
+    zfree(v->owners);
+    zfree(v->errs);
+}
+
+/* Copy value into sds and release rocksdb owned value, returns NULL if
+ * value not found. */
+static sds RIOMultiGetValuesMove(RIOMultiGetValues *v, size_t i) {
+    sds rawval;
+    size_t copied;
+    if (v->vals[i] == NULL) return NULL;
+    rawval = sdsnewlen(v->vals[i],v->vlens[i]);
+    /* non-pinned value already copied once by rocksdb. */
+    copied = v->pinned ? v->vlens[i] : v->vlens[i]*2;
+    atomicIncr(server.ror_stats->rio_get_value_count,1);
+    atomicIncr(server.ror_stats->rio_get_copied_bytes,copied);
+    RIOMultiGetValuesRelease(v,i);
+    return rawval;
+}
+
+static size_t RIOMultiGetValuesPayload(RIOMultiGetValues *v, size_t from, size_t to) {
+    size_t payload_size = 0;
+    for (size_t i = from; i < to; i++) payload_size += v->vlens[i];
+    return payload_size;
+}
+
+/* batched multiget accepts only one cf, keys are grouped by cf. */
+static void RIOMultiGetPinned(RIOMultiGetValues *v, int *cfs,
+        const char **keys_list, const size_t *keys_list_sizes) {
+    size_t count = v->count, *idx = zmalloc(count*sizeof(size_t));
+    const char **cf_keys_list = zmalloc(count*sizeof(char*));
+    size_t *cf_keys_list_sizes = zmalloc(count*sizeof(size_t));
+    rocksdb_pinnableslice_t **cf_values = zmalloc(count*sizeof(rocksdb_pinnableslice_t*));
+    char **cf_errs = zmalloc(count*sizeof(char*));
+
+    for (int cf = 0; cf < CF_COUNT; cf++) {
+        size_t n = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (cfs[i] != cf) continue;
+            idx[n] = i;
+            cf_keys_list[n] = keys_list[i];
+            cf_keys_list_sizes[n] = keys_list_sizes[i];
+            n++;
+        }
+        if (n == 0) continue;
+
+        rocksdb_batched_multi_get_cf(server.rocks->db,server.rocks->ropts,
+                swapGetCF(cf),n,cf_keys_list,cf_keys_list_sizes,
+                cf_values,cf_errs,0);
+
+        for (size_t j = 0; j < n; j++) {
+            size_t i = idx[j];
+            v->owners[i] = cf_values[j];
+            if (cf_values[j])
+                v->vals[i] = rocksdb_pinnableslice_value(cf_values[j],&v->vlens[i]);
+            v->errs[i] = cf_errs[j];
+        }
+    }
+
+    zfree(idx);
+    zfree(cf_keys_list);
+    zfree(cf_keys_list_sizes);
+    zfree(cf_values);
+    zfree(cf_errs);
+}
+
+static void RIOMultiGetCopied(RIOMultiGetValues *v, int *cfs,
+        const char **keys_list, const size_t *keys_list_sizes) {
+    size_t count = v->count;
+    char **values_list = zmalloc(count*sizeof(char*));
+    rocksdb_column_family_handle_t **cfs_list =
+        zmalloc(count*sizeof(rocksdb_column_family_handle_t*));
+
+    for (size_t i = 0; i < count; i++) cfs_list[i] = swapGetCF(cfs[i]);
+
+    rocksdb_multi_get_cf(server.rocks->db, server.rocks->ropts,
+            (const rocksdb_column_family_handle_t *const *)cfs_list,count,
+            keys_list,keys_list_sizes,values_list,v->vlens,v->errs);
+
+    for (size_t i = 0; i < count; i++) {
+        v->vals[i] = values_list[i];
+        v->owners[i] = values_list[i];
+    }
+
+    zfree(cfs_list);
+    zfree(values_list);
+}
+
+static void RIOMultiGet(RIOMultiGetValues *v, int *cfs,
+        const char **keys_list, const size_t *keys_list_sizes) {
+    if (v->count == 0) return;
+    if (v->pinned) RIOMultiGetPinned(v,cfs,keys_list,keys_list_sizes);
+    else RIOMultiGetCopied(v,cfs,keys_list,keys_list_sizes);
+}
+
 /* server.rocks can be used without lock here because they are exclusive:
  *   server.rocks changed with global lock
  *   RIO called with key lock */
 void RIODoGet(RIO *rio) {
     int i;
-    rocksdb_column_family_handle_t **cfs_list;
-    char **keys_list = zmalloc(rio->get.numkeys*sizeof(char*));
-    char **values_list = zmalloc(rio->get.numkeys*sizeof(char*));
+    RIOMultiGetValues _values, *values = &_values;
+    const char **keys_list = zmalloc(rio->get.numkeys*sizeof(char*));
     size_t *keys_list_sizes = zmalloc(rio->get.numkeys*sizeof(size_t));
-    size_t *values_list_sizes = zmalloc(rio->get.numkeys*sizeof(size_t));
-    char **errs = zmalloc(rio->get.numkeys*sizeof(char*));
-    cfs_list = zmalloc(rio->get.numkeys*sizeof(rocksdb_column_family_handle_t*));
 
     for (i = 0; i < rio->get.numkeys; i++) {
-        cfs_list[i] = swapGetCF(rio->get.cfs[i]);
         keys_list[i] = rio->get.rawkeys[i];
         keys_list_sizes[i] = sdslen(rio->get.rawkeys[i]);
     }
 
-    rocksdb_multi_get_cf(server.rocks->db, server.rocks->ropts,
-            (const rocksdb_column_family_handle_t *const *)cfs_list,
-            rio->get.numkeys,
-            (const char**)keys_list, (const size_t*)keys_list_sizes,
-            values_list, values_list_sizes, errs);
+    RIOMultiGetValuesInit(values,rio->get.numkeys);
+    RIOMultiGet(values,rio->get.cfs,keys_list,keys_list_sizes);
 
     if (rio->oom_check) {
-        size_t payload_size = 0;
-        for (i = 0; i < rio->get.numkeys; i++) payload_size += values_list_sizes[i];
+        size_t payload_size = RIOMultiGetValuesPayload(values,0,rio->get.numkeys);
         if (rioMayOOM(payload_size)) {
             RIOSetError(rio,SWAP_ERR_RIO_OOM,sdsnew("rio get oom"));
             serverLog(LL_WARNING,"[rocks] do rocksdb get failed: may OOM");
-            for (i = 0; i < rio->get.numkeys; i++) zlibc_free(values_list[i]);
             goto end;
         }
     }
 
     rio->get.rawvals = zmalloc(rio->get.numkeys*sizeof(sds));
     for (i = 0; i < rio->get.numkeys; i++) {
-        if (values_list[i] == NULL) {
-            rio->get.rawvals[i] = NULL;
-            rio->get.notfound++;
-        } else {
-            rio->get.rawvals[i] = sdsnewlen(values_list[i],
-                    values_list_sizes[i]);
-            zlibc_free(values_list[i]);
-        }
-        if (errs[i]) {
-            if (!RIOGetError(rio)) {
-                RIOSetError(rio,SWAP_ERR_RIO_GET_FAIL,sdsnew(errs[i]));
-                serverLog(LL_WARNING,"[rocks] do rocksdb get failed: %s",
-                        rio->err);
-            }
-            zlibc_free(errs[i]);
+        rio->get.rawvals[i] = RIOMultiGetValuesMove(values,i);
+        if (rio->get.rawvals[i] == NULL) rio->get.notfound++;
+        if (values->errs[i] && !RIOGetError(rio)) {
+            RIOSetError(rio,SWAP_ERR_RIO_GET_FAIL,sdsnew(values->errs[i]));
+            serverLog(LL_WARNING,"[rocks] do rocksdb get failed: %s",
+                    rio->err);
         }
     }
 
 end:
-    zfree(cfs_list);
+    RIOMultiGetValuesDeinit(values);
     zfree(keys_list);
-    zfree(values_list);
     zfree(keys_list_sizes);
-    zfree(values_list_sizes);
-    zfree(errs);
 }
 
 static void RIODoPut(RIO *rio) {
@@ -229,14 +355,81 @@ static void RIODoDel(RIO *rio) {
     rocksdb_writebatch_destroy(wb);
 }
 
+/* Pass bounds to rocksdb so that sst files and blocks out of range could be
+ * skipped. Bounds are conservative, exact bound check (exclude, prefix match)
+ * still done while iterating. Returns upper bound that must outlive iter. */
+static sds RIOIterateSetBounds(RIO *rio, rocksdb_readoptions_t *ropts) {
+    sds start = rio->iterate.start, end = rio->iterate.end, upper_bound = NULL;
+    int prefix_match = rio->iterate.flags & ROCKS_ITERATE_PREFIX_MATCH;
+    size_t start_prefix_len, end_prefix_len;
+
+    if (start) {
+        rocksdb_readoptions_set_iterate_lower_bound(ropts,start,sdslen(start));
+    }
+
+    if (end) {
+        if (prefix_match) {
+            upper_bound = rocksEncodePrefixSuccessor(end,sdslen(end));
+        } else {
+            upper_bound = sdscatlen(sdsdup(end),"\0",1);
+        }
+        if (upper_bound) {
+            rocksdb_readoptions_set_iterate_upper_bound(ropts,upper_bound,
+                    sdslen(upper_bound));
+        }
+    }
+
+    /* range inside one key version could use prefix bloom, otherwise
+     * iterator would cross prefixes and must seek in total order. */
+    if (server.rocksdb_data_prefix_extractor && rio->iterate.cf != META_CF &&
+            start && end &&
+            (start_prefix_len = rocksDataKeyPrefixLen(start,sdslen(start))) &&
+            (end_prefix_len = rocksDataKeyPrefixLen(end,sdslen(end))) &&
+            start_prefix_len == end_prefix_len &&
+            !memcmp(start,end,start_prefix_len)) {
+        rocksdb_readoptions_set_prefix_same_as_start(ropts,1);
+    } else {
+        rocksdb_readoptions_set_total_order_seek(ropts,1);
+    }
+
+    return upper_bound;
+}
+
+/* excludes are sorted, walked forward along with iterator. */
+static inline int RIOIterateExcluded(RIO *rio, int *idx, const char *rawkey,
+        size_t klen) {
+    while (*idx < rio->iterate.numexcludes) {
+        sds exclude = rio->iterate.excludes[*idx];
+        size_t elen = sdslen(exclude);
+        int cmp = memcmp(exclude,rawkey,MIN(elen,klen));
+        if (cmp == 0) cmp = elen == klen ? 0 : (elen < klen ? -1 : 1);
+        if (cmp > 0) return 0;
+        (*idx)++;
+        if (cmp == 0) return 1;
+    }
+    return 0;
+}
+
+static inline int RIOIterateUnmatched(RIO *rio, const char *rawkey,
+        size_t klen) {
+    const char *key;
+    size_t keylen;
+    sds match = rio->iterate.match;
+    if (match == NULL) return 0;
+    if (rocksDecodeMetaKey(rawkey,klen,NULL,&key,&keylen)) return 0;
+    return !stringmatchlen(match,sdslen(match),key,keylen,0);
+}
+
 static void RIODoIterate(RIO *rio) {
-    size_t numkeys = 0;
+    size_t numkeys = 0, count = 0;
+    int exclude_idx = 0, bound_reached = 0;
     char *err = NULL;
     rocksdb_iterator_t *iter = NULL;
     sds start = rio->iterate.start;
     sds end = rio->iterate.end;
     size_t limit = rio->iterate.limit;
     rocksdb_readoptions_t *ropts = NULL;
+    sds upper_bound = NULL;
 
     int reverse = rio->iterate.flags & ROCKS_ITERATE_REVERSE;
     int low_bound_exclude = rio->iterate.flags & ROCKS_ITERATE_LOW_BOUND_EXCLUDE;
@@ -244,6 +437,7 @@ static void RIODoIterate(RIO *rio) {
     int next_seek = rio->iterate.flags & ROCKS_ITERATE_CONTINUOUSLY_SEEK;
     int disable_cache = rio->iterate.flags & ROCKS_ITERATE_DISABLE_CACHE;
     int prefix_match = rio->iterate.flags & ROCKS_ITERATE_PREFIX_MATCH;
+    int count_only = rio->iterate.flags & ROCKS_ITERATE_COUNT_ONLY;
 
     size_t numalloc = ROCKS_ITERATE_NO_LIMIT == limit ? RIO_ITERATE_NUMKEYS_ALLOC_INIT : limit;
     numalloc = numalloc > RIO_ITERATE_NUMKEYS_ALLOC_LINER ? RIO_ITERATE_NUMKEYS_ALLOC_LINER : numalloc;
@@ -257,12 +451,11 @@ static void RIODoIterate(RIO *rio) {
 
     if (start == NULL && end == NULL) goto end;
 
-    if (disable_cache) {
-        ropts = rocksdb_readoptions_create();
-        rocksdb_readoptions_set_verify_checksums(ropts, 0);
-        rocksdb_readoptions_set_fill_cache(ropts, 0);
-    }
-    iter = rocksdb_create_iterator_cf(server.rocks->db,NULL!=ropts?ropts:server.rocks->ropts,swapGetCF(rio->iterate.cf));
+    ropts = rocksdb_readoptions_create();
+    rocksdb_readoptions_set_verify_checksums(ropts, 0);
+    rocksdb_readoptions_set_fill_cache(ropts, !disable_cache);
+    upper_bound = RIOIterateSetBounds(rio,ropts);
+    iter = rocksdb_create_iterator_cf(server.rocks->db,ropts,swapGetCF(rio->iterate.cf));
 
     if (reverse) rocksdb_iter_seek_for_prev(iter,end,end_len);
     else rocksdb_iter_seek(iter, start, start_len);
@@ -300,21 +493,37 @@ static void RIODoIterate(RIO *rio) {
     sds bound = reverse ? start : end;
     size_t bound_len = reverse ? start_len : end_len;
     int bound_exclude = reverse ? low_bound_exclude : high_bound_exclude;
-    while (rocksdb_iter_valid(iter) && (limit == ROCKS_ITERATE_NO_LIMIT || numkeys < limit)) {
-        if (rio->oom_check && numkeys % 512 == 0 && rioMayOOM(mem_allocated)) {
-            RIOSetError(rio,SWAP_ERR_RIO_OOM,sdsnew("rio iterate oom"));
-            serverLog(LL_WARNING,"[rocks] do rocksdb iterate failed: may OOM");
-            goto end;
-        }
-
+    while (rocksdb_iter_valid(iter)) {
         rawkey = rocksdb_iter_key(iter, &klen);
         if (bound) {
             int cmp_result = memcmp(rawkey, bound, MIN(bound_len, klen));
             if (0 == cmp_result) {
                 if (!prefix_match && bound_len != klen) cmp_result = klen > bound_len;
-                else if (bound_exclude) break;
+                else if (bound_exclude) {
+                    bound_reached = 1;
+                    break;
+                }
+            }
+            if ((reverse && cmp_result < 0) || (!reverse && cmp_result > 0)) {
+                bound_reached = 1;
+                break;
             }
-            if ((reverse && cmp_result < 0) || (!reverse && cmp_result > 0)) break;
+        }
+
+        if (RIOIterateExcluded(rio,&exclude_idx,rawkey,klen)) goto next;
+        if (RIOIterateUnmatched(rio,rawkey,klen)) goto next;
+        /* stop at the first key beyond limit, so that nextseek is set only
+         * if there are more keys in range. */
+        if (limit != ROCKS_ITERATE_NO_LIMIT && numkeys+count >= limit) break;
+        if (count_only) {
+            count++;
+            goto next;
+        }
+
+        if (rio->oom_check && numkeys % 512 == 0 && rioMayOOM(mem_allocated)) {
+            RIOSetError(rio,SWAP_ERR_RIO_OOM,sdsnew("rio iterate oom"));
+            serverLog(LL_WARNING,"[rocks] do rocksdb iterate failed: may OOM");
+            goto end;
         }
 
         rawval = rocksdb_iter_value(iter, &vlen);
@@ -334,6 +543,7 @@ static void RIODoIterate(RIO *rio) {
         mem_allocated += klen;
         mem_allocated += vlen;
 
+next:
         if (reverse) rocksdb_iter_prev(iter);
         else rocksdb_iter_next(iter);
     }
@@ -345,19 +555,21 @@ static void RIODoIterate(RIO *rio) {
         zlibc_free(err);
     }
 
-    /* save next seek */
-    if (next_seek && rocksdb_iter_valid(iter)) {
+    /* save next seek (only if stopped by limit). */
+    if (next_seek && !bound_reached && rocksdb_iter_valid(iter)) {
         rawkey = rocksdb_iter_key(iter, &klen);
         rio->iterate.nextseek = sdsnewlen(rawkey, klen);
     }
 
     end:
+    rio->iterate.count = count;
     rio->iterate.numkeys = numkeys;
     rio->iterate.rawkeys = rawkeys;
     rio->iterate.rawvals = rawvals;
 
     if (iter) rocksdb_iter_destroy(iter);
     if (ropts) rocksdb_readoptions_destroy(ropts);
+    if (upper_bound) sdsfree(upper_bound);
 }
 
 static sds RIODumpGeneric(RIO *rio, sds repr) {
@@ -565,26 +777,23 @@ RIO *RIOBatchAlloc(RIOBatch *rios) {
 void RIOBatchDoGet(RIOBatch *rios) {
     RIO *rio;
     size_t count = 0, x;
+    RIOMultiGetValues _values, *values = &_values;
 
     serverAssert(rios->action == ROCKS_GET);
     for (size_t i = 0; i < rios->count; i++) {
         count += rios->rios[i].get.numkeys;
     }
 
-    rocksdb_column_family_handle_t **cfs_list;
-    char **keys_list = zmalloc(count*sizeof(char*));
-    char **values_list = zmalloc(count*sizeof(char*));
+    int *cfs = zmalloc(count*sizeof(int));
+    const char **keys_list = zmalloc(count*sizeof(char*));
     size_t *keys_list_sizes = zmalloc(count*sizeof(size_t));
-    size_t *values_list_sizes = zmalloc(count*sizeof(size_t));
-    char **errs = zmalloc(count*sizeof(char*));
-    cfs_list = zmalloc(count*sizeof(rocksdb_column_family_handle_t*));
 
     x = 0;
     for (size_t i = 0; i < rios->count; i++) {
         rio = rios->rios+i;
         serverAssert(rio->action == rios->action);
         for (int j = 0; j < rio->get.numkeys; j++) {
-            cfs_list[x] = swapGetCF(rio->get.cfs[j]);
+            cfs[x] = rio->get.cfs[j];
             keys_list[x] = rio->get.rawkeys[j];
             keys_list_sizes[x] = sdslen(rio->get.rawkeys[j]);
             x++;
@@ -592,56 +801,42 @@ void RIOBatchDoGet(RIOBatch *rios) {
     }
     serverAssert(x == count);
 
-    rocksdb_multi_get_cf(server.rocks->db, server.rocks->ropts,
-            (const rocksdb_column_family_handle_t *const *)cfs_list,count,
-            (const char**)keys_list, (const size_t*)keys_list_sizes,
-            values_list, values_list_sizes, errs);
+    RIOMultiGetValuesInit(values,count);
+    RIOMultiGet(values,cfs,keys_list,keys_list_sizes);
 
     x = 0;
     for (size_t i = 0; i < rios->count; i++) {
         rio = rios->rios+i;
 
         if (rio->oom_check) {
-            size_t payload_size = 0, tmpx = x;
-            for (int j = 0; j < rio->get.numkeys; j++)
-                payload_size += values_list_sizes[tmpx++];
+            size_t payload_size = RIOMultiGetValuesPayload(values,x,
+                    x+rio->get.numkeys);
             if (rioMayOOM(payload_size)) {
                 RIOSetError(rio,SWAP_ERR_RIO_OOM,sdsnew("rio batch get oom"));
                 serverLog(LL_WARNING,"[rocks] do rocksdb batch get failed: may OOM");
-                for (int j = 0; j < rio->get.numkeys; j++) zlibc_free(values_list[x++]);
+                x += rio->get.numkeys;
                 continue;
             }
         }
 
         rio->get.rawvals = zmalloc(rio->get.numkeys*sizeof(sds));
         for (int j = 0; j < rio->get.numkeys; j++) {
-            if (values_list[x] == NULL) {
-                rio->get.rawvals[j] = NULL;
-                rio->get.notfound++;
-            } else {
-                rio->get.rawvals[j] = sdsnewlen(values_list[x],
-                        values_list_sizes[x]);
-                zlibc_free(values_list[x]);
-            }
-            if (errs[x]) {
-                if (!RIOGetError(rio)) {
-                    RIOSetError(rio,SWAP_ERR_RIO_GET_FAIL,sdsnew(errs[x]));
-                    serverLog(LL_WARNING,"[rocks] do batch rocksdb get failed: %s",
-                            rio->err);
-                }
-                zlibc_free(errs[x]);
+            rio->get.rawvals[j] = RIOMultiGetValuesMove(values,x);
+            if (rio->get.rawvals[j] == NULL) rio->get.notfound++;
+            if (values->errs[x] && !RIOGetError(rio)) {
+                RIOSetError(rio,SWAP_ERR_RIO_GET_FAIL,sdsnew(values->errs[x]));
+                serverLog(LL_WARNING,"[rocks] do batch rocksdb get failed: %s",
+                        rio->err);
             }
             x++;
         }
     }
     serverAssert(x == count);
 
-    zfree(cfs_list);
+    RIOMultiGetValuesDeinit(values);
+    zfree(cfs);
     zfree(keys_list);
-    zfree(values_list);
     zfree(keys_list_sizes);
-    zfree(values_list_sizes);
-    zfree(errs);
 }
 
 static void RIOBatchSetError(RIOBatch *rios, int errcode, const char *err) {
@@ -1016,6 +1211,71 @@ int swapRIOTest(int argc, char *argv[], int accurate) {
         sdsfree(hello), sdsfree(world);
     }
 
+    TEST("RIO: pinned and copied multiget across cfs") {
+        RIO _rio;
+        RIOBatch _rios, *rios = &_rios;
+        RIO *rio;
+        sds foo = sdsnew("foo"), bar = sdsnew("bar"), miss = sdsnew("miss"),
+            hello = sdsnew("hello"), world = sdsnew("world");
+        sds *rawkeys, *rawvals;
+        int *cfs, pinned_saved = server.swap_rio_pinned_multiget;
+        size_t copied_pinned, copied_unpinned;
+
+        RIOBatchInit(rios,ROCKS_PUT);
+        rio = RIOBatchAlloc(rios);
+        cfs = genIntArray(2,DATA_CF,META_CF);
+        rawkeys = genSdsArray(2,foo,hello);
+        rawvals = genSdsArray(2,bar,world);
+        RIOInitPut(rio,2,cfs,rawkeys,rawvals);
+        RIOBatchDo(rios);
+        RIOBatchDeinit(rios);
+
+        for (int pinned = 0; pinned <= 1; pinned++) {
+            server.swap_rio_pinned_multiget = pinned;
+            atomicSet(server.ror_stats->rio_get_value_count,0);
+            atomicSet(server.ror_stats->rio_get_copied_bytes,0);
+
+            RIOBatchInit(rios,ROCKS_GET);
+            rio = RIOBatchAlloc(rios);
+            cfs = genIntArray(3,META_CF,DATA_CF,DATA_CF);
+            rawkeys = genSdsArray(3,hello,miss,foo);
+            RIOInitGet(rio,3,cfs,rawkeys);
+            rio = RIOBatchAlloc(rios);
+            cfs = genIntArray(1,DATA_CF);
+            rawkeys = genSdsArray(1,foo);
+            RIOInitGet(rio,1,cfs,rawkeys);
+            RIOBatchDo(rios);
+            rio = rios->rios;
+            test_assert(!RIOGetError(rio));
+            test_assert(sdscmp(rio->get.rawvals[0],world) == 0);
+            test_assert(rio->get.rawvals[1] == NULL);
+            test_assert(sdscmp(rio->get.rawvals[2],bar) == 0);
+            test_assert(rio->get.notfound == 1);
+            rio = rios->rios+1;
+            test_assert(sdscmp(rio->get.rawvals[0],bar) == 0);
+            RIOBatchDeinit(rios);
+
+            cfs = genIntArray(1,DATA_CF);
+            rawkeys = genSdsArray(1,foo);
+            RIOInitGet(&_rio,1,cfs,rawkeys);
+            RIODo(&_rio);
+            test_assert(sdscmp(_rio.get.rawvals[0],bar) == 0);
+            RIODeinit(&_rio);
+
+            test_assert(server.ror_stats->rio_get_value_count == 4);
+            if (pinned) copied_pinned = server.ror_stats->rio_get_copied_bytes;
+            else copied_unpinned = server.ror_stats->rio_get_copied_bytes;
+        }
+        /* unpinned copy made inside rocksdb can't be observed here, only
+         * pinned (single memcpy into sds) accounting is checked. */
+        test_assert(copied_pinned == sdslen(world)+sdslen(bar)*3);
+        UNUSED(copied_unpinned);
+
+        server.swap_rio_pinned_multiget = pinned_saved;
+        sdsfree(foo), sdsfree(bar), sdsfree(miss);
+        sdsfree(hello), sdsfree(world);
+    }
+
     return error;
 }
 #endif
@@ -40,7 +40,7 @@
 #define KB 1024
 #define MB (1024*1024)
 
-const char *swap_cf_names[CF_COUNT] = {data_cf_name, meta_cf_name, score_cf_name};
+const char *swap_cf_names[CF_COUNT] = {data_cf_name, meta_cf_name, score_cf_name, expire_cf_name};
 
 int rmdirRecursive(const char *path);
 
@@ -61,6 +61,39 @@ static inline void rocks_init_option_compression(rocksdb_options_t *opts, int co
     }
 }
 
+/* Subkeys of the same key version share (dbid,keylen,key,version) prefix,
+ * with prefix bloom range swap-in of big keys touches only the sst files
+ * and blocks that may contain that key. */
+static char *rocksDataKeyPrefixTransform(void *state, const char *key,
+        size_t length, size_t *dst_length) {
+    UNUSED(state);
+    *dst_length = rocksDataKeyPrefixLen(key,length);
+    return (char*)key;
+}
+
+static unsigned char rocksDataKeyPrefixInDomain(void *state, const char *key,
+        size_t length) {
+    UNUSED(state);
+    return rocksDataKeyPrefixLen(key,length) > 0;
+}
+
+static unsigned char rocksDataKeyPrefixInRange(void *state, const char *key,
+        size_t length) {
+    UNUSED(state), UNUSED(key), UNUSED(length);
+    return 0;
+}
+
+static const char *rocksDataKeyPrefixName(void *state) {
+    UNUSED(state);
+    return "swap.DataKeyPrefix";
+}
+
+static rocksdb_slicetransform_t *rocksCreateDataKeyPrefixExtractor(void) {
+    return rocksdb_slicetransform_create(NULL,NULL,
+            rocksDataKeyPrefixTransform,rocksDataKeyPrefixInDomain,
+            rocksDataKeyPrefixInRange,rocksDataKeyPrefixName);
+}
+
 rocks *serverRocksGetReadLock() {
     pthread_rwlock_rdlock(server.rocks->rwlock);
     serverAssert(server.rocks && server.rocks->db);
@@ -85,8 +118,39 @@ void serverRocksUnlock(rocks *rocks) {
     pthread_rwlock_unlock(rocks->rwlock);
 }
 
+static rocksdb_cache_t *rocksCreateBlockCache(size_t capacity, size_t block_size) {
+    if (server.rocksdb_block_cache_type == ROCKSDB_BLOCK_CACHE_TYPE_HYPER_CLOCK)
+        return rocksdb_cache_create_hyper_clock(capacity, block_size);
+    else
+        return rocksdb_cache_create_lru(capacity);
+}
+
+/* Block cache of cf: shared cache if enabled, otherwise a dedicated one. */
+static rocksdb_cache_t *rocksGetCfBlockCache(rocks *rocks, int cf,
+        size_t capacity, size_t block_size) {
+    if (rocks->shared_block_cache) return rocks->shared_block_cache;
+    rocks->block_caches[cf] = rocksCreateBlockCache(capacity, block_size);
+    return rocks->block_caches[cf];
+}
+
+static size_t rocksBlockCacheUsage(rocks *rocks, int pinned) {
+    size_t usage = 0;
+    rocksdb_cache_t *cache;
+
+    if (rocks->shared_block_cache) {
+        cache = rocks->shared_block_cache;
+        return pinned ? rocksdb_cache_get_pinned_usage(cache) : rocksdb_cache_get_usage(cache);
+    }
+
+    for (int i = 0; i < CF_COUNT; i++) {
+        if ((cache = rocks->block_caches[i]) == NULL) continue;
+        usage += pinned ? rocksdb_cache_get_pinned_usage(cache) : rocksdb_cache_get_usage(cache);
+    }
+    return usage;
+}
+
 static int rocksOpen(rocks *rocks) {
-    char *errs[3] = {NULL}, dir[ROCKS_DIR_MAX_LEN], *err = NULL, longlong_str[20];
+    char *errs[CF_COUNT] = {NULL}, dir[ROCKS_DIR_MAX_LEN], *err = NULL, longlong_str[20];
     rocksdb_block_based_table_options_t *block_opts = NULL;
 
     serverAssert(rocks->db_opts == NULL);
@@ -100,6 +164,25 @@ static int rocksOpen(rocks *rocks) {
     rocksdb_options_set_max_bytes_for_level_base(rocks->db_opts, 256*MB);
     rocksdb_options_compaction_readahead_size(rocks->db_opts, 2*1024*1024); /* default 0 */
 
+    /* one cache shared by all cfs so that block cache usage is bounded by
+     * a single budget, memtables are charged to it too if write buffer
+     * manager enabled. */
+    if (server.rocksdb_shared_block_cache) {
+        rocks->shared_block_cache = rocksCreateBlockCache(
+                server.rocksdb_data_block_cache_size+server.rocksdb_meta_block_cache_size,
+                server.rocksdb_data_block_size);
+    }
+    if (server.rocksdb_write_buffer_manager_size) {
+        if (rocks->shared_block_cache) {
+            rocks->write_buffer_manager = rocksdb_write_buffer_manager_create_with_cache(
+                    server.rocksdb_write_buffer_manager_size,rocks->shared_block_cache,0);
+        } else {
+            rocks->write_buffer_manager = rocksdb_write_buffer_manager_create(
+                    server.rocksdb_write_buffer_manager_size,0);
+        }
+        rocksdb_options_set_write_buffer_manager(rocks->db_opts,rocks->write_buffer_manager);
+    }
+
     rocksdb_options_set_max_background_jobs(rocks->db_opts, server.rocksdb_max_background_jobs); /* default 4 */
     rocksdb_options_set_max_background_compactions(rocks->db_opts, server.rocksdb_max_background_compactions); /* default 4 */
     rocksdb_options_set_max_background_flushes(rocks->db_opts, server.rocksdb_max_background_flushes); /* default -1 */
@@ -114,6 +197,8 @@ static int rocksOpen(rocks *rocks) {
     rocks->ropts = rocksdb_readoptions_create();
     rocksdb_readoptions_set_verify_checksums(rocks->ropts, 0);
     rocksdb_readoptions_set_fill_cache(rocks->ropts, 1);
+    /* ropts also used by full scan iterators which cross key prefixes. */
+    rocksdb_readoptions_set_total_order_seek(rocks->ropts, 1);
 
     rocks->wopts = rocksdb_writeoptions_create();
     if (server.swap_persist_enabled) {
@@ -164,13 +249,15 @@ static int rocksOpen(rocks *rocks) {
     rocksdb_block_based_options_set_block_size(block_opts, server.rocksdb_data_block_size);
     rocksdb_block_based_options_set_cache_index_and_filter_blocks(block_opts, server.rocksdb_data_cache_index_and_filter_blocks);
     rocksdb_block_based_options_set_filter_policy(block_opts, rocksdb_filterpolicy_create_bloom(10));
-    rocksdb_cache_t *data_cache = rocksdb_cache_create_lru(server.rocksdb_data_block_cache_size);
-    rocksdb_block_based_options_set_block_cache(block_opts, data_cache);
-    rocksdb_cache_destroy(data_cache);
+    rocksdb_block_based_options_set_block_cache(block_opts,
+            rocksGetCfBlockCache(rocks,DATA_CF,server.rocksdb_data_block_cache_size,server.rocksdb_data_block_size));
     rocksdb_options_set_block_based_table_factory(rocks->cf_opts[DATA_CF], block_opts);
     rocksdb_block_based_options_destroy(block_opts);
 
     rocksdb_options_set_compaction_filter_factory(rocks->cf_opts[DATA_CF], createDataCfCompactionFilterFactory());
+    if (server.rocksdb_data_prefix_extractor) {
+        rocksdb_options_set_prefix_extractor(rocks->cf_opts[DATA_CF], rocksCreateDataKeyPrefixExtractor());
+    }
 
     /* score cf */
     rocks->cf_opts[SCORE_CF] = rocksdb_options_create_copy(rocks->db_opts);
@@ -201,13 +288,15 @@ static int rocksOpen(rocks *rocks) {
     rocksdb_block_based_options_set_block_size(block_opts, server.rocksdb_data_block_size);
     rocksdb_block_based_options_set_cache_index_and_filter_blocks(block_opts, server.rocksdb_data_cache_index_and_filter_blocks);
     rocksdb_block_based_options_set_filter_policy(block_opts, rocksdb_filterpolicy_create_bloom(10));
-    rocksdb_cache_t *score_cache = rocksdb_cache_create_lru(server.rocksdb_data_block_cache_size);
-    rocksdb_block_based_options_set_block_cache(block_opts, score_cache);
-    rocksdb_cache_destroy(score_cache);
+    rocksdb_block_based_options_set_block_cache(block_opts,
+            rocksGetCfBlockCache(rocks,SCORE_CF,server.rocksdb_data_block_cache_size,server.rocksdb_data_block_size));
     rocksdb_options_set_block_based_table_factory(rocks->cf_opts[SCORE_CF], block_opts);
     rocksdb_block_based_options_destroy(block_opts);
 
     rocksdb_options_set_compaction_filter_factory(rocks->cf_opts[SCORE_CF], createScoreCfCompactionFilterFactory());
+    if (server.rocksdb_data_prefix_extractor) {
+        rocksdb_options_set_prefix_extractor(rocks->cf_opts[SCORE_CF], rocksCreateDataKeyPrefixExtractor());
+    }
 
     /* meta cf */
     rocks->cf_opts[META_CF] = rocksdb_options_create_copy(rocks->db_opts);
@@ -238,20 +327,34 @@ static int rocksOpen(rocks *rocks) {
     rocksdb_block_based_options_set_block_size(block_opts, server.rocksdb_meta_block_size);
     rocksdb_block_based_options_set_cache_index_and_filter_blocks(block_opts, server.rocksdb_meta_cache_index_and_filter_blocks);
     rocksdb_block_based_options_set_filter_policy(block_opts, rocksdb_filterpolicy_create_bloom(10));
-    rocksdb_cache_t *meta_cache = rocksdb_cache_create_lru(server.rocksdb_meta_block_cache_size);
-    rocksdb_block_based_options_set_block_cache(block_opts, meta_cache);
-    rocksdb_cache_destroy(meta_cache);
+    rocksdb_block_based_options_set_block_cache(block_opts,
+            rocksGetCfBlockCache(rocks,META_CF,server.rocksdb_meta_block_cache_size,server.rocksdb_meta_block_size));
     rocksdb_options_set_block_based_table_factory(rocks->cf_opts[META_CF], block_opts);
     rocksdb_block_based_options_destroy(block_opts);
 
     rocksdb_options_set_compaction_filter_factory(rocks->cf_opts[META_CF], NULL);
 
+    /* expire cf: small (dbid,expire,key) index keys only range scanned by
+     * active expire, block cache shared with meta cf. */
+    rocks->cf_opts[EXPIRE_CF] = rocksdb_options_create_copy(rocks->db_opts);
+    rocks_init_option_compression(rocks->cf_opts[EXPIRE_CF],server.rocksdb_meta_compression);
+    rocksdb_options_set_write_buffer_size(rocks->cf_opts[EXPIRE_CF],server.rocksdb_meta_write_buffer_size);
+    rocksdb_options_set_target_file_size_base(rocks->cf_opts[EXPIRE_CF], server.rocksdb_meta_target_file_size_base);
+    rocksdb_options_set_max_bytes_for_level_base(rocks->cf_opts[EXPIRE_CF],server.rocksdb_meta_max_bytes_for_level_base);
+
+    block_opts = rocksdb_block_based_options_create();
+    rocksdb_block_based_options_set_block_size(block_opts, server.rocksdb_meta_block_size);
+    rocksdb_block_based_options_set_block_cache(block_opts, rocks->shared_block_cache ?
+            rocks->shared_block_cache : rocks->block_caches[META_CF]);
+    rocksdb_options_set_block_based_table_factory(rocks->cf_opts[EXPIRE_CF], block_opts);
+    rocksdb_block_based_options_destroy(block_opts);
+
     snprintf(dir, ROCKS_DIR_MAX_LEN, "%s/%d", ROCKS_DATA, rocks->rocksdb_epoch);
     rocks->db = rocksdb_open_column_families(rocks->db_opts, dir, CF_COUNT,
             swap_cf_names, (const rocksdb_options_t *const *)rocks->cf_opts,
             rocks->cf_handles, errs);
-    if (errs[0] != NULL || errs[1] != NULL || errs[2] != NULL) {
-        serverLog(LL_WARNING, "[ROCKS] rocksdb open failed: default_cf=%s, meta_cf=%s, score_cf=%s", errs[0], errs[1], errs[2]);
+    if (errs[0] != NULL || errs[1] != NULL || errs[2] != NULL || errs[3] != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] rocksdb open failed: default_cf=%s, meta_cf=%s, score_cf=%s, expire_cf=%s", errs[0], errs[1], errs[2], errs[3]);
         return -1;
     }
     serverLog(LL_NOTICE, "[ROCKS] opened rocks data in (%s).", dir);
@@ -285,6 +388,188 @@ static int rocksOpen(rocks *rocks) {
     return 0;
 }
 
+/* Key encoding of data dir recorded in ROCKS_DATA/ROCKS_KEY_ENCODING_FILE,
+ * data dir created before key encoding introduced is v1. */
+static int rocksReadKeyEncoding(void) {
+    char path[ROCKS_DIR_MAX_LEN], buf[16] = {0};
+    int encoding = SWAP_KEY_ENCODING_V1;
+    FILE *fp;
+
+    snprintf(path, ROCKS_DIR_MAX_LEN, "%s/%s", ROCKS_DATA, ROCKS_KEY_ENCODING_FILE);
+    if ((fp = fopen(path,"r")) == NULL) return 0;
+    if (fgets(buf,sizeof(buf),fp) != NULL) encoding = atoi(buf);
+    fclose(fp);
+    if (encoding < SWAP_KEY_ENCODING_V1 || encoding > SWAP_KEY_ENCODING_V3) {
+        serverLog(LL_WARNING, "[ROCKS] invalid key encoding(%s) in %s.",
+                buf, path);
+        return -1;
+    }
+    return encoding;
+}
+
+static int rocksWriteKeyEncoding(int encoding) {
+    char path[ROCKS_DIR_MAX_LEN];
+    FILE *fp;
+
+    snprintf(path, ROCKS_DIR_MAX_LEN, "%s/%s", ROCKS_DATA, ROCKS_KEY_ENCODING_FILE);
+    if ((fp = fopen(path,"w")) == NULL || fprintf(fp,"%d\n",encoding) < 0 ||
+            fflush(fp) || fsync(fileno(fp))) {
+        serverLog(LL_WARNING, "[ROCKS] write key encoding to %s failed: %s",
+                path, strerror(errno));
+        if (fp) fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return 0;
+}
+
+#define ROCKS_CONVERT_BATCH_SIZE 4096
+
+/* Offline rewrite every key of src_dir into dst_dir with key encoding
+ * converted from => to, values copied as is. Keys not recognized as
+ * swap keys are copied verbatim. */
+static int rocksConvertKeyEncodingDir(const char *src_dir, const char *dst_dir,
+        int from, int to) {
+    rocksdb_options_t *opts = rocksdb_options_create(), *cf_opts[CF_COUNT];
+    rocksdb_column_family_handle_t *src_cfs[CF_COUNT] = {NULL}, *dst_cfs[CF_COUNT] = {NULL};
+    rocksdb_readoptions_t *ropts = rocksdb_readoptions_create();
+    rocksdb_writeoptions_t *wopts = rocksdb_writeoptions_create();
+    rocksdb_flushoptions_t *fopts = rocksdb_flushoptions_create();
+    char *src_errs[CF_COUNT] = {NULL}, *dst_errs[CF_COUNT] = {NULL}, *err = NULL;
+    rocksdb_t *src = NULL, *dst = NULL;
+    long long converted = 0, verbatim = 0;
+    mstime_t start_time = mstime();
+    int i, ret = -1;
+
+    rocksdb_options_set_create_if_missing(opts, 1);
+    rocksdb_options_set_create_missing_column_families(opts, 1);
+    for (i = 0; i < CF_COUNT; i++) cf_opts[i] = opts;
+    rocksdb_readoptions_set_fill_cache(ropts, 0);
+    rocksdb_readoptions_set_total_order_seek(ropts, 1);
+    rocksdb_writeoptions_disable_WAL(wopts, 1);
+    rocksdb_flushoptions_set_wait(fopts, 1);
+
+    src = rocksdb_open_column_families(opts, src_dir, CF_COUNT, swap_cf_names,
+            (const rocksdb_options_t *const *)cf_opts, src_cfs, src_errs);
+    dst = rocksdb_open_column_families(opts, dst_dir, CF_COUNT, swap_cf_names,
+            (const rocksdb_options_t *const *)cf_opts, dst_cfs, dst_errs);
+    for (i = 0; i < CF_COUNT; i++) {
+        if (src_errs[i] || dst_errs[i]) {
+            serverLog(LL_WARNING, "[ROCKS] open %s cf for key encoding convert failed: src=%s, dst=%s",
+                    swap_cf_names[i], src_errs[i], dst_errs[i]);
+            goto end;
+        }
+    }
+
+    for (i = 0; i < CF_COUNT && err == NULL; i++) {
+        /* dbid of expire index keys follows key encoding, index is dropped
+         * and rebuilt by load fix instead. */
+        if (i == EXPIRE_CF) continue;
+        rocksdb_iterator_t *iter = rocksdb_create_iterator_cf(src, ropts, src_cfs[i]);
+        rocksdb_writebatch_t *wb = rocksdb_writebatch_create();
+
+        for (rocksdb_iter_seek_to_first(iter); rocksdb_iter_valid(iter) && err == NULL;
+                rocksdb_iter_next(iter)) {
+            size_t klen, vlen;
+            const char *rawkey = rocksdb_iter_key(iter, &klen);
+            const char *rawval = rocksdb_iter_value(iter, &vlen);
+            sds newkey = rocksConvertKeyEncoding(rawkey, klen, from, to);
+
+            if (newkey) {
+                rocksdb_writebatch_put_cf(wb, dst_cfs[i], newkey, sdslen(newkey), rawval, vlen);
+                sdsfree(newkey);
+                converted++;
+            } else {
+                rocksdb_writebatch_put_cf(wb, dst_cfs[i], rawkey, klen, rawval, vlen);
+                verbatim++;
+            }
+            if (rocksdb_writebatch_count(wb) >= ROCKS_CONVERT_BATCH_SIZE) {
+                rocksdb_write(dst, wopts, wb, &err);
+                rocksdb_writebatch_clear(wb);
+            }
+        }
+        if (err == NULL) rocksdb_iter_get_error(iter, &err);
+        if (err == NULL) rocksdb_write(dst, wopts, wb, &err);
+        if (err == NULL) rocksdb_flush_cf(dst, fopts, dst_cfs[i], &err);
+        rocksdb_writebatch_destroy(wb);
+        rocksdb_iter_destroy(iter);
+    }
+
+    if (err != NULL) {
+        serverLog(LL_WARNING, "[ROCKS] convert key encoding failed: %s", err);
+        zlibc_free(err);
+        goto end;
+    }
+    serverLog(LL_NOTICE, "[ROCKS] converted key encoding v%d => v%d: converted=%lld, verbatim=%lld, took %lld ms.",
+            from, to, converted, verbatim, mstime()-start_time);
+    ret = 0;
+
+end:
+    for (i = 0; i < CF_COUNT; i++) {
+        if (src_cfs[i]) rocksdb_column_family_handle_destroy(src_cfs[i]);
+        if (dst_cfs[i]) rocksdb_column_family_handle_destroy(dst_cfs[i]);
+        if (src_errs[i]) zlibc_free(src_errs[i]);
+        if (dst_errs[i]) zlibc_free(dst_errs[i]);
+    }
+    if (src) rocksdb_close(src);
+    if (dst) rocksdb_close(dst);
+    rocksdb_flushoptions_destroy(fopts);
+    rocksdb_writeoptions_destroy(wopts);
+    rocksdb_readoptions_destroy(ropts);
+    rocksdb_options_destroy(opts);
+    return ret;
+}
+
+/* Decide key encoding of data dir, existing data encoded differently from
+ * swap-key-encoding-version is converted before rocksdb opened. */
+static int rocksInitKeyEncoding(rocks *rocks) {
+    char dir[ROCKS_DIR_MAX_LEN], convert_dir[ROCKS_DIR_MAX_LEN], old_dir[ROCKS_DIR_MAX_LEN];
+    int encoding = rocksReadKeyEncoding(), target = server.swap_key_encoding_version;
+    struct stat statbuf;
+
+    if (encoding < 0) return -1;
+    snprintf(dir, ROCKS_DIR_MAX_LEN, "%s/%d", ROCKS_DATA, rocks->rocksdb_epoch);
+    if (encoding == 0) {
+        /* no marker: legacy data dir is v1, fresh one uses configured */
+        encoding = stat(dir, &statbuf) ? target : SWAP_KEY_ENCODING_V1;
+    }
+
+    snprintf(convert_dir, ROCKS_DIR_MAX_LEN, "%s.convert", dir);
+    snprintf(old_dir, ROCKS_DIR_MAX_LEN, "%s.old", dir);
+    if (!stat(old_dir, &statbuf)) {
+        /* crashed after data dir replaced, marker may be stale. */
+        serverLog(LL_WARNING, "[ROCKS] found (%s) left by interrupted key encoding convert, "
+                "remove it after checking %s.", old_dir, ROCKS_KEY_ENCODING_FILE);
+        return -1;
+    }
+
+    if (encoding != target) {
+        serverLog(LL_NOTICE, "[ROCKS] converting key encoding of (%s) from v%d to v%d.",
+                dir, encoding, target);
+        rmdirRecursive(convert_dir);
+        if (rocksConvertKeyEncodingDir(dir, convert_dir, encoding, target)) {
+            rmdirRecursive(convert_dir);
+            return -1;
+        }
+        if (rename(dir, old_dir) || rename(convert_dir, dir)) {
+            serverLog(LL_WARNING, "[ROCKS] replace (%s) with converted dir failed: %s",
+                    dir, strerror(errno));
+            return -1;
+        }
+        encoding = target;
+        if (rocksWriteKeyEncoding(encoding)) return -1;
+        if (rmdirRecursive(old_dir)) {
+            serverLog(LL_WARNING, "[ROCKS] purge (%s) failed: %s", old_dir, strerror(errno));
+        }
+    } else if (rocksWriteKeyEncoding(encoding)) {
+        return -1;
+    }
+
+    server.swap_key_encoding = encoding;
+    serverLog(LL_NOTICE, "[ROCKS] key encoding v%d.", encoding);
+    return 0;
+}
+
 int serverRocksInit() {
     if (server.swap_debug_init_rocksdb_delay_micro)
         usleep(server.swap_debug_init_rocksdb_delay_micro);
@@ -305,6 +590,8 @@ int serverRocksInit() {
             return -1;
         }
     }
+    rdbLoadIngestCleanupStale();
+    if (rocksInitKeyEncoding(rocks)) return -1;
     pthread_rwlock_init(rocks->rwlock,NULL);
     server.rocks = rocks;
     return rocksOpen(server.rocks);
@@ -342,6 +629,18 @@ static void rocksClose(rocks *rocks) {
     rocks->filter_meta_ropts = NULL;
     rocksdb_close(rocks->db);
     rocks->db = NULL;
+    for (i = 0; i < CF_COUNT; i++) {
+        if (rocks->block_caches[i]) rocksdb_cache_destroy(rocks->block_caches[i]);
+        rocks->block_caches[i] = NULL;
+    }
+    if (rocks->shared_block_cache) {
+        rocksdb_cache_destroy(rocks->shared_block_cache);
+        rocks->shared_block_cache = NULL;
+    }
+    if (rocks->write_buffer_manager) {
+        rocksdb_write_buffer_manager_destroy(rocks->write_buffer_manager);
+        rocks->write_buffer_manager = NULL;
+    }
 }
 
 int rocksRestore(rocks *rocks, const char *checkpoint_dir) {
@@ -564,6 +863,9 @@ int rocksGetCfByName(rocks *rocks, const char *cfnames,
         } else if (!strcasecmp(ptr,score_cf_name)) {
             handles[i] = rocks->cf_handles[SCORE_CF];
             if (names) names[i] = score_cf_name;
+        } else if (!strcasecmp(ptr,expire_cf_name)) {
+            handles[i] = rocks->cf_handles[EXPIRE_CF];
+            if (names) names[i] = expire_cf_name;
         } else {
             ret = -1;
             goto end;
@@ -636,17 +938,17 @@ struct rocksdbMemOverhead *rocksGetMemoryOverhead(rocks *rocks) {
 
     if (!rocksPropertyInt(rocks, NULL, "rocksdb.cur-size-all-mem-tables", &mem)) {
         mh->memtable = mem;
-        total += mem;
+        /* memtables already charged to shared block cache. */
+        if (!(rocks->write_buffer_manager && rocks->shared_block_cache))
+            total += mem;
     } else {
         mh->memtable = -1;
     }
 
-    if (!rocksPropertyInt(rocks, NULL, "rocksdb.block-cache-usage", &mem)) {
-        mh->block_cache = mem;
-        total += mem;
-    } else {
-        mh->block_cache = -1;
-    }
+    /* block-cache-usage property is reported per cf, which counts shared
+     * cache multiple times, so query caches directly. */
+    mh->block_cache = rocksBlockCacheUsage(rocks,0);
+    total += mh->block_cache;
 
     if (!rocksPropertyInt(rocks, NULL, "rocksdb.estimate-table-readers-mem", &mem)) {
         mh->index_and_filter = mem;
@@ -655,12 +957,8 @@ struct rocksdbMemOverhead *rocksGetMemoryOverhead(rocks *rocks) {
         mh->index_and_filter = -1;
     }
 
-    if (!rocksPropertyInt(rocks, NULL, "rocksdb.block-cache-pinned-usage", &mem)) {
-        mh->pinned_blocks = mem;
-        total += mem;
-    } else {
-        mh->pinned_blocks = -1;
-    }
+    /* pinned blocks are part of block cache usage. */
+    mh->pinned_blocks = rocksBlockCacheUsage(rocks,1);
 
     mh->total = total;
     return mh;
@@ -1183,14 +1481,16 @@ sds genSwapStorageInfoString(sds info) {
 			"swap_used_disk_size:%lu\r\n"
 			"swap_disk_capacity:%lu\r\n"
 			"swap_used_disk_percent:%0.2f%%\r\n"
-            "swap_error_count:%ld\r\n",
+            "swap_error_count:%ld\r\n"
+            "swap_rocksdb_memory_used:%llu\r\n",
 			swap_used_db_size,
 			swap_max_db_size,
 			swap_used_db_percent,
 			swap_used_disk_size,
 			swap_disk_capacity,
 			swap_used_disk_percent,
-            server.swap_error_count);
+            server.swap_error_count,
+            server.rocksdb_memory_used);
 
     serverRocksUnlock(rocks);
     return info;
@@ -1229,7 +1529,7 @@ sds genRocksdbStatsString(sds section, sds info) {
     if (count == 0) {
         info = infoCfStats(DATA_CF, info);
     }
-    int handled_cf[CF_COUNT] = {0,0,0};
+    int handled_cf[CF_COUNT] = {0};
 
     for(int i = 0; i < count; i++) {
         sds type = section_splits[i];
@@ -1254,6 +1554,7 @@ sds genRocksdbStatsString(sds section, sds info) {
 }
 
 #define ROCKSDB_DISK_USED_UPDATE_PERIOD 60
+#define ROCKSDB_MEMORY_USED_UPDATE_PERIOD 1
 #define ROCKSDB_DISK_HEALTH_DETECT_PERIOD 1
 
 void serverRocksCron() {
@@ -1287,6 +1588,12 @@ void serverRocksCron() {
 
     rocks *rocks = serverRocksGetReadLock();
 
+    if (rocks_cron_loops % ROCKSDB_MEMORY_USED_UPDATE_PERIOD == 0) {
+        struct rocksdbMemOverhead *mh = rocksGetMemoryOverhead(rocks);
+        server.rocksdb_memory_used = mh ? mh->total : 0;
+        rocksFreeMemoryOverhead(mh);
+    }
+
     if (rocks_cron_loops % ROCKSDB_DISK_USED_UPDATE_PERIOD == 0) {
         uint64_t property_int = 0;
         if (!rocksdb_property_int(rocks->db,
@@ -128,10 +128,76 @@ werr:
     return C_ERR;
 }
 
+/* Sst file number is allocated by each rocksdb instance, so name is not
+ * enough to identify sst held by replica: size, level and crc64 of
+ * smallest/largest key are checked too. Taken from live files metadata
+ * kept in memory by rocksdb, sst files are not read. */
+static sds rordbSSTIdentity(const rocksdb_livefiles_t *livefiles, int index) {
+    size_t smallest_len, largest_len;
+    const char *smallest = rocksdb_livefiles_smallestkey(livefiles,index,
+            &smallest_len);
+    const char *largest = rocksdb_livefiles_largestkey(livefiles,index,
+            &largest_len);
+    return sdscatprintf(sdsempty(),"%zu,%d,%llx,%llx",
+            rocksdb_livefiles_size(livefiles,index),
+            rocksdb_livefiles_level(livefiles,index),
+            (unsigned long long)crc64(0,(unsigned char*)smallest,smallest_len),
+            (unsigned long long)crc64(0,(unsigned char*)largest,largest_len));
+}
+
+static size_t rordbSSTIdentitySize(sds identity) {
+    return strtoull(identity,NULL,10);
+}
+
+/* Dict of name => identity of live ssts. */
+static dict *rordbLiveSSTsCreate(rocks *rocks) {
+    const rocksdb_livefiles_t *livefiles = rocksdb_livefiles(rocks->db);
+    int i, count = rocksdb_livefiles_count(livefiles);
+    dict *ssts = dictCreate(&hashDictType,NULL);
+
+    for (i = 0; i < count; i++) {
+        const char *name = rocksdb_livefiles_name(livefiles,i);
+        sds key, identity;
+
+        if (*name == '/') name++;
+        key = sdsnew(name);
+        identity = rordbSSTIdentity(livefiles,i);
+        if (dictAdd(ssts,key,identity) != DICT_OK) {
+            sdsfree(key);
+            sdsfree(identity);
+        }
+    }
+    rocksdb_livefiles_destroy(livefiles);
+    return ssts;
+}
+
+/* Sst could be reused if replicas hold sst with same identity (checked
+ * against master's live ssts by rordbDeltaSSTsCreate). */
+static sds rordbSSTReusable(char *filename, size_t filesize) {
+    dict *ssts = server.swap_repl_rordb_delta_ssts;
+    sds held;
+
+    if (ssts == NULL || (held = dictFetchValue(ssts,filename)) == NULL)
+        return NULL;
+    return rordbSSTIdentitySize(held) == filesize ? held : NULL;
+}
+
+static int rordbSaveSSTReuse(rio *rdb, char *filename, size_t filesize,
+        sds identity) {
+    if (rdbSaveType(rdb,RORDB_OPCODE_SST_REUSE) == -1) return C_ERR;
+    if (rdbSaveRawString(rdb,(unsigned char*)filename,strlen(filename)) == -1)
+        return C_ERR;
+    if (rdbSaveLen(rdb,filesize) == -1) return C_ERR;
+    if (rdbSaveRawString(rdb,(unsigned char*)identity,sdslen(identity)) == -1)
+        return C_ERR;
+    return C_OK;
+}
+
 static int rordbSaveSSTFiles(rio *rdb, char* path) {
 	DIR *dir;
 	struct dirent *ent;
-    int saved = 0, skipped = 0;
+    int saved = 0, reused = 0, skipped = 0;
+    sds identity;
     rordb_ratelimit_ctx *ratelimit = rordb_ratelimit_new();
 
 	if ((dir = opendir(path)) == NULL) goto werr;
@@ -161,7 +227,14 @@ static int rordbSaveSSTFiles(rio *rdb, char* path) {
             continue;
         }
 
-        if (rordbSaveSSTFile(rdb, filepath, ratelimit) != C_OK) {
+        if ((identity = rordbSSTReusable(ent->d_name, statbuf.st_size))) {
+            if (rordbSaveSSTReuse(rdb, ent->d_name, statbuf.st_size, identity) != C_OK) {
+                zfree(filepath);
+                goto werr;
+            }
+            reused++;
+            serverLog(LL_VERBOSE, "[rordb] reused sst file: %s", filepath);
+        } else if (rordbSaveSSTFile(rdb, filepath, ratelimit) != C_OK) {
             zfree(filepath);
             goto werr;
         } else {
@@ -173,8 +246,8 @@ static int rordbSaveSSTFiles(rio *rdb, char* path) {
 	}
 
     serverLog(LL_NOTICE,
-            "[rordb] save sst files in (%s) ok: saved %d, skipped %d file.",
-            path, saved, skipped);
+            "[rordb] save sst files in (%s) ok: saved %d, reused %d, skipped %d file.",
+            path, saved, reused, skipped);
 
     if (ratelimit) rordb_ratelimit_free(ratelimit);
 	if (dir) closedir(dir);
@@ -182,8 +255,8 @@ static int rordbSaveSSTFiles(rio *rdb, char* path) {
 
 werr:
     serverLog(LL_WARNING,
-            "[rordb] save sst files in (%s) err: saved %d, skipped %d file.",
-            path, saved, skipped);
+            "[rordb] save sst files in (%s) err: saved %d, reused %d, skipped %d file.",
+            path, saved, reused, skipped);
 
     if (ratelimit) rordb_ratelimit_free(ratelimit);
     if (dir) closedir(dir);
@@ -193,6 +266,8 @@ werr:
 int rordbSaveSST(rio *rdb) {
     if (rdbSaveType(rdb,RORDB_OPCODE_SWAP_VERSION) == -1) goto err;
     if (rdbSaveLen(rdb,server.swap_key_version) == -1) goto err;
+    if (rdbSaveType(rdb,RORDB_OPCODE_KEY_ENCODING) == -1) goto err;
+    if (rdbSaveLen(rdb,server.swap_key_encoding) == -1) goto err;
     if (rordbSaveSSTFiles(rdb,server.rocksdb_checkpoint_dir) == -1) goto err;
     return C_OK;
 err:
@@ -279,11 +354,95 @@ err:
     return C_ERR;
 }
 
+/* Ssts advertised to master (name => identity), see
+ * rordbDeltaManifestCreate. */
+static dict *rordb_delta_held = NULL;
+
+/* Link sst held by replica (hard linked in deltadir when handshake) into
+ * checkpoint dir, instead of loading sst content from rdb. */
+static int rordbLoadSSTReuse(rio *rdb, char *deltadir, dict *held,
+        char* path) {
+    sds filename = NULL, identity = NULL, held_identity;
+    char *src = NULL, *dst = NULL;
+    uint64_t filesize;
+    struct stat statbuf;
+    size_t fplen;
+
+    filename = rdbGenericLoadStringObject(rdb,RDB_LOAD_SDS,NULL);
+    if (filename == NULL) {
+        serverLog(LL_WARNING,"[rordb] load reused filename failed: %s(%d)",
+                strerror(errno),errno);
+        goto err;
+    }
+
+    if ((filesize = rdbLoadLen(rdb,NULL)) == RDB_LENERR ||
+            (identity = rdbGenericLoadStringObject(rdb,RDB_LOAD_SDS,
+                NULL)) == NULL) {
+        serverLog(LL_WARNING,"[rordb] load reused sst identity failed: %s(%d)",
+                strerror(errno),errno);
+        goto err;
+    }
+
+    fplen = strlen(deltadir) + 2 + sdslen(filename);
+    src = zmalloc(fplen);
+    snprintf(src,fplen,"%s/%s",deltadir,filename);
+    fplen = strlen(path) + 2 + sdslen(filename);
+    dst = zmalloc(fplen);
+    snprintf(dst,fplen,"%s/%s",path,filename);
+
+    held_identity = held ? dictFetchValue(held,filename) : NULL;
+    if (held_identity == NULL || sdscmp(held_identity,identity) ||
+            stat(src,&statbuf) || (uint64_t)statbuf.st_size != filesize) {
+        serverLog(LL_WARNING,
+                "[rordb] reused sst file(%s) missing or mismatch with master.",
+                src);
+        goto err;
+    }
+
+    if (link(src,dst)) {
+        serverLog(LL_WARNING,"[rordb] link sst file(%s) to (%s) failed: %s(%d)",
+                src,dst,strerror(errno),errno);
+        goto err;
+    }
+
+    serverLog(LL_VERBOSE, "[rordb] reuse sst file(%s) ok.", dst);
+
+    sdsfree(filename);
+    sdsfree(identity);
+    zfree(src);
+    zfree(dst);
+    return C_OK;
+
+err:
+    if (filename) sdsfree(filename);
+    if (identity) sdsfree(identity);
+    if (src) zfree(src);
+    if (dst) zfree(dst);
+    return C_ERR;
+}
+
+/* Key encoding of ssts loaded, checked against local encoding since
+ * restored ssts are read with it. */
+static int rordb_load_key_encoding = SWAP_KEY_ENCODING_V1;
+
+static int rordbCheckKeyEncoding(int encoding) {
+    if (encoding != server.swap_key_encoding) {
+        serverLog(LL_WARNING,
+                "[rordb] refuse to load ssts with key encoding v%d, "
+                "while local key encoding is v%d.",
+                encoding,server.swap_key_encoding);
+        return C_ERR;
+    }
+    return C_OK;
+}
+
 int rmdirRecursive(const char *path);
 int rordbLoadSSTStart(rio *rdb) {
     UNUSED(rdb);
     struct stat st;
 
+    rordb_load_key_encoding = SWAP_KEY_ENCODING_V1;
+
     if (stat(RORDB_CHECKPOINT_DIR, &st) != 0) {
         /* it's ok that prev checkpoint dir not exists */
     } else if (rmdirRecursive(RORDB_CHECKPOINT_DIR)) {
@@ -313,6 +472,16 @@ int rordbLoadSSTType(rio *rdb, int type) {
         uint64_t version;
         if ((version = rdbLoadLen(rdb,NULL)) == RDB_LENERR) return C_ERR;
         swapSetVersion(version);
+    } else if (type == RORDB_OPCODE_KEY_ENCODING) {
+        uint64_t encoding;
+        if ((encoding = rdbLoadLen(rdb,NULL)) == RDB_LENERR) return C_ERR;
+        rordb_load_key_encoding = (int)encoding;
+        /* refuse early before ssts transferred. */
+        if (rordbCheckKeyEncoding(rordb_load_key_encoding)) return C_ERR;
+    } else if (type == RORDB_OPCODE_SST_REUSE) {
+        if (rordbLoadSSTReuse(rdb,RORDB_DELTA_DIR,rordb_delta_held,
+                    RORDB_CHECKPOINT_DIR) == -1)
+            return C_ERR;
     } else {
         if (rordbLoadSSTFile(rdb,RORDB_CHECKPOINT_DIR) == -1) return C_ERR;
     }
@@ -321,6 +490,8 @@ int rordbLoadSSTType(rio *rdb, int type) {
 
 int rordbLoadSSTFinished(rio *rdb) {
     UNUSED(rdb);
+    /* master without key encoding opcode saves ssts in v1. */
+    if (rordbCheckKeyEncoding(rordb_load_key_encoding)) return C_ERR;
     serverLog(LL_NOTICE, "[rordb] restoring from checkpoint(%s).", RORDB_CHECKPOINT_DIR);
     rocks *rocks = serverRocksGetReadLock();
     int ret = rocksRestore(rocks,RORDB_CHECKPOINT_DIR);
@@ -334,6 +505,159 @@ int rordbLoadSSTFinished(rio *rdb) {
     }
 }
 
+void rordbDeltaCleanup(void) {
+    struct stat st;
+
+    if (rordb_delta_held) {
+        dictRelease(rordb_delta_held);
+        rordb_delta_held = NULL;
+    }
+    if (stat(RORDB_DELTA_DIR, &st) == 0 && rmdirRecursive(RORDB_DELTA_DIR))
+        serverLog(LL_WARNING, "[rordb] cleanup delta dir(%s) failed.",
+                RORDB_DELTA_DIR);
+}
+
+/* Called by replica before psync: hard link live ssts into RORDB_DELTA_DIR
+ * so that they survive compaction until fullsync finished, returns manifest
+ * of them ("name,identity ..."), or NULL if nothing to advertise. Identity
+ * comes from live files metadata, sst files are only linked (not read). */
+sds rordbDeltaManifestCreate(void) {
+    rocks *rocks;
+    char dbdir[ROCKS_DIR_MAX_LEN], src[ROCKS_DIR_MAX_LEN], dst[ROCKS_DIR_MAX_LEN];
+    sds manifest;
+    dict *ssts;
+    dictIterator *di;
+    dictEntry *de;
+    int linked = 0;
+
+    if (server.swap_mode == SWAP_MODE_MEMORY ||
+            !server.swap_repl_rordb_delta_sync)
+        return NULL;
+
+    rordbDeltaCleanup();
+    if (mkdir(RORDB_DELTA_DIR,0755)) {
+        serverLog(LL_WARNING, "[rordb] create delta dir(%s) failed:%s,%d.",
+                RORDB_DELTA_DIR,strerror(errno),errno);
+        return NULL;
+    }
+
+    manifest = sdsempty();
+    rocks = serverRocksGetReadLock();
+    snprintf(dbdir,ROCKS_DIR_MAX_LEN,"%s/%d",ROCKS_DATA,rocks->rocksdb_epoch);
+    ssts = rordbLiveSSTsCreate(rocks);
+
+    di = dictGetSafeIterator(ssts);
+    while ((de = dictNext(di))) {
+        sds name = dictGetKey(de);
+
+        snprintf(src,ROCKS_DIR_MAX_LEN,"%s/%s",dbdir,name);
+        snprintf(dst,ROCKS_DIR_MAX_LEN,"%s/%s",RORDB_DELTA_DIR,name);
+
+        /* sst might be deleted by compaction meanwhile. */
+        if (link(src,dst)) {
+            dictDelete(ssts,name);
+            continue;
+        }
+
+        manifest = sdscatprintf(manifest,"%s%s,%s",linked++ ? " " : "",
+                name,(sds)dictGetVal(de));
+    }
+    dictReleaseIterator(di);
+    serverRocksUnlock(rocks);
+
+    if (linked == 0) {
+        sdsfree(manifest);
+        dictRelease(ssts);
+        rordbDeltaCleanup();
+        return NULL;
+    }
+    rordb_delta_held = ssts;
+
+    serverLog(LL_NOTICE, "[rordb] advertise %d ssts held to master.", linked);
+    return manifest;
+}
+
+/* Parse manifest into dict of name => identity. */
+static dict *rordbDeltaManifestParse(sds manifest) {
+    dict *ssts = dictCreate(&hashDictType,NULL);
+    int i, count;
+    sds *entries = sdssplitlen(manifest,sdslen(manifest)," ",1,&count);
+
+    for (i = 0; i < count; i++) {
+        char *sep = strchr(entries[i],',');
+        sds name, identity;
+
+        if (sep == NULL || sep == entries[i]) continue;
+        name = sdsnewlen(entries[i],sep-entries[i]);
+        identity = sdsnew(sep+1);
+        if (dictAdd(ssts,name,identity) != DICT_OK) {
+            sdsfree(name);
+            sdsfree(identity);
+        }
+    }
+
+    sdsfreesplitres(entries,count);
+    return ssts;
+}
+
+/* Drop ssts not in held with the same identity, held released. */
+static void rordbDeltaSSTsIntersect(dict *ssts, dict *held) {
+    dictIterator *di = dictGetSafeIterator(ssts);
+    dictEntry *de;
+
+    while ((de = dictNext(di))) {
+        sds identity = dictFetchValue(held,dictGetKey(de));
+        if (identity == NULL || sdscmp(identity,dictGetVal(de)))
+            dictDelete(ssts,dictGetKey(de));
+    }
+    dictReleaseIterator(di);
+    dictRelease(held);
+}
+
+/* Ssts held by all replicas waiting for bgsave start (they share the same
+ * rordb) and live in master with the same identity, NULL if any of them
+ * advertised nothing. */
+dict *rordbDeltaSSTsCreate(list *slaves) {
+    dict *ssts = NULL, *held;
+    rocks *rocks;
+    listIter li;
+    listNode *ln;
+
+    listRewind(slaves,&li);
+    while ((ln = listNext(&li))) {
+        client *slave = ln->value;
+
+        if (slave->replstate != SLAVE_STATE_WAIT_BGSAVE_START) continue;
+
+        if (slave->slave_rordb_ssts == NULL) {
+            if (ssts) dictRelease(ssts);
+            return NULL;
+        }
+
+        held = rordbDeltaManifestParse(slave->slave_rordb_ssts);
+        if (ssts == NULL) {
+            ssts = held;
+            continue;
+        }
+        rordbDeltaSSTsIntersect(ssts,held);
+    }
+
+    if (ssts) {
+        rocks = serverRocksGetReadLock();
+        held = rordbLiveSSTsCreate(rocks);
+        serverRocksUnlock(rocks);
+        rordbDeltaSSTsIntersect(ssts,held);
+
+        serverLog(LL_NOTICE, "[rordb] %lu ssts held by replicas could be reused.",
+                dictSize(ssts));
+    }
+    return ssts;
+}
+
+void rordbDeltaSSTsRelease(dict *ssts) {
+    if (ssts) dictRelease(ssts);
+}
+
 #define RORRDB_CUCKOO_FILTER_FORMAT_V1 1
 
 static int rordbSaveCuckooFilter(rio *rdb, cuckooFilter *cuckoo_filter) {
@@ -674,6 +998,123 @@ int swapRordbTest(int argc, char *argv[], int accurate) {
         sdsfree(rdb->io.buffer.ptr);
     }
 
+    TEST("rordb: save & load reused sst") {
+        rio _rdb, *rdb = &_rdb;
+        mstime_t identity = mstime();
+        char identity_dir[TMP_PATH_MAX], checkpoint_dir[TMP_PATH_MAX],
+        delta_dir[TMP_PATH_MAX], load_dir[TMP_PATH_MAX],
+        hello_filepath[TMP_PATH_MAX], foo_filepath[TMP_PATH_MAX],
+        held_filepath[TMP_PATH_MAX];
+        FILE *hello_file, *foo_file;
+        char read_buffer[16];
+        size_t read_len;
+        int i, type, saved = 0, reused = 0;
+        sds manifest;
+        dict *held;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+
+        snprintf(identity_dir,sizeof(identity_dir),"/tmp/%lld-delta",identity);
+        snprintf(checkpoint_dir,sizeof(checkpoint_dir), "%s/rordb-checkpoint", identity_dir);
+        snprintf(delta_dir,sizeof(delta_dir), "%s/rordb-delta", identity_dir);
+        snprintf(load_dir,sizeof(load_dir), "%s/rordb-load", identity_dir);
+
+        mkdir(identity_dir, 0755), mkdir(checkpoint_dir, 0755);
+        mkdir(delta_dir, 0755), mkdir(load_dir, 0755);
+
+        snprintf(hello_filepath,sizeof(hello_filepath),"%s/hello.sst", checkpoint_dir);
+        snprintf(foo_filepath,sizeof(foo_filepath),"%s/foo.sst", checkpoint_dir);
+        snprintf(held_filepath,sizeof(held_filepath),"%s/hello.sst", delta_dir);
+
+        hello_file = fopen(hello_filepath,"w");
+        fwrite("world",5,1,hello_file);
+        fclose(hello_file);
+        foo_file = fopen(foo_filepath,"w");
+        fwrite("bar",3,1,foo_file);
+        fclose(foo_file);
+        test_assert(link(hello_filepath,held_filepath) == 0);
+
+        /* replica holds hello.sst, and a foo.sst different from master
+         * (size mismatch with checkpoint file). */
+        manifest = sdsnew("hello.sst,5,0,1a,2b foo.sst,4,0,3c,4d");
+        server.swap_repl_rordb_delta_ssts = rordbDeltaManifestParse(manifest);
+        test_assert(dictSize(server.swap_repl_rordb_delta_ssts) == 2);
+        held = rordbDeltaManifestParse(manifest);
+
+        rioInitWithBuffer(rdb,sdsempty());
+        test_assert(rordbSaveSSTFiles(rdb,checkpoint_dir) == C_OK);
+        rordbDeltaSSTsRelease(server.swap_repl_rordb_delta_ssts);
+        server.swap_repl_rordb_delta_ssts = NULL;
+
+        rioInitWithBuffer(rdb,rdb->io.buffer.ptr);
+        for (i = 0; i < 2; i++) {
+            type = rdbLoadType(rdb);
+            if (type == RORDB_OPCODE_SST) {
+                test_assert(rordbLoadSSTFile(rdb,load_dir) == C_OK);
+                saved++;
+            } else {
+                test_assert(type == RORDB_OPCODE_SST_REUSE);
+                test_assert(rordbLoadSSTReuse(rdb,delta_dir,held,load_dir) == C_OK);
+                reused++;
+            }
+        }
+        test_assert(saved == 1 && reused == 1);
+
+        snprintf(hello_filepath,sizeof(hello_filepath),"%s/hello.sst", load_dir);
+        snprintf(foo_filepath,sizeof(foo_filepath),"%s/foo.sst", load_dir);
+
+#pragma GCC diagnostic pop
+
+        hello_file = fopen(hello_filepath,"r");
+        read_len = fread(read_buffer,1,sizeof(read_buffer),hello_file);
+        test_assert(read_len == 5);
+        test_assert(memcmp(read_buffer,"world",read_len) == 0);
+        fclose(hello_file);
+
+        foo_file = fopen(foo_filepath,"r");
+        read_len = fread(read_buffer,1,sizeof(read_buffer),foo_file);
+        test_assert(read_len == 3);
+        test_assert(memcmp(read_buffer,"bar",read_len) == 0);
+        fclose(foo_file);
+
+        /* reuse fails if held sst mismatch with master. */
+        sdsfree(rdb->io.buffer.ptr);
+        rioInitWithBuffer(rdb,sdsempty());
+        sds mismatch = sdsnew("5,0,1a,2c");
+        test_assert(rordbSaveSSTReuse(rdb,"hello.sst",5,mismatch) == C_OK);
+        rioInitWithBuffer(rdb,rdb->io.buffer.ptr);
+        test_assert(rdbLoadType(rdb) == RORDB_OPCODE_SST_REUSE);
+        test_assert(rordbLoadSSTReuse(rdb,delta_dir,held,identity_dir) == C_ERR);
+        sdsfree(mismatch);
+
+        rmdirRecursive(identity_dir);
+        sdsfree(rdb->io.buffer.ptr);
+        dictRelease(held);
+        sdsfree(manifest);
+    }
+
+    TEST("rordb: refuse ssts of different key encoding") {
+        rio _rdb, *rdb = &_rdb;
+        int orig_encoding = server.swap_key_encoding;
+
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V2;
+        rioInitWithBuffer(rdb,sdsempty());
+        rdbSaveType(rdb,RORDB_OPCODE_KEY_ENCODING);
+        rdbSaveLen(rdb,SWAP_KEY_ENCODING_V2);
+        rdbSaveType(rdb,RORDB_OPCODE_KEY_ENCODING);
+        rdbSaveLen(rdb,SWAP_KEY_ENCODING_V1);
+
+        rioInitWithBuffer(rdb,rdb->io.buffer.ptr);
+        test_assert(rdbLoadType(rdb) == RORDB_OPCODE_KEY_ENCODING);
+        test_assert(rordbLoadSSTType(rdb,RORDB_OPCODE_KEY_ENCODING) == C_OK);
+        test_assert(rdbLoadType(rdb) == RORDB_OPCODE_KEY_ENCODING);
+        test_assert(rordbLoadSSTType(rdb,RORDB_OPCODE_KEY_ENCODING) == C_ERR);
+
+        server.swap_key_encoding = orig_encoding;
+        sdsfree(rdb->io.buffer.ptr);
+    }
+
     TEST("rordb: save & load cuckoo filter") {
         rio _rdb, *rdb = &_rdb;
         cuckooFilter *origin, *loaded;
@@ -56,10 +56,15 @@
 #define RORDB_OPCODE_ZSET             RORDB_OPCODE(7)
 #define RORDB_OPCODE_LIST             RORDB_OPCODE(8)
 #define RORDB_OPCODE_BITMAP           RORDB_OPCODE(9)
+/* ror.sst opcode: sst already held by replica (delta sync) */
+#define RORDB_OPCODE_SST_REUSE        RORDB_OPCODE(10)
+/* ror.sst opcode: key encoding of ssts, v1 if absent */
+#define RORDB_OPCODE_KEY_ENCODING     RORDB_OPCODE(11)
 /* ror opcode must lt limit */
-#define RORDB_OPCODE_LIMIT            RORDB_OPCODE(10)
+#define RORDB_OPCODE_LIMIT            RORDB_OPCODE(12)
 
 #define RORDB_CHECKPOINT_DIR          "rordb_checkpoint"
+#define RORDB_DELTA_DIR               "rordb_delta"
 
 static inline int rordbOpcodeIsValid(int type) {
   return type >= RORDB_OPCODE_BASE && type < RORDB_OPCODE_LIMIT;
@@ -70,11 +75,12 @@ static inline int rordbOpcodeIsObjectFlags(int type) {
 }
 
 static inline int rordbOpcodeIsSSTType(int type) {
-  return type == RORDB_OPCODE_SWAP_VERSION || type == RORDB_OPCODE_SST;
+  return type == RORDB_OPCODE_SWAP_VERSION || type == RORDB_OPCODE_SST ||
+    type == RORDB_OPCODE_SST_REUSE || type == RORDB_OPCODE_KEY_ENCODING;
 }
 
 static inline int rordbOpcodeIsDbType(int type) {
-  return type >= RORDB_OPCODE_COLD_KEY_NUM && type < RORDB_OPCODE_LIMIT;
+  return type >= RORDB_OPCODE_COLD_KEY_NUM && type <= RORDB_OPCODE_BITMAP;
 }
 
 static inline int rordbOpcodeFromSwapType(int swap_type) {
@@ -124,4 +130,9 @@ int rordbLoadSSTType(rio *rdb, int type);
 int rordbLoadSSTFinished(rio *rdb);
 int rordbLoadDbType(rio *rdb, redisDb *db, int type);
 
+sds rordbDeltaManifestCreate(void);
+void rordbDeltaCleanup(void);
+dict *rordbDeltaSSTsCreate(list *slaves);
+void rordbDeltaSSTsRelease(dict *ssts);
+
 #endif
@@ -40,7 +40,7 @@ static void createFakeSetForDeleteIfCold(swapData *data) {
 
 /* return 1 if noswap needed */
 static int setSwapAnaOutSelectSubkeys(swapData *data, setDataCtx *datactx,
-        int *may_keep_data) {
+        subkeyClock *clock, int *may_keep_data) {
     int select_type, noswap;
     size_t count;
     robj *subkeys;
@@ -75,6 +75,7 @@ static int setSwapAnaOutSelectSubkeys(swapData *data, setDataCtx *datactx,
     }
 
     count = MIN(count,(size_t)server.swap_evict_step_max_subkeys);
+    size_t chances = subkeyClockSecondChances(count);
     datactx->ctx.type = BASE_SWAP_CTX_TYPE_SUBKEY;
     datactx->ctx.sub.subkeys = zmalloc(count*sizeof(robj*));
 
@@ -95,6 +96,13 @@ static int setSwapAnaOutSelectSubkeys(swapData *data, setDataCtx *datactx,
             }
 
             subkey = createObject(OBJ_STRING, vstr);
+            /* Recently accessed member kept for now, evicted in later
+             * steps if not accessed again. */
+            if (subkeyClockSecondChance(clock,subkey,&chances)) {
+                if (!noswap) *may_keep_data = 0;
+                decrRefCount(subkey);
+                continue;
+            }
             evict_memory += vlen;
             datactx->ctx.sub.subkeys[datactx->ctx.sub.num++] = subkey;
         }
@@ -208,6 +216,13 @@ int setSwapAna(swapData *data, int thd, struct keyRequest *req,
                 }
             } else { /* keyrequests with subkeys */
                 objectMeta *meta = swapDataObjectMeta(data);
+                subkeyClock *clock = NULL;
+                if (thd == SWAP_ANA_THD_MAIN && server.swap_evict_subkey_clock &&
+                        req->cmd_intention_flags != SWAP_IN_DEL) {
+                    size_t nsubkeys = meta->len;
+                    if (data->value) nsubkeys += setTypeSize(data->value);
+                    clock = subkeyClockLookupOrCreate(data->db,data->key,nsubkeys);
+                }
                 if (req->cmd_intention_flags == SWAP_IN_DEL) {
                     datactx->ctx.type = BASE_SWAP_CTX_TYPE_SUBKEY;
                     datactx->ctx.sub.num = 0;
@@ -224,6 +239,9 @@ int setSwapAna(swapData *data, int thd, struct keyRequest *req,
                     *intention = datactx->ctx.sub.num > 0 ? SWAP_IN : SWAP_NOP;
                     *intention_flags = SWAP_EXEC_IN_DEL;
                 } else if (meta->len == 0) {
+                    /* all members in memory, no swap needed. */
+                    for (int i = 0; clock && i < req->b.num_subkeys; i++)
+                        subkeyClockAccess(clock,req->b.subkeys[i],1);
                     *intention = SWAP_NOP;
                     *intention_flags = 0;
                 } else {
@@ -232,7 +250,10 @@ int setSwapAna(swapData *data, int thd, struct keyRequest *req,
                     datactx->ctx.sub.subkeys = zmalloc(req->b.num_subkeys * sizeof(robj *));
                     for (int i = 0; i < req->b.num_subkeys; i++) {
                         robj *subkey = req->b.subkeys[i];
-                        if (data->value == NULL || !setTypeIsMember(data->value, subkey->ptr)) {
+                        int hot = data->value != NULL &&
+                            setTypeIsMember(data->value, subkey->ptr);
+                        if (clock) subkeyClockAccess(clock,subkey,hot);
+                        if (!hot) {
                             if (swapDataMayContainSubkey(data,thd,subkey)) {
                                 incrRefCount(subkey);
                                 datactx->ctx.sub.subkeys[datactx->ctx.sub.num++] = subkey;
@@ -256,7 +277,10 @@ int setSwapAna(swapData *data, int thd, struct keyRequest *req,
                 /* may_keep_data is true if we could keep data in memory and clear dirty
                  * after persisting data to rocksdb. */
                 int may_keep_data;
-                int noswap = setSwapAnaOutSelectSubkeys(data,datactx,&may_keep_data);
+                subkeyClock *clock = thd == SWAP_ANA_THD_MAIN ?
+                    subkeyClockLookup(data->db,data->key) : NULL;
+                int noswap = setSwapAnaOutSelectSubkeys(data,datactx,clock,
+                        &may_keep_data);
 
                 int keep_data = swapDataPersistKeepData(data,cmd_intention_flags,may_keep_data);
 
@@ -470,10 +494,16 @@ int setSwapIn(swapData *data, void *result_, void *datactx) {
 /* subkeys already cleaned by cleanObject(to save cpu usage of main thread),
  * swapout only updates db.dict keyspace, meta (db.meta/db.expire) swapped
  * out by swap framework. */
-int setSwapOut(swapData *data, void *datactx, int clear_dirty, int *totally_out) {
-    UNUSED(datactx);
+int setSwapOut(swapData *data, void *datactx_, int clear_dirty, int *totally_out) {
+    setDataCtx *datactx = datactx_;
     serverAssert(!swapDataIsCold(data));
 
+    if (datactx->ctx.type == BASE_SWAP_CTX_TYPE_SUBKEY) {
+        swapDataSubkeysSwappedOut(data,datactx->ctx.sub.subkeys,
+                datactx->ctx.sub.num,
+                setTypeSize(data->value)+datactx->ctx.sub.num);
+    }
+
     if (data->dirty_subkeys &&
             dirtySubkeysLength(data->dirty_subkeys) == 0) {
         dbDeleteDirtySubkeys(data->db,data->key);
@@ -74,10 +74,17 @@ void initStatsSwap() {
         server.ror_stats->compaction_filter_stats[i].filt_count = 0;
         server.ror_stats->compaction_filter_stats[i].scan_count = 0;
         server.ror_stats->compaction_filter_stats[i].rio_count = 0;
+        server.ror_stats->compaction_filter_stats[i].cache_hit_count = 0;
         server.ror_stats->compaction_filter_stats[i].stats_metric_idx_filt = metric_offset+COMPACTION_FILTER_METRIC_FILT;
         server.ror_stats->compaction_filter_stats[i].stats_metric_idx_scan = metric_offset+COMPACTION_FILTER_METRIC_SCAN;
         server.ror_stats->compaction_filter_stats[i].stats_metric_idx_rio = metric_offset+COMPACTION_FILTER_METRIC_RIO;
     }
+    server.ror_stats->rio_get_value_count = 0;
+    server.ror_stats->rio_get_copied_bytes = 0;
+    for (i = 0; i < SWAP_TYPE_COUNT; i++) {
+        server.ror_stats->swapin_rio_count[i] = 0;
+        server.ror_stats->swapin_rio_time[i] = 0;
+    }
     server.swap_debug_info = zmalloc(SWAP_DEBUG_INFO_TYPE*sizeof(swapDebugInfo));
     for (i = 0; i < SWAP_DEBUG_INFO_TYPE; i++) {
         metric_offset = SWAP_DEBUG_STATS_METRIC_OFFSET + i*SWAP_DEBUG_SIZE;
@@ -349,6 +356,8 @@ sds genSwapInfoString(sds info) {
     info = genSwapUnblockInfoString(info);
     info = genSwapRateLimitInfoString(info);
     info = genSwapPersistInfoString(info);
+    info = genSwapPrefetchInfoString(info);
+    info = genSwapSubkeyClockInfoString(info);
     info = genSwapBitmapStringSwitchedInfoString(info);
     info = genSwapTtlCompactInfoString(info);
     return info;
@@ -405,14 +414,24 @@ sds genSwapExecInfoString(sds info) {
                 ops > 0 ? total_latency/ops : 0);
     }
 
+    size_t value_count, copied_bytes, swapin_count;
+    atomicGet(server.ror_stats->rio_get_value_count,value_count);
+    atomicGet(server.ror_stats->rio_get_copied_bytes,copied_bytes);
+    atomicGet(server.ror_stats->swap_stats[SWAP_IN].count,swapin_count);
+    info = sdscatprintf(info,
+            "swap_rio_get_copy:pinned=%d,values=%ld,copied_bytes=%ld,copied_bytes_per_swapin=%ld\r\n",
+            server.swap_rio_pinned_multiget,value_count,copied_bytes,
+            swapin_count > 0 ? copied_bytes/swapin_count : 0);
+
     for (j = 0; j < CF_COUNT; j++) {
         compactionFilterStat *cfs = &server.ror_stats->compaction_filter_stats[j];
-        long long filt_count, scan_count, rio_count;
+        long long filt_count, scan_count, rio_count, cache_hit_count;
         atomicGet(cfs->filt_count,filt_count);
         atomicGet(cfs->scan_count,scan_count);
         atomicGet(cfs->rio_count,rio_count);
-        info = sdscatprintf(info,"swap_compaction_filter_%s:filt_count=%lld,scan_count=%lld,rio_count=%lld,filt_ps=%lld,scan_ps=%lld,rio_ps=%lld\r\n",
-                cfs->name,filt_count,scan_count,rio_count,
+        atomicGet(cfs->cache_hit_count,cache_hit_count);
+        info = sdscatprintf(info,"swap_compaction_filter_%s:filt_count=%lld,scan_count=%lld,rio_count=%lld,cache_hit_count=%lld,filt_ps=%lld,scan_ps=%lld,rio_ps=%lld\r\n",
+                cfs->name,filt_count,scan_count,rio_count,cache_hit_count,
                 getInstantaneousMetric(cfs->stats_metric_idx_filt),
                 getInstantaneousMetric(cfs->stats_metric_idx_scan),
                 getInstantaneousMetric(cfs->stats_metric_idx_rio));
@@ -459,10 +478,18 @@ void resetStatsSwap() {
         server.ror_stats->rio_stats[i].batch = 0;
         server.ror_stats->rio_stats[i].memory = 0;
     }
+    atomicSet(server.ror_stats->rio_get_value_count,0);
+    atomicSet(server.ror_stats->rio_get_copied_bytes,0);
+    resetSwapThreadsStats();
+    resetAsyncCompleteQueueStats();
+    resetSwapPrefetchStats();
+    resetSwapEvictionStats();
+    resetSwapSubkeyClockStats();
     for (i = 0; i < CF_COUNT; i++) {
         server.ror_stats->compaction_filter_stats[i].filt_count = 0;
         server.ror_stats->compaction_filter_stats[i].scan_count = 0;
         server.ror_stats->compaction_filter_stats[i].rio_count = 0;
+        server.ror_stats->compaction_filter_stats[i].cache_hit_count = 0;
     }
     resetSwapLockInstantaneousMetrics();
     resetSwapBatchInstantaneousMetrics();
@@ -478,13 +505,22 @@ void resetSwapHitStat() {
     atomicSet(server.swap_hit_stats->stat_swapin_data_not_found_count,0);
     atomicSet(server.swap_hit_stats->stat_absent_subkey_query_count,0);
     atomicSet(server.swap_hit_stats->stat_absent_subkey_filt_count,0);
+    atomicSet(server.swap_hit_stats->stat_swapin_warm_tier_hit_count,0);
+    atomicSet(server.swap_hit_stats->stat_swapin_warm_tier_miss_count,0);
+    atomicSet(server.swap_hit_stats->stat_warm_tier_put_count,0);
+    atomicSet(server.swap_hit_stats->stat_warm_tier_evict_count,0);
+    atomicSet(server.swap_hit_stats->stat_swapin_pushdown_count,0);
+    atomicSet(server.swap_hit_stats->stat_subkey_filter_query_count,0);
+    atomicSet(server.swap_hit_stats->stat_subkey_filter_filt_count,0);
 }
 
 sds genSwapHitInfoString(sds info) {
-    double memory_hit_perc = 0, keyspace_hit_perc = 0, notfound_coldfilter_filt_perc = 0;
+    double memory_hit_perc = 0, keyspace_hit_perc = 0, notfound_coldfilter_filt_perc = 0,
+           warm_tier_hit_perc = 0;
     long long attempt, noio, notfound_coldfilter_miss, notfound_absentcache_filt,
          notfound_cuckoofilter_filt, notfound, data_notfound,
-         absent_subkey_query, absent_subkey_filt;
+         absent_subkey_query, absent_subkey_filt, warm_tier_hit, warm_tier_miss, pushdown,
+         subkey_filter_query, subkey_filter_filt;
 
     atomicGet(server.swap_hit_stats->stat_swapin_attempt_count,attempt);
     atomicGet(server.swap_hit_stats->stat_swapin_no_io_count,noio);
@@ -494,6 +530,11 @@ sds genSwapHitInfoString(sds info) {
     atomicGet(server.swap_hit_stats->stat_swapin_data_not_found_count,data_notfound);
     atomicGet(server.swap_hit_stats->stat_absent_subkey_query_count,absent_subkey_query);
     atomicGet(server.swap_hit_stats->stat_absent_subkey_filt_count,absent_subkey_filt);
+    atomicGet(server.swap_hit_stats->stat_swapin_warm_tier_hit_count,warm_tier_hit);
+    atomicGet(server.swap_hit_stats->stat_swapin_warm_tier_miss_count,warm_tier_miss);
+    atomicGet(server.swap_hit_stats->stat_swapin_pushdown_count,pushdown);
+    atomicGet(server.swap_hit_stats->stat_subkey_filter_query_count,subkey_filter_query);
+    atomicGet(server.swap_hit_stats->stat_subkey_filter_filt_count,subkey_filter_filt);
 
     notfound = notfound_absentcache_filt + notfound_cuckoofilter_filt + notfound_coldfilter_miss;
 
@@ -501,6 +542,9 @@ sds genSwapHitInfoString(sds info) {
         memory_hit_perc = ((double)noio/attempt)*100;
         keyspace_hit_perc = ((double)(attempt - notfound)/attempt)*100;
     }
+    if (warm_tier_hit+warm_tier_miss) {
+        warm_tier_hit_perc = ((double)warm_tier_hit/(warm_tier_hit+warm_tier_miss))*100;
+    }
     if (notfound) {
         notfound_coldfilter_filt_perc = ((double)(notfound_absentcache_filt+notfound_cuckoofilter_filt)/notfound)*100;
     }
@@ -517,11 +561,21 @@ sds genSwapHitInfoString(sds info) {
             "swap_swapin_not_found_coldfilter_filt_perc:%.2f%%\r\n"
             "swap_swapin_data_not_found_count:%lld\r\n"
             "swap_absent_subkey_query_count:%lld\r\n"
-            "swap_absent_subkey_filt_count:%lld\r\n",
+            "swap_absent_subkey_filt_count:%lld\r\n"
+            "swap_subkey_filter_query_count:%lld\r\n"
+            "swap_subkey_filter_filt_count:%lld\r\n"
+            "swap_swapin_warm_tier_hit_count:%lld\r\n"
+            "swap_swapin_warm_tier_miss_count:%lld\r\n"
+            "swap_swapin_warm_tier_hit_perc:%.2f%%\r\n"
+            "swap_swapin_pushdown_count:%lld\r\n",
             attempt,notfound,noio,memory_hit_perc,keyspace_hit_perc,
             notfound_cuckoofilter_filt, notfound_absentcache_filt,
             notfound_coldfilter_miss, notfound_coldfilter_filt_perc,
-            data_notfound,absent_subkey_query,absent_subkey_filt);
+            data_notfound,absent_subkey_query,absent_subkey_filt,
+            subkey_filter_query,subkey_filter_filt,
+            warm_tier_hit,warm_tier_miss,warm_tier_hit_perc,pushdown);
+
+    info = genSwapWarmTierInfoString(info);
 
     return info;
 }
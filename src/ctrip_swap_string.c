@@ -241,6 +241,7 @@ int wholeKeySwapOut(swapData *data, void *datactx, int keep_data, int *totally_o
         clearObjectDataDirty(data->value);
         if (totally_out) *totally_out = 0;
     } else {
+        warmTierPutKey(db,key,data->value,data->expire);
         if (dictSize(db->dict) > 0) dbDelete(db, key);
         if (totally_out) *totally_out = 1;
     }
@@ -328,7 +329,7 @@ int wholekeySave(rdbKeySaveData *keydata, rio *rdb, decodedData *decoded) {
     initStaticStringObject(keyobj,decoded->key);
 
     if (rdbSaveKeyHeader(rdb,&keyobj,&keyobj,
-                RDB_TYPE_STRING,
+                decoded->rdbtype,
                 keydata->expire) == -1) {
         return -1;
     }
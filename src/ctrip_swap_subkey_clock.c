@@ -0,0 +1,265 @@
+/* Copyright (c) 2024, ctrip.com * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ctrip_swap.h"
+
+/* Subkey CLOCK: approximate access recency of subkeys of big hash/set/zset.
+ *
+ * Each tracked key owns a bit array, subkey accessed sets the bit it hashes
+ * to. When selecting subkeys to swap out, subkeys with bit set are given a
+ * second chance (bit cleared, subkey skipped), so that recently accessed
+ * subkeys stay in memory and colder ones are evicted first. Bits are shared
+ * by subkeys hashing to the same slot, which is fine for a recency hint.
+ *
+ * Only a bounded number of keys are tracked (random one dropped if full),
+ * entries are not removed when key deleted: stale bits only bias selection. */
+
+static void dictSubkeyClockDestructor(void *privdata, void *val) {
+    UNUSED(privdata);
+    zfree(val);
+}
+
+dictType subkeyClockDictType = {
+    dictSdsHash,                /* hash function */
+    NULL,                       /* key dup */
+    NULL,                       /* val dup */
+    dictSdsKeyCompare,          /* key compare */
+    dictSdsDestructor,          /* key destructor */
+    dictSubkeyClockDestructor,  /* val destructor */
+    NULL                        /* allow to expand */
+};
+
+subkeyClocks *subkeyClocksNew(void) {
+    subkeyClocks *clocks = zcalloc(sizeof(subkeyClocks));
+    clocks->clocks = dictCreate(&subkeyClockDictType,NULL);
+    return clocks;
+}
+
+void subkeyClocksFree(subkeyClocks *clocks) {
+    if (clocks == NULL) return;
+    dictRelease(clocks->clocks);
+    zfree(clocks);
+}
+
+static sds subkeyClockEncodeKey(redisDb *db, robj *key) {
+    sds clock_key = sdsnewlen(&db->id,sizeof(db->id));
+    return sdscatsds(clock_key,key->ptr);
+}
+
+static subkeyClock *subkeyClockNew(size_t nsubkeys) {
+    uint32_t nbits = SUBKEY_CLOCK_MIN_BITS;
+    subkeyClock *clock;
+
+    while (nbits < nsubkeys && nbits < SUBKEY_CLOCK_MAX_BITS) nbits <<= 1;
+    clock = zcalloc(sizeof(subkeyClock)+nbits/8);
+    clock->nbits = nbits;
+    return clock;
+}
+
+subkeyClock *subkeyClockLookup(redisDb *db, robj *key) {
+    subkeyClocks *clocks = server.swap_subkey_clocks;
+    subkeyClock *clock;
+    sds clock_key;
+
+    if (clocks == NULL || !server.swap_evict_subkey_clock ||
+            dictSize(clocks->clocks) == 0) return NULL;
+    clock_key = subkeyClockEncodeKey(db,key);
+    clock = dictFetchValue(clocks->clocks,clock_key);
+    sdsfree(clock_key);
+    return clock;
+}
+
+/* Lookup clock of key, create one if key is big enough to be swapped out
+ * in steps. */
+subkeyClock *subkeyClockLookupOrCreate(redisDb *db, robj *key, size_t nsubkeys) {
+    subkeyClocks *clocks = server.swap_subkey_clocks;
+    subkeyClock *clock;
+    dictEntry *de;
+    sds clock_key;
+
+    if (clocks == NULL || !server.swap_evict_subkey_clock) return NULL;
+
+    clock_key = subkeyClockEncodeKey(db,key);
+    if ((clock = dictFetchValue(clocks->clocks,clock_key)) != NULL ||
+            nsubkeys < SUBKEY_CLOCK_MIN_SUBKEYS) {
+        sdsfree(clock_key);
+        return clock;
+    }
+
+    if (dictSize(clocks->clocks) >= SUBKEY_CLOCK_MAX_KEYS &&
+            (de = dictGetRandomKey(clocks->clocks)) != NULL) {
+        dictDelete(clocks->clocks,dictGetKey(de));
+        clocks->stat_dropped++;
+    }
+
+    clock = subkeyClockNew(nsubkeys);
+    dictAdd(clocks->clocks,clock_key,clock);
+    return clock;
+}
+
+static inline uint32_t subkeyClockSlot(subkeyClock *clock, robj *subkey) {
+    char buf[LONG_STR_SIZE];
+    const void *ptr;
+    size_t len;
+
+    if (sdsEncodedObject(subkey)) {
+        ptr = subkey->ptr;
+        len = sdslen(subkey->ptr);
+    } else {
+        len = ll2string(buf,sizeof(buf),(long)subkey->ptr);
+        ptr = buf;
+    }
+    return (uint32_t)dictGenHashFunction(ptr,len) & (clock->nbits-1);
+}
+
+void subkeyClockAccess(subkeyClock *clock, robj *subkey, int hit) {
+    uint32_t slot = subkeyClockSlot(clock,subkey);
+    clock->bits[slot>>3] |= 1<<(slot&7);
+    if (hit) {
+        clock->hits++;
+        server.swap_subkey_clocks->stat_hits++;
+    } else {
+        clock->misses++;
+        server.swap_subkey_clocks->stat_misses++;
+    }
+}
+
+/* Returns 1 if subkey recently accessed (and clears its bit, so that it is
+ * selected next time if not accessed again), consuming one of chances.
+ * Returns 0 once chances run out. */
+int subkeyClockSecondChance(subkeyClock *clock, robj *subkey, size_t *chances) {
+    uint32_t slot;
+
+    if (clock == NULL || *chances == 0) return 0;
+    slot = subkeyClockSlot(clock,subkey);
+    if (!(clock->bits[slot>>3] & (1<<(slot&7)))) return 0;
+    clock->bits[slot>>3] &= ~(1<<(slot&7));
+    (*chances)--;
+    server.swap_subkey_clocks->stat_second_chances++;
+    return 1;
+}
+
+sds genSubkeyClockInfo(subkeyClock *clock) {
+    long long total = clock->hits+clock->misses;
+    return sdscatprintf(sdsempty(),
+            "bits=%u,hits=%lld,misses=%lld,warm_hit_ratio=%.2f%%",
+            clock->nbits,clock->hits,clock->misses,
+            total ? (double)clock->hits*100/total : 0);
+}
+
+sds genSwapSubkeyClockInfoString(sds info) {
+    subkeyClocks *clocks = server.swap_subkey_clocks;
+    long long total;
+
+    if (clocks == NULL) return info;
+    total = clocks->stat_hits+clocks->stat_misses;
+    info = sdscatprintf(info,
+            "swap_subkey_clock:enabled=%d,keys=%lu,hits=%lld,misses=%lld,warm_hit_ratio=%.2f%%,second_chances=%lld,dropped=%lld\r\n",
+            server.swap_evict_subkey_clock,dictSize(clocks->clocks),
+            clocks->stat_hits,clocks->stat_misses,
+            total ? (double)clocks->stat_hits*100/total : 0,
+            clocks->stat_second_chances,clocks->stat_dropped);
+    return info;
+}
+
+void resetSwapSubkeyClockStats(void) {
+    subkeyClocks *clocks = server.swap_subkey_clocks;
+    if (clocks == NULL) return;
+    clocks->stat_hits = 0;
+    clocks->stat_misses = 0;
+    clocks->stat_second_chances = 0;
+    clocks->stat_dropped = 0;
+}
+
+#ifdef REDIS_TEST
+
+int swapSubkeyClockTest(int argc, char *argv[], int accurate) {
+    UNUSED(argc), UNUSED(argv), UNUSED(accurate);
+    int error = 0, i, skipped = 0;
+    int orig_enabled = server.swap_evict_subkey_clock;
+    subkeyClocks *orig_clocks = server.swap_subkey_clocks;
+    redisDb *db = server.db;
+    robj *key = createStringObject("clock-key",9);
+
+    server.swap_evict_subkey_clock = 1;
+    server.swap_subkey_clocks = subkeyClocksNew();
+
+    TEST("subkey clock - small key not tracked") {
+        test_assert(subkeyClockLookupOrCreate(db,key,SUBKEY_CLOCK_MIN_SUBKEYS-1) == NULL);
+        test_assert(subkeyClockLookup(db,key) == NULL);
+    }
+
+    TEST("subkey clock - second chance for accessed subkeys") {
+        subkeyClock *clock = subkeyClockLookupOrCreate(db,key,1000);
+        test_assert(clock != NULL && clock->nbits == 1024);
+        test_assert(subkeyClockLookup(db,key) == clock);
+
+        robj *hot = createStringObject("hot-field",9);
+        robj *cold = createStringObject("cold-field",10);
+        robj *intkey = createStringObjectFromLongLong(12345);
+        robj *strkey = createStringObject("12345",5);
+        subkeyClockAccess(clock,hot,1);
+        subkeyClockAccess(clock,strkey,0);
+        test_assert(clock->hits == 1 && clock->misses == 1);
+
+        size_t chances = 8;
+        if (subkeyClockSlot(clock,hot) != subkeyClockSlot(clock,cold))
+            test_assert(!subkeyClockSecondChance(clock,cold,&chances));
+        /* int encoded subkey hashes same as its string form */
+        test_assert(subkeyClockSecondChance(clock,intkey,&chances));
+        test_assert(!subkeyClockSecondChance(clock,intkey,&chances));
+        test_assert(subkeyClockSecondChance(clock,hot,&chances));
+        test_assert(!subkeyClockSecondChance(clock,hot,&chances));
+        test_assert(chances == 6);
+
+        /* no more second chance once chances run out. */
+        chances = 0;
+        subkeyClockAccess(clock,hot,1);
+        test_assert(!subkeyClockSecondChance(clock,hot,&chances));
+        decrRefCount(hot), decrRefCount(cold);
+        decrRefCount(intkey), decrRefCount(strkey);
+    }
+
+    TEST("subkey clock - tracked keys bounded") {
+        for (i = 0; i < SUBKEY_CLOCK_MAX_KEYS+16; i++) {
+            robj *k = createObject(OBJ_STRING,sdscatprintf(sdsempty(),"key-%d",i));
+            test_assert(subkeyClockLookupOrCreate(db,k,SUBKEY_CLOCK_MIN_SUBKEYS) != NULL);
+            decrRefCount(k);
+        }
+        test_assert(dictSize(server.swap_subkey_clocks->clocks) == SUBKEY_CLOCK_MAX_KEYS);
+        skipped = (int)server.swap_subkey_clocks->stat_dropped;
+        test_assert(skipped >= 17);
+    }
+
+    decrRefCount(key);
+    subkeyClocksFree(server.swap_subkey_clocks);
+    server.swap_subkey_clocks = orig_clocks;
+    server.swap_evict_subkey_clock = orig_enabled;
+    return error;
+}
+
+#endif
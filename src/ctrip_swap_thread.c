@@ -27,48 +27,257 @@
 
 #include "ctrip_swap.h"
 
+void swapRingInit(swapRing *ring, size_t size) {
+    serverAssert(size > 0 && (size & (size-1)) == 0);
+    ring->cells = zmalloc(sizeof(swapRingCell)*size);
+    ring->mask = size-1;
+    for (size_t i = 0; i < size; i++) {
+        atomicSet(ring->cells[i].seq,i);
+        ring->cells[i].data = NULL;
+    }
+    atomicSetWithSync(ring->enqueue_pos,0);
+    atomicSetWithSync(ring->dequeue_pos,0);
+}
+
+void swapRingDeinit(swapRing *ring) {
+    zfree(ring->cells);
+    ring->cells = NULL;
+}
+
+/* Returns -1 if ring is full. */
+int swapRingPush(swapRing *ring, void *data) {
+    swapRingCell *cell;
+    size_t pos, seq;
+    int success;
+
+    atomicGet(ring->enqueue_pos,pos);
+    while (1) {
+        cell = ring->cells + (pos & ring->mask);
+        atomicGetWithSync(cell->seq,seq);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            atomicCompareExchangeWithSync(ring->enqueue_pos,pos,pos+1,success);
+            if (success) break;
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            atomicGet(ring->enqueue_pos,pos);
+        }
+    }
+
+    cell->data = data;
+    atomicSetWithSync(cell->seq,pos+1);
+    return 0;
+}
+
+/* Returns NULL if ring is empty. */
+void *swapRingPop(swapRing *ring) {
+    swapRingCell *cell;
+    size_t pos, seq;
+    void *data;
+    int success;
+
+    atomicGet(ring->dequeue_pos,pos);
+    while (1) {
+        cell = ring->cells + (pos & ring->mask);
+        atomicGetWithSync(cell->seq,seq);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos+1);
+        if (diff == 0) {
+            atomicCompareExchangeWithSync(ring->dequeue_pos,pos,pos+1,success);
+            if (success) break;
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            atomicGet(ring->dequeue_pos,pos);
+        }
+    }
+
+    data = cell->data;
+    atomicSetWithSync(cell->seq,pos+ring->mask+1);
+    return data;
+}
+
+/* Approximate length, exact if there are no concurrent push & pop. */
+size_t swapRingLength(swapRing *ring) {
+    size_t enqueue_pos, dequeue_pos;
+    atomicGetWithSync(ring->dequeue_pos,dequeue_pos);
+    atomicGetWithSync(ring->enqueue_pos,enqueue_pos);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+}
+
+/* Only normal swap threads steal & get stolen, requests submitted to defer
+ * or util thread are expected to be executed by that thread in order. */
+static inline int swapThreadIsStealable(int idx) {
+    return idx < server.swap_threads_num;
+}
+
+static inline size_t swapThreadPriorityPendingLength(swapThread *thread,
+        int prio) {
+    size_t overflow_len;
+    atomicGetWithSync(thread->overflow_len[prio],overflow_len);
+    return swapRingLength(&thread->rings[prio]) + overflow_len;
+}
+
+static inline size_t swapThreadPendingLength(swapThread *thread) {
+    size_t length = 0;
+    for (int prio = 0; prio < SWAP_PRIORITY_COUNT; prio++)
+        length += swapThreadPriorityPendingLength(thread,prio);
+    return length;
+}
+
+static swapRequestBatch *swapThreadPopOverflow(swapThread *thread, int prio) {
+    swapRequestBatch *reqs = NULL;
+    size_t overflow_len;
+    listNode *ln;
+
+    atomicGetWithSync(thread->overflow_len[prio],overflow_len);
+    if (overflow_len == 0) return NULL;
+
+    pthread_mutex_lock(&thread->lock);
+    if ((ln = listFirst(thread->overflow_reqs[prio]))) {
+        reqs = listNodeValue(ln);
+        listDelNode(thread->overflow_reqs[prio],ln);
+        atomicDecr(thread->overflow_len[prio],1);
+    }
+    pthread_mutex_unlock(&thread->lock);
+
+    return reqs;
+}
+
+/* Ring first, then overflowed reqs (older reqs are in ring if overflow
+ * list not empty). */
+static swapRequestBatch *swapThreadPopPriority(swapThread *thread, int prio) {
+    swapRequestBatch *reqs;
+    if ((reqs = swapRingPop(&thread->rings[prio]))) return reqs;
+    return swapThreadPopOverflow(thread,prio);
+}
+
+/* Higher priority first, but a lower priority class that has been skipped
+ * swap-threads-starvation-limit times while pending is served next. */
+static swapRequestBatch *swapThreadPopOwn(swapThread *thread) {
+    swapRequestBatch *reqs;
+    int prio, p;
+
+    for (prio = SWAP_PRIORITY_COUNT-1; prio > 0; prio--) {
+        if (thread->skipped[prio] < server.swap_threads_starvation_limit)
+            continue;
+        thread->skipped[prio] = 0;
+        if ((reqs = swapThreadPopPriority(thread,prio))) {
+            atomicIncr(thread->prio_stats[prio].starvation_count,1);
+            return reqs;
+        }
+    }
+
+    for (prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+        if ((reqs = swapThreadPopPriority(thread,prio))) {
+            for (p = prio+1; p < SWAP_PRIORITY_COUNT; p++) {
+                if (swapThreadPriorityPendingLength(thread,p))
+                    thread->skipped[p]++;
+            }
+            return reqs;
+        }
+    }
+
+    return NULL;
+}
+
+static swapRequestBatch *swapThreadSteal(swapThread *thread) {
+    swapRequestBatch *reqs;
+    int i, prio;
+
+    if (!server.swap_threads_work_stealing ||
+            !swapThreadIsStealable(thread->id))
+        return NULL;
+
+    for (prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+        for (i = 1; i < server.swap_threads_num; i++) {
+            swapThread *victim = server.swap_threads +
+                (thread->id + i) % server.swap_threads_num;
+            if ((reqs = swapRingPop(&victim->rings[prio]))) {
+                atomicIncr(thread->stat_steal_count,1);
+                return reqs;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int swapThreadsHasStealableWork(swapThread *thread) {
+    if (!server.swap_threads_work_stealing ||
+            !swapThreadIsStealable(thread->id))
+        return 0;
+
+    for (int i = 0; i < server.swap_threads_num; i++) {
+        for (int prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+            if (swapRingLength(&server.swap_threads[i].rings[prio])) return 1;
+        }
+    }
+    return 0;
+}
+
+static swapRequestBatch *swapThreadNext(swapThread *thread) {
+    swapRequestBatch *reqs;
+
+    if ((reqs = swapThreadPopOwn(thread)) == NULL &&
+            (reqs = swapThreadSteal(thread)) == NULL)
+        return NULL;
+
+    swapThreadPriorityStat *stat = thread->prio_stats + reqs->priority;
+    atomicIncr(stat->count,1);
+    atomicIncr(stat->wait_us,(long long)elapsedUs(reqs->dispatch_timer));
+    return reqs;
+}
+
+static void swapThreadWait(swapThread *thread) {
+    pthread_mutex_lock(&thread->lock);
+    atomicSetWithSync(thread->sleeping,1);
+    /* dispatcher checks sleeping after push, so either we see the pushed
+     * reqs here or dispatcher sees sleeping and signals us. */
+    while (!swapThreadPendingLength(thread) &&
+            !swapThreadsHasStealableWork(thread)) {
+        pthread_cond_wait(&thread->cond, &thread->lock);
+    }
+    atomicSetWithSync(thread->sleeping,0);
+    pthread_mutex_unlock(&thread->lock);
+}
+
+static void swapThreadWakeup(swapThread *thread) {
+    int sleeping;
+    atomicGetWithSync(thread->sleeping,sleeping);
+    if (!sleeping) return;
+    pthread_mutex_lock(&thread->lock);
+    pthread_cond_signal(&thread->cond);
+    pthread_mutex_unlock(&thread->lock);
+}
+
 void *swapThreadMain (void *arg) {
     char thdname[16];
     swapThread *thread = arg;
+    swapRequestBatch *reqs;
 
     snprintf(thdname, sizeof(thdname), "swap_thd_%d", thread->id);
     redis_set_thread_title(thdname);
 #ifndef __APPLE__
     atomicIncr(server.swap_threads_initialized, 1);
 #endif
-    listIter li;
-    listNode *ln;
-    list *processing_reqs;
     while (1) {
-        pthread_mutex_lock(&thread->lock);
-        while (listLength(thread->pending_reqs) == 0)
-            pthread_cond_wait(&thread->cond, &thread->lock);
-
-        listRewind(thread->pending_reqs, &li);
-        processing_reqs = listCreate();
-        while ((ln = listNext(&li))) {
-            swapRequest *req = listNodeValue(ln);
-            listAddNodeHead(processing_reqs, req);
-            listDelNode(thread->pending_reqs, ln);
-        }
-        pthread_mutex_unlock(&thread->lock);
-
-        listRewind(processing_reqs, &li);
+        /* mark running before pop, so that swapThreadsDrained won't see
+         * an empty ring while reqs popped but not yet processed. */
         atomicSetWithSync(thread->is_running_rio, 1);
-        while ((ln = listNext(&li))) {
-            swapRequestBatch *reqs = listNodeValue(ln);
+        while ((reqs = swapThreadNext(thread))) {
             swapRequestBatchProcess(reqs);
         }
-
         atomicSetWithSync(thread->is_running_rio, 0);
-        listRelease(processing_reqs);
+
+        swapThreadWait(thread);
     }
 
     return NULL;
 }
 
 int swapThreadsInit() {
-    int i;
+    int i, prio;
     server.swap_defer_thread_idx = server.swap_threads_num;
     server.swap_util_thread_idx = server.swap_threads_num + 1;
     server.total_swap_threads_num = server.swap_threads_num + 2;
@@ -76,10 +285,22 @@ int swapThreadsInit() {
     for (i = 0; i < server.total_swap_threads_num; i++) {
         swapThread *thread = server.swap_threads+i;
         thread->id = i;
-        thread->pending_reqs = listCreate();
+        for (prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+            swapRingInit(&thread->rings[prio], SWAP_THREAD_RING_SIZE);
+            thread->overflow_reqs[prio] = listCreate();
+            atomicSetWithSync(thread->overflow_len[prio], 0);
+            thread->skipped[prio] = 0;
+        }
+        atomicSetWithSync(thread->sleeping, 0);
         atomicSetWithSync(thread->is_running_rio, 0);
         pthread_mutex_init(&thread->lock, NULL);
         pthread_cond_init(&thread->cond, NULL);
+    }
+    resetSwapThreadsStats();
+
+    /* threads steal from each other, start after all rings initialized. */
+    for (i = 0; i < server.total_swap_threads_num; i++) {
+        swapThread *thread = server.swap_threads+i;
         if (pthread_create(&thread->thread_id, NULL, swapThreadMain, thread)) {
             serverLog(LL_WARNING, "Fatal: create swap threads failed.");
             return -1;
@@ -93,7 +314,6 @@ void swapThreadsDeinit() {
     int i, err;
     for (i = 0; i < server.total_swap_threads_num; i++) {
         swapThread *thread = server.swap_threads+i;
-        listRelease(thread->pending_reqs);
         if (thread->thread_id == pthread_self()) continue;
         if (thread->thread_id && pthread_cancel(thread->thread_id) == 0) {
             if ((err = pthread_join(thread->thread_id, NULL)) != 0) {
@@ -104,6 +324,14 @@ void swapThreadsDeinit() {
             }
         }
     }
+    /* rings are shared by stealing threads, release after all joined. */
+    for (i = 0; i < server.total_swap_threads_num; i++) {
+        swapThread *thread = server.swap_threads+i;
+        for (int prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+            listRelease(thread->overflow_reqs[prio]);
+            swapRingDeinit(&thread->rings[prio]);
+        }
+    }
 }
 
 static inline int swapThreadsDistNext() {
@@ -114,17 +342,49 @@ static inline int swapThreadsDistNext() {
 }
 
 void swapThreadsDispatch(swapRequestBatch *reqs, int idx) {
-    if (idx == -1) {
+    size_t overflow_len;
+    int i, prio;
+
+    if (idx == -1 && server.swap_debug_dispatch_thread >= 0) {
+        /* overload one thread on purpose (e.g. to test work stealing). */
+        idx = server.swap_debug_dispatch_thread % server.swap_threads_num;
+    } else if (idx == -1) {
         idx = swapThreadsDistNext() % server.swap_threads_num;
     } else {
         serverAssert(idx < server.total_swap_threads_num);
     }
     swapRequestBatchDispatched(reqs);
     swapThread *t = server.swap_threads+idx;
-    pthread_mutex_lock(&t->lock);
-    listAddNodeTail(t->pending_reqs,reqs);
-    pthread_cond_signal(&t->cond);
-    pthread_mutex_unlock(&t->lock);
+    prio = reqs->priority;
+    elapsedStart(&reqs->dispatch_timer);
+
+    /* keep fifo: once overflowed, append to overflow list until drained. */
+    atomicGetWithSync(t->overflow_len[prio],overflow_len);
+    if (overflow_len || swapRingPush(&t->rings[prio],reqs)) {
+        pthread_mutex_lock(&t->lock);
+        listAddNodeTail(t->overflow_reqs[prio],reqs);
+        atomicIncr(t->overflow_len[prio],1);
+        pthread_mutex_unlock(&t->lock);
+        atomicIncr(t->stat_overflow_count,1);
+    }
+
+    int sleeping;
+    atomicGetWithSync(t->sleeping,sleeping);
+    if (sleeping) {
+        swapThreadWakeup(t);
+    } else if (server.swap_threads_work_stealing &&
+            swapThreadIsStealable(idx)) {
+        /* owner is busy, wakeup one idle thread to steal. */
+        for (i = 1; i < server.swap_threads_num; i++) {
+            swapThread *thief = server.swap_threads +
+                (idx + i) % server.swap_threads_num;
+            atomicGetWithSync(thief->sleeping,sleeping);
+            if (sleeping) {
+                swapThreadWakeup(thief);
+                break;
+            }
+        }
+    }
 }
 
 int swapThreadsDrained() {
@@ -132,16 +392,27 @@ int swapThreadsDrained() {
     int drained = 1, i;
     for (i = 0; i < server.total_swap_threads_num; i++) {
         rt = server.swap_threads+i;
-
-        pthread_mutex_lock(&rt->lock);
         unsigned long count = 0;
         atomicGetWithSync(rt->is_running_rio, count);
-        if (listLength(rt->pending_reqs) || count) drained = 0;
-        pthread_mutex_unlock(&rt->lock);
+        if (swapThreadPendingLength(rt) || count) drained = 0;
     }
     return drained;
 }
 
+void resetSwapThreadsStats() {
+    if (server.swap_threads == NULL) return;
+    for (int i = 0; i < server.total_swap_threads_num; i++) {
+        swapThread *thread = server.swap_threads+i;
+        atomicSet(thread->stat_steal_count, 0);
+        atomicSet(thread->stat_overflow_count, 0);
+        for (int prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+            atomicSet(thread->prio_stats[prio].count, 0);
+            atomicSet(thread->prio_stats[prio].wait_us, 0);
+            atomicSet(thread->prio_stats[prio].starvation_count, 0);
+        }
+    }
+}
+
 // utils task
 #define ROCKSDB_UTILS_TASK_DONE 0
 #define ROCKSDB_UTILS_TASK_DOING 1
@@ -195,25 +466,145 @@ int submitUtilTask(int type, void *arg, rocksdbUtilTaskCallback cb, void* pd, sd
     return 1;
 }
 
+/* Non-exclusive util task dispatched to any swap thread in parallel sync
+ * mode, so that heavy tasks could run in parallel (e.g. during loading),
+ * finished before parallelSyncDrain returns. */
+void submitParallelUtilTask(int type, void *arg, rocksdbUtilTaskCallback cb, void* pd) {
+    swapRequest *req = NULL;
+    rocksdbUtilTaskCtx *utilctx = NULL;
+
+    serverAssert(!isUtilTaskExclusive(type));
+
+    utilctx = zcalloc(sizeof(rocksdbUtilTaskCtx));
+    utilctx->type = type;
+    utilctx->argument = arg;
+    utilctx->result = NULL;
+    utilctx->finish_cb = cb;
+    utilctx->finish_pd = pd;
+
+    req = swapDataRequestNew(SWAP_UTILS,type,NULL,NULL,NULL,NULL,
+            rocksdbUtilTaskSwapFinished,utilctx,NULL);
+    submitSwapRequest(SWAP_MODE_PARALLEL_SYNC,req,-1);
+}
+
 sds genSwapThreadInfoString(sds info) {
-    size_t thread_depth = 0, async_depth;
+    size_t thread_depth = 0, thread_depth_max = 0, async_depth, depth;
+    long long steal_count = 0, overflow_count = 0, count;
+    int prio;
 
-    pthread_mutex_lock(&server.CQ->lock);
-    async_depth = listLength(server.CQ->complete_queue);
-    pthread_mutex_unlock(&server.CQ->lock);
+    atomicGet(server.CQ->length,async_depth);
 
     for (int i = 0; i < server.swap_threads_num; i++) {
         swapThread *thread = server.swap_threads+i;
-        pthread_mutex_lock(&thread->lock);
-        thread_depth += listLength(thread->pending_reqs);
-        pthread_mutex_unlock(&thread->lock);
+        depth = swapThreadPendingLength(thread);
+        thread_depth += depth;
+        if (depth > thread_depth_max) thread_depth_max = depth;
     }
     thread_depth /= server.swap_threads_num;
 
+    for (int i = 0; i < server.total_swap_threads_num; i++) {
+        swapThread *thread = server.swap_threads+i;
+        atomicGet(thread->stat_steal_count,count);
+        steal_count += count;
+        atomicGet(thread->stat_overflow_count,count);
+        overflow_count += count;
+    }
+
     info = sdscatprintf(info,
             "swap_thread_queue_depth:%lu\r\n"
+            "swap_thread_queue_depth_max:%lu\r\n"
+            "swap_thread_steals:%lld\r\n"
+            "swap_thread_ring_overflows:%lld\r\n"
             "swap_async_queue_depth:%lu\r\n",
-            thread_depth, async_depth);
+            thread_depth, thread_depth_max, steal_count, overflow_count,
+            async_depth);
+
+    for (prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+        long long batches = 0, wait_us = 0, starvation_count = 0;
+        depth = 0;
+        for (int i = 0; i < server.total_swap_threads_num; i++) {
+            swapThread *thread = server.swap_threads+i;
+            swapThreadPriorityStat *stat = thread->prio_stats+prio;
+            depth += swapThreadPriorityPendingLength(thread,prio);
+            atomicGet(stat->count,count);
+            batches += count;
+            atomicGet(stat->wait_us,count);
+            wait_us += count;
+            atomicGet(stat->starvation_count,count);
+            starvation_count += count;
+        }
+        info = sdscatprintf(info,
+                "swap_thread_priority_%s:queue_depth=%lu,batches=%lld,wait_us=%lld,avg_wait_us=%lld,starvation=%lld\r\n",
+                swapPriorityName(prio),depth,batches,wait_us,
+                batches > 0 ? wait_us/batches : 0,starvation_count);
+    }
+
+    info = genAsyncCompleteQueueInfoString(info);
 
     return info;
 }
+
+#ifdef REDIS_TEST
+
+int swapThreadTest(int argc, char *argv[], int accurate) {
+    UNUSED(argc), UNUSED(argv), UNUSED(accurate);
+    int error = 0;
+
+    TEST("thread - ring push & pop") {
+        swapRing ring;
+        long i;
+        swapRingInit(&ring,4);
+        test_assert(swapRingPop(&ring) == NULL);
+        for (i = 1; i <= 4; i++) test_assert(!swapRingPush(&ring,(void*)i));
+        test_assert(swapRingLength(&ring) == 4);
+        test_assert(swapRingPush(&ring,(void*)5L) == -1);
+        test_assert(swapRingPop(&ring) == (void*)1L);
+        test_assert(!swapRingPush(&ring,(void*)5L));
+        for (i = 2; i <= 5; i++) test_assert(swapRingPop(&ring) == (void*)i);
+        test_assert(swapRingPop(&ring) == NULL);
+        test_assert(swapRingLength(&ring) == 0);
+        swapRingDeinit(&ring);
+    }
+
+    TEST("thread - priority pop with starvation protection") {
+        swapThread thread = {0};
+        swapRequestBatch *high[3], *low[2];
+        int i, prio, limit = server.swap_threads_starvation_limit;
+
+        server.swap_threads_starvation_limit = 2;
+        for (prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+            swapRingInit(&thread.rings[prio],8);
+            thread.overflow_reqs[prio] = listCreate();
+        }
+        for (i = 0; i < 3; i++) {
+            high[i] = swapRequestBatchNew();
+            high[i]->priority = SWAP_PRIORITY_HIGH;
+            swapRingPush(&thread.rings[SWAP_PRIORITY_HIGH],high[i]);
+        }
+        for (i = 0; i < 2; i++) {
+            low[i] = swapRequestBatchNew();
+            low[i]->priority = SWAP_PRIORITY_LOW;
+            swapRingPush(&thread.rings[SWAP_PRIORITY_LOW],low[i]);
+        }
+
+        test_assert(swapThreadPopOwn(&thread) == high[0]);
+        test_assert(swapThreadPopOwn(&thread) == high[1]);
+        test_assert(swapThreadPopOwn(&thread) == low[0]);
+        test_assert(thread.prio_stats[SWAP_PRIORITY_LOW].starvation_count == 1);
+        test_assert(swapThreadPopOwn(&thread) == high[2]);
+        test_assert(swapThreadPopOwn(&thread) == low[1]);
+        test_assert(swapThreadPopOwn(&thread) == NULL);
+
+        for (i = 0; i < 3; i++) swapRequestBatchFree(high[i]);
+        for (i = 0; i < 2; i++) swapRequestBatchFree(low[i]);
+        for (prio = 0; prio < SWAP_PRIORITY_COUNT; prio++) {
+            swapRingDeinit(&thread.rings[prio]);
+            listRelease(thread.overflow_reqs[prio]);
+        }
+        server.swap_threads_starvation_limit = limit;
+    }
+
+    return error;
+}
+
+#endif
@@ -31,6 +31,7 @@
 #include "endianconv.h"
 #include <dirent.h>
 #include <sys/stat.h>
+#include <arpa/inet.h>
 
 /* See keyIsExpired for more details */
 size_t ctripDbSize(redisDb *db) {
@@ -150,17 +151,142 @@ int rocksDecodeMetaVal(const char *raw, size_t rawlen, int *pswap_type,
 
 typedef unsigned int keylen_t;
 
+/* Key encoding v2 (see swap-key-encoding-version): dbid is encoded big
+ * endian and key is escaped (0x00 => 0x00 0xff) and terminated by 0x00 0x01,
+ * so that raw keys sort the same as (dbid,key) and keys sharing a common
+ * prefix are contiguous in rocksdb. v1 encodes host order dbid and keylen,
+ * which groups keys by length rather than by content. v3 is v2 with big
+ * endian cluster slot of key following dbid, so that keys of one slot are
+ * contiguous instead. */
+#define ROCKS_KEY_ESCAPE_BYTE 0x00
+#define ROCKS_KEY_ESCAPED_BYTE 0xff
+#define ROCKS_KEY_TERMINATOR_BYTE 0x01
+#define ROCKS_KEY_V2_DBID_LEN sizeof(uint32_t)
+#define ROCKS_KEY_V2_TERMINATOR_LEN 2
+#define ROCKS_KEY_V3_SLOT_LEN sizeof(uint16_t)
+
+static inline int rocksKeyEncoding(void) {
+    if (server.swap_key_encoding == SWAP_KEY_ENCODING_V2 ||
+            server.swap_key_encoding == SWAP_KEY_ENCODING_V3)
+        return server.swap_key_encoding;
+    return SWAP_KEY_ENCODING_V1;
+}
+
+/* Length of v2/v3 header before escaped key. */
+static inline size_t rocksKeyHeaderLen(int encoding) {
+    return ROCKS_KEY_V2_DBID_LEN +
+        (encoding == SWAP_KEY_ENCODING_V3 ? ROCKS_KEY_V3_SLOT_LEN : 0);
+}
+
+static size_t rocksKeyPrefixEncodedLen(int encoding, const char *key,
+        size_t keylen) {
+    size_t i, len;
+    if (encoding != SWAP_KEY_ENCODING_V1) {
+        len = rocksKeyHeaderLen(encoding)+keylen+ROCKS_KEY_V2_TERMINATOR_LEN;
+        for (i = 0; i < keylen; i++) {
+            if (key[i] == ROCKS_KEY_ESCAPE_BYTE) len++;
+        }
+    } else {
+        len = sizeof(int)+sizeof(keylen_t)+keylen;
+    }
+    return len;
+}
+
+/* Encode (dbid,key) prefix shared by meta, data and score keys, returns
+ * pointer past the encoded prefix. */
+static char *rocksEncodeKeyPrefix(int encoding, char *ptr, int dbid,
+        const char *key, size_t keylen_) {
+    size_t i;
+    if (encoding != SWAP_KEY_ENCODING_V1) {
+        uint32_t bedbid = htonl((uint32_t)dbid);
+        memcpy(ptr, &bedbid, sizeof(bedbid)), ptr += sizeof(bedbid);
+        if (encoding == SWAP_KEY_ENCODING_V3) {
+            uint16_t beslot = htons((uint16_t)keyHashSlot((char*)key,(int)keylen_));
+            memcpy(ptr, &beslot, sizeof(beslot)), ptr += sizeof(beslot);
+        }
+        for (i = 0; i < keylen_; i++) {
+            *ptr++ = key[i];
+            if (key[i] == ROCKS_KEY_ESCAPE_BYTE)
+                *ptr++ = (char)ROCKS_KEY_ESCAPED_BYTE;
+        }
+        *ptr++ = ROCKS_KEY_ESCAPE_BYTE;
+        *ptr++ = ROCKS_KEY_TERMINATOR_BYTE;
+    } else {
+        keylen_t keylen = keylen_;
+        memcpy(ptr, &dbid, sizeof(dbid)), ptr += sizeof(dbid);
+        memcpy(ptr, &keylen, sizeof(keylen_t)), ptr += sizeof(keylen_t);
+        memcpy(ptr, key, keylen), ptr += keylen;
+    }
+    return ptr;
+}
+
+/* Escaped keys are decoded into thread local buffer: decoded key is valid
+ * until next decode of the same thread, callers copy it right away. */
+static __thread char *rocks_key_unescape_buf;
+static __thread size_t rocks_key_unescape_buflen;
+
+/* Decode (dbid,key) prefix, *prefixlen set to encoded length of prefix.
+ * Returns -1 if raw is not a valid prefix. */
+static int rocksDecodeKeyPrefix(int encoding, const char *raw, size_t rawlen,
+        int *dbid, const char **key, size_t *keylen, size_t *prefixlen) {
+    if (encoding != SWAP_KEY_ENCODING_V1) {
+        uint32_t bedbid;
+        size_t i, escaped = 0, enclen, hdrlen = rocksKeyHeaderLen(encoding);
+        const char *enc;
+
+        if (rawlen < hdrlen+ROCKS_KEY_V2_TERMINATOR_LEN)
+            return -1;
+        memcpy(&bedbid, raw, sizeof(bedbid));
+        if (dbid) *dbid = (int)ntohl(bedbid);
+        for (i = hdrlen; i+1 < rawlen; i++) {
+            if (raw[i] != ROCKS_KEY_ESCAPE_BYTE) continue;
+            if ((uint8_t)raw[i+1] == ROCKS_KEY_TERMINATOR_BYTE) break;
+            if ((uint8_t)raw[i+1] != ROCKS_KEY_ESCAPED_BYTE) return -1;
+            escaped++, i++;
+        }
+        if (i+1 >= rawlen) return -1;
+
+        enc = raw+hdrlen;
+        enclen = i-hdrlen;
+        if (keylen) *keylen = enclen-escaped;
+        if (key && escaped == 0) {
+            *key = enc;
+        } else if (key) {
+            size_t j, k = 0;
+            if (rocks_key_unescape_buflen < enclen) {
+                rocks_key_unescape_buf = zrealloc(rocks_key_unescape_buf,enclen);
+                rocks_key_unescape_buflen = enclen;
+            }
+            for (j = 0; j < enclen; j++) {
+                rocks_key_unescape_buf[k++] = enc[j];
+                if (enc[j] == ROCKS_KEY_ESCAPE_BYTE) j++;
+            }
+            *key = rocks_key_unescape_buf;
+        }
+        if (prefixlen) *prefixlen = i+ROCKS_KEY_V2_TERMINATOR_LEN;
+    } else {
+        keylen_t keylen_;
+        if (rawlen < sizeof(int)+sizeof(keylen_t)) return -1;
+        if (dbid) memcpy(dbid, raw, sizeof(int));
+        memcpy(&keylen_, raw+sizeof(int), sizeof(keylen_t));
+        if (keylen) *keylen = keylen_;
+        if (key) *key = raw+sizeof(int)+sizeof(keylen_t);
+        if (rawlen-sizeof(int)-sizeof(keylen_t) < keylen_) return -1;
+        if (prefixlen) *prefixlen = sizeof(int)+sizeof(keylen_t)+keylen_;
+    }
+    return 0;
+}
+
 static sds _rocksEncodeDataKey(int dbid, sds key, uint64_t version,
         uint8_t subkeyflag, sds subkey) {
-    keylen_t keylen = key ? sdslen(key) : 0;
+    int encoding = rocksKeyEncoding();
+    size_t keylen = key ? sdslen(key) : 0;
     keylen_t subkeylen = subkey ? sdslen(subkey) : 0;
     uint64_t encoded_version = rocksEncodeVersion(version);
-    size_t rawkeylen = sizeof(dbid)+sizeof(keylen)+keylen+
+    size_t rawkeylen = rocksKeyPrefixEncodedLen(encoding,key,keylen)+
         sizeof(encoded_version)+1+subkeylen;
     sds rawkey = sdsnewlen(SDS_NOINIT,rawkeylen), ptr = rawkey;
-    memcpy(ptr, &dbid, sizeof(dbid)), ptr += sizeof(dbid);
-    memcpy(ptr, &keylen, sizeof(keylen_t)), ptr += sizeof(keylen_t);
-    memcpy(ptr, key, keylen), ptr += keylen;
+    ptr = rocksEncodeKeyPrefix(encoding,ptr,dbid,key,keylen);
     memcpy(ptr, &encoded_version, sizeof(encoded_version));
     ptr += sizeof(encoded_version);
     ptr[0] = subkeyflag, ptr++;
@@ -188,7 +314,12 @@ sds rocksEncodeDataRangeEndKey(redisDb *db, sds key, uint64_t version) {
 
 sds rocksEncodeDbRangeStartKey(int dbid) {
     sds rawkey = sdsnewlen(SDS_NOINIT,sizeof(dbid));
-    memcpy(rawkey, &dbid, sizeof(dbid));
+    if (rocksKeyEncoding() != SWAP_KEY_ENCODING_V1) {
+        uint32_t bedbid = htonl((uint32_t)dbid);
+        memcpy(rawkey, &bedbid, sizeof(bedbid));
+    } else {
+        memcpy(rawkey, &dbid, sizeof(dbid));
+    }
     return rawkey;
 }
 
@@ -196,23 +327,74 @@ sds rocksEncodeDbRangeEndKey(int dbid) {
     return rocksEncodeDbRangeStartKey(dbid+1);
 }
 
+/* Range [start,end) of meta keys (and data keys) whose key starts with
+ * prefix, only available with key encoding v2. Returns -1 if not available. */
+int rocksEncodeKeyPrefixRange(int dbid, const char *prefix, size_t prefixlen,
+        sds *start, sds *end) {
+    size_t enclen;
+    if (rocksKeyEncoding() != SWAP_KEY_ENCODING_V2) return -1;
+    /* encoded prefix without terminator */
+    enclen = rocksKeyPrefixEncodedLen(SWAP_KEY_ENCODING_V2,prefix,prefixlen)-
+        ROCKS_KEY_V2_TERMINATOR_LEN;
+    *start = sdsnewlen(SDS_NOINIT,enclen+ROCKS_KEY_V2_TERMINATOR_LEN);
+    rocksEncodeKeyPrefix(SWAP_KEY_ENCODING_V2,*start,dbid,prefix,prefixlen);
+    sdssetlen(*start,enclen);
+    *end = rocksEncodePrefixSuccessor(*start,enclen);
+    if (*end == NULL) *end = rocksEncodeDbRangeEndKey(dbid);
+    return 0;
+}
+
+static sds rocksEncodeSlotRangeKey(int dbid, int slot) {
+    uint32_t bedbid = htonl((uint32_t)dbid);
+    uint16_t beslot = htons((uint16_t)slot);
+    sds rawkey = sdsnewlen(SDS_NOINIT,sizeof(bedbid)+sizeof(beslot));
+    memcpy(rawkey, &bedbid, sizeof(bedbid));
+    memcpy(rawkey+sizeof(bedbid), &beslot, sizeof(beslot));
+    return rawkey;
+}
+
+/* Range [start,end) of meta keys (and data keys) of cluster slot, only
+ * available with key encoding v3. Returns -1 if not available. */
+int rocksEncodeSlotRange(int dbid, int slot, sds *start, sds *end) {
+    if (rocksKeyEncoding() != SWAP_KEY_ENCODING_V3) return -1;
+    *start = rocksEncodeSlotRangeKey(dbid,slot);
+    *end = rocksEncodeSlotRangeKey(dbid,slot+1);
+    return 0;
+}
+
+/* Data & score keys of the same key version share the (dbid,keylen,key,version)
+ * prefix, returns 0 if raw is not a data/score key (e.g. db range key). */
+size_t rocksDataKeyPrefixLen(const char *raw, size_t rawlen) {
+    size_t prefixlen;
+    if (raw == NULL || rocksDecodeKeyPrefix(rocksKeyEncoding(),raw,rawlen,
+                NULL,NULL,NULL,&prefixlen)) return 0;
+    prefixlen += sizeof(uint64_t);
+    return rawlen >= prefixlen ? prefixlen : 0;
+}
+
+/* Smallest key greater than all keys prefixed by prefix, returns NULL if
+ * there is no such key (prefix is all 0xff). */
+sds rocksEncodePrefixSuccessor(const char *prefix, size_t prefixlen) {
+    sds successor;
+    while (prefixlen > 0 && (unsigned char)prefix[prefixlen-1] == 0xff)
+        prefixlen--;
+    if (prefixlen == 0) return NULL;
+    successor = sdsnewlen(prefix,prefixlen);
+    successor[prefixlen-1]++;
+    return successor;
+}
+
 int rocksDecodeDataKey(const char *raw, size_t rawlen, int *dbid,
         const char **key, size_t *keylen, uint64_t *version,
         const char **subkey, size_t *subkeylen) {
-    keylen_t keylen_;
     uint64_t encoded_version;
-    if (raw == NULL || rawlen < sizeof(int)+sizeof(keylen_t)+sizeof(encoded_version)+1) return -1;
-    if (dbid) *dbid = *(int*)raw;
-    raw += sizeof(int), rawlen -= sizeof(int);
-    keylen_ = *(keylen_t*)raw;
-    if (keylen) *keylen = keylen_;
-    raw += sizeof(keylen_t), rawlen -= sizeof(keylen_t);
-    if (key) *key = raw;
-    if (rawlen < keylen_) return -1;
-    raw += keylen_, rawlen -= keylen_;
-    if (rawlen < sizeof(encoded_version)) return -1;
+    size_t prefixlen;
+    if (raw == NULL || rocksDecodeKeyPrefix(rocksKeyEncoding(),raw,rawlen,
+                dbid,key,keylen,&prefixlen)) return -1;
+    raw += prefixlen, rawlen -= prefixlen;
+    if (rawlen < sizeof(encoded_version)+1) return -1;
     if (version) {
-        encoded_version = *(uint64_t*)raw;
+        memcpy(&encoded_version, raw, sizeof(encoded_version));
         *version = rocksDecodeVersion(encoded_version);
     }
     raw += sizeof(encoded_version), rawlen -= sizeof(encoded_version);
@@ -225,13 +407,11 @@ int rocksDecodeDataKey(const char *raw, size_t rawlen, int *dbid,
 
 /* Note that metakey MUST be prefix of datakeys, rdb save key switch detection
  * relay on that assumption. */
-sds encodeMetaKey(int dbid, const char* key, size_t keylen_) {
-    keylen_t keylen = keylen_;
-    size_t rawkeylen = sizeof(dbid)+sizeof(keylen)+keylen;
-    sds rawkey = sdsnewlen(SDS_NOINIT,rawkeylen), ptr = rawkey;
-    memcpy(ptr, &dbid, sizeof(dbid)), ptr += sizeof(dbid);
-    memcpy(ptr, &keylen, sizeof(keylen_t)), ptr += sizeof(keylen_t);
-    memcpy(ptr, key, keylen), ptr += keylen;
+sds encodeMetaKey(int dbid, const char* key, size_t keylen) {
+    int encoding = rocksKeyEncoding();
+    size_t rawkeylen = rocksKeyPrefixEncodedLen(encoding,key,keylen);
+    sds rawkey = sdsnewlen(SDS_NOINIT,rawkeylen);
+    rocksEncodeKeyPrefix(encoding,rawkey,dbid,key,keylen);
     return rawkey;
 }
 
@@ -241,18 +421,60 @@ sds rocksEncodeMetaKey(redisDb *db, sds key) {
 
 int rocksDecodeMetaKey(const char *raw, size_t rawlen, int *dbid,
         const char **key, size_t *keylen) {
-    keylen_t keylen_;
-    if (raw == NULL || rawlen < sizeof(int)+sizeof(keylen_t)) return -1;
-    if (dbid) *dbid = *(int*)raw;
-    raw += sizeof(int), rawlen -= sizeof(int);
-    keylen_ = *(keylen_t*)raw;
-    if (keylen) *keylen = keylen_;
-    raw += sizeof(keylen_t), rawlen -= sizeof(keylen_t);
+    if (raw == NULL) return -1;
+    return rocksDecodeKeyPrefix(rocksKeyEncoding(),raw,rawlen,dbid,key,
+            keylen,NULL);
+}
+
+/* Expire index key: (dbid,expire,key), dbid encoded as db range key so that
+ * flushdb deletes index of db too, expire in BE order so that index of one
+ * db is ordered by expire time. key is omitted (NULL) for range keys. */
+sds rocksEncodeExpireIndexKey(int dbid, long long expire, const char *key,
+        size_t keylen) {
+    uint64_t encoded_expire = htonu64((uint64_t)expire);
+    sds rawkey = rocksEncodeDbRangeStartKey(dbid);
+    rawkey = sdscatlen(rawkey,&encoded_expire,sizeof(encoded_expire));
+    if (key) rawkey = sdscatlen(rawkey,key,keylen);
+    return rawkey;
+}
+
+int rocksDecodeExpireIndexKey(const char *raw, size_t rawlen, int *dbid,
+        long long *expire, const char **key, size_t *keylen) {
+    uint32_t encoded_dbid;
+    uint64_t encoded_expire;
+
+    if (raw == NULL || rawlen < sizeof(encoded_dbid)+sizeof(encoded_expire))
+        return -1;
+    memcpy(&encoded_dbid,raw,sizeof(encoded_dbid));
+    raw += sizeof(encoded_dbid), rawlen -= sizeof(encoded_dbid);
+    if (dbid) {
+        *dbid = rocksKeyEncoding() != SWAP_KEY_ENCODING_V1 ?
+            (int)ntohl(encoded_dbid) : (int)encoded_dbid;
+    }
+    memcpy(&encoded_expire,raw,sizeof(encoded_expire));
+    raw += sizeof(encoded_expire), rawlen -= sizeof(encoded_expire);
+    if (expire) *expire = (long long)ntohu64(encoded_expire);
     if (key) *key = raw;
-    if (rawlen < keylen_) return -1;
+    if (keylen) *keylen = rawlen;
     return 0;
 }
 
+/* Re-encode raw meta/data/score key from one key encoding to another, tail
+ * after (dbid,key) prefix is copied as is. Returns NULL if raw malformed. */
+sds rocksConvertKeyEncoding(const char *raw, size_t rawlen, int from, int to) {
+    int dbid;
+    const char *key;
+    size_t keylen, prefixlen, tailen;
+    sds rawkey;
+
+    if (rocksDecodeKeyPrefix(from,raw,rawlen,&dbid,&key,&keylen,&prefixlen))
+        return NULL;
+    tailen = rawlen-prefixlen;
+    rawkey = sdsnewlen(SDS_NOINIT,rocksKeyPrefixEncodedLen(to,key,keylen)+tailen);
+    memcpy(rocksEncodeKeyPrefix(to,rawkey,dbid,key,keylen),raw+prefixlen,tailen);
+    return rawkey;
+}
+
 sds rocksEncodeValRdb(robj *value) {
     rio sdsrdb;
     rioInitWithBuffer(&sdsrdb,sdsempty());
@@ -377,9 +599,10 @@ int decodeDouble(const char* val, double* score) {
 
 sds _encodeScoreKey(int dbid, sds key, uint64_t version, uint8_t subkeyflag,
         double score, sds subkey) {
+    int encoding = rocksKeyEncoding();
     uint64_t encoded_version = rocksEncodeVersion(version);
-    keylen_t keylen = key ? sdslen(key) : 0;
-    keylen_t scoresubkeylen, rawkeylen;
+    size_t keylen = key ? sdslen(key) : 0;
+    size_t scoresubkeylen, rawkeylen;
     sds rawkey, ptr;
 
     if (subkeyflag == ROCKS_KEY_FLAG_SUBKEY) {
@@ -390,19 +613,18 @@ sds _encodeScoreKey(int dbid, sds key, uint64_t version, uint8_t subkeyflag,
         scoresubkeylen = 0;
     }
 
-    rawkeylen = sizeof(dbid)+sizeof(keylen)+keylen+sizeof(version)+1+scoresubkeylen;
+    rawkeylen = rocksKeyPrefixEncodedLen(encoding,key,keylen)+
+        sizeof(version)+1+scoresubkeylen;
     rawkey = sdsnewlen(SDS_NOINIT,rawkeylen), ptr = rawkey;
 
-    memcpy(ptr, &dbid, sizeof(dbid)), ptr += sizeof(dbid);
-    memcpy(ptr, &keylen, sizeof(keylen_t)), ptr += sizeof(keylen_t);
-    memcpy(ptr, key, keylen), ptr += keylen;
+    ptr = rocksEncodeKeyPrefix(encoding,ptr,dbid,key,keylen);
     memcpy(ptr, &encoded_version, sizeof(encoded_version));
     ptr += sizeof(encoded_version);
     ptr[0] = subkeyflag, ptr++;
 
     if (subkeyflag == ROCKS_KEY_FLAG_SUBKEY) {
         ptr += encodeDouble(ptr,score);
-        memcpy(ptr,subkey,sdslen(subkey)), ptr += scoresubkeylen;
+        memcpy(ptr,subkey,sdslen(subkey)), ptr += sdslen(subkey);
     }
 
     return rawkey;
@@ -424,27 +646,25 @@ sds encodeScoreKey(redisDb* db, sds key, uint64_t version, double score, sds sub
     }
 }
 
-int decodeScoreKey(const char* raw, int rawlen, int* dbid, const char** key,
+int decodeScoreKey(const char* raw, int rawlen_, int* dbid, const char** key,
         size_t* keylen, uint64_t *version, double* score, const char** subkey,
         size_t* subkeylen) {
-    keylen_t keylen_;
-    if (raw == NULL || rawlen < (int)(sizeof(int)+sizeof(keylen_t)+sizeof(uint64_t)+1+sizeOfDouble)) return -1;
-    if (dbid) *dbid = *(int*)raw;
-    raw += sizeof(int), rawlen -= sizeof(int);
-    keylen_ = *(keylen_t*)raw;
-    if (keylen) *keylen = keylen_;
-    raw += sizeof(keylen_t), rawlen -= sizeof(keylen_t);
-    if (key) *key = raw;
-    if (rawlen < (int)keylen_) return -1;
-    raw += keylen_, rawlen -= keylen_;
+    size_t rawlen = rawlen_, prefixlen;
+    if (raw == NULL || rawlen_ < 0 ||
+            rocksDecodeKeyPrefix(rocksKeyEncoding(),raw,rawlen,dbid,key,
+                keylen,&prefixlen)) return -1;
+    raw += prefixlen, rawlen -= prefixlen;
+    if (rawlen < sizeof(uint64_t)+1) return -1;
     if (version) {
-        uint64_t encoded_version = *(uint64_t*)raw;
+        uint64_t encoded_version;
+        memcpy(&encoded_version, raw, sizeof(encoded_version));
         *version = rocksDecodeVersion(encoded_version);
     }
     raw += sizeof(uint64_t), rawlen -= sizeof(uint64_t);
     uint8_t subkeyflag = raw[0];
     raw++, rawlen--;
     if (subkeyflag == ROCKS_KEY_FLAG_SUBKEY) {
+        if (rawlen < sizeOfDouble) return -1;
         int double_offset = decodeDouble(raw, score);
         raw += double_offset;
         rawlen -= double_offset;
@@ -673,6 +893,32 @@ int swapUtilTest(int argc, char **argv, int accurate) {
         sdsfree(empty);
     }
 
+    TEST("util - data key prefix & prefix successor") {
+        sds key = sdsnew("key1"), f1 = sdsnew("f1"), successor;
+        uint64_t V = 0x12345678;
+        sds start_key = rocksEncodeDataRangeStartKey(db,key,V);
+        sds end_key = rocksEncodeDataRangeEndKey(db,key,V);
+        sds data_key = rocksEncodeDataKey(db,key,V,f1);
+        size_t prefixlen = rocksDataKeyPrefixLen(data_key,sdslen(data_key));
+
+        test_assert(prefixlen == sizeof(int)+sizeof(keylen_t)+sdslen(key)+sizeof(uint64_t));
+        test_assert(prefixlen == rocksDataKeyPrefixLen(start_key,sdslen(start_key)));
+        test_assert(prefixlen == rocksDataKeyPrefixLen(end_key,sdslen(end_key)));
+        test_assert(!memcmp(start_key,end_key,prefixlen));
+        test_assert(rocksDataKeyPrefixLen("ab",2) == 0);
+
+        successor = rocksEncodePrefixSuccessor(data_key,sdslen(data_key));
+        test_assert(sdscmp(successor,data_key) > 0);
+        sdsfree(successor);
+        successor = rocksEncodePrefixSuccessor("a\xff\xff",3);
+        test_assert(sdslen(successor) == 1 && successor[0] == 'b');
+        sdsfree(successor);
+        test_assert(rocksEncodePrefixSuccessor("\xff\xff",2) == NULL);
+
+        sdsfree(key), sdsfree(f1), sdsfree(start_key), sdsfree(end_key);
+        sdsfree(data_key);
+    }
+
     TEST("util - encode & decode meta") {
         sds empty = sdsempty(), rocksKey, rocksVal;
         sds key = sdsnew("key1");
@@ -745,6 +991,122 @@ int swapUtilTest(int argc, char **argv, int accurate) {
         sdsfree(empty), sdsfree(subkey), sdsfree(key);
     }
 
+    TEST("util - key encoding v2 roundtrip & order") {
+        int orig_encoding = server.swap_key_encoding, dbId;
+        sds a = sdsnew("a"), ab = sdsnew("ab"), b = sdsnew("b");
+        sds nul = sdsnewlen("a\0\xff\0",4), f1 = sdsnew("f1"), empty = sdsempty();
+        sds ka, kab, kb, knul, kdata, kscore, kmeta, start, end, v1key, v2key;
+        const char *keystr, *subkeystr;
+        size_t klen, slen;
+        uint64_t version, V = 0x12345678;
+        double score;
+
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V2;
+
+        /* meta keys sort by (dbid,key) */
+        ka = rocksEncodeMetaKey(db,a), kab = rocksEncodeMetaKey(db,ab);
+        kb = rocksEncodeMetaKey(db,b), knul = rocksEncodeMetaKey(db,nul);
+        test_assert(sdscmp(ka,knul) < 0 && sdscmp(knul,kab) < 0);
+        test_assert(sdscmp(kab,kb) < 0);
+        start = rocksEncodeDbRangeStartKey(db->id);
+        end = rocksEncodeDbRangeEndKey(db->id);
+        test_assert(sdscmp(start,ka) < 0 && sdscmp(kb,end) < 0);
+        sdsfree(start), sdsfree(end);
+
+        /* key with NUL bytes decoded */
+        test_assert(!rocksDecodeMetaKey(knul,sdslen(knul),&dbId,&keystr,&klen));
+        test_assert(dbId == db->id && klen == 4 && !memcmp(keystr,nul,4));
+
+        /* all data keys of a sort before keys of ab */
+        kdata = rocksEncodeDataKey(db,a,V,f1);
+        test_assert(!memcmp(ka,kdata,sdslen(ka)));
+        test_assert(sdscmp(kdata,knul) < 0);
+        test_assert(!rocksDecodeDataKey(kdata,sdslen(kdata),&dbId,&keystr,&klen,&version,&subkeystr,&slen));
+        test_assert(klen == 1 && keystr[0] == 'a' && version == V);
+        test_assert(slen == 2 && !memcmp(subkeystr,"f1",2));
+        test_assert(rocksDataKeyPrefixLen(kdata,sdslen(kdata)) == sdslen(ka)+sizeof(uint64_t));
+        sdsfree(kdata);
+
+        kscore = encodeScoreKey(db,nul,V,0.5,empty);
+        test_assert(!decodeScoreKey(kscore,sdslen(kscore),&dbId,&keystr,&klen,&version,&score,&subkeystr,&slen));
+        test_assert(klen == 4 && !memcmp(keystr,nul,4) && score == 0.5 && slen == 0);
+
+        /* prefix range covers keys starting with prefix only */
+        test_assert(!rocksEncodeKeyPrefixRange(db->id,"a",1,&start,&end));
+        test_assert(sdscmp(start,ka) <= 0 && sdscmp(kab,end) < 0);
+        test_assert(sdscmp(kscore,end) < 0 && sdscmp(kb,end) >= 0);
+        sdsfree(start), sdsfree(end);
+
+        /* convert between encodings */
+        v1key = rocksConvertKeyEncoding(kscore,sdslen(kscore),SWAP_KEY_ENCODING_V2,SWAP_KEY_ENCODING_V1);
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V1;
+        test_assert(!decodeScoreKey(v1key,sdslen(v1key),&dbId,&keystr,&klen,&version,&score,&subkeystr,&slen));
+        test_assert(klen == 4 && !memcmp(keystr,nul,4) && score == 0.5 && version == V);
+        test_assert(rocksEncodeKeyPrefixRange(db->id,"a",1,&start,&end) == -1);
+        v2key = rocksConvertKeyEncoding(v1key,sdslen(v1key),SWAP_KEY_ENCODING_V1,SWAP_KEY_ENCODING_V2);
+        test_assert(sdscmp(v2key,kscore) == 0);
+        kmeta = rocksEncodeMetaKey(db,nul);
+        test_assert(rocksConvertKeyEncoding(kmeta,2,SWAP_KEY_ENCODING_V1,SWAP_KEY_ENCODING_V2) == NULL);
+        sdsfree(v1key), sdsfree(v2key), sdsfree(kmeta), sdsfree(kscore);
+
+        sdsfree(ka), sdsfree(kab), sdsfree(kb), sdsfree(knul);
+        sdsfree(a), sdsfree(ab), sdsfree(b), sdsfree(nul), sdsfree(f1), sdsfree(empty);
+        server.swap_key_encoding = orig_encoding;
+    }
+
+    TEST("util - key encoding v3 slot range") {
+        int orig_encoding = server.swap_key_encoding, dbId;
+        sds a = sdsnew("{user1}:a"), b = sdsnew("{user1}:b"), other = sdsnew("other");
+        sds ka, kb, kother, kdata, start, end;
+        int slot = keyHashSlot(a,sdslen(a));
+        const char *keystr;
+        size_t klen;
+
+        test_assert(rocksEncodeSlotRange(db->id,slot,&start,&end) == -1);
+        server.swap_key_encoding = SWAP_KEY_ENCODING_V3;
+        ka = rocksEncodeMetaKey(db,a), kb = rocksEncodeMetaKey(db,b);
+        kother = rocksEncodeMetaKey(db,other);
+        kdata = rocksEncodeDataKey(db,a,1,a);
+        test_assert(!rocksEncodeSlotRange(db->id,slot,&start,&end));
+        test_assert(sdscmp(start,ka) < 0 && sdscmp(ka,kb) < 0 && sdscmp(kb,end) < 0);
+        test_assert(sdscmp(start,kdata) < 0 && sdscmp(kdata,end) < 0);
+        test_assert(!memcmp(ka,kdata,sdslen(ka)));
+        if (keyHashSlot(other,sdslen(other)) != (unsigned)slot)
+            test_assert(sdscmp(kother,start) < 0 || sdscmp(kother,end) >= 0);
+        test_assert(!rocksDecodeMetaKey(kb,sdslen(kb),&dbId,&keystr,&klen));
+        test_assert(dbId == db->id && klen == sdslen(b) && !memcmp(keystr,b,klen));
+        sdsfree(start), sdsfree(end);
+        test_assert(rocksEncodeKeyPrefixRange(db->id,"a",1,&start,&end) == -1);
+
+        test_assert(!rocksEncodeSlotRange(db->id,16383,&start,&end));
+        test_assert(sdscmp(start,end) < 0);
+        sdsfree(start), sdsfree(end);
+
+        sdsfree(ka), sdsfree(kb), sdsfree(kother), sdsfree(kdata);
+        sdsfree(a), sdsfree(b), sdsfree(other);
+        server.swap_key_encoding = orig_encoding;
+    }
+
+    TEST("util - expire index key") {
+        int dbId;
+        long long expire;
+        const char *keystr;
+        size_t klen;
+        sds k1 = rocksEncodeExpireIndexKey(db->id,1000,"b",1),
+            k2 = rocksEncodeExpireIndexKey(db->id,2000,"a",1),
+            start = rocksEncodeExpireIndexKey(db->id,0,NULL,0),
+            end = rocksEncodeExpireIndexKey(db->id,2000,NULL,0);
+
+        test_assert(!rocksDecodeExpireIndexKey(k1,sdslen(k1),&dbId,&expire,&keystr,&klen));
+        test_assert(dbId == db->id && expire == 1000 && klen == 1 && keystr[0] == 'b');
+        /* ordered by expire, range end excludes keys expiring at end. */
+        test_assert(sdscmp(start,k1) < 0 && sdscmp(k1,k2) < 0);
+        test_assert(sdscmp(k1,end) < 0 && sdscmp(k2,end) > 0);
+        test_assert(rocksDecodeExpireIndexKey(k1,4,NULL,NULL,NULL,NULL) == -1);
+
+        sdsfree(k1), sdsfree(k2), sdsfree(start), sdsfree(end);
+    }
+
     TEST("util - data & score constains") {
         sds key = sdsnew("key"), empty = sdsempty(), subkey = sdsnew("subkey");
         sds dataKey, metaKey;
@@ -0,0 +1,353 @@
+/* Copyright (c) 2024, ctrip.com * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *   * Neither the name of Redis nor the names of its contributors may be used
+ *     to endorse or promote products derived from this software without
+ *     specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ctrip_swap.h"
+#include "lzf.h"
+
+/* Warm tier: values of whole keys evicted to rocksdb are also kept in memory
+ * as (lzf compressed) rdb encoded blobs, bounded by swap-warm-tier-max-memory
+ * in LRU order. Cold key found in warm tier is restored on main thread right
+ * when key request proceeds, no rocksdb read needed.
+ *
+ * Rocksdb is still the source of truth: entries are only a copy of persisted
+ * value, so entry is dropped whenever key is deleted or overwritten, and all
+ * tiers are reset together with cold filter (flushdb, swapdb...). */
+
+dictType warmTierDictType = {
+    dictSdsHash,               /* hash function */
+    NULL,                      /* key dup */
+    NULL,                      /* val dup */
+    dictSdsKeyCompare,         /* key compare */
+    NULL,                      /* key destructor */
+    NULL,                      /* val destructor */
+    NULL                       /* allow to expand */
+};
+
+warmTier *warmTierNew(void) {
+    warmTier *tier = zcalloc(sizeof(warmTier));
+    tier->map = dictCreate(&warmTierDictType,NULL);
+    tier->list = listCreate();
+    return tier;
+}
+
+static void warmTierEntryFree(warmTierEntry *e) {
+    sdsfree(e->key);
+    sdsfree(e->blob);
+    zfree(e);
+}
+
+static inline size_t warmTierEntryMemory(warmTierEntry *e) {
+    return sizeof(warmTierEntry) + sizeof(listNode) + sizeof(dictEntry) +
+        sdsZmallocSize(e->key) + sdsZmallocSize(e->blob);
+}
+
+void warmTierFree(warmTier *tier) {
+    listIter li;
+    listNode *ln;
+
+    if (tier == NULL) return;
+    listRewind(tier->list,&li);
+    while ((ln = listNext(&li))) warmTierEntryFree(listNodeValue(ln));
+    dictRelease(tier->map);
+    listRelease(tier->list);
+    zfree(tier);
+}
+
+static void warmTierDeleteNode(warmTier *tier, listNode *ln) {
+    warmTierEntry *e = listNodeValue(ln);
+    serverAssert(dictDelete(tier->map,e->key) == DICT_OK);
+    listDelNode(tier->list,ln);
+    tier->used_memory -= warmTierEntryMemory(e);
+    tier->raw_bytes -= e->rawlen ? e->rawlen : sdslen(e->blob);
+    tier->blob_bytes -= sdslen(e->blob);
+    warmTierEntryFree(e);
+}
+
+int warmTierDelete(warmTier *tier, sds key) {
+    dictEntry *de;
+    if (tier == NULL || (de = dictFind(tier->map,key)) == NULL) return 0;
+    warmTierDeleteNode(tier,dictGetVal(de));
+    return 1;
+}
+
+size_t warmTiersUsedMemory(void) {
+    size_t used_memory = 0;
+    for (int i = 0; i < server.dbnum; i++) {
+        coldFilter *filter = server.db[i].cold_filter;
+        if (filter && filter->warm) used_memory += filter->warm->used_memory;
+    }
+    return used_memory;
+}
+
+/* Evict least recently put entries until all tiers fit in max memory,
+ * entries of prefer tier evicted first. */
+void warmTiersTrim(warmTier *prefer) {
+    size_t used_memory = warmTiersUsedMemory(), before;
+    int dbid = 0;
+
+    while (used_memory > server.swap_warm_tier_max_memory) {
+        warmTier *tier = NULL;
+
+        if (prefer && listLength(prefer->list)) tier = prefer;
+        for (; tier == NULL && dbid < server.dbnum; dbid++) {
+            coldFilter *filter = server.db[dbid].cold_filter;
+            if (filter && filter->warm && listLength(filter->warm->list))
+                tier = filter->warm;
+        }
+        if (tier == NULL) break;
+
+        before = tier->used_memory;
+        warmTierDeleteNode(tier,listLast(tier->list));
+        used_memory -= before - tier->used_memory;
+        atomicIncr(server.swap_hit_stats->stat_warm_tier_evict_count,1);
+    }
+}
+
+static sds warmTierEncodeValue(robj *value, size_t *rawlen) {
+    sds raw = rocksEncodeValRdb(value), compressed;
+    size_t len = sdslen(raw), comprlen;
+
+    *rawlen = 0;
+    if (len < WARM_TIER_COMPRESS_MIN_LEN) return sdsRemoveFreeSpace(raw);
+
+    /* same as rdbSaveLzfStringObject: worth only if saves 4 bytes. */
+    compressed = sdsnewlen(SDS_NOINIT,len-4);
+    comprlen = lzf_compress(raw,len,compressed,len-4);
+    if (comprlen == 0) {
+        sdsfree(compressed);
+        return sdsRemoveFreeSpace(raw);
+    }
+    sdssetlen(compressed,comprlen);
+    compressed[comprlen] = '\0';
+    sdsfree(raw);
+    *rawlen = len;
+    return sdsRemoveFreeSpace(compressed);
+}
+
+static robj *warmTierDecodeValue(warmTierEntry *e) {
+    sds raw = e->blob;
+    robj *value;
+
+    if (e->rawlen) {
+        raw = sdsnewlen(SDS_NOINIT,e->rawlen);
+        if (lzf_decompress(e->blob,sdslen(e->blob),raw,e->rawlen) != e->rawlen) {
+            sdsfree(raw);
+            return NULL;
+        }
+    }
+    value = rocksDecodeValRdb(raw);
+    if (raw != e->blob) sdsfree(raw);
+    return value;
+}
+
+/* Called when value of whole key is evicted (already persisted to rocksdb). */
+void warmTierPutKey(redisDb *db, robj *key, robj *value, long long expire) {
+    coldFilter *filter = db->cold_filter;
+    warmTierEntry *e;
+    warmTier *tier;
+    size_t memory;
+
+    if (server.swap_warm_tier_max_memory == 0 || filter == NULL) return;
+    /* module value needs key name to (de)serialize, not cached. */
+    if (value->type == OBJ_MODULE) return;
+    if (filter->warm == NULL) filter->warm = warmTierNew();
+    tier = filter->warm;
+    warmTierDelete(tier,key->ptr);
+
+    e = zmalloc(sizeof(warmTierEntry));
+    e->key = sdsdup(key->ptr);
+    e->blob = warmTierEncodeValue(value,&e->rawlen);
+    e->expire = expire;
+
+    memory = warmTierEntryMemory(e);
+    if (memory > server.swap_warm_tier_max_memory) {
+        warmTierEntryFree(e);
+        return;
+    }
+
+    listAddNodeHead(tier->list,e);
+    serverAssert(dictAdd(tier->map,e->key,listFirst(tier->list)) == DICT_OK);
+    tier->used_memory += memory;
+    tier->raw_bytes += e->rawlen ? e->rawlen : sdslen(e->blob);
+    tier->blob_bytes += sdslen(e->blob);
+    atomicIncr(server.swap_hit_stats->stat_warm_tier_put_count,1);
+
+    warmTiersTrim(tier);
+}
+
+/* Restore cold key from warm tier as if swapped in from rocksdb, returns
+ * restored value or NULL if key should proceed to rocksdb. */
+robj *warmTierRestoreKey(redisDb *db, robj *key, int cmd_intention,
+        uint32_t cmd_intention_flags) {
+    coldFilter *filter = db->cold_filter;
+    warmTier *tier = filter ? filter->warm : NULL;
+    warmTierEntry *e;
+    long long expire;
+    dictEntry *de;
+    robj *value;
+
+    if (tier == NULL || dictSize(tier->map) == 0) return NULL;
+    if (cmd_intention != SWAP_IN && cmd_intention != SWAP_DEL) return NULL;
+    if ((de = dictFind(tier->map,key->ptr)) == NULL) return NULL;
+
+    /* key going to be deleted, entry would be stale. */
+    if (cmd_intention == SWAP_DEL ||
+            (cmd_intention_flags & (SWAP_IN_DEL|SWAP_IN_DEL_MOCK_VALUE|SWAP_IN_FORCE_HOT))) {
+        warmTierDeleteNode(tier,dictGetVal(de));
+        return NULL;
+    }
+
+    e = listNodeValue((listNode*)dictGetVal(de));
+    value = warmTierDecodeValue(e);
+    expire = e->expire;
+    warmTierDeleteNode(tier,dictGetVal(de));
+    if (value == NULL) return NULL;
+
+    if (value->refcount == OBJ_SHARED_REFCOUNT)
+        value = dupSharedObject(value);
+    clearObjectDirty(value);
+    clearObjectPersistKeep(value);
+    overwriteObjectPersistent(value,1);
+    dbAdd(db,key,value);
+    if (expire != -1) setExpire(NULL,db,key,expire);
+    db->cold_keys--;
+    coldFilterDeleteKey(filter,key->ptr);
+
+    atomicIncr(server.swap_hit_stats->stat_swapin_warm_tier_hit_count,1);
+    return value;
+}
+
+sds genSwapWarmTierInfoString(sds info) {
+    size_t used_memory = 0, raw_bytes = 0, blob_bytes = 0;
+    unsigned long keys = 0;
+    long long puts, evicts;
+
+    for (int i = 0; i < server.dbnum; i++) {
+        coldFilter *filter = server.db[i].cold_filter;
+        if (filter == NULL || filter->warm == NULL) continue;
+        used_memory += filter->warm->used_memory;
+        raw_bytes += filter->warm->raw_bytes;
+        blob_bytes += filter->warm->blob_bytes;
+        keys += dictSize(filter->warm->map);
+    }
+    atomicGet(server.swap_hit_stats->stat_warm_tier_put_count,puts);
+    atomicGet(server.swap_hit_stats->stat_warm_tier_evict_count,evicts);
+
+    info = sdscatprintf(info,
+            "swap_warm_tier:max_memory=%llu,used_memory=%lu,keys=%lu,puts=%lld,evicts=%lld,compress_ratio=%.2f\r\n",
+            server.swap_warm_tier_max_memory,used_memory,keys,puts,evicts,
+            blob_bytes ? (double)raw_bytes/blob_bytes : 0);
+    return info;
+}
+
+#ifdef REDIS_TEST
+
+int swapWarmTierTest(int argc, char *argv[], int accurate) {
+    UNUSED(argc), UNUSED(argv), UNUSED(accurate);
+    int error = 0;
+    unsigned long long orig_max_memory;
+    redisDb *db;
+
+    TEST("warm tier - init") {
+        initServerConfig4Test();
+        initTestRedisDb();
+        if (server.swap_hit_stats == NULL)
+            server.swap_hit_stats = zcalloc(sizeof(swapHitStat));
+        db = server.db;
+        orig_max_memory = server.swap_warm_tier_max_memory;
+        server.swap_warm_tier_max_memory = 1024*1024;
+    }
+
+    TEST("warm tier - compressed roundtrip") {
+        robj *key = createStringObject("warm-key",8);
+        sds val = sdsempty();
+        for (int i = 0; i < 64; i++) val = sdscat(val,"warm-tier-value");
+        robj *value = createObject(OBJ_STRING,sdsdup(val));
+
+        warmTierPutKey(db,key,value,-1);
+        test_assert(db->cold_filter->warm != NULL);
+        warmTierEntry *e = listNodeValue(listFirst(db->cold_filter->warm->list));
+        test_assert(e->rawlen > 0 && sdslen(e->blob) < e->rawlen);
+        decrRefCount(value);
+        db->cold_keys++;
+
+        /* NOP/OUT requests leave entry alone. */
+        test_assert(warmTierRestoreKey(db,key,SWAP_NOP,0) == NULL);
+        test_assert(dictSize(db->cold_filter->warm->map) == 1);
+
+        robj *restored = warmTierRestoreKey(db,key,SWAP_IN,0);
+        test_assert(restored != NULL);
+        test_assert(!sdscmp(restored->ptr,val));
+        test_assert(getObjectPersistent(restored));
+        test_assert(lookupKey(db,key,LOOKUP_NOTOUCH) == restored);
+        test_assert(dictSize(db->cold_filter->warm->map) == 0);
+        test_assert(db->cold_filter->warm->used_memory == 0);
+
+        dbDelete(db,key);
+        decrRefCount(key);
+        sdsfree(val);
+    }
+
+    TEST("warm tier - deleted key dropped") {
+        robj *key = createStringObject("warm-del",8);
+        robj *value = createStringObject("v",1);
+        warmTierPutKey(db,key,value,-1);
+        test_assert(dictSize(db->cold_filter->warm->map) == 1);
+        test_assert(warmTierRestoreKey(db,key,SWAP_IN,SWAP_IN_DEL) == NULL);
+        test_assert(dictSize(db->cold_filter->warm->map) == 0);
+        test_assert(lookupKey(db,key,LOOKUP_NOTOUCH) == NULL);
+        decrRefCount(value);
+        decrRefCount(key);
+    }
+
+    TEST("warm tier - bounded by max memory") {
+        robj *value = createStringObject("small-value",11);
+        server.swap_warm_tier_max_memory = 4096;
+        for (int i = 0; i < 256; i++) {
+            robj *key = createObject(OBJ_STRING,sdscatprintf(sdsempty(),"warm-%d",i));
+            warmTierPutKey(db,key,value,-1);
+            decrRefCount(key);
+        }
+        test_assert(warmTiersUsedMemory() <= 4096);
+        test_assert(dictSize(db->cold_filter->warm->map) < 256);
+        /* most recently put kept */
+        sds newest = sdsnew("warm-255"), oldest = sdsnew("warm-0");
+        test_assert(dictFind(db->cold_filter->warm->map,newest) != NULL);
+        test_assert(dictFind(db->cold_filter->warm->map,oldest) == NULL);
+        sdsfree(newest), sdsfree(oldest);
+
+        server.swap_warm_tier_max_memory = 0;
+        warmTiersTrim(NULL);
+        test_assert(warmTiersUsedMemory() == 0);
+        decrRefCount(value);
+    }
+
+    server.swap_warm_tier_max_memory = orig_max_memory;
+    return error;
+}
+
+#endif
@@ -40,7 +40,7 @@ static void createFakeZsetForDeleteIfCold(swapData *data) {
 
 /* return 1 if noswap needed */
 static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
-        int *may_keep_data) {
+        subkeyClock *clock, int *may_keep_data) {
     int select_type, noswap;
     size_t count;
     robj *subkeys;
@@ -75,6 +75,7 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
     }
 
     count = MIN(count,(size_t)server.swap_evict_step_max_subkeys);
+    size_t chances = subkeyClockSecondChances(count);
     datactx->bdc.type = BASE_SWAP_CTX_TYPE_SUBKEY;
     datactx->bdc.sub.subkeys = zmalloc(count*sizeof(robj*));
 
@@ -103,12 +104,20 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
 
                     vlong = 0;
                     ziplistGet(eptr, &vstr, &vlen, &vlong);
-                    evict_memory += vlen;
                     if (vstr != NULL) {
                         subkey = createStringObject((const char*)vstr, vlen);
                     } else {
                         subkey = createObject(OBJ_STRING,sdsfromlonglong(vlong));
                     }
+                    /* Recently accessed member kept for now, evicted in
+                     * later steps if not accessed again. */
+                    if (subkeyClockSecondChance(clock,subkey,&chances)) {
+                        if (!noswap) *may_keep_data = 0;
+                        decrRefCount(subkey);
+                        zzlNext(zl, &eptr, &sptr);
+                        continue;
+                    }
+                    evict_memory += vlen;
                     datactx->bdc.sub.subkeys[datactx->bdc.sub.num++] = subkey;
                     ziplistGet(sptr, &vstr, &vlen, &vlong);
                     evict_memory += vlen;
@@ -129,6 +138,11 @@ static int zsetSwapAnaOutSelectSubkeys(swapData *data, zsetDataCtx *datactx,
                     }
                     sds skey = dictGetKey(de);
                     subkey = createStringObject(skey, sdslen(skey));
+                    if (subkeyClockSecondChance(clock,subkey,&chances)) {
+                        if (!noswap) *may_keep_data = 0;
+                        decrRefCount(subkey);
+                        continue;
+                    }
                     datactx->bdc.sub.subkeys[datactx->bdc.sub.num++] = subkey;
                     evict_memory += sizeof(zset) + sizeof(dictEntry);
                 }
@@ -263,6 +277,13 @@ int zsetSwapAna(swapData *data, int thd, struct keyRequest *req,
             }
         } else { /* keyrequests with subkeys */
             objectMeta *meta = swapDataObjectMeta(data);
+            subkeyClock *clock = NULL;
+            if (thd == SWAP_ANA_THD_MAIN && server.swap_evict_subkey_clock &&
+                    req->cmd_intention_flags != SWAP_IN_DEL) {
+                size_t nsubkeys = meta->len;
+                if (data->value) nsubkeys += zsetLength(data->value);
+                clock = subkeyClockLookupOrCreate(data->db,data->key,nsubkeys);
+            }
             if (req->cmd_intention_flags == SWAP_IN_DEL) {
                 datactx->bdc.type = BASE_SWAP_CTX_TYPE_SUBKEY;
                 datactx->bdc.sub.num = 0;
@@ -279,6 +300,9 @@ int zsetSwapAna(swapData *data, int thd, struct keyRequest *req,
                 *intention = datactx->bdc.sub.num > 0 ? SWAP_IN : SWAP_NOP;
                 *intention_flags = SWAP_EXEC_IN_DEL;
             } else if (meta->len == 0) {
+                /* all members in memory, no swap needed. */
+                for (int i = 0; clock && i < req->b.num_subkeys; i++)
+                    subkeyClockAccess(clock,req->b.subkeys[i],1);
                 *intention = SWAP_NOP;
                 *intention_flags = 0;
             } else {
@@ -288,7 +312,10 @@ int zsetSwapAna(swapData *data, int thd, struct keyRequest *req,
                 for (int i = 0; i < req->b.num_subkeys; i++) {
                     robj *subkey = req->b.subkeys[i];
                     double score;
-                    if (data->value == NULL || zsetScore(data->value, subkey->ptr, &score) == C_ERR) {
+                    int hot = data->value != NULL &&
+                        zsetScore(data->value, subkey->ptr, &score) == C_OK;
+                    if (clock) subkeyClockAccess(clock,subkey,hot);
+                    if (!hot) {
                         if (swapDataMayContainSubkey(data,thd,subkey)) {
                             incrRefCount(subkey);
                             datactx->bdc.sub.subkeys[datactx->bdc.sub.num++] = subkey;
@@ -310,7 +337,10 @@ int zsetSwapAna(swapData *data, int thd, struct keyRequest *req,
             *intention_flags = 0;
         } else {
             int may_keep_data;
-            int noswap = zsetSwapAnaOutSelectSubkeys(data,datactx,&may_keep_data);
+            subkeyClock *clock = thd == SWAP_ANA_THD_MAIN ?
+                subkeyClockLookup(data->db,data->key) : NULL;
+            int noswap = zsetSwapAnaOutSelectSubkeys(data,datactx,clock,
+                    &may_keep_data);
             int keep_data = swapDataPersistKeepData(data,cmd_intention_flags,may_keep_data);
 
             /* create new meta if needed */
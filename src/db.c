@@ -846,6 +846,24 @@ void keysCommand(client *c) {
         }
     }
     dictReleaseIterator(di);
+
+    /* Cold keys matched by swap thread, hot ones (maybe also persisted in
+     * rocksdb) are already replied above. */
+    if (c->swap_metas) {
+        metaScanResult *metas = c->swap_metas;
+        for (int i = 0; i < metas->num; i++) {
+            scanMeta *meta = metas->metas+i;
+            if (dictFind(c->db->dict,meta->key) != NULL) continue;
+            if (!metas->filtered && !allkeys &&
+                    !stringmatchlen(pattern,plen,meta->key,sdslen(meta->key),0))
+                continue;
+            if (timestampIsExpired(meta->expire)) continue;
+            addReplyBulkCBuffer(c,meta->key,sdslen(meta->key));
+            numkeys++;
+        }
+        freeScanMetaResult(c->swap_metas);
+        c->swap_metas = NULL;
+    }
     setDeferredArrayLen(c,replylen,numkeys);
 }
 
@@ -1063,6 +1081,8 @@ void scanGenericCommand(client *c, robj *o, unsigned long cursor) {
 
     /* Step 3: Filter elements. */
     scanMeta *curmeta = NULL;
+    /* MATCH/TYPE of cold keys may already applied by swap thread. */
+    int metas_filtered = metascan && c->swap_metas->filtered;
     i = 0;
     node = listFirst(keys);
     while (node) {
@@ -1076,7 +1096,7 @@ void scanGenericCommand(client *c, robj *o, unsigned long cursor) {
         }
 
         /* Filter element if it does not match the pattern. */
-        if (use_pattern) {
+        if (use_pattern && !metas_filtered) {
             if (sdsEncodedObject(kobj)) {
                 if (!stringmatchlen(pat, patlen, kobj->ptr, sdslen(kobj->ptr), 0))
                     filter = 1;
@@ -1091,7 +1111,7 @@ void scanGenericCommand(client *c, robj *o, unsigned long cursor) {
         }
 
         /* Filter an element if it isn't the type we want. */
-        if (!filter && o == NULL && typename){
+        if (!filter && o == NULL && typename && !metas_filtered){
             char* type;
             if (metascan) {
                 type = (char*)strObjectType(curmeta->swap_type);
@@ -185,6 +185,12 @@ void evictionPoolPopulate(int dbid, dict *sampledict, dict *keydict, struct evic
             serverPanic("Unknown eviction policy in evictionPoolPopulate()");
         }
 
+        /* Prefer keys that free more memory per swap-in cost in disk mode. */
+        if (server.swap_mode != SWAP_MODE_MEMORY && server.swap_evict_cost_aware &&
+                server.maxmemory_policy != MAXMEMORY_VOLATILE_TTL) {
+            idle = swapEvictionCostAwareScore(server.db+dbid,key,o,idle);
+        }
+
         /* Insert the element inside the pool.
          * First, find the first empty bucket or the first populated
          * bucket that has an idle time smaller than our idle time. */
@@ -941,7 +941,7 @@ int RM_CreateCommand(RedisModuleCtx *ctx, const char *name, RedisModuleCmdFunc c
     cp->rediscmd->name = cmdname;
     cp->rediscmd->proc = RedisModuleCommandDispatcher;
     cp->rediscmd->arity = -1;
-    cp->rediscmd->flags = flags | CMD_MODULE;
+    cp->rediscmd->flags = flags | CMD_MODULE | CMD_SWAP_DATATYPE_MODULE;
     cp->rediscmd->intention = intention;
     cp->rediscmd->getkeys_proc = (redisGetKeysProc*)(unsigned long)cp;
     cp->rediscmd->getkeyrequests_proc = getkeyrequests_proc;
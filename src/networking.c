@@ -166,6 +166,7 @@ client *createClient(connection *conn) {
     c->repl_last_partial_write = 0;
     c->slave_listening_port = 0;
     c->slave_addr = NULL;
+    c->slave_rordb_ssts = NULL;
     c->slave_capa = SLAVE_CAPA_NONE;
     c->reply = listCreate();
     c->reply_bytes = 0;
@@ -197,15 +198,18 @@ client *createClient(connection *conn) {
     c->auth_callback_privdata = NULL;
     c->auth_module = NULL;
     c->keyrequests_count = 0;
+    c->swap_prefetched_cmds = 0;
     c->swap_cmd = NULL;
     c->swap_result = 0;
     c->cmd_reploff = -1;
     c->repl_client = NULL;
     c->client_hold_mode = CLIENT_HOLD_MODE_CMD;
+    c->swap_priority = SWAP_PRIORITY_HIGH;
     c->CLIENT_DEFERED_CLOSING = 0;
     c->CLIENT_REPL_SWAPPING = 0;
     c->swap_locks = listCreate();
     c->swap_metas = NULL;
+    c->swap_pushdown = NULL;
     c->swap_errcode = 0;
     c->swap_arg_rewrites = argRewritesCreate();
     c->rate_limit_event_id = -1;
@@ -1570,11 +1574,16 @@ void freeClient(client *c) {
     sdsfree(c->peerid);
     sdsfree(c->sockname);
     sdsfree(c->slave_addr);
+    sdsfree(c->slave_rordb_ssts);
     listRelease(c->swap_locks);
     if (c->swap_metas) {
         freeScanMetaResult(c->swap_metas);
         c->swap_metas = NULL;
     }
+    if (c->swap_pushdown) {
+        swapPushdownFree(c->swap_pushdown);
+        c->swap_pushdown = NULL;
+    }
     argRewritesFree(c->swap_arg_rewrites);
     zfree(c);
 }
@@ -2207,6 +2216,8 @@ int processCommandAndResetClient(client *c) {
     int deadclient = 0;
     client *old_client = server.current_client;
     server.current_client = c;
+    /* current command is no longer a pipelined one. */
+    if (c->swap_prefetched_cmds > 0) c->swap_prefetched_cmds--;
     if (processCommand(c) == C_OK) {
         commandProcessed(c);
     }
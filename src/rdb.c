@@ -2929,6 +2929,12 @@ int rdbLoadRio(rio *rdb, int rdbflags, rdbSaveInfo *rsi) {
         }
     }
 
+    if (server.swap_mode != SWAP_MODE_MEMORY && evictFinishLoading() != C_OK) {
+        serverLog(LL_WARNING,"Ingest swap data loaded failed. Aborting now.");
+        rdbReportReadError("Ingest swap data failed");
+        return C_ERR;
+    }
+
     if (empty_keys_skipped) {
         serverLog(LL_WARNING,
             "Done loading RDB, keys loaded: %lld, keys expired: %lld, empty keys skipped: %lld.",
@@ -32,6 +32,7 @@
 #include "server.h"
 #include "cluster.h"
 #include "bio.h"
+#include "ctrip_swap_rordb.h"
 
 #include <sys/time.h>
 #include <unistd.h>
@@ -50,6 +51,18 @@ int cancelReplicationHandshake(int reconnect);
  * the instance is configured to have no persistence. */
 int RDBGeneratedByReplication = 0;
 
+/* Remember if rordb ssts held by this replica were advertised in current
+ * handshake, so that we know whether to wait for the reply. */
+static int RordbSSTsAdvertised = 0;
+
+/* Release ssts hard linked for current handshake: once sync finished or
+ * aborted, they are not needed (re-linked in next handshake). */
+static void replicationRordbDeltaCleanup(void) {
+    if (!RordbSSTsAdvertised) return;
+    rordbDeltaCleanup();
+    RordbSSTsAdvertised = 0;
+}
+
 /* --------------------------- Utility functions ---------------------------- */
 
 /* Return the pointer to a string representing the slave ip:listening_port
@@ -669,6 +682,10 @@ int startBgsaveForReplication(int mincapa) {
         if (server.swap_repl_rordb_sync && (mincapa & SLAVE_CAPA_RORDB)) {
             rordb = 1;
             sfrctx = swapForkRocksdbCtxCreate(SWAP_FORK_ROCKSDB_TYPE_CHECKPOINT);
+            /* Rdb file on disk might be reused by replicas attached later,
+             * so delta rordb is only generated for socket target. */
+            if (socket_target && server.swap_repl_rordb_delta_sync)
+                server.swap_repl_rordb_delta_ssts = rordbDeltaSSTsCreate(server.slaves);
             serverLog(LL_NOTICE, "start replcation sync in rordb mode.");
         } else {
             sfrctx = swapForkRocksdbCtxCreate(SWAP_FORK_ROCKSDB_TYPE_SNAPSHOT);
@@ -688,6 +705,12 @@ int startBgsaveForReplication(int mincapa) {
         retval = C_ERR;
     }
 
+    /* Checkpoint is created and inherited by child before fork returns. */
+    if (server.swap_repl_rordb_delta_ssts) {
+        rordbDeltaSSTsRelease(server.swap_repl_rordb_delta_ssts);
+        server.swap_repl_rordb_delta_ssts = NULL;
+    }
+
     /* If we succeeded to start a BGSAVE with disk target, let's remember
      * this fact, so that we can later delete the file if needed. Note
      * that we don't set the flag to 1 if the feature is disabled, otherwise
@@ -998,6 +1021,10 @@ void replconfCommand(client *c) {
                 c->slave_capa |= SLAVE_CAPA_RORDB;
             else if (!strcasecmp(c->argv[j+1]->ptr,"swap.info"))
                 c->slave_capa |= SLAVE_CAPA_SWAP_INFO;
+        } else if (!strcasecmp(c->argv[j]->ptr,"rordb-ssts")) {
+            /* Ssts held by replica, see rordbDeltaManifestCreate. */
+            if (c->slave_rordb_ssts) sdsfree(c->slave_rordb_ssts);
+            c->slave_rordb_ssts = sdsdup(c->argv[j+1]->ptr);
         } else if (!strcasecmp(c->argv[j]->ptr,"ack")) {
             /* REPLCONF ACK is used by slave to inform the master the amount
              * of replication stream that it processed so far. It is an
@@ -1942,6 +1969,7 @@ void readSyncBulkPayload(connection *conn) {
      * masters after a failover. */
     if (server.repl_backlog == NULL) ctrip_createReplicationBacklog();
     serverLog(LL_NOTICE, "MASTER <-> REPLICA sync: Finished with success");
+    replicationRordbDeltaCleanup();
 
     if (server.supervised_mode == SUPERVISED_SYSTEMD) {
         redisCommunicateSystemd("STATUS=MASTER <-> REPLICA sync: Finished with success. Ready to accept connections in read-write mode.\n");
@@ -1957,6 +1985,7 @@ void readSyncBulkPayload(connection *conn) {
     return;
 
 error:
+    replicationRordbDeltaCleanup();
     cancelReplicationHandshake(1);
     return;
 }
@@ -2388,6 +2417,16 @@ void syncWithMaster(connection *conn) {
                 "capa","eof","capa","psync2","capa","rordb","capa","swap.info",NULL);
         if (err) goto write_error;
 
+        /* Advertise ssts we already hold, so that master could skip them
+         * in rordb fullsync. */
+        sds manifest = rordbDeltaManifestCreate();
+        RordbSSTsAdvertised = manifest != NULL;
+        if (manifest) {
+            err = sendCommand(conn,"REPLCONF","rordb-ssts",manifest,NULL);
+            sdsfree(manifest);
+            if (err) goto write_error;
+        }
+
         server.repl_state = REPL_STATE_RECEIVE_AUTH_REPLY;
         return;
     }
@@ -2451,6 +2490,25 @@ void syncWithMaster(connection *conn) {
         }
         sdsfree(err);
         err = NULL;
+        server.repl_state = REPL_STATE_RECEIVE_RORDB_SSTS_REPLY;
+        /* rordb-ssts reply not arrived yet, wait for next readable event. */
+        if (RordbSSTsAdvertised) return;
+    }
+
+    if (server.repl_state == REPL_STATE_RECEIVE_RORDB_SSTS_REPLY && !RordbSSTsAdvertised)
+        server.repl_state = REPL_STATE_SEND_PSYNC;
+
+    /* Receive REPLCONF rordb-ssts reply. */
+    if (server.repl_state == REPL_STATE_RECEIVE_RORDB_SSTS_REPLY) {
+        err = receiveSynchronousResponse(conn);
+        /* Ignore the error if any, master will send all ssts. */
+        if (err[0] == '-') {
+            serverLog(LL_NOTICE,"(Non critical) Master does not understand "
+                                  "REPLCONF rordb-ssts: %s", err);
+            replicationRordbDeltaCleanup();
+        }
+        sdsfree(err);
+        err = NULL;
         server.repl_state = REPL_STATE_SEND_PSYNC;
     }
 
@@ -2503,6 +2561,7 @@ void syncWithMaster(connection *conn) {
 
     if (psync_result == PSYNC_CONTINUE) {
         serverLog(LL_NOTICE, "MASTER <-> REPLICA sync: Master accepted a Partial Resynchronization.");
+        replicationRordbDeltaCleanup();
         if (server.supervised_mode == SUPERVISED_SYSTEMD) {
             redisCommunicateSystemd("STATUS=MASTER <-> REPLICA sync: Partial Resynchronization accepted. Ready to accept connections in read-write mode.\n");
         }
@@ -2576,6 +2635,7 @@ error:
     server.repl_transfer_tmpfile = NULL;
     server.repl_transfer_fd = -1;
     server.repl_state = REPL_STATE_CONNECT;
+    replicationRordbDeltaCleanup();
     return;
 
 write_error: /* Handle sendCommand() errors. */
@@ -2685,6 +2745,7 @@ int cancelReplicationHandshake(int reconnect) {
     } else {
         return 0;
     }
+    replicationRordbDeltaCleanup();
 
     if (!reconnect)
         return 1;
@@ -2771,6 +2832,7 @@ void replicationUnsetMaster(void) {
     if (server.master) freeClient(server.master);
     replicationDiscardCachedMaster();
     cancelReplicationHandshake(0);
+    replicationRordbDeltaCleanup();
     /* When a slave is turned into a master, the current replication ID
      * (that was inherited from the master at synchronization time) is
      * used as secondary ID up to the current offset, and a new replication
@@ -381,11 +381,11 @@ struct redisCommand redisCommandTable[] = {
 
     {"sismember",sismemberCommand,3,
      "read-only fast @set @swap_set",
-     0,NULL,getKeyRequestSmembers,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestSmembers,SWAP_IN,SWAP_IN_PUSHDOWN,1,1,1,0,0,0},
 
     {"smismember",smismemberCommand,-3,
      "read-only fast @set @swap_set",
-     0,NULL,getKeyRequestSmembers,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestSmembers,SWAP_IN,SWAP_IN_PUSHDOWN,1,1,1,0,0,0},
 
     {"scard",ctrip_scardCommand,2,
      "read-only fast @set @swap_set",
@@ -505,11 +505,11 @@ struct redisCommand redisCommandTable[] = {
 
     {"zcount",zcountCommand,4,
      "read-only fast @sortedset @swap_zset",
-     0,NULL,NULL,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsZcount,SWAP_IN,SWAP_IN_PUSHDOWN,1,1,1,0,0,0},
 
     {"zlexcount",zlexcountCommand,4,
      "read-only fast @sortedset @swap_zset",
-     0,NULL,getKeyRequestsZlexCount,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsZlexCount,SWAP_IN,SWAP_IN_PUSHDOWN,1,1,1,0,0,0},
 
     {"zrevrange",zrevrangeCommand,-4,
      "read-only @sortedset @swap_zset",
@@ -597,7 +597,7 @@ struct redisCommand redisCommandTable[] = {
 
     {"hstrlen",hstrlenCommand,3,
      "read-only fast @hash @swap_hash",
-     0,NULL,getKeyRequestsHstrlen,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsHstrlen,SWAP_IN,SWAP_IN_PUSHDOWN,1,1,1,0,0,0},
 
     {"hkeys",hkeysCommand,2,
      "read-only to-sort @hash @swap_hash",
@@ -613,7 +613,7 @@ struct redisCommand redisCommandTable[] = {
 
     {"hexists",hexistsCommand,3,
      "read-only fast @hash @swap_hash",
-     0,NULL,getKeyRequestsHexists,SWAP_IN,0,1,1,1,0,0,0},
+     0,NULL,getKeyRequestsHexists,SWAP_IN,SWAP_IN_PUSHDOWN,1,1,1,0,0,0},
 
     {"hrandfield",hrandfieldCommand,-2,
      "read-only random @hash @swap_hash",
@@ -695,7 +695,7 @@ struct redisCommand redisCommandTable[] = {
 
     {"keys",keysCommand,2,
      "read-only to-sort @keyspace @dangerous @swap_keyspace",
-     0,NULL,NULL,SWAP_NOP,0,0,0,0,0,0,0},
+     0,NULL,getKeyRequestsMetaScan,SWAP_IN,SWAP_METASCAN_KEYS,0,0,0,0,0,0},
 
     {"scan",scanCommand,-2,
      "read-only random @keyspace @swap_keyspace",
@@ -870,7 +870,7 @@ struct redisCommand redisCommandTable[] = {
 
     {"cluster",clusterCommand,-2,
      "admin ok-stale random",
-     0,NULL,NULL,SWAP_NOP,0,0,0,0,0,0,0},
+     0,NULL,getKeyRequestsCluster,SWAP_IN,SWAP_METASCAN_SLOT,0,0,0,0,0,0},
 
     {"restore",restoreCommand,-4,
      "write use-memory @keyspace @dangerous @swap_keyspace",
@@ -1144,6 +1144,14 @@ struct redisCommand redisCommandTable[] = {
 	 "read-only fast",
 	 0,NULL,NULL,SWAP_IN,0,0,0,0,0,0,0},
 
+    {"swap.migrateslot",swapMigrateSlotCommand,6,
+     "write no-script @keyspace @dangerous",
+     0,NULL,getKeyRequestsDb,SWAP_NOP,0,0,0,0,0,0,0},
+
+    {"swap.restoreslot",swapRestoreSlotCommand,3,
+     "write use-memory no-script @keyspace @dangerous",
+     0,NULL,getKeyRequestsDb,SWAP_NOP,0,0,0,0,0,0,0},
+
     {"swap.mutexop",swapMutexopCommand,1,
     "admin no-script",
     0,NULL,getKeyRequestsNone,SWAP_NOP,0,0,0,0,0,0,0},
@@ -2171,10 +2179,13 @@ static void ttlCompactRefreshSstAgeLimit() {
 }
 
 static void ttlCompactProduceTask() {
+    /* sst age limit not needed if sst selected by sampled expire props. */
     if (server.swap_ttl_compact_enabled && server.swap_ttl_compact_ctx->task == NULL &&
-        (server.swap_ttl_compact_ctx->expire_stats->sst_age_limit != SWAP_TTL_COMPACT_INVALID_EXPIRE)) {
+        (server.swap_ttl_compact_expired_percentage > 0 ||
+         server.swap_ttl_compact_ctx->expire_stats->sst_age_limit != SWAP_TTL_COMPACT_INVALID_EXPIRE)) {
         cfIndexes *idxes = cfIndexesNew(1);
         idxes->index[0] = DATA_CF;
+        idxes->collect_sst_props = server.swap_ttl_compact_expired_percentage > 0;
         if (!submitUtilTask(ROCKSDB_COLLECT_CF_META_TASK, idxes, genServerTtlCompactTask, idxes, NULL)) {
             serverLog(LL_NOTICE, "[rocksdb] collect cf meta task set failed.");
             cfIndexesFree(idxes);
@@ -2613,6 +2624,10 @@ void beforeSleep(struct aeEventLoop *eventLoop) {
 
     if (server.swap_mode != SWAP_MODE_MEMORY) swapEvictionFreedInrowReset(server.swap_eviction_ctx);
 
+    /* process swaps completed while we are busy, requests submitted by their
+     * callbacks are flushed right after. */
+    if (server.swap_mode != SWAP_MODE_MEMORY) asyncCompleteQueueProcessBeforeSleep();
+
     /* submit buffered swap request in current batch */
     swapBatchCtxFlush(server.swap_batch_ctx,SWAP_BATCH_FLUSH_BEFORE_SLEEP);
 
@@ -3756,6 +3771,7 @@ void initServer(void) {
 void InitServerLast() {
     bioInit();
     server.rocksdb_disk_used = 0;
+    server.rocksdb_memory_used = 0;
     server.rocksdb_disk_error = 0;
     server.rocksdb_disk_error_since = 0;
     server.swap_rocksdb_stats_collect_interval_ms = 2000;
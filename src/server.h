@@ -185,7 +185,7 @@ static inline const char *gtidSyncTypeName(int type) {
 #define STATS_METRIC_NET_INPUT 1    /* Bytes read to network .*/
 #define STATS_METRIC_NET_OUTPUT 2   /* Bytes written to network. */
 #define STATS_METRIC_COUNT_MEM 3
-#define STATS_METRIC_COUNT_SWAP 77 /* define directly here to avoid dependcy cycle, will be checked later. */
+#define STATS_METRIC_COUNT_SWAP 80 /* define directly here to avoid dependcy cycle, will be checked later. */
 #define STATS_METRIC_COUNT (STATS_METRIC_COUNT_SWAP + STATS_METRIC_COUNT_MEM)
 
 /* Protocol and I/O related defines */
@@ -271,6 +271,7 @@ extern int configOOMScoreAdjValuesDefaults[CONFIG_OOM_COUNT];
 #define CMD_SWAP_DATATYPE_ZSET (1ULL<<44)
 #define CMD_SWAP_DATATYPE_LIST (1ULL<<45)
 #define CMD_SWAP_DATATYPE_BITMAP (1ULL<<46)
+#define CMD_SWAP_DATATYPE_MODULE (1ULL<<47)
 
 
 /* AOF states */
@@ -342,6 +343,7 @@ extern int configOOMScoreAdjValuesDefaults[CONFIG_OOM_COUNT];
 #define CLIENT_SWAP_DISCARD_CACHED_MASTER (1ULL<<47) /* The client will not be saved as cached_master. */
 #define CLIENT_SWAP_SHIFT_REPL_ID (1ULL<<48) /* shift repl id when this client (drainning master) drained. */
 #define CLIENT_SWAP_DONT_RECONNECT_MASTER (1ULL<<49) /* shift repl id when this client (drainning master) drained. */
+#define CLIENT_SWAP_PREFETCH (1ULL<<50) /* swap internal client that prefetch keys of pipelined commands. */
 
 /* Client block type (btype field in client structure)
  * if CLIENT_BLOCKED flag is set. */
@@ -382,6 +384,7 @@ typedef enum {
     REPL_STATE_RECEIVE_PORT_REPLY,  /* Wait for REPLCONF reply */
     REPL_STATE_RECEIVE_IP_REPLY,    /* Wait for REPLCONF reply */
     REPL_STATE_RECEIVE_CAPA_REPLY,  /* Wait for REPLCONF reply */
+    REPL_STATE_RECEIVE_RORDB_SSTS_REPLY, /* Wait for REPLCONF reply */
     REPL_STATE_SEND_PSYNC,          /* Send PSYNC */
     REPL_STATE_RECEIVE_PSYNC_REPLY, /* Wait for PSYNC reply */
     /* --- End of handshake states --- */
@@ -1008,6 +1011,7 @@ typedef struct client {
     int slave_listening_port; /* As configured with: REPLCONF listening-port */
     char *slave_addr;       /* Optionally given by REPLCONF ip-address */
     int slave_capa;         /* Slave capabilities: SLAVE_CAPA_* bitwise OR. */
+    sds slave_rordb_ssts;   /* Optionally given by REPLCONF rordb-ssts */
     multiState mstate;      /* MULTI/EXEC state */
     int btype;              /* Type of blocking op if CLIENT_BLOCKED. */
     blockingState bpop;     /* blocking state */
@@ -1049,18 +1053,21 @@ typedef struct client {
 
     /* swap */
     int keyrequests_count;
+    int swap_prefetched_cmds; /* num of pipelined commands (after current) already prefetched. */
     swapCmdTrace *swap_cmd;
     long swap_duration; /* microseconds used in swap */
     int swap_result;
     voidfuncptr client_swap_finished_cb;
     void *client_swap_finished_pd;
     int client_hold_mode; /* indicates how client should hold key */
+    int swap_priority; /* SWAP_PRIORITY_* of swap requests issued by client */
     int CLIENT_DEFERED_CLOSING;
     int CLIENT_REPL_SWAPPING;
     long long cmd_reploff; /* Command replication offset when dispatch if this is a repl worker */
     struct client *repl_client; /* Master or peer client if this is a repl worker */
     list *swap_locks; /* swap locks */
     struct metaScanResult *swap_metas;
+    struct swapPushdown *swap_pushdown; /* cold object read by pushdown */
     int swap_errcode;
     struct argRewrites *swap_arg_rewrites;
     int rate_limit_event_id; /* add time event when rate limit */
@@ -1787,6 +1794,8 @@ struct redisServer {
     struct rocksdbUtilTaskManager* util_task_manager;
     /* swap threads */
     int swap_threads_num;
+    int swap_threads_work_stealing; /* idle swap threads steal from busy ones */
+    int swap_threads_starvation_limit; /* lower priority served after skipped this many times */
     int swap_defer_thread_idx;
     int swap_util_thread_idx;
     int total_swap_threads_num; /* swap_threads_num + extra_swap_threads_num */
@@ -1796,6 +1805,13 @@ struct redisServer {
     /* parallel sync */
     struct parallelSync *parallel_sync;
     unsigned long long rocksdb_disk_used; /* rocksd disk usage bytes, updated every 1 minute. */
+    unsigned long long rocksdb_memory_used; /* rocksdb memory usage bytes, updated every 1 second. */
+    int swap_maxmemory_include_rocksdb; /* count rocksdb_memory_used in maxmemory. */
+    int swap_evict_cost_aware; /* weight eviction candidates by bytes freed per swap-in cost. */
+    int swap_evict_subkey_clock; /* give recently accessed subkeys of big keys a second chance when swapping out in steps. */
+    int swap_pushdown_enabled; /* serve read-only commands on cold keys without swapping them in. */
+    int swap_pushdown_promote_hits; /* swap in cold key after about that many pushdown hits. */
+    int swap_expire_index_enabled; /* active expire cold keys by expire cf range scan. */
 		/* swaps */
     client **evict_clients; /* array of evict clients (one for each db). */
     client **expire_clients; /* array of rocks expire clients (one for each db). */
@@ -1815,6 +1831,7 @@ struct redisServer {
     redisAtomic size_t swap_inprogress_memory;  /* swap consumed memory in bytes */
     redisAtomic size_t swap_error_count;  /* swap error count */
     int swap_debug_rio_delay_micro; /* sleep swap_debug_rio_delay microsencods to simulate ssd delay. */
+    int swap_debug_dispatch_thread; /* dispatch all requests to one swap thread (-1 disabled). */
     int swap_debug_swapout_notify_delay_micro; /* sleep swap_debug_swapout_notify_delay microsencods
                                         to simulate notify queue blocked after swap out */
     int swap_debug_before_exec_swap_delay_micro; /* sleep swap_debug_before_exec_swap_delay microsencods before exec swap request */
@@ -1822,10 +1839,15 @@ struct redisServer {
     int swap_debug_rio_error; /* mock rio error */
     int swap_debug_rio_error_action;
     int swap_debug_trace_latency;
+    long long swap_async_complete_queue_budget_us; /* time budget per complete queue processing, 0 means unlimited. */
     int swap_debug_bgsave_metalen_addition;
     int swap_debug_compaction_filter_delay_micro;
     int swap_debug_rdb_key_save_delay_micro;
     int swap_rordb_load_incremental_fsync;
+    int swap_rio_pinned_multiget; /* multiget into pinned slices to avoid extra value copy. */
+    int swap_pipeline_lookahead; /* max num of pipelined commands to prefetch, 0 to disable. */
+    struct swapPrefetchCtx *swap_prefetch_ctx;
+    struct subkeyClocks *swap_subkey_clocks;
 
     /* repl swap */
     int repl_workers;   /* num of repl worker clients */
@@ -1869,10 +1891,14 @@ struct redisServer {
     struct swapScanSessions *swap_scan_sessions;
     int swap_scan_session_bits;
     int swap_scan_session_max_idle_seconds;
+    int swap_keys_cold_limit;
 
     /* rocksdb configs */
     unsigned long long rocksdb_meta_block_cache_size;
     unsigned long long rocksdb_data_block_cache_size;
+    int rocksdb_shared_block_cache; /* one block cache (capacity data+meta) shared by all cfs. */
+    int rocksdb_block_cache_type; /* lru or hyper_clock */
+    unsigned long long rocksdb_write_buffer_manager_size; /* limit of memtables of all cfs, 0 to disable. */
     int rocksdb_max_open_files;
     int rocksdb_WAL_ttl_seconds;
     int rocksdb_WAL_size_limit_MB;
@@ -1898,6 +1924,7 @@ struct redisServer {
     int rocksdb_data_max_bytes_for_level_multiplier;
     int rocksdb_meta_max_bytes_for_level_multiplier;
     int rocksdb_data_compaction_dynamic_level_bytes;
+    int rocksdb_data_prefix_extractor; /* data & score cf keys prefixed by (dbid,keylen,key,version). */
     int rocksdb_meta_compaction_dynamic_level_bytes;
     int rocksdb_data_suggest_compact_deletion_percentage;
     int rocksdb_meta_suggest_compact_deletion_percentage;
@@ -1955,10 +1982,14 @@ struct redisServer {
     int swap_absent_cache_include_subkey;
     unsigned long long swap_absent_cache_capacity;
 
+    /* warm tier */
+    unsigned long long swap_warm_tier_max_memory;
+
     /* cuckoo filter */
     int swap_cuckoo_filter_enabled;
     int swap_cuckoo_filter_bit_type;
     unsigned long long swap_cuckoo_filter_estimated_keys;
+    unsigned long long swap_subkey_filter_min_subkeys; /* 0: subkey filter disabled */
 
 #ifndef __APPLE__
     /* swap_cpu_usage */
@@ -1980,6 +2011,7 @@ struct redisServer {
 
     unsigned long long swap_compaction_filter_disable_until;
     int swap_compaction_filter_skip_level;
+    int swap_compaction_filter_meta_readahead; /* metas read ahead on filter cache miss, 0 to disable. */
 
     int swap_dirty_subkeys_enabled;
 
@@ -1992,19 +2024,30 @@ struct redisServer {
     int swap_ratelimit_persist_pause_growth_rate;
     uint64_t swap_persist_load_fix_version;
 
+    /* swap key encoding */
+    int swap_key_encoding_version; /* configured, used when creating data dir */
+    int swap_key_encoding; /* effective, decided by existing data dir */
+
     /* swap meta flush */
     int swap_flush_meta_deletes_percentage;
     unsigned long long swap_flush_meta_deletes_num;
 
+    /* swap rdb load */
+    int swap_rdb_load_ingest_enabled;
+    unsigned long long swap_rdb_load_ingest_run_size;
+
     /* swap rordb */
     int swap_repl_rordb_sync;
     unsigned long long swap_repl_rordb_max_write_bps;
+    int swap_repl_rordb_delta_sync;
+    dict *swap_repl_rordb_delta_ssts; /* ssts held by all replicas of current fullsync */
 
     client *swap_draining_master;
 
     /* ttl compact, only compact default CF */
     int swap_ttl_compact_enabled;
     unsigned int swap_ttl_compact_expire_percentile;
+    unsigned int swap_ttl_compact_expired_percentage; /* 0: select sst by age */
     unsigned long long swap_ttl_compact_period; /* seconds */
     unsigned long long swap_sst_age_limit_refresh_period; /* seconds */
     struct swapTtlCompactCtx *swap_ttl_compact_ctx;
@@ -2854,6 +2897,7 @@ void signalModifiedKey(client *c, redisDb *db, robj *key);
 void signalFlushedDb(int dbid, int async);
 unsigned int getKeysInSlot(unsigned int hashslot, robj **keys, unsigned int count);
 unsigned int countKeysInSlot(unsigned int hashslot);
+int verifyDumpPayload(unsigned char *p, size_t len);
 unsigned int delKeysInSlot(unsigned int hashslot);
 int verifyClusterConfigWithData(void);
 void scanGenericCommand(client *c, robj *o, unsigned long cursor);
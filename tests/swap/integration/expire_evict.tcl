@@ -140,3 +140,78 @@ start_server {tags {"swap string"}} {
     }
 } 
 
+
+start_server {tags {"perform eviction"}} {
+    r config set swap-debug-evict-keys 0
+
+    test {cost aware eviction prefers keys freeing more memory} {
+        r config set swap-evict-cost-aware yes
+        r config set maxmemory-policy allkeys-lru
+        for {set i 0} {$i < 500} {incr i} {
+            r set small-$i [string repeat x 64]
+            r set big-$i [string repeat x 8192]
+        }
+        # let all keys idle for a while so that lru scores are comparable
+        after 2000
+        set maxmemory [expr {[s used_memory]-1024*1024}]
+        r config set maxmemory $maxmemory
+        wait_for_condition 50 100 {
+            [s used_memory] < $maxmemory+512*1024
+        } else {
+            fail "eviction not performed"
+        }
+        r config set maxmemory 0
+
+        set small_cold 0
+        set big_cold 0
+        for {set i 0} {$i < 500} {incr i} {
+            incr small_cold [object_is_cold r small-$i]
+            incr big_cold [object_is_cold r big-$i]
+        }
+        # big keys free about 100x memory of small ones with same swap-in
+        # cost, so victims are almost all big keys.
+        assert {$big_cold >= 64}
+        assert {$small_cold*10 < $big_cold}
+
+        set efficiency [getInfoProperty [r info swap] swap_evict_efficiency]
+        assert {[regexp {cost_aware=1,freed_bytes=([0-9]+),rios=([0-9]+),bytes_per_rio=([0-9]+)} $efficiency -> freed rios per_rio]}
+        assert {$freed > 0}
+        if {$rios == 0} {assert_equal 0 $per_rio}
+        assert_equal [r get small-0] [string repeat x 64]
+        assert_equal [r get big-0] [string repeat x 8192]
+    }
+
+    test {cost aware eviction weights hash by actual field count} {
+        r flushdb
+        r config set swap-evict-cost-aware yes
+        r config set maxmemory-policy allkeys-lru
+        for {set i 0} {$i < 200} {incr i} {
+            r hset small-hash-$i f0 [string repeat x 64]
+            set fields {}
+            for {set j 0} {$j < 100} {incr j} {
+                lappend fields f$j [string repeat x 64]
+            }
+            r hset big-hash-$i {*}$fields
+        }
+        after 2000
+        set maxmemory [expr {[s used_memory]-1024*1024}]
+        r config set maxmemory $maxmemory
+        wait_for_condition 50 100 {
+            [s used_memory] < $maxmemory+512*1024
+        } else {
+            fail "eviction not performed"
+        }
+        r config set maxmemory 0
+
+        set small_cold 0
+        set big_cold 0
+        for {set i 0} {$i < 200} {incr i} {
+            incr small_cold [object_is_cold r small-hash-$i]
+            incr big_cold [object_is_cold r big-hash-$i]
+        }
+        assert {$big_cold > 0}
+        assert {$small_cold*10 < $big_cold}
+        assert_equal [r hlen big-hash-0] 100
+        r config set swap-evict-cost-aware no
+    }
+}
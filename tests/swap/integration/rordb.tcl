@@ -141,3 +141,45 @@ start_server {tags {"rordb replication"} overrides {}} {
     }
 }
 
+
+start_server {tags {"rordb replication"} overrides {}} {
+    start_server {overrides {}} {
+        set master [srv -1 client]
+        set master_host [srv -1 host]
+        set master_port [srv -1 port]
+        set slave [srv 0 client]
+
+        $master config set swap-debug-evict-keys 0; # evict manually
+        $master config set repl-diskless-sync yes
+        $master config set repl-diskless-sync-delay 0
+        $master config set swap-repl-rordb-delta-sync yes
+        $slave config set swap-repl-rordb-delta-sync yes
+
+        test {delta rordb fullsync reuses ssts held by replica} {
+            for {set i 0} {$i < 100} {incr i} {
+                $master hmset myhash$i a a b b c c
+                $master swap.evict myhash$i
+            }
+            $master set mystring0 myval0
+
+            $slave slaveof $master_host $master_port
+            wait_for_sync $slave
+            assert_equal [$slave dbsize] 101
+
+            # force fullsync again, ssts got by last fullsync are reused.
+            $slave slaveof no one
+            $master debug change-repl-id
+            $master set mystring1 myval1
+            set loglines [count_log_lines -1]
+            $slave slaveof $master_host $master_port
+            wait_for_sync $slave
+            wait_for_log_messages -1 {"*save sst files in*reused [1-9]*"} $loglines 100 100
+
+            assert_equal [$slave dbsize] 102
+            assert_equal [$slave get mystring1] myval1
+            for {set i 0} {$i < 100} {incr i} {
+                assert_equal [$slave hmget myhash$i a b c] {a b c}
+            }
+        }
+    }
+}
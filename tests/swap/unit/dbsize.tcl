@@ -90,4 +90,40 @@ test "dbsize" {
             assert_equal [r dbsize] 1
         }
     }
+
+    start_server {tags {"dbsize keys"}} {
+        r config set swap-debug-evict-keys 0
+        test "keys includes cold keys and agrees with dbsize" {
+            r mset order:1 a order:2 b user:1 c
+            r hset order:h f v
+            r swap.evict order:1 user:1 order:h
+            wait_key_cold r order:1
+            wait_key_cold r user:1
+            wait_key_cold r order:h
+
+            assert_equal [lsort [r keys *]] {order:1 order:2 order:h user:1}
+            assert_equal [lsort [r keys order:*]] {order:1 order:2 order:h}
+            assert_equal [r keys user:?] {user:1}
+            assert_equal [llength [r keys *]] [r dbsize]
+            # keys does not swap values in
+            assert [object_is_cold r order:1]
+
+            r pexpire user:1 1
+            after 10
+            assert_equal [lsort [r keys *]] {order:1 order:2 order:h}
+        }
+
+        test "keys cold limit and keys in multi" {
+            # limit applies to matched cold keys only
+            r config set swap-keys-cold-limit 2
+            assert_equal [lsort [r keys order:*]] {order:1 order:2 order:h}
+            r config set swap-keys-cold-limit 1
+            assert_error "*swap-keys-cold-limit*" {r keys order:*}
+            r config set swap-keys-cold-limit 100000
+
+            r multi
+            r keys order:*
+            assert_error "*not supported in multi*" {r exec}
+        }
+    }
 }
@@ -0,0 +1,44 @@
+start_server {tags {"swap expire index"}
+    overrides {swap-debug-evict-keys {0}
+               swap-expire-index-enabled {yes}}} {
+
+    test {cold keys actively expired by expire index} {
+        for {set i 0} {$i < 20} {incr i} {
+            r psetex volatile$i 200 v$i
+            r set persist$i v$i
+        }
+        for {set i 0} {$i < 20} {incr i} {
+            r swap.evict volatile$i persist$i
+        }
+        for {set i 0} {$i < 20} {incr i} {
+            wait_key_cold r volatile$i
+            wait_key_cold r persist$i
+        }
+        assert_equal [getInfoProperty [r info swap.scanexpire] swap_scan_expire_index_enabled] 1
+        wait_for_condition 50 100 {
+            [r dbsize] == 20
+        } else {
+            fail "cold keys not expired by expire index"
+        }
+        assert_equal [r get persist0] v0
+        r flushdb
+    }
+
+    test {stale expire index entry dropped} {
+        set stale [getInfoProperty [r info swap.scanexpire] swap_scan_expire_index_stale_count]
+        r psetex foo 300 bar
+        r swap.evict foo
+        wait_key_cold r foo
+        # expire of cold key removed, index entry becomes stale
+        assert_equal [r persist foo] 1
+        r swap.evict foo
+        wait_key_cold r foo
+        wait_for_condition 50 100 {
+            [getInfoProperty [r info swap.scanexpire] swap_scan_expire_index_stale_count] > $stale
+        } else {
+            fail "stale expire index entry not dropped"
+        }
+        assert_equal [r get foo] bar
+        assert_equal [r ttl foo] -1
+    }
+}
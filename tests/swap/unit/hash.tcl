@@ -353,3 +353,57 @@ test {two big hash check reload1} {
     }
 }
 
+
+start_server {tags {"swap subkey clock"}} {
+    r config set swap-debug-evict-keys 0
+    r config set swap-evict-subkey-clock yes
+
+    test {subkey clock keeps recently accessed fields in memory} {
+        for {set i 0} {$i < 200} {incr i} {
+            r hset clockhash f$i v$i
+        }
+        r swap.evict clockhash
+        wait_key_cold r clockhash
+
+        for {set i 0} {$i < 100} {incr i} {
+            assert_equal [r hget clockhash f$i] v$i
+        }
+        set str [r swap object clockhash]
+        assert_equal [swap_object_property $str subkey_clock hits] 0
+        assert_equal [swap_object_property $str subkey_clock misses] 100
+
+        # all fields swapped in just now get a second chance
+        r swap.evict clockhash
+        after 100
+        assert {[get_info_property r swap swap_subkey_clock second_chances] >= 100}
+
+        for {set i 0} {$i < 10} {incr i} {
+            assert_equal [r hget clockhash f$i] v$i
+        }
+        r swap.evict clockhash
+        after 100
+
+        # fields accessed again survived, others evicted
+        for {set i 0} {$i < 10} {incr i} {
+            assert_equal [r hget clockhash f$i] v$i
+        }
+        for {set i 10} {$i < 100} {incr i} {
+            assert_equal [r hget clockhash f$i] v$i
+        }
+        set str [r swap object clockhash]
+        assert_equal [swap_object_property $str subkey_clock hits] 20
+        assert {[swap_object_property $str subkey_clock misses] > 150}
+        assert_equal [r hlen clockhash] 200
+    }
+
+    test {subkey clock not touched by hdel} {
+        for {set i 0} {$i < 10} {incr i} {
+            r hset clockdel f$i v$i
+        }
+        r swap.evict clockdel
+        wait_key_cold r clockdel
+        assert_equal [r hdel clockdel f0 f1] 2
+        # no clock created for deleted fields
+        assert {![string match *subkey_clock* [r swap object clockdel]]}
+    }
+}
@@ -7,3 +7,219 @@ start_server {} {
     }
 
 }
+
+start_server {} {
+    r config set swap-debug-evict-keys 0
+
+    test {rio get copied bytes reported for pinned and copied multiget} {
+        r swap.debug reset-stats
+        r set foo [string repeat x 1024]
+        r swap.evict foo
+        wait_key_cold r foo
+        r config set swap-rio-pinned-multiget no
+        assert_equal [string length [r get foo]] 1024
+        set copy [getInfoProperty [r info swap] swap_rio_get_copy]
+        assert_match {pinned=0,*} $copy
+        assert {[regexp {copied_bytes=([0-9]+)} $copy -> unpinned_bytes]}
+        assert {$unpinned_bytes >= 2048}
+
+        r swap.debug reset-stats
+        r swap.evict foo
+        wait_key_cold r foo
+        r config set swap-rio-pinned-multiget yes
+        assert_equal [string length [r get foo]] 1024
+        set copy [getInfoProperty [r info swap] swap_rio_get_copy]
+        assert_match {pinned=1,*} $copy
+        assert {[regexp {copied_bytes=([0-9]+)} $copy -> pinned_bytes]}
+        assert {$pinned_bytes >= 1024 && $pinned_bytes < $unpinned_bytes}
+    }
+}
+
+start_server {} {
+    r config set swap-debug-evict-keys 0
+
+    test {swap thread queue depth and steals reported} {
+        foreach stealing {no yes} {
+            r config set swap-threads-work-stealing $stealing
+            r swap.debug reset-stats
+            for {set i 0} {$i < 200} {incr i} {
+                r hset h$i f1 v1 f2 v2
+                r swap.evict h$i
+            }
+            for {set i 0} {$i < 200} {incr i} {
+                wait_key_cold r h$i
+                assert_equal [r hget h$i f2] v2
+            }
+            set info [r info swap]
+            assert_equal [getInfoProperty $info swap_thread_queue_depth] 0
+            assert {[getInfoProperty $info swap_thread_queue_depth_max] >= 0}
+            assert {[getInfoProperty $info swap_thread_steals] >= 0}
+            assert_equal [getInfoProperty $info swap_thread_ring_overflows] 0
+            if {$stealing eq {no}} {
+                assert_equal [getInfoProperty $info swap_thread_steals] 0
+            }
+        }
+    }
+
+    test {idle swap threads steal from overloaded one} {
+        r config set swap-threads-work-stealing yes
+        r config set swap-debug-dispatch-thread 0
+        r config set swap-debug-rio-delay-micro 2000
+        r swap.debug reset-stats
+        for {set i 0} {$i < 200} {incr i} {
+            r hset steal_h$i f1 v1
+            r swap.evict steal_h$i
+        }
+        for {set i 0} {$i < 200} {incr i} {
+            wait_key_cold r steal_h$i
+        }
+        r config set swap-debug-rio-delay-micro 0
+        r config set swap-debug-dispatch-thread -1
+        assert {[getInfoProperty [r info swap] swap_thread_steals] > 0}
+        for {set i 0} {$i < 200} {incr i} {
+            assert_equal [r hget steal_h$i f1] v1
+        }
+    }
+
+    test {swap thread priority classes reported} {
+        r swap.debug reset-stats
+        for {set i 0} {$i < 50} {incr i} {
+            r hset prio_h$i f1 v1
+            r swap.evict prio_h$i
+        }
+        for {set i 0} {$i < 50} {incr i} {
+            wait_key_cold r prio_h$i
+            assert_equal [r hget prio_h$i f1] v1
+        }
+        set info [r info swap]
+        assert {[regexp {batches=([0-9]+)} [getInfoProperty $info swap_thread_priority_high] -> high_batches]}
+        assert {[regexp {batches=([0-9]+)} [getInfoProperty $info swap_thread_priority_low] -> low_batches]}
+        assert {$high_batches > 0}
+        assert {$low_batches > 0}
+        assert_match {queue_depth=0,*} [getInfoProperty $info swap_thread_priority_normal]
+    }
+
+    test {swap async complete notifies coalesced} {
+        r swap.debug reset-stats
+        set rd [redis_deferring_client]
+        for {set i 0} {$i < 200} {incr i} {
+            r hset h$i f1 v1 f2 v2
+            r swap.evict h$i
+        }
+        for {set i 0} {$i < 200} {incr i} {
+            wait_key_cold r h$i
+        }
+        for {set i 0} {$i < 200} {incr i} {
+            $rd hget h$i f1
+        }
+        for {set i 0} {$i < 200} {incr i} {
+            assert_equal [$rd read] v1
+        }
+        $rd close
+        set complete [getInfoProperty [r info swap] swap_async_complete]
+        assert {[regexp {notifies=([0-9]+),wakeups=([0-9]+),processed=([0-9]+),budget_exceeded=([0-9]+)} $complete -> notifies wakeups processed exceeded]}
+        assert {$processed > 0}
+        assert {$notifies <= $processed + $exceeded}
+    }
+
+    test {swap pipeline lookahead prefetch} {
+        r config set swap-pipeline-lookahead 16
+        r swap.debug reset-stats
+        for {set i 0} {$i < 100} {incr i} {
+            r set pk$i v$i
+            r swap.evict pk$i
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            wait_key_cold r pk$i
+        }
+        set rd [redis_deferring_client]
+        set buf {}
+        for {set i 0} {$i < 100} {incr i} {
+            append buf "*2\r\n\$3\r\nget\r\n\$[string length pk$i]\r\npk$i\r\n"
+        }
+        $rd write $buf
+        $rd flush
+        for {set i 0} {$i < 100} {incr i} {
+            assert_equal [$rd read] v$i
+        }
+        $rd close
+        set prefetch [getInfoProperty [r info swap] swap_pipeline_prefetch]
+        assert {[regexp {lookahead=16,cmds=([0-9]+),keys=([0-9]+),errors=0,inprogress=0} $prefetch -> cmds keys]}
+        assert {$keys > 0}
+        assert {$keys >= $cmds}
+    }
+}
+
+start_server {overrides {rocksdb.shared_block_cache yes rocksdb.write_buffer_manager_size 64mb}} {
+    r config set swap-debug-evict-keys 0
+
+    test {shared block cache memory reported} {
+        for {set i 0} {$i < 100} {incr i} {
+            r hset sh$i f1 v1 f2 v2
+            r swap.evict sh$i
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            wait_key_cold r sh$i
+        }
+        for {set i 0} {$i < 100} {incr i} {
+            assert_equal [r hget sh$i f1] v1
+        }
+        wait_for_condition 50 100 {
+            [getInfoProperty [r info swap] swap_rocksdb_memory_used] > 0
+        } else {
+            fail "rocksdb memory not reported"
+        }
+        r config set swap-maxmemory-include-rocksdb yes
+        assert_equal [lindex [r config get swap-maxmemory-include-rocksdb] 1] yes
+        r config set swap-maxmemory-include-rocksdb no
+    }
+}
+
+start_server {overrides {swap-warm-tier-max-memory 1mb}} {
+    r config set swap-debug-evict-keys 0
+
+    test {warm tier serves evicted string without rocksdb read} {
+        set val [string repeat warm-tier-value 64]
+        for {set i 0} {$i < 10} {incr i} {
+            r set wk$i $val$i
+            r swap.evict wk$i
+        }
+        for {set i 0} {$i < 10} {incr i} {
+            wait_key_cold r wk$i
+        }
+        set warm [getInfoProperty [r info swap] swap_warm_tier]
+        assert {[regexp {keys=10,puts=10,} $warm]}
+
+        for {set i 0} {$i < 10} {incr i} {
+            assert_equal [r get wk$i] $val$i
+            assert [object_is_hot r wk$i]
+        }
+        assert_equal [getInfoProperty [r info swap] swap_swapin_warm_tier_hit_count] 10
+
+        # deleted cold key is dropped from warm tier
+        r swap.evict wk0
+        wait_key_cold r wk0
+        r del wk0
+        assert_equal [r get wk0] {}
+
+        # non-string keys are never cached, not counted as miss
+        r swap.debug reset-stats
+        r hset wh f v
+        r swap.evict wh
+        wait_key_cold r wh
+        assert_equal [r hget wh f] v
+        assert_equal [getInfoProperty [r info swap] swap_swapin_warm_tier_miss_count] 0
+
+        # string bigger than tier could never be cached either, but the
+        # tier can't tell it from an evicted one, so it is a miss
+        r set wbig [string repeat x [expr 2*1024*1024]]
+        r swap.evict wbig
+        wait_key_cold r wbig
+        assert_equal [r strlen wbig] [expr 2*1024*1024]
+        assert_equal [getInfoProperty [r info swap] swap_swapin_warm_tier_miss_count] 1
+
+        r config set swap-warm-tier-max-memory 0
+        set warm [getInfoProperty [r info swap] swap_warm_tier]
+        assert {[regexp {used_memory=0,keys=0,} $warm]}
+    }
+}
@@ -0,0 +1,45 @@
+start_server {tags {"swap rdb load ingest"}
+    overrides {swap-debug-evict-keys {0}
+               swap-rdb-load-ingest-enabled {yes}
+               swap-rdb-load-ingest-run-size {1mb}}} {
+
+    test {debug reload loads cold keys by ingest} {
+        set val [string repeat x 1024]
+        for {set i 0} {$i < 2000} {incr i} {
+            r set str$i $val
+        }
+        for {set i 0} {$i < 10} {incr i} {
+            for {set j 0} {$j < 200} {incr j} {
+                r hset hash$i f$j $val
+            }
+            r zadd zset$i 1 a 2 b 3 c
+            r sadd set$i m1 m2 m3
+        }
+        r pexpire str0 1000000
+        r debug reload
+
+        assert_equal [r dbsize] 2030
+        for {set i 0} {$i < 2000} {incr i 97} {
+            assert_equal [r get str$i] $val
+        }
+        for {set i 0} {$i < 10} {incr i} {
+            assert_equal [r hlen hash$i] 200
+            assert_equal [r hget hash$i f199] $val
+            assert_equal [r zrange zset$i 0 -1] {a b c}
+            assert_equal [lsort [r smembers set$i]] {m1 m2 m3}
+        }
+        assert_range [r pttl str0] 1 1000000
+    }
+
+    test {keys loaded by ingest are writable} {
+        r debug reload
+        r set str1 newval
+        r hdel hash1 f0
+        r swap.evict str1 hash1
+        wait_key_cold r str1
+        wait_key_cold r hash1
+        assert_equal [r get str1] newval
+        assert_equal [r hlen hash1] 199
+        r flushdb
+    }
+}
@@ -48,6 +48,28 @@ start_server {tags "metascan"} {
 
     }
 
+    test {scan cold keys with match and type} {
+        r mset order:1 a order:2 b user:1 c
+        r hset order:h f v
+        r swap.evict order:1 order:2 user:1 order:h
+        wait_key_cold r order:1
+        wait_key_cold r order:2
+        wait_key_cold r user:1
+        wait_key_cold r order:h
+
+        set keys {}
+        set cursor 0
+        while 1 {
+            set res [r scan $cursor match order:* type string count 1]
+            set cursor [lindex $res 0]
+            lappend keys {*}[lindex $res 1]
+            if {$cursor == 0} break
+        }
+        assert_equal [lsort $keys] {order:1 order:2}
+
+        r del order:1 order:2 user:1 order:h
+    }
+
     test {randomkey in multi} {
         r set key val
         r swap.evict key
@@ -0,0 +1,52 @@
+start_server {tags {"swap migrate slot"} overrides {swap-key-encoding-version 3}} {
+    start_server {overrides {swap-key-encoding-version 3}} {
+        set src [srv -1 client]
+        set dst [srv 0 client]
+        set dst_host [srv 0 host]
+        set dst_port [srv 0 port]
+        set slot 15891 ;# keyslot of {t}
+
+        test {swap.migrateslot moves cold keys of slot} {
+            $src flushdb
+            $dst flushdb
+            for {set i 0} {$i < 10} {incr i} {
+                $src set "{t}s$i" v$i
+                $src hset "{t}h$i" f1 v1 f2 v2
+            }
+            $src set "{t}hot" hot
+            $src set other v
+            for {set i 0} {$i < 10} {incr i} {
+                $src swap.evict "{t}s$i" "{t}h$i"
+                wait_key_cold $src "{t}s$i"
+                wait_key_cold $src "{t}h$i"
+            }
+            $src swap.evict other
+            wait_key_cold $src other
+
+            set moved 0
+            while {[set n [$src swap.migrateslot $dst_host $dst_port $slot 3 5000]] > 0} {
+                assert {$n <= 3}
+                incr moved $n
+            }
+            assert_equal 20 $moved
+            assert_equal 2 [$src dbsize]
+            assert_equal hot [$src get "{t}hot"]
+            assert_equal v [$src get other]
+            assert_equal 20 [$dst dbsize]
+            for {set i 0} {$i < 10} {incr i} {
+                assert_equal {} [$src get "{t}s$i"]
+                assert_equal v$i [$dst get "{t}s$i"]
+                assert_equal {f1 v1 f2 v2} [$dst hgetall "{t}h$i"]
+            }
+        }
+
+        test {swap.restoreslot refuses existing keys} {
+            $src set "{t}s0" v0
+            $src swap.evict "{t}s0"
+            wait_key_cold $src "{t}s0"
+            catch {$src swap.migrateslot $dst_host $dst_port $slot 10 5000} e
+            assert_match {*BUSYKEY*} $e
+            assert_equal v0 [$src get "{t}s0"]
+        }
+    }
+}
@@ -0,0 +1,101 @@
+start_server {tags {"swap pushdown"}} {
+    r config set swap-debug-evict-keys 0
+    # no random promotion, keys stay cold unless tested otherwise.
+    r config set swap-pushdown-promote-hits 0
+
+    proc pushdown_count {} {
+        getInfoProperty [r info swap] swap_swapin_pushdown_count
+    }
+
+    test {pushdown disabled swaps in cold key} {
+        r config set swap-pushdown-enabled no
+        r sadd s1 a b c
+        r swap.evict s1
+        wait_key_cold r s1
+        set count [pushdown_count]
+        assert_equal [r sismember s1 a] 1
+        assert ![object_is_cold r s1]
+        assert_equal [pushdown_count] $count
+    }
+
+    r config set swap-pushdown-enabled yes
+
+    test {pushdown set commands keep key cold} {
+        r sadd s2 a b c
+        r swap.evict s2
+        wait_key_cold r s2
+        set count [pushdown_count]
+        assert_equal [r sismember s2 a] 1
+        assert_equal [r sismember s2 x] 0
+        assert_equal [r smismember s2 a x c] {1 0 1}
+        assert [object_is_cold r s2]
+        assert {[pushdown_count] > $count}
+        assert_equal [r scard s2] 3
+    }
+
+    test {pushdown hash commands keep key cold} {
+        r hset h1 f1 v1 f2 value2
+        r swap.evict h1
+        wait_key_cold r h1
+        set count [pushdown_count]
+        assert_equal [r hexists h1 f1] 1
+        assert_equal [r hexists h1 fx] 0
+        assert_equal [r hstrlen h1 f2] 6
+        assert_equal [r hstrlen h1 fx] 0
+        assert [object_is_cold r h1]
+        assert {[pushdown_count] > $count}
+        assert_equal [r hget h1 f1] v1
+    }
+
+    test {pushdown zset commands keep key cold} {
+        r zadd z1 1 a 2 b 3 c
+        r swap.evict z1
+        wait_key_cold r z1
+        set count [pushdown_count]
+        assert_equal [r zcount z1 1 2] 2
+        assert_equal [r zcount z1 5 6] 0
+        assert_equal [r zlexcount z1 - +] 3
+        assert [object_is_cold r z1]
+        assert {[pushdown_count] > $count}
+    }
+
+    test {pushdown zcount reads score range only} {
+        r zadd z2 1 a 2 b 3 c 4 d
+        r swap.evict z2
+        wait_key_cold r z2
+        assert_equal [r zcount z2 2 3] 2
+        assert_equal [r zcount z2 (1 +inf] 3
+        assert [object_is_cold r z2]
+    }
+
+    test {pushdown promotes key after hits} {
+        r sadd s4 a b
+        r swap.evict s4
+        wait_key_cold r s4
+        r config set swap-pushdown-promote-hits 1
+        assert_equal [r sismember s4 a] 1
+        assert ![object_is_cold r s4]
+        r config set swap-pushdown-promote-hits 0
+    }
+
+    test {pushdown wrong type and not exist key} {
+        r set str v
+        r swap.evict str
+        wait_key_cold r str
+        assert_error {*WRONGTYPE*} {r sismember str a}
+        assert_equal [r sismember notexist a] 0
+        assert_equal [r hexists notexist f] 0
+    }
+
+    test {pushdown skipped in multi} {
+        r sadd s3 a b
+        r swap.evict s3
+        wait_key_cold r s3
+        r multi
+        r sismember s3 a
+        assert_equal [r exec] 1
+        assert ![object_is_cold r s3]
+    }
+
+    r config set swap-pushdown-enabled no
+}
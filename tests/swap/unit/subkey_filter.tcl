@@ -0,0 +1,73 @@
+start_server {tags {"swap subkey filter"}} {
+    r config set swap-debug-evict-keys 0
+    r config set swap-subkey-filter-min-subkeys 4
+
+    proc subkey_filter_filt_count {} {
+        getInfoProperty [r info swap] swap_subkey_filter_filt_count
+    }
+
+    test {subkey filter answers absent fields of cold hash} {
+        for {set i 0} {$i < 10} {incr i} {
+            r hset h1 f$i v$i
+        }
+        r swap.evict h1
+        wait_key_cold r h1
+        set count [subkey_filter_filt_count]
+        assert_equal [r hget h1 notexist] {}
+        assert_equal [r hexists h1 notexist] 0
+        assert [object_is_cold r h1]
+        assert {[subkey_filter_filt_count] > $count}
+        assert_equal [r hget h1 f3] v3
+    }
+
+    test {subkey filter answers absent members of cold set} {
+        for {set i 0} {$i < 10} {incr i} {
+            r sadd s1 m$i
+        }
+        r swap.evict s1
+        wait_key_cold r s1
+        set count [subkey_filter_filt_count]
+        assert_equal [r sismember s1 notexist] 0
+        assert [object_is_cold r s1]
+        assert {[subkey_filter_filt_count] > $count}
+        assert_equal [r sismember s1 m5] 1
+    }
+
+    test {subkey filter keeps subkeys swapped out later} {
+        r hset h1 new1 nv1
+        r swap.evict h1
+        wait_key_cold r h1
+        assert_equal [r hget h1 new1] nv1
+        assert_equal [r hlen h1] 11
+    }
+
+    test {write absent field of cold hash swaps in key} {
+        r swap.evict h1
+        wait_key_cold r h1
+        r hset h1 new2 nv2
+        assert_equal [r hlen h1] 12
+        assert_equal [r hget h1 f0] v0
+    }
+
+    test {small keys have no subkey filter} {
+        r hset h2 f1 v1
+        r swap.evict h2
+        wait_key_cold r h2
+        set count [subkey_filter_filt_count]
+        assert_equal [r hget h2 notexist] {}
+        assert_equal [subkey_filter_filt_count] $count
+    }
+
+    test {subkey filter dropped with key} {
+        r del h1
+        for {set i 0} {$i < 10} {incr i} {
+            r hset h1 g$i v$i
+        }
+        r swap.evict h1
+        wait_key_cold r h1
+        assert_equal [r hget h1 f0] {}
+        assert_equal [r hget h1 g0] v0
+    }
+
+    r config set swap-subkey-filter-min-subkeys 0
+}
@@ -324,3 +324,25 @@ start_server {tags {"ttl-compact master propagate"} overrides {save ""}} {
         }
     }
 }
+
+start_server {tags {"ttl-compact"}
+    overrides {swap-debug-evict-keys {0}
+               swap-expire-index-enabled {yes}
+               swap-ttl-compact-period {1}
+               swap-sst-age-limit-refresh-period {1}
+               swap-swap-info-slave-period {1}}}  {
+    test {ttl compact samples expire on swap out with expire index} {
+        for {set j 0} { $j < 100} {incr j} {
+            r set key-$j val
+            r pexpire key-$j 1000000
+            r swap.evict key-$j
+            wait_key_cold r key-$j
+        }
+
+        # more than swap-sst-age-limit-refresh-period
+        after 1200
+
+        set sst_age_limit [get_info_property r Swap swap_ttl_compact sst_age_limit]
+        assert_range $sst_age_limit 900000 1000000
+    }
+}
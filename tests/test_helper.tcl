@@ -58,6 +58,10 @@ set ::disk_tests {
     swap/unit/zset
     swap/unit/bitmap
     swap/unit/geo
+    swap/unit/pushdown
+    swap/unit/subkey_filter
+    swap/unit/expire_index
+    swap/unit/ingest_load
     swap/unit/big_hash
     swap/unit/big_set
     swap/unit/latency-monitor
@@ -72,6 +76,7 @@ set ::disk_tests {
     swap/unit/slowlog
     swap/unit/scripting
     swap/unit/ttl_compact
+    swap/unit/migrate_slot
     swap/unit/swap_info
     unit/shutdown
     gtid/gtid